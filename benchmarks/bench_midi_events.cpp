@@ -0,0 +1,103 @@
+// Memory and scan throughput of the MIDI schedule's event storage: the old layout, a juce::MidiMessage, a
+// sample position and a key per event, against MidiScheduler::EventColumns, 16 bytes an event with sample
+// positions and message bytes in separate columns. Built by the bench_midi_events target
+// (cmake -DBUILD_BENCHMARKS=ON):
+//
+//   bench_midi_events [events=10000000]
+#include <chrono>
+#include <cstdlib>
+
+#define JUCE_ENGINE_MODULE 1
+#include "juce_gui_server.cpp"
+
+namespace
+{
+  const int benchBlock = 512;
+
+  struct OldEvent
+  {
+    juce::MidiMessage message;
+    int64_t samplePosition;
+    int key;
+  };
+
+  template <typename Pass>
+  double timeMs(Pass pass)
+  {
+    auto start = chrono::steady_clock::now();
+    pass();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  }
+
+  void report(const char* name, size_t bytes, size_t numEvents, double scanMs, double renderMs)
+  {
+    cout << name << double(bytes) / (1024 * 1024) << " MB (" << double(bytes) / double(numEvents) << " bytes an event), "
+         << "scan " << double(numEvents) / scanMs / 1000 << " M events/s, "
+         << "render " << double(numEvents) / renderMs / 1000 << " M events/s" << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  size_t numEvents = argc > 1 ? size_t(atoll(argv[1])) : 10000000;
+
+  // A dense generative piece on one lane: a note on or off every 4 samples on average
+  vector<OldEvent> oldEvents;
+  oldEvents.reserve(numEvents);
+  MidiScheduler::EventColumns columns;
+  columns.reserve(numEvents);
+  juce::Random random(1234);
+  int64_t position = 0;
+  for (size_t i = 0; i < numEvents; ++i)
+  {
+    position += random.nextInt(8);
+    auto message = i % 2 == 0 ? juce::MidiMessage::noteOn(1, 36 + random.nextInt(48), uint8_t(100))
+                               : juce::MidiMessage::noteOff(1, 36 + random.nextInt(48));
+    oldEvents.push_back({ message, position, 0 });
+    columns.append(position, MidiScheduler::toMidiBytes(message, columns.sysex), columns.sysex);
+  }
+  int64_t end = position + 1;
+  cout << numEvents << " events over " << end << " samples" << endl;
+
+  // Scan: what a cursor does, reading every event's time and counting the note ons
+  size_t oldNoteOns = 0, newNoteOns = 0;
+  double oldScan = timeMs([&] {
+    for (const auto& event : oldEvents)
+      if (event.samplePosition < end && event.message.isNoteOn())
+        oldNoteOns++;
+  });
+  double newScan = timeMs([&] {
+    for (size_t i = 0; i < columns.size(); ++i)
+      if (columns.samplePositions[i] < end && (columns.messages[i].data[0] & 0xf0) == 0x90 && columns.messages[i].data[2] != 0)
+        newNoteOns++;
+  });
+
+  // Render: block by block into a MidiBuffer, as a MidiSourceNode does
+  juce::MidiBuffer buffer;
+  size_t oldDelivered = 0, newDelivered = 0;
+  double oldRender = timeMs([&] {
+    size_t i = 0;
+    for (int64_t blockStart = 0; blockStart < end; blockStart += benchBlock)
+    {
+      buffer.clear();
+      for (; i < oldEvents.size() && oldEvents[i].samplePosition < blockStart + benchBlock; ++i)
+        buffer.addEvent(oldEvents[i].message, int(oldEvents[i].samplePosition - blockStart));
+      oldDelivered += size_t(buffer.getNumEvents());
+    }
+  });
+  double newRender = timeMs([&] {
+    size_t i = 0;
+    for (int64_t blockStart = 0; blockStart < end; blockStart += benchBlock)
+    {
+      buffer.clear();
+      for (; i < columns.size() && columns.samplePositions[i] < blockStart + benchBlock; ++i)
+        columns.addToBuffer(i, buffer, int(columns.samplePositions[i] - blockStart));
+      newDelivered += size_t(buffer.getNumEvents());
+    }
+  });
+
+  report("MidiMessage events: ", oldEvents.capacity() * sizeof(OldEvent), numEvents, oldScan, oldRender);
+  report("16-byte columns:    ", columns.samplePositions.capacity() * sizeof(int64_t)
+    + columns.messages.capacity() * sizeof(MidiScheduler::MidiBytes) + columns.sysex.capacity(), numEvents, newScan, newRender);
+  return oldNoteOns == newNoteOns && oldDelivered == newDelivered ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// Per-block cost of handing scheduled MIDI to the MIDI source nodes with many instrument tracks: the old flat
+// schedule, where every node scans every event in the block for its own key, against MidiScheduler's
+// per-key lanes. Built by the bench_midi_lanes target (cmake -DBUILD_BENCHMARKS=ON):
+//
+//   bench_midi_lanes [tracks=300] [seconds=120] [notes per second per track=8]
+#include <chrono>
+#include <cstdlib>
+
+#define JUCE_ENGINE_MODULE 1
+#include "juce_gui_server.cpp"
+
+namespace
+{
+  const int benchRate = 48000;
+  const int benchBlock = 512;
+
+  // The schedule as it was before lanes: one sorted vector for every key, scanned from nextEventIndex by
+  // each node for its own events, then skipped past once the block is done
+  struct FlatSchedule
+  {
+    struct Event
+    {
+      juce::MidiMessage message;
+      int64_t samplePosition;
+      int key;
+    };
+    vector<Event> events;
+    size_t nextEventIndex = 0;
+    int64_t currentSamplePosition = 0;
+
+    void getEventsForPlugin(int key, juce::MidiBuffer& buffer, int numSamples)
+    {
+      buffer.clear();
+      int64_t blockEnd = currentSamplePosition + numSamples;
+      for (size_t index = nextEventIndex; index < events.size(); ++index)
+      {
+        const auto& event = events[index];
+        if (event.samplePosition >= blockEnd)
+          break;
+        if (event.key == key && event.samplePosition >= currentSamplePosition)
+          buffer.addEvent(event.message, static_cast<int>(event.samplePosition - currentSamplePosition));
+      }
+    }
+
+    void advance(int numSamples)
+    {
+      currentSamplePosition += numSamples;
+      while (nextEventIndex < events.size() && events[nextEventIndex].samplePosition < currentSamplePosition)
+        nextEventIndex++;
+    }
+  };
+
+  // Random notes on every track, as the records a client would send with schedule_midi_events_bulk
+  vector<MidiEventRecord> makeSong(int tracks, int seconds, int notesPerSecond)
+  {
+    vector<MidiEventRecord> records;
+    juce::Random random(1234);
+    int64_t length = int64_t(seconds) * benchRate;
+    for (int track = 0; track < tracks; ++track)
+    {
+      for (int64_t i = 0; i < int64_t(seconds) * notesPerSecond; ++i)
+      {
+        int64_t start = random.nextInt64() % length;
+        if (start < 0)
+          start += length;
+        uint8_t note = uint8_t(36 + random.nextInt(48));
+        records.push_back({ track, 0x90, note, 100, start });
+        records.push_back({ track, 0x80, note, 0, start + benchRate / 8 });
+      }
+    }
+    return records;
+  }
+
+  template <typename Render>
+  double timeBlocks(int64_t numBlocks, Render render)
+  {
+    auto start = chrono::steady_clock::now();
+    for (int64_t block = 0; block < numBlocks; ++block)
+      render();
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / double(numBlocks);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int tracks = argc > 1 ? atoi(argv[1]) : 300;
+  int seconds = argc > 2 ? atoi(argv[2]) : 120;
+  int notesPerSecond = argc > 3 ? atoi(argv[3]) : 8;
+  auto records = makeSong(tracks, seconds, notesPerSecond);
+  int64_t numBlocks = int64_t(seconds) * benchRate / benchBlock;
+  cout << tracks << " tracks, " << records.size() << " events, " << numBlocks << " blocks of " << benchBlock << endl;
+
+  juce::MidiBuffer buffer;
+
+  FlatSchedule flat;
+  for (const auto& r : records)
+    flat.events.push_back({ juce::MidiMessage(r.status, r.data1, r.data2), r.sampleTime, r.key });
+  stable_sort(flat.events.begin(), flat.events.end(),
+    [](const auto& a, const auto& b) { return a.samplePosition < b.samplePosition; });
+  size_t flatEvents = 0;
+  double flatMicros = timeBlocks(numBlocks, [&] {
+    for (int key = 0; key < tracks; ++key)
+    {
+      flat.getEventsForPlugin(key, buffer, benchBlock);
+      flatEvents += size_t(buffer.getNumEvents());
+    }
+    flat.advance(benchBlock);
+  });
+
+  MidiScheduler lanes(benchRate);
+  lanes.setBlockSize(benchBlock);
+  auto compileStart = chrono::steady_clock::now();
+  lanes.scheduleEventsBulk(records.data(), records.size());
+  lanes.sync();
+  double compileMs = chrono::duration<double, milli>(chrono::steady_clock::now() - compileStart).count();
+  size_t laneEvents = 0;
+  double laneMicros = timeBlocks(numBlocks, [&] {
+    lanes.beginBlock();
+    for (int key = 0; key < tracks; ++key)
+    {
+      lanes.getEventsForPlugin(key, buffer, benchBlock);
+      laneEvents += size_t(buffer.getNumEvents());
+    }
+    lanes.endBlock(benchBlock);
+  });
+
+  cout << "flat schedule: " << flatMicros << " us per block, " << flatEvents << " events delivered" << endl;
+  cout << "lanes:         " << laneMicros << " us per block, " << laneEvents << " events delivered ("
+       << compileMs << " ms to compile, off the audio thread)" << endl;
+  cout << "speedup:       " << flatMicros / laneMicros << "x" << endl;
+  return flatEvents == laneEvents ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+"""Generates juce_protocol.h and juce_protocol.py from protocol.json, so the server and the client share one
+definition of every command, notification and record. Run after editing protocol.json:
+
+  python gen_protocol.py [protocol.json] [output directory]
+"""
+import json, os, sys
+
+scalars = { #type: (C++ type, struct code, numpy dtype, size)
+  "u8": ("uint8_t", "B", "u1", 1),
+  "i32": ("int32_t", "i", "<i4", 4),
+  "u32": ("uint32_t", "I", "<u4", 4),
+  "i64": ("int64_t", "q", "<i8", 8),
+  "u64": ("uint64_t", "Q", "<u8", 8),
+  "f32": ("float", "f", "<f4", 4),
+  "f64": ("double", "d", "<f8", 8),
+}
+
+header = "Generated by gen_protocol.py from protocol.json. Do not edit."
+
+def load(path):
+  schema = json.load(open(path))
+  groups = schema["groups"]
+  def expand(fields):
+    out = []
+    for field in fields:
+      if field[1].startswith("group:"):
+        out += expand(groups[field[1][6:]])
+      else:
+        out.append(field)
+    return out
+  for name in groups:
+    groups[name] = expand(groups[name])
+  for command in schema["commands"]:
+    command["args"] = expand(command["args"])
+    if "reply" in command:
+      command["reply"] = expand(command["reply"])
+  for notification in schema["notifications"]:
+    notification["fields"] = expand(notification["fields"])
+  return schema
+
+def messages(schema):
+  """(name, fields, doc) for every message body, named as in both generated files"""
+  for command in schema["commands"]:
+    yield command["name"] + "_args", command["args"], f"{command['name']} command"
+    if "reply" in command:
+      yield command["name"] + "_reply", command["reply"], f"{command['name']} reply"
+  yield "command_failed_reply", schema["command_failed"]["fields"], "reply to a command whose handler failed"
+  for notification in schema["notifications"]:
+    yield notification["name"] + "_notification", notification["fields"], f"{notification['name']} notification, after its type byte"
+
+def fixed(fields):
+  return all(kind in scalars for name, kind, *count in fields)
+
+def describe(fields):
+  return ", ".join(f"{kind} {name}" + (f" (count in {count[0]})" if count else "") for name, kind, *count in fields) or "empty"
+
+def struct_cpp(name, fields, doc):
+  lines = [f"// {doc}", f"struct {name}", "{"]
+  for field, kind, *count in fields:
+    lines.append(f"  {scalars[kind][0]} {field};")
+  lines.append(f"  static constexpr size_t wireSize = {sum(scalars[kind][3] for field, kind, *count in fields)};")
+  lines.append("};")
+  lines.append(f"static_assert(sizeof({name}) == {name}::wireSize, \"{name} layout\");")
+  return "\n".join(lines)
+
+def generate_cpp(schema):
+  out = [f"// {header}", "#pragma once", "", "#include <cstddef>", "#include <cstdint>", ""]
+  out.append("// Commands, client -> server")
+  out.append("enum recv_cmd\n{\n  " + ",\n  ".join(c["name"] for c in schema["commands"]) + "\n};\n")
+  out.append("// Notifications, server -> client; the first byte of every notification frame")
+  out.append("enum send_cmd : uint8_t\n{\n  " + ",\n  ".join(n["name"] for n in schema["notifications"]) + "\n};\n")
+  for name, enum in schema.get("enums", {}).items():
+    out.append(f"// {enum['doc']}")
+    out.append(f"enum class {name} : uint32_t\n{{\n  " + ",\n  ".join(enum["values"] + ["count"]) + "\n};\n")
+  failed = schema["command_failed"]
+  out.append(f"// {failed['doc']}")
+  out.append(f"constexpr uint32_t commandFailedBit = 1u << {failed['requestIdBit']};\n")
+  out.append("#pragma pack(push, 1)")
+  for name, record in schema["records"].items():
+    out.append(struct_cpp(name, record["fields"], record["doc"]) + "\n")
+  out.append("// Messages made only of scalars decode with one memcpy: READFROMPIPE(set_parameter_args).")
+  out.append("// The rest are read and written field by field in the order given.")
+  for name, fields, doc in messages(schema):
+    if fields and fixed(fields):
+      out.append(struct_cpp(name, fields, doc) + "\n")
+    elif fields:
+      out.append(f"// {name}: {describe(fields)}\n")
+  out.append("#pragma pack(pop)")
+  return "\n".join(out) + "\n"
+
+runtime_py = '''
+u32 = struct.Struct("<I")
+
+class Record:
+  """A packed record type: struct format for packing, numpy dtype for zero-copy arrays"""
+  def __init__(self, name, fields):
+    self.name = name
+    self.fields = fields
+    self.format = "".join(scalars[kind] for field, kind in fields)
+    self.struct = struct.Struct("<" + self.format)
+    self.size = self.struct.size
+    self.dtype = np.dtype([(field, dtypes[kind]) for field, kind in fields])
+
+  def tobytes(self, records):
+    """records as bytes: a numpy array or bytes-like object already in this layout, or a sequence of tuples,
+    converted in one go through a structured array rather than packed one record at a time"""
+    if hasattr(records, "tobytes"):
+      return records.tobytes()
+    if isinstance(records, (bytes, bytearray, memoryview)):
+      return bytes(records)
+    return np.array([tuple(record) for record in records], dtype=self.dtype).tobytes()
+
+class Message:
+  """Wire layout of one message body. Runs of scalar fields pack and unpack with one precompiled Struct;
+  the rest is handled field by field. unpack_from returns a namedtuple, with records as numpy views"""
+  def __init__(self, name, fields):
+    self.name = name
+    self.fields = fields
+    self.tuple = collections.namedtuple(name, [field[0] for field in fields])
+    index = {field[0]: i for i, field in enumerate(fields)}
+    self.steps = [] #(Struct, number of fields) or (kind, count field index or None)
+    run = ""
+    for field, kind, *count in fields:
+      if kind in scalars:
+        run += scalars[kind]
+        continue
+      if run:
+        self.steps.append((struct.Struct("<" + run), len(run)))
+        run = ""
+      self.steps.append((kind, index[count[0]] if count else None))
+    if run:
+      self.steps.append((struct.Struct("<" + run), len(run)))
+    self.struct = self.steps[0][0] if len(self.steps) == 1 and isinstance(self.steps[0][0], struct.Struct) else None
+
+  def pack(self, *values):
+    if self.struct:
+      return self.struct.pack(*values)
+    out = bytearray()
+    i = 0
+    for step, arg in self.steps:
+      if isinstance(step, struct.Struct):
+        out += step.pack(*values[i:i + arg])
+        i += arg
+        continue
+      value = values[i]
+      i += 1
+      if step == "str":
+        packstr(out, value)
+      elif step == "strs":
+        out += u32.pack(len(value))
+        for s in value:
+          packstr(out, s)
+      elif step.startswith("records:"):
+        record = records[step[8:]]
+        data = record.tobytes(value)
+        if arg is None:
+          out += u32.pack(len(data) // record.size)
+        out += data
+      elif step.startswith("list:"):
+        group = groups[step[5:]]
+        if arg is None:
+          out += u32.pack(len(value))
+        for item in value:
+          out += group.pack(*item)
+    return bytes(out)
+
+  def unpack_from(self, buffer, offset=0):
+    """Returns (namedtuple, offset after the message)"""
+    if self.struct:
+      return self.tuple._make(self.struct.unpack_from(buffer, offset)), offset + self.struct.size
+    values = []
+    for step, arg in self.steps:
+      if isinstance(step, struct.Struct):
+        values += step.unpack_from(buffer, offset)
+        offset += step.size
+        continue
+      if step == "str":
+        value, offset = unpackstr(buffer, offset)
+      elif step == "strs":
+        count, = u32.unpack_from(buffer, offset)
+        offset += 4
+        value = []
+        for x in range(count):
+          s, offset = unpackstr(buffer, offset)
+          value.append(s)
+      else:
+        if arg is None:
+          count, = u32.unpack_from(buffer, offset)
+          offset += 4
+        else:
+          count = values[arg]
+        if step.startswith("records:"):
+          record = records[step[8:]]
+          if offset + count * record.size > len(buffer):
+            raise struct.error(f"{self.name}: {count} {record.name} records overrun the frame")
+          value = np.frombuffer(buffer, record.dtype, count, offset) if count else np.empty(0, record.dtype)
+          offset += count * record.size
+        else:
+          group = groups[step[5:]]
+          value = []
+          for x in range(count):
+            item, offset = group.unpack_from(buffer, offset)
+            value.append(item)
+      values.append(value)
+    return self.tuple._make(values), offset
+
+def packstr(out, s):
+  data = s.encode("utf-8")
+  out += u32.pack(len(data))
+  out += data
+
+def unpackstr(buffer, offset):
+  n, = u32.unpack_from(buffer, offset)
+  offset += 4
+  if offset + n > len(buffer):
+    raise struct.error("string overruns the frame")
+  return bytes(buffer[offset:offset + n]).decode("utf-8"), offset + n
+'''
+
+def generate_py(schema):
+  out = [f"# {header}", "import struct, collections", "import numpy as np", ""]
+  out.append("class send_cmd: #commands, client -> server")
+  for i, command in enumerate(schema["commands"]):
+    out.append(f"  {command['name']} = {i}")
+  out.append("")
+  out.append("class recv_cmd: #notifications, server -> client")
+  for i, notification in enumerate(schema["notifications"]):
+    out.append(f"  {notification['name']} = {i}")
+  out.append("")
+  for name, enum in schema.get("enums", {}).items():
+    out.append(f"class {name}: #{enum['doc']}")
+    for i, value in enumerate(enum["values"]):
+      out.append(f"  {value} = {i}")
+    out.append(f"  count = {len(enum['values'])}")
+    out.append("")
+  failed = schema["command_failed"]
+  out.append(f"command_failed_bit = 1 << {failed['requestIdBit']} #{failed['doc']}")
+  out.append("")
+  out.append("scalars = {" + ", ".join(f"{k!r}: {v[1]!r}" for k, v in scalars.items()) + "}")
+  out.append("dtypes = {" + ", ".join(f"{k!r}: {v[2]!r}" for k, v in scalars.items()) + "}")
+  out.append(runtime_py)
+  out.append("records = {}")
+  for name, record in schema["records"].items():
+    out.append(f"{name} = records[{name!r}] = Record({name!r}, {[tuple(f) for f in record['fields']]!r}) #{record['doc']}")
+  out.append("")
+  out.append("groups = {}")
+  for name, fields in schema["groups"].items():
+    out.append(f"{name} = groups[{name!r}] = Message({name!r}, {[tuple(f) for f in fields]!r})")
+  out.append("")
+  for name, fields, doc in messages(schema):
+    out.append(f"{name} = Message({name!r}, {[tuple(f) for f in fields]!r})")
+  return "\n".join(out) + "\n"
+
+def main():
+  here = os.path.dirname(os.path.abspath(__file__))
+  schema_path = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "protocol.json")
+  out_dir = sys.argv[2] if len(sys.argv) > 2 else here
+  schema = load(schema_path)
+  for filename, text in (("juce_protocol.h", generate_cpp(schema)), ("juce_protocol.py", generate_py(schema))):
+    path = os.path.join(out_dir, filename)
+    if not os.path.exists(path) or open(path).read() != text:
+      open(path, "w").write(text)
+      print(f"wrote {path}")
+
+if __name__ == "__main__":
+  main()
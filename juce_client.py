@@ -27,28 +27,13 @@
 #Special MIDI notes outside the playable range trigger articulation changes
 #For example, C0 might switch to legato, C#0 to staccato, D0 to pizzicato
 
-import time, struct, platform, sys, json, os, threading, subprocess
+import time, struct, platform, sys, json, os, threading, subprocess, itertools, io, ctypes, mmap, asyncio, concurrent.futures, socket, collections
 from notes_manipulation import *
 import yaml
+import numpy as np
 
-class send_cmd:
-  load_plugin, load_plugin_by_index, scan_plugins, list_plugins, get_plugin_info, show_plugin_ui, hide_plugin_ui, \
-  set_parameter, get_parameter, connect_audio, connect_midi, start_playback, cmd_shutdown, remove_plugin, \
-  list_bad_paths, get_params_info, get_channels_info, schedule_midi_note, schedule_midi_cc, clear_midi_schedule, \
-  schedule_param_change, route_keyboard_input, unroute_keyboard_input, route_cc_to_param, unroute_cc_to_param, \
-  show_virtual_keyboard, hide_virtual_keyboard, route_virtual_keyboard, unroute_virtual_keyboard, \
-  toggle_recording, toggle_monitoring, \
-  load_audio_file, control_audio_playback, \
-  schedule_ordered_notes, start_ordered_playback, stop_ordered_playback, clear_ordered_notes, \
-  clear_midi_cc_schedule, clear_param_schedule, clear_all_plugins = range(40)
-
-class recv_cmd:
-  param_change, param_changes_end, stop_playback, midi_note_event, midi_cc_event, \
-  virtual_keyboard_note_event, virtual_keyboard_cc_event, \
-  midi_keyboard_routed, virtual_keyboard_routed, \
-  recording_started, recording_stopped, monitoring_changed, \
-  audio_file_loaded, audio_playback_started, audio_playback_stopped, \
-  ordered_note_triggered, ordered_playback_started, ordered_playback_stopped = range(18)
+import juce_protocol as protocol #generated from protocol.json by gen_protocol.py
+from juce_protocol import send_cmd, recv_cmd, NotificationStream
 
 pipe_name = "juceclientserver"
 
@@ -89,6 +74,44 @@ elif platform.system() == "Darwin":
 class dummy:
   pass
 
+def todummy(t):
+  """A decoded message's namedtuple as a dummy with the same attributes"""
+  d = dummy()
+  d.__dict__.update(t._asdict())
+  return d
+
+def plugininfo(t):
+  p = todummy(t)
+  p.pluginId = p.uid
+  return p
+
+#records in a notification_batch
+param_change_dtype = protocol.ParamChangeRecord.dtype
+midi_note_dtype = protocol.MidiNoteRecord.dtype
+midi_cc_dtype = protocol.MidiCCRecord.dtype
+
+def midinotestoevents(notes):
+  """Convert (key, note, velocity, startTime, duration, channel) tuples, as used by schedulemidinote,
+  into (key, status, data1, data2, sampleTime) records for schedulemidieventsbulk"""
+  events = []
+  for key, note, velocity, startTime, duration, channel in notes:
+    startSample = int(startTime * sampleRate)
+    events.append((key, 0x90 | (channel - 1), note, int(velocity * 127), startSample))
+    events.append((key, 0x80 | (channel - 1), note, 0, startSample + int(duration * sampleRate)))
+  return events
+
+def writemidieventfile(path, events, append=False):
+  """Write (key, status, data1, data2, sampleTime) events, or a protocol.MidiEventRecord array, to a file
+  for streammidieventfile. sampleTime is absolute, from the start of the timeline. Events are sorted by
+  time, keeping the order of those at the same sample; appended events must not start before the file ends"""
+  if isinstance(events, np.ndarray):
+    records = events.astype(protocol.MidiEventRecord.dtype, copy=False)
+  else:
+    records = np.array([tuple(event) for event in events], dtype=protocol.MidiEventRecord.dtype)
+  records = records[np.argsort(records['sampleTime'], kind='stable')]
+  with open(path, 'ab' if append else 'wb') as f:
+    f.write(records.tobytes())
+
 param_changes = []
 
 def read_exact(pipe_handle, n):
@@ -101,6 +124,309 @@ def read_exact(pipe_handle, n):
     data += chunk
   return data
 
+def write_all(pipe_handle, data):
+  view = memoryview(data)
+  while view:
+    n = pipe_handle.write(view)
+    view = view[n:]
+
+def read_frame(reader):
+  """Read one length-prefixed frame (uint32 byte count + body). reader should be buffered so this is
+  normally served from memory rather than a syscall per field"""
+  size, = struct.unpack("<I", read_exact(reader, 4))
+  return read_exact(reader, size)
+
+class CommandFailed(RuntimeError):
+  """The server's handler for a command failed before replying; the message is the server's error"""
+  pass
+
+class FrameBuffer:
+  """Decodes fields out of the frames arriving on one pipe, fetching the next frame when the current one
+  is used up. An empty frame means the stream continues on the reader returned by handover()"""
+  def __init__(self, reader, handover=None):
+    self.reader = reader
+    self.handover = handover
+    self.frame = b''
+    self.pos = 0
+
+  def take(self, n):
+    while self.pos >= len(self.frame) and self.reader:
+      self.frame = read_frame(self.reader)
+      self.pos = 0
+      if not self.frame and self.handover:
+        self.reader = self.handover()
+    if self.pos + n > len(self.frame):
+      raise IOError(f"frame underrun: wanted {n} bytes, {len(self.frame) - self.pos} left")
+    start = self.pos
+    self.pos += n
+    return start
+
+  def unpack(self, pattern):
+    s = struct.Struct("<"+pattern)
+    start = self.take(s.size)
+    return s.unpack_from(self.frame, start)
+
+  def read(self, n):
+    start = self.take(n)
+    return self.frame[start:start+n]
+
+  def message(self, msg):
+    """Decode a generated protocol message (juce_protocol.<name>_reply etc.) as a namedtuple"""
+    if msg.fields:
+      self.take(0)
+    try:
+      value, self.pos = msg.unpack_from(self.frame, self.pos)
+    except struct.error as e:
+      raise IOError(f"frame underrun decoding {msg.name}: {e}")
+    return value
+
+  def array(self, dtype, count):
+    """count packed records as a numpy array viewing the frame, without copying"""
+    if not count:
+      return np.empty(0, dtype)
+    return np.frombuffer(self.frame, dtype, count, self.take(dtype.itemsize * count))
+
+#The shared memory rings (SharedRing, AudioTap) hand positions to and from the server's atomics with plain ctypes
+#loads and stores. Those only get the acquire/release ordering the server relies on from x86's total store order,
+#so on other CPUs the client stays on the pipes and doesn't offer audio taps
+x86_memory_order = platform.machine().lower() in ("x86_64", "amd64", "i386", "i686", "x86")
+
+if platform.system() == "Linux":
+  libc = ctypes.CDLL(None, use_errno=True)
+  SYS_futex = {"x86_64": 202, "i686": 240}.get(platform.machine())
+  FUTEX_WAIT, FUTEX_WAKE = 0, 1
+elif platform.system() == "Windows":
+  kernel32 = ctypes.WinDLL("kernel32", use_last_error=True)
+  kernel32.CreateEventW.restype = ctypes.c_void_p
+  kernel32.CreateEventW.argtypes = (ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_wchar_p)
+  kernel32.WaitForSingleObject.argtypes = (ctypes.c_void_p, ctypes.c_uint32)
+  kernel32.SetEvent.argtypes = (ctypes.c_void_p,)
+
+class timespec(ctypes.Structure):
+  _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+class RingSignal:
+  """Sleeps on / wakes one signal word of a shared ring: a futex on Linux, the server's named event on Windows"""
+  def __init__(self, word, event_name):
+    self.word = word
+    if platform.system() == "Windows":
+      self.event = kernel32.CreateEventW(None, False, False, event_name) #opens the server's event
+      if not self.event:
+        raise IOError(f"couldn't open event {event_name}")
+
+  def wait(self, seen, timeout):
+    if platform.system() == "Windows":
+      kernel32.WaitForSingleObject(self.event, int(timeout * 1000))
+    else:
+      ts = timespec(int(timeout), int((timeout % 1) * 1e9))
+      libc.syscall(ctypes.c_long(SYS_futex), ctypes.byref(self.word), ctypes.c_int(FUTEX_WAIT), ctypes.c_uint32(seen), ctypes.byref(ts), None, ctypes.c_int(0))
+
+  def wake(self):
+    if platform.system() == "Windows":
+      kernel32.SetEvent(self.event)
+    else:
+      libc.syscall(ctypes.c_long(SYS_futex), ctypes.byref(self.word), ctypes.c_int(FUTEX_WAKE), ctypes.c_int(0x7fffffff), None, None, ctypes.c_int(0))
+
+class SharedRing(io.RawIOBase):
+  """Client end of one single-producer single-consumer byte ring in the shared memory transport. The control
+  block layout must match RingControl in the server"""
+  spin_count = 50 if (os.cpu_count() or 1) > 1 else 0 #kept short, a spinning thread holds the GIL
+  sleep_timeout = 0.1
+
+  def __init__(self, mm, control_offset, data_offset, capacity, event_prefix, peer_alive):
+    self.mm = mm
+    self.write_pos = ctypes.c_uint64.from_buffer(mm, control_offset)
+    self.read_pos = ctypes.c_uint64.from_buffer(mm, control_offset + 64)
+    self.reader_sleeping = ctypes.c_uint32.from_buffer(mm, control_offset + 132)
+    self.writer_sleeping = ctypes.c_uint32.from_buffer(mm, control_offset + 196)
+    self.data_ready = RingSignal(ctypes.c_uint32.from_buffer(mm, control_offset + 128), event_prefix + "_data")
+    self.space_ready = RingSignal(ctypes.c_uint32.from_buffer(mm, control_offset + 192), event_prefix + "_space")
+    self.data_offset = data_offset
+    self.capacity = capacity
+    self.peer_alive = peer_alive
+
+  def readable(self):
+    return True
+
+  def writable(self):
+    return True
+
+  def readinto(self, b):
+    pos = self.read_pos.value
+    n = min(self.wait_for(lambda: self.write_pos.value - pos, self.data_ready, self.reader_sleeping), len(b))
+    start = self.data_offset + (pos & (self.capacity - 1))
+    first = min(n, self.data_offset + self.capacity - start)
+    b[:first] = self.mm[start:start+first]
+    b[first:n] = self.mm[self.data_offset:self.data_offset+n-first]
+    self.read_pos.value = pos + n
+    self.notify(self.space_ready, self.writer_sleeping)
+    return n
+
+  def write(self, data):
+    """Writes all of data, waiting for the server to make room if the ring is full"""
+    view = memoryview(data).cast("B")
+    pos = self.write_pos.value
+    done = 0
+    while done < len(view):
+      space = self.capacity - (pos - self.read_pos.value)
+      if not space:
+        self.publish(pos)
+        space = self.wait_for(lambda: self.capacity - (pos - self.read_pos.value), self.space_ready, self.writer_sleeping)
+      n = min(space, len(view) - done)
+      start = self.data_offset + (pos & (self.capacity - 1))
+      first = min(n, self.data_offset + self.capacity - start)
+      self.mm[start:start+first] = view[done:done+first]
+      self.mm[self.data_offset:self.data_offset+n-first] = view[done+first:done+n]
+      pos += n
+      done += n
+    self.publish(pos)
+    return done
+
+  def wait_for(self, available, signal, sleeping):
+    for _ in range(self.spin_count):
+      n = available()
+      if n:
+        return n
+    while True:
+      seen = signal.word.value
+      sleeping.value = 1
+      n = available()
+      if not n:
+        signal.wait(seen, self.sleep_timeout)
+      sleeping.value = 0
+      n = n or available()
+      if n:
+        return n
+      if not self.peer_alive():
+        raise IOError("shared transport closed")
+
+  def publish(self, pos):
+    if pos != self.write_pos.value:
+      self.write_pos.value = pos
+      self.notify(self.data_ready, self.reader_sleeping)
+
+  def notify(self, signal, sleeping):
+    signal.word.value = (signal.word.value + 1) & 0xffffffff #only this side bumps this word
+    if sleeping.value:
+      signal.wake()
+
+  def wake_all(self):
+    for signal in (self.data_ready, self.space_ready):
+      signal.word.value = (signal.word.value + 1) & 0xffffffff
+      signal.wake()
+
+def mapshared(name, size):
+  """Maps a shared memory region the server created by name"""
+  if platform.system() == "Windows":
+    return mmap.mmap(-1, size, tagname=name)
+  fd = os.open("/dev/shm" + name, os.O_RDWR)
+  try:
+    return mmap.mmap(fd, size)
+  finally:
+    os.close(fd)
+
+class SharedTransport:
+  """Client side of the server's shared memory transport. The region starts with a header, then the ring control
+  blocks for commands, replies and notifications, then their data areas (see SharedTransport in the server)"""
+  magic = 0x4d485353
+  control_offset = 64
+  data_offset = 4096
+  command_ring, reply_ring, notification_ring = range(3)
+
+  @staticmethod
+  def supported():
+    if not x86_memory_order:
+      return False
+    return platform.system() == "Windows" or (platform.system() == "Linux" and SYS_futex is not None)
+
+  def __init__(self, name, capacity):
+    self.mm = mapshared(name, self.data_offset + 3 * capacity)
+    magic, version, ringCapacity, numRings, self.server_pid = struct.unpack_from("<IIIIq", self.mm, 0)
+    if magic != self.magic or ringCapacity != capacity or numRings != 3:
+      raise IOError(f"unexpected shared memory layout in {name}")
+    self.server_closed = ctypes.c_uint32.from_buffer(self.mm, 32)
+    self.client_closed = ctypes.c_uint32.from_buffer(self.mm, 36)
+    self.rings = [SharedRing(self.mm, self.control_offset + i * 256, self.data_offset + i * capacity, capacity, f"{name}_{i}", self.alive)
+                  for i in range(3)]
+
+  def alive(self):
+    """False once either end has closed the transport or the server process is gone"""
+    if self.server_closed.value or self.client_closed.value:
+      return False
+    if platform.system() != "Windows":
+      try:
+        os.kill(self.server_pid, 0)
+      except ProcessLookupError:
+        return False
+      except PermissionError:
+        pass
+    return True
+
+  def close(self):
+    self.client_closed.value = 1
+    for ring in self.rings:
+      ring.wake_all()
+
+class AudioTap:
+  """Reader for a subscribe_audio_tap ring: the audio thread copies each block of the tapped bus into planar float32
+  rings in shared memory, and drops (and counts) blocks rather than wait when the reader falls behind.
+  data is a (channels, capacity) numpy view straight onto the shared memory"""
+  magic = 0x50415441
+  data_offset = 256
+
+  def __init__(self, tapId, name, channels, capacity):
+    self.tapId = tapId
+    self.mm = mapshared(name, self.data_offset + channels * capacity * 4)
+    magic, numChannels, ringCapacity = struct.unpack_from("<III", self.mm, 0)
+    if magic != self.magic or numChannels != channels or ringCapacity != capacity:
+      raise IOError(f"unexpected audio tap layout in {name}")
+    self.channels = channels
+    self.capacity = capacity
+    self.closed_flag = ctypes.c_uint32.from_buffer(self.mm, 12)
+    self.write_pos = ctypes.c_uint64.from_buffer(self.mm, 64)
+    self.dropped_frames = ctypes.c_uint64.from_buffer(self.mm, 72)
+    self.dropped_blocks = ctypes.c_uint64.from_buffer(self.mm, 80)
+    self.read_pos = ctypes.c_uint64.from_buffer(self.mm, 128)
+    self.data = np.frombuffer(self.mm, np.float32, channels * capacity, self.data_offset).reshape(channels, capacity)
+
+  @property
+  def samplerate(self):
+    return struct.unpack_from("<d", self.mm, 16)[0]
+
+  def available(self):
+    return self.write_pos.value - self.read_pos.value
+
+  def closed(self):
+    """True once the server has dropped the tap, by unsubscribe_audio_tap or clear_all_plugins (which also sends an
+    audio_tap_closed notification). Frames already written can still be read"""
+    return bool(self.closed_flag.value)
+
+  def dropped(self):
+    """(frames, blocks) the audio thread has thrown away because the ring was full"""
+    return self.dropped_frames.value, self.dropped_blocks.value
+
+  def peek(self, maxFrames=None):
+    """Views of the unread frames, without copying: one (channels, n) array, or two when the data wraps around the
+    ring. They stay valid until advance() hands the space back to the audio thread"""
+    count = self.available()
+    if maxFrames is not None:
+      count = min(count, maxFrames)
+    start = self.read_pos.value & (self.capacity - 1)
+    first = min(count, self.capacity - start)
+    if first == count:
+      return [self.data[:, start:start + count]]
+    return [self.data[:, start:], self.data[:, :count - first]]
+
+  def advance(self, frames):
+    self.read_pos.value += frames
+
+  def read(self, maxFrames=None):
+    """Copies out and consumes the unread frames as a (channels, n) array"""
+    views = self.peek(maxFrames)
+    out = views[0].copy() if len(views) == 1 else np.concatenate(views, axis=1)
+    self.advance(out.shape[1])
+    return out
+
 class JuceAudioClient:
     def __init__(self, pipe_name=pipe_name, server_exe_path=None, pluginDirectories = None, badPluginPaths = None):
         self.pipe_name = pipe_name
@@ -113,8 +439,20 @@ class JuceAudioClient:
         self.server_process = None
         self.server_exe_path = server_exe_path or os.path.join(os.path.dirname(os.path.abspath(__file__)), "juce_gui_server.exe") #todo: make this work on mac and linux
         self.availablePlugins = None
+        self.samplerate = sampleRate #the server's rate
         self.pluginDirectories = pluginDirectories
         self.badPluginPaths = badPluginPaths
+        self.frame = None #command being built by sendcmd/sendinfo/sendstr
+        self.outbuf = bytearray() #finished command frames waiting for flushcmd
+        self.reply_reader = None
+        self.notifications = None
+        self.command_sink = None #the pipe, or the command ring once the shared memory transport is open
+        self.shared = None
+        self.shared_ready = threading.Event()
+        self.request_ids = itertools.count() #request id 0 means no reply wanted
+        self.pending = {} #request id -> (future, decode)
+        self.pending_lock = threading.Lock()
+        self.local = threading.local() #.reply is the reply being decoded on the reply thread
 
     def start_server(self):
         """Launch the JUCE server process if not already running"""
@@ -137,15 +475,22 @@ class JuceAudioClient:
             print(f"Failed to launch server: {e}")
             return False
 
-    def connect(self, auto_start=True, max_retries=5, retry_delay=1.0):
-        """Connect to the JUCE server, optionally starting it if not running"""
+    def connect(self, auto_start=True, max_retries=5, retry_delay=1.0, shared_memory=True):
+        """Connect to the JUCE server, optionally starting it if not running. With shared_memory the connection moves
+        onto shared memory rings if the server and platform support it, and stays on the pipes otherwise"""
         for attempt in range(max_retries):
             try:
                 print(f"Connecting to {self.pipe_name}... (attempt {attempt + 1}/{max_retries})")
                 self.commands_pipe_handle = open(self.commands_pipe_path, 'w+b', buffering=0)
-                self.notifications_pipe_handle = open(self.notifications_pipe_path, 'rb', buffering=0)
+                self.notifications_pipe_handle = open(self.notifications_pipe_path, 'rb', buffering=65536)
+                self.reply_reader = io.BufferedReader(self.commands_pipe_handle, 65536)
+                self.notifications = FrameBuffer(self.notifications_pipe_handle, self.sharednotifications)
+                self.command_sink = self.commands_pipe_handle
                 self.commands_connected = True
                 self.notifications_connected = True
+                threading.Thread(target=self.readreplies, daemon=True).start()
+                if shared_memory:
+                  self.opensharedtransport()
                 return True
                 print("Connected successfully!")
             except Exception as e:
@@ -170,6 +515,27 @@ class JuceAudioClient:
 
         return False
     
+    def connectsocket(self, path=None):
+      """Connect to an already running server as one of several controllers, over its Unix socket (Linux).
+      Commands and replies use one connection and this client's notifications another"""
+      path = path or f"/tmp/{self.pipe_name}.sock"
+      commands = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+      commands.connect(path)
+      commands.sendall(struct.pack("<IB", 1, 0))
+      self.commands_pipe_handle = commands.makefile('rwb', buffering=0)
+      self.reply_reader = io.BufferedReader(self.commands_pipe_handle, 65536)
+      self.client_id, = struct.unpack("<I", read_frame(self.reply_reader))
+      notifications = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+      notifications.connect(path)
+      notifications.sendall(struct.pack("<IBI", 5, 1, self.client_id))
+      self.notifications_pipe_handle = notifications.makefile('rb', buffering=65536)
+      self.notifications = FrameBuffer(self.notifications_pipe_handle)
+      self.command_sink = self.commands_pipe_handle
+      self.commands_connected = True
+      self.notifications_connected = True
+      threading.Thread(target=self.readreplies, daemon=True).start()
+      return True
+
     def disconnect(self, shutdown_server=False):
         """Disconnect from the server"""
         if self.commands_connected and self.commands_pipe_handle:
@@ -178,11 +544,15 @@ class JuceAudioClient:
                     # Send shutdown command before disconnecting
                     try:
                         self.sendcmd(send_cmd.cmd_shutdown)
-                        self.commands_pipe_handle.flush()
+                        self.flushcmd()
                         time.sleep(0.5)  # Give server time to shutdown
                     except:
                         pass
 
+                if self.shared:
+                    self.shared.close()
+                    self.shared = None
+
                 self.commands_pipe_handle.close()
                 print("Disconnected from server")
             except:
@@ -213,38 +583,112 @@ class JuceAudioClient:
       if not self.commands_connected:
         raise IOError
       else:
-        self.commands_pipe_handle.write(struct.pack("<"+pattern, *args))
+        self.frame += struct.pack("<"+pattern, *args)
 
-    def readinfoc(self, pattern):
+    def sendbytes(self, data):
       if not self.commands_connected:
         raise IOError
       else:
-        return struct.unpack("<"+pattern, read_exact(self.commands_pipe_handle, struct.calcsize("<"+pattern)))
+        self.frame += data
+
+    def endframe(self):
+      if self.frame is not None:
+        self.outbuf += struct.pack("<I", len(self.frame))
+        self.outbuf += self.frame
+        self.frame = None
+
+    def flushcmd(self):
+      """Send every command queued since the last flush in one write"""
+      self.endframe()
+      if self.outbuf:
+        write_all(self.command_sink, self.outbuf)
+        self.outbuf = bytearray()
+
+    def reply(self, decode=None, wait=True):
+      """Ask for a reply to the command being built, and send it. decode reads the reply's fields with readinfoc,
+      readstr1 etc. and runs on the reply thread when the reply arrives. Returns decode's result, or with
+      wait=False a concurrent.futures.Future for it, so many requests can be in flight at once.
+      The server runs a client's commands in the order they were sent, except load_plugin, load_plugin_by_uid and
+      scan_plugins, which run on their own thread: later commands only wait for one of those if they use the key
+      it loads (or name no single key), or read the plugin list a scan builds. Their replies can come back out of order"""
+      future = concurrent.futures.Future()
+      with self.pending_lock:
+        requestId = next(self.request_ids) % (protocol.command_failed_bit - 1) + 1
+        self.pending[requestId] = (future, decode)
+      struct.pack_into("<I", self.frame, 0, requestId)
+      self.flushcmd()
+      return future.result() if wait else future
+
+    def awaitable(self, future):
+      """Wrap a future from reply(wait=False) for use with await in an asyncio event loop"""
+      return asyncio.wrap_future(future)
+
+    def readreplies(self):
+      """Reply thread: hands each reply frame to the request it answers. Slow commands can complete out of order.
+      A command_failed reply raises CommandFailed from the request, whatever the command was"""
+      try:
+        while True:
+          frame = read_frame(self.reply_reader)
+          requestId, = struct.unpack_from("<I", frame)
+          failed = requestId & protocol.command_failed_bit
+          requestId &= ~protocol.command_failed_bit
+          with self.pending_lock:
+            future, decode = self.pending.pop(requestId, (None, None))
+          if future is None:
+            print(f"reply to unknown request {requestId}")
+            continue
+          self.local.reply = FrameBuffer(None)
+          self.local.reply.frame, self.local.reply.pos = frame, 4
+          try:
+            if failed:
+              raise CommandFailed(self.local.reply.message(protocol.command_failed_reply).message)
+            future.set_result(decode() if decode else None)
+          except Exception as e:
+            future.set_exception(e)
+      except Exception as e:
+        with self.pending_lock:
+          pending, self.pending = self.pending, {}
+        for future, decode in pending.values():
+          future.set_exception(IOError(f"connection lost: {e}"))
+
+    def readinfoc(self, pattern):
+      return self.local.reply.unpack(pattern)
 
     def readinfo1c(self, pattern):
-      if not self.commands_connected:
-        raise IOError
-      else:
-        return struct.unpack("<"+pattern, read_exact(self.commands_pipe_handle, struct.calcsize("<"+pattern)))[0]
+      return self.readinfoc(pattern)[0]
 
     def readinfon(self, pattern):
       if not self.notifications_connected:
         raise IOError
       else:
-        return struct.unpack("<"+pattern, read_exact(self.notifications_pipe_handle, struct.calcsize("<"+pattern)))
+        return self.notifications.unpack(pattern)
 
     def readinfo1n(self, pattern):
+      return self.readinfon(pattern)[0]
+
+    def readmsgc(self, msg):
+      """Decode a reply message generated from protocol.json, e.g. protocol.load_plugin_reply"""
+      return self.local.reply.message(msg)
+
+    def readmsgn(self, msg):
+      """Decode the rest of a notification, e.g. protocol.param_changed_notification"""
       if not self.notifications_connected:
         raise IOError
       else:
-        return struct.unpack("<"+pattern, read_exact(self.notifications_pipe_handle, struct.calcsize("<"+pattern)))[0]
+        return self.notifications.message(msg)
+
+    def readnotificationbatch(self):
+      """Decode the rest of a notification_batch as numpy record arrays:
+      (paramChanges, midiNotes, midiCCs, virtualKeyboardNotes, virtualKeyboardCCs).
+      Parameter changes are coalesced: at most one per (key, parameterIndex), holding the latest value"""
+      return tuple(self.readmsgn(protocol.notification_batch_notification))
 
     def readstr1(self):
       if not self.commands_connected:
         raise IOError
       else:
         size = self.readinfo1c("I")
-        return read_exact(self.commands_pipe_handle, size).decode("utf-8", errors="ignore") #debug, there should never be decoding errors so we shouldn't have errors="ignore"
+        return bytes(self.local.reply.read(size)).decode("utf-8", errors="ignore") #debug, there should never be decoding errors so we shouldn't have errors="ignore"
 
     def readstrs(self, num):
       return tuple(self.readstr1() for _ in range(num))
@@ -253,207 +697,499 @@ class JuceAudioClient:
       if not self.commands_connected:      
         raise IOError
       else:
-        self.commands_pipe_handle.write(struct.pack("I", len(s)) + s.encode("utf-8"))
+        b = s.encode("utf-8")
+        self.frame += struct.pack("<I", len(b)) + b
 
     def sendstrs(self, ss):
       for s in ss:
         self.sendstr(s)
         
+    def sendmsg(self, msg, *values):
+      """Append a command's arguments, laid out by a message generated from protocol.json"""
+      if not self.commands_connected:
+        raise IOError
+      else:
+        self.frame += msg.pack(*values)
+
     def sendcmd(self, command):
-      self.sendinfo("B", command)
+      """Start a new command frame; the previous one is queued until flushcmd or the next read"""
+      self.endframe()
+      self.frame = bytearray(struct.pack("<IB", 0, command)) #request id, filled in by reply()
           
-    def loadplugin(self, path, key): 
-      #success, uid, name, errmsg
+    def opensharedtransport(self, ringCapacity=0):
+      """Move commands, replies and notifications onto shared memory rings. Returns False, and the pipes stay in
+      use, if the server or this platform doesn't support it. ringCapacity 0 uses the server's default"""
+      if not SharedTransport.supported():
+        return False
+      self.sendcmd(send_cmd.open_shared_transport)
+      self.sendmsg(protocol.open_shared_transport_args, ringCapacity, os.getpid())
+      ok, name, capacity = self.reply(lambda: tuple(self.readmsgc(protocol.open_shared_transport_reply)))
+      if not ok:
+        print(f"shared memory transport unavailable: {name}")
+        return False
+      #the server only moves over once we confirm the region is mapped, and drops it if we can't
+      try:
+        shared = SharedTransport(name, capacity)
+      except Exception as e:
+        print(f"couldn't attach shared memory transport {name}: {e}")
+        self.sendcmd(send_cmd.confirm_shared_transport)
+        self.sendmsg(protocol.confirm_shared_transport_args, 0, str(e))
+        self.flushcmd()
+        return False
+      self.sendcmd(send_cmd.confirm_shared_transport)
+      self.sendmsg(protocol.confirm_shared_transport_args, 1, "")
+      return self.reply(lambda: self.attachshared(shared))
+
+    def attachshared(self, shared):
+      #runs on the reply thread: the confirm reply is the last one on the pipe, after it the thread carries on
+      #reading from the reply ring
+      switched, = self.readmsgc(protocol.confirm_shared_transport_reply)
+      if not switched:
+        print("server didn't switch to the shared memory transport, staying on the pipes")
+        shared.close()
+        return False
+      self.shared = shared
+      self.command_sink = shared.rings[SharedTransport.command_ring]
+      self.reply_reader = io.BufferedReader(shared.rings[SharedTransport.reply_ring], 65536)
+      self.shared_ready.set()
+      return True
+
+    def sharednotifications(self):
+      """Called by the notification reader when the server says notifications continue in shared memory"""
+      self.shared_ready.wait()
+      return io.BufferedReader(self.shared.rings[SharedTransport.notification_ring], 65536)
+
+    def loadplugin(self, path, key, wait=True):
+      #success, name, uid, errmsg
       self.sendcmd(send_cmd.load_plugin)
-      self.sendstr(path)
-      self.sendinfo("II", key)
-      self.commands_pipe_handle.flush()
-      return self.readinfoc("I") + self.readstrs(2) 
+      self.sendmsg(protocol.load_plugin_args, path, key)
+      return self.reply(lambda: tuple(self.readmsgc(protocol.load_plugin_reply)), wait)
                                    
-    def loadpluginbyuid(self, uid, key):
-      #success, name, pluginId, uid, errmsg
-      self.sendcmd(send_cmd.load_plugin_by_index)
-      self.sendinfo("II", uid, key)
-      self.commands_pipe_handle.flush()
-      success, name, errmsg = self.readinfoc("I") + self.readstrs(2)
-      if not success:
-        raise ValueError("loading plugin failed. errmsg: " + errmsg) #todo: i forget, is 0 success or is 1 success?
-      return Processor(uid=uid, key=key)
-
-    def scanplugins(self, directories=None, badpaths=None):
+    def loadpluginbyuid(self, uid, key, wait=True):
+      #success, name, errmsg
+      self.sendcmd(send_cmd.load_plugin_by_uid)
+      self.sendmsg(protocol.load_plugin_by_uid_args, uid, key)
+      def decode():
+        success, name, errmsg = self.readmsgc(protocol.load_plugin_by_uid_reply)
+        if not success:
+          raise ValueError("loading plugin failed. errmsg: " + errmsg) #todo: i forget, is 0 success or is 1 success?
+        return Processor(uid=uid, key=key)
+      return self.reply(decode, wait)
+
+    def scanplugins(self, directories=None, badpaths=None, wait=True):
       #num_found
       directories = directories or self.pluginDirectories
       badpaths = badpaths or self.badPluginPaths
       assert directories #todo: i forget, does scanplugins in the server have default directories?
       self.sendcmd(send_cmd.scan_plugins)
-      self.sendinfo("I", len(directories))
-      self.sendstrs(directories)
-      self.sendinfo("I", len(badpaths))
-      self.sendstrs(badpaths)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
-
-    def listplugins(self):
+      self.sendmsg(protocol.scan_plugins_args, directories, badpaths)
+      return self.reply(lambda: self.readmsgc(protocol.scan_plugins_reply).numFound, wait)
+
+    def listplugins(self, wait=True):
       self.sendcmd(send_cmd.list_plugins)
-      self.commands_pipe_handle.flush()
-      size = self.readinfo1c("I")
-      plugins = []
-      for x in range(size):
-        p = dummy()
-        p.isInstrument, p.pluginId, p.numInputChannels, p.numOutputChannels = self.readinfoc("IIII") #todo: we could use "?" for booleans and cast to uint8_t in c++
-        p.name, p.descriptiveName, p.pluginFormatName, p.category, p.manufacturerName, p.version, p.fileOrIdentifier, p.lastFileModTime, p.path = self.readstrs(9)
-        plugins.append(p)
-      self.availablePlugins = plugins
-      return plugins
-
-    def listbadpaths(self):
-      badpaths = []
+      def decode():
+        plugins = [plugininfo(p) for p in self.readmsgc(protocol.list_plugins_reply).plugins]
+        self.availablePlugins = plugins
+        return plugins
+      return self.reply(decode, wait)
+
+    def listbadpaths(self, wait=True):
       self.sendcmd(send_cmd.list_bad_paths)
-      self.commands_pipe_handle.flush()
-      size = self.readinfo1c("I")
-      for x in range(size):
-        badpaths.append(self.readstr1())
-      return badpaths
+      return self.reply(lambda: self.readmsgc(protocol.list_bad_paths_reply).paths, wait)
     
-    def getPluginInfo(self, pluginId):
-       self.sendcmd(send_cmd.get_plugin_info)
-       self.sendinfo("I", pluginId)       
-       p = dummy()
-       p.isInstrument, p.pluginId, p.numInputChannels, p.numOutputChannels = self.readinfoc("IIII") #todo: we could use "?" for booleans and cast to uint8_t in c++
-       p.name, p.descriptiveName, p.pluginFormatName, p.category, p.manufacturerName, p.version, p.fileOrIdentifier, p.lastFileModTime, p.path = self.readstrs(9)
-       return p
-
-    def getParamsInfo(self, pluginId):
+    def getPluginInfo(self, pluginId, wait=True):
+      self.sendcmd(send_cmd.get_plugin_info)
+      self.sendmsg(protocol.get_plugin_info_args, pluginId)
+      return self.reply(lambda: plugininfo(self.readmsgc(protocol.get_plugin_info_reply)), wait)
+
+    def getParamsInfo(self, pluginId, wait=True):
       self.sendcmd(send_cmd.get_params_info)
-      self.sendinfo("I", pluginId)
-      self.commands_pipe_handle.flush()
-      success, numParams = self.readinfoc("II")
-      print(f"{success=}{numParams=}")
-      errmsg = self.readstr1()
-      params = []
-      for x in range(numParams):
-        p = dummy()
-        p.originalIndex = self.readinfo1c("I")
-        p.name = self.readstr1()
-        a = read_exact(self.commands_pipe_handle, struct.calcsize("<"+"ffffffIIIIII"))
-        p.minValue, p.maxValue, p.interval, p.defaultValue, p.skewFactor, p.value, p.numSteps, p.isDiscrete, p.isBoolean, p.isOrientationInverted, \
-          p.isAutomatable, p.isMetaParameter = struct.unpack("<ffffffIIIIII", a) #debug
-        print("parameters data:")
-        print(f"{p.originalIndex=} {p.name=} {p.minValue=} {p.maxValue=} {p.defaultvalue=} {p.skewFactor=} {p.value=} {p.numStemsp=} {p.isDiscrete=}"
-        " {p.isBoolean=} {p.isOrientationInverted=} {p.isAutomatable=} {p.isMetaParameter=}")
-      return success, numParams, params, errmsg
+      self.sendmsg(protocol.get_params_info_args, pluginId)
+      def decode():
+        r = self.readmsgc(protocol.get_params_info_reply)
+        params = [todummy(p) for p in r.params]
+        return r.success, r.numParams, params, r.errmsg
+      return self.reply(decode, wait)
     
-    def getChannelsInfo(self, pluginId):
+    def getparameterhandles(self, key, wait=True):
+      """Handles for a plugin's parameters, for setparametersbyhandle. Parameter i's handle is firstHandle + i,
+      and stays valid until the plugin is removed
+
+      Args:
+        key: The plugin's key
+
+      Returns:
+        (firstHandle, numParams)
+      """
+      self.sendcmd(send_cmd.get_parameter_handles)
+      self.sendmsg(protocol.get_parameter_handles_args, key)
+      def decode():
+        r = self.readmsgc(protocol.get_parameter_handles_reply)
+        if not r.success:
+          raise ValueError("no plugin loaded with key " + str(key))
+        return r.firstHandle, r.numParams
+      return self.reply(decode, wait)
+
+    def setparametersbyhandle(self, changes):
+      """Set parameters from (handle, value) pairs, handles from getparameterhandles. The server goes straight
+      to each parameter without looking up its plugin, so this is the way to send dense automation live"""
+      self.sendcmd(send_cmd.set_parameters_by_handle)
+      self.sendmsg(protocol.set_parameters_by_handle_args, changes)
+      self.flushcmd()
+
+    def getChannelsInfo(self, pluginId, wait=True):
       self.sendcmd(send_cmd.get_channels_info)
-      self.commands_pipe_handle.flush()
-      self.sendinfo("I", pluginId)
-      success, acceptsMidi, producesMidi = self.readinfoc("III")
-      print(f"getChannelsInfo: {pluginId=} {success=} {acceptsMidi=} {producesMidi=}")
-      inputBuses = []
-      for x in range(self.readinfo1c("I")):
-        b = dummy()
-        b.numChannels = self.readinfo1c("I")
-        b.channelTypes = self.readstrs(self.readinfo1c("I"))
-        b.isEnabled = self.readinfo1c("I")
-        b.mainBusLayout = self.readstr1()
-        inputBuses.append(b)
-      print("finished reading input buses")
-      outputBuses = []
-      a = self.readinfo1c("I")
-      print(f"number of output buses for pluginId {pluginId}: {a}")
-      for x in range(a):
-        print(f"reading input channel info for channel for bus {x} pluginId {pluginId}")
-        b = dummy()
-        b.numChannels = self.readinfo1c("I")
-        print(f"{b.numChannels=}")
-        a = self.readinfo1c("I")
-        print(f"channel types size: {a}")
-        b.channelTypes = self.readstrs(a)
-        print(f"{b.channelTypes=}")
-        b.isEnabled = self.readinfo1c("I")
-        print(f"{b.isEnabled=}")
-        b.mainBusLayout = self.readstr1()
-        print(f"{b.mainBusLayout=}")
-        outputBuses.append(b)
-      print("finished reading output buses")
-      errmsg = self.readstr1()  
-      return success, acceptsMidi, producesMidi, inputBuses, outputBuses, errmsg
-
-    def showpluginui(self, pluginId):
+      self.sendmsg(protocol.get_channels_info_args, pluginId)
+      def decode():
+        r = self.readmsgc(protocol.get_channels_info_reply)
+        return r.success, r.acceptsMidi, r.producesMidi, [todummy(b) for b in r.inputBuses], [todummy(b) for b in r.outputBuses], r.errmsg
+      return self.reply(decode, wait)
+
+    def showpluginui(self, pluginId, wait=True):
       #success, errmsg
       self.sendcmd(send_cmd.show_plugin_ui)
-      self.sendinfo("I", pluginId)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I"), self.readstr1()
+      self.sendmsg(protocol.show_plugin_ui_args, pluginId)
+      return self.reply(lambda: tuple(self.readmsgc(protocol.show_plugin_ui_reply)), wait)
+
+    def setnotificationinterval(self, ms):
+      """How long the server collects notifications before sending a batch. 0 sends as soon as anything happens"""
+      self.sendcmd(send_cmd.set_notification_interval)
+      self.sendmsg(protocol.set_notification_interval_args, ms)
+      self.flushcmd()
+
+    def subscribe(self, streams=None, keys=(), rates=None):
+      """Choose which notification_batch streams the server sends this client; other clients keep their own
+      subscriptions. Events no client wants are dropped where they're produced, so they cost close to nothing.
+
+      Args:
+        streams: NotificationStream values to receive, e.g. (NotificationStream.params,). None for all, () for none
+        keys: plugin keys whose parameter changes are wanted; empty for every plugin
+        rates: {NotificationStream value: max events per second}. MIDI streams drop events over the rate;
+               parameter changes are held and coalesced instead, so the latest value always arrives
+      """
+      if streams is None:
+        streams = range(NotificationStream.count)
+      mask = 0
+      for stream in streams:
+        mask |= 1 << stream
+      rates = rates or {}
+      self.sendcmd(send_cmd.subscribe)
+      self.sendmsg(protocol.subscribe_args, mask, [(key,) for key in keys],
+                   *(float(rates.get(stream, 0)) for stream in range(NotificationStream.count)))
+      self.flushcmd()
+
+    def subscribeaudiotap(self, key, bus=0, ringFrames=0, wait=True):
+      """Streams output bus `bus` of plugin `key` into shared memory. Returns an AudioTap, or None with the server's
+      error printed, or on CPUs without x86 memory ordering. ringFrames 0 uses the server's default"""
+      if not x86_memory_order:
+        print("audio taps need x86 memory ordering")
+        future = concurrent.futures.Future()
+        future.set_result(None)
+        return None if wait else future
+      self.sendcmd(send_cmd.subscribe_audio_tap)
+      self.sendmsg(protocol.subscribe_audio_tap_args, key, bus, ringFrames)
+      def decode():
+        tapId, name, channels, capacity, errmsg = self.readmsgc(protocol.subscribe_audio_tap_reply)
+        if tapId < 0:
+          print(f"audio tap failed: {errmsg}")
+          return None
+        return AudioTap(tapId, name, channels, capacity)
+      return self.reply(decode, wait)
+
+    def unsubscribeaudiotap(self, tap):
+      self.sendcmd(send_cmd.unsubscribe_audio_tap)
+      self.sendmsg(protocol.unsubscribe_audio_tap_args, tap.tapId)
+      self.flushcmd()
 
     def schedulemidinote(self, *args):
       #in: index, note, velocity, startTime, duration, channel
       self.sendcmd(send_cmd.schedule_midi_note)
-      self.sendinfo("IIfddI", *args)
-      self.commands_pipe_handle.flush()
+      self.sendmsg(protocol.schedule_midi_note_args, *args)
+      self.flushcmd()
 
     def schedulemidicc(self, *args): #todo: add to song
       #in: pluginId, controller, value, time, channel
       self.sendcmd(send_cmd.schedule_midi_cc)
-      self.senfindo("IIId", *args)
-      self.commands_pipe_handle_flush()
+      self.sendmsg(protocol.schedule_midi_cc_args, *args)
+      self.flushcmd()
     
     def schedulemidiccs(self, arg):
       for e in arg:
         self.sendcmd(send_cmd.schedule_midi_cc)
-        self.senfindo("IIId", *e)
-      self.commands_pipe_handle_flush()
+        self.sendmsg(protocol.schedule_midi_cc_args, *e)
+      self.flushcmd()
       
     def clearmidischedule(self): #todo: remove from song?
       self.sendcmd(send_cmd.clear_midi_schedule)
-      self.commands_pipe_handle_flush()
+      self.flushcmd()
 
     def clearmidiccschedule(self):
       """Clear only scheduled MIDI CC events, keeping notes intact"""
       self.sendcmd(send_cmd.clear_midi_cc_schedule)
-      self.commands_pipe_handle_flush()
+      self.flushcmd()
+
+    def clearmidievents(self, key=-1, categories=None, start=None, end=None):
+      """Clear some of the scheduled MIDI while playback carries on, e.g. the CCs of one plugin in bars 20-40
+
+      Args:
+        key: Plugin unique id, or -1 for every plugin
+        categories: protocol.EventCategory values to clear, all of them if None. A note goes with its note off
+        start, end: the samples events must start in, [start, end); None for the start or end of the timeline
+      """
+      if categories is None:
+        categories = range(protocol.EventCategory.count)
+      mask = 0
+      for category in categories:
+        mask |= 1 << category
+      self.sendcmd(send_cmd.clear_midi_events)
+      self.sendmsg(protocol.clear_midi_events_args, key, mask, -2**63 if start is None else start, 2**63 - 1 if end is None else end)
+      self.flushcmd()
 
     def clearparamschedule(self):
       """Clear all scheduled parameter changes"""
       self.sendcmd(send_cmd.clear_param_schedule)
-      self.commands_pipe_handle_flush()
+      self.flushcmd()
 
     def clearallplugins(self):
       """Clear all loaded plugins from the processor graph"""
       self.sendcmd(send_cmd.clear_all_plugins)
-      self.commands_pipe_handle_flush()
+      self.flushcmd()
+
+    def removeplugin(self, key):
+      """Remove the plugin loaded under key from the processor graph"""
+      self.sendcmd(send_cmd.remove_plugin)
+      self.sendmsg(protocol.remove_plugin_args, key)
+      self.flushcmd()
 
     def scheduleparamchange(self, *args): #todo: add to song
       #in: pluginId, parameterIndex, value, atBlock)
       self.sendcmd(send_cmd.schedule_param_change)
-      self.sendinfo("IIfQ", *args)
-      self.commands_pipe_handle_flush()
+      self.sendmsg(protocol.schedule_param_change_args, *args)
+      self.flushcmd()
 
     def scheduleparamchanges(self, arg):
       for e in arg:
         self.sendcmd(send_cmd.schedule_param_change)
-        self.sendinfo("IIfQ", *e)
-      self.commands_pipe_handle_flush()
+        self.sendmsg(protocol.schedule_param_change_args, *e)
+      self.flushcmd()
 
     def schedulemidinotes(self, arg):
-      for e in arg:
-        self.sendcmd(send_cmd.schedule_midi_cc)
-        self.sendinfo("IIfddI", *e)
-      self.commands_pipe_handle.flush()
+      #in: list of (index, note, velocity, startTime, duration, channel)
+      self.schedulemidieventsbulk(midinotestoevents(arg))
+
+    def schedulemidieventsbulk(self, events):
+      """Upload many MIDI events in one command
+      
+      Args:
+        events: sequence of (key, status, data1, data2, sampleTime) tuples, or a numpy structured array /
+                bytes object already laid out as packed protocol.MidiEventRecord records.
+                sampleTime is relative to the scheduler's current position.
+      """
+      self.sendcmd(send_cmd.schedule_midi_events_bulk)
+      self.sendmsg(protocol.schedule_midi_events_bulk_args, events)
+      self.flushcmd()
+
+    def settempomap(self, tempos, signatures=(), wait=True):
+      """Replace the server's tempo map. Everything scheduled in beats moves to match, without sending it again
+
+      Args:
+        tempos: (beat, bpm, ramp) tuples. Beats are quarter notes from the start of the timeline; ramp True
+                ramps linearly to the next tempo instead of jumping
+        signatures: (bar, numerator, denominator) tuples, bars counting from 0. 4/4 if empty
+      Returns (success, errmsg)
+      """
+      self.sendcmd(send_cmd.set_tempo_map)
+      self.sendmsg(protocol.set_tempo_map_args, [(beat, bpm, int(ramp)) for beat, bpm, ramp in tempos], list(signatures))
+      return self.reply(lambda: tuple(self.readmsgc(protocol.set_tempo_map_reply)), wait)
+
+    def schedulemidinoteatbeat(self, key, note, velocity, startBeat, durationBeats, channel=1):
+      self.sendcmd(send_cmd.schedule_midi_note_at_beat)
+      self.sendmsg(protocol.schedule_midi_note_at_beat_args, key, note, velocity, startBeat, durationBeats, channel)
+      self.flushcmd()
+
+    def schedulemidiccatbeat(self, key, controller, value, beat, channel=1):
+      self.sendcmd(send_cmd.schedule_midi_cc_at_beat)
+      self.sendmsg(protocol.schedule_midi_cc_at_beat_args, key, controller, value, beat, channel)
+      self.flushcmd()
+
+    def scheduleparamchangeatbeat(self, key, parameterIndex, value, beat):
+      self.sendcmd(send_cmd.schedule_param_change_at_beat)
+      self.sendmsg(protocol.schedule_param_change_at_beat_args, key, parameterIndex, value, beat)
+      self.flushcmd()
+
+    def setautomationlane(self, key, parameterIndex, points, resolution=0):
+      """Replace a parameter's automation lane with an envelope the server works out as it renders.
+
+      Args:
+        key: The plugin's key.
+        parameterIndex: The parameter's index.
+        points: (sampleTime, value, shape) breakpoints, sampleTime from the start of playback, value
+          normalised 0 to 1, shape a protocol.CurveShape for the segment to the next point. Empty removes the lane.
+        resolution: Samples between values along a ramp, which splits the render's blocks; 0 sets one value a block.
+      """
+      self.sendcmd(send_cmd.set_automation_lane)
+      self.sendmsg(protocol.set_automation_lane_args, key, parameterIndex, resolution, points)
+      self.flushcmd()
+
+    def addautomationpoints(self, key, parameterIndex, points):
+      """Add (sampleTime, value, shape) breakpoints to a parameter's automation lane, as in setautomationlane"""
+      self.sendcmd(send_cmd.add_automation_points)
+      self.sendmsg(protocol.add_automation_points_args, key, parameterIndex, points)
+      self.flushcmd()
+
+    def startautomationrecording(self, capacity=0):
+      """Record parameter moves made from plugin editors or controllers while playing, to the sample.
+
+      Args:
+        capacity: How many moves the server makes room for; later ones are dropped. 0 uses the server's default.
+      """
+      self.sendcmd(send_cmd.start_automation_recording)
+      self.sendmsg(protocol.start_automation_recording_args, capacity)
+      self.flushcmd()
+
+    def stopautomationrecording(self, tolerance=0.002, wait=True):
+      """Stop recording and get the moves back thinned into automation lanes.
+
+      Args:
+        tolerance: How far, in normalised parameter value, a lane may stray from what was recorded.
+
+      Returns:
+        ({(key, parameterIndex): AutomationPointRecord array for setautomationlane}, moves recorded, moves dropped)
+      """
+      self.sendcmd(send_cmd.stop_automation_recording)
+      self.sendmsg(protocol.stop_automation_recording_args, tolerance)
+      def decode():
+        r = self.readmsgc(protocol.stop_automation_recording_reply)
+        lanes = {}
+        for key, parameterIndex in dict.fromkeys(zip(r.points["key"].tolist(), r.points["parameterIndex"].tolist())):
+          recorded = r.points[(r.points["key"] == key) & (r.points["parameterIndex"] == parameterIndex)]
+          lane = np.zeros(len(recorded), protocol.AutomationPointRecord.dtype)
+          lane["sampleTime"] = recorded["sampleTime"]
+          lane["value"] = recorded["value"]
+          lanes[(key, parameterIndex)] = lane
+        return lanes, r.recorded, r.dropped
+      return self.reply(decode, wait)
+
+    def scheduleparamchangeatsample(self, key, parameterIndex, value, sample):
+      """Schedules a parameter change at an exact sample; rendering splits the block there.
+
+      Args:
+        key: The plugin's key.
+        parameterIndex: The parameter's index.
+        value: The normalised value, 0 to 1.
+        sample: Samples from the start of playback.
+      """
+      self.sendcmd(send_cmd.schedule_param_change_at_sample)
+      self.sendmsg(protocol.schedule_param_change_at_sample_args, key, parameterIndex, value, sample)
+      self.flushcmd()
+
+    def schedulemidieventsbulkatbeats(self, events):
+      """Like schedulemidieventsbulk with (key, status, data1, data2, beat) events, or protocol.MidiBeatEventRecord
+      records. Beats are absolute and follow the tempo map"""
+      self.sendcmd(send_cmd.schedule_midi_events_bulk_at_beats)
+      self.sendmsg(protocol.schedule_midi_events_bulk_at_beats_args, events)
+      self.flushcmd()
 
     def connectaudio(self, sourcePluginId, sourcechan, destPluginId, destchan):
       self.sendcmd(send_cmd.connect_audio)
-      self.sendinfo("IIII", sourcePluginId, sourcechan, destPluginId, destchan)
+      self.sendmsg(protocol.connect_audio_args, sourcePluginId, sourcechan, destPluginId, destchan)
+      return self.reply(lambda: self.readmsgc(protocol.connect_audio_reply).success)
 
-    def startplayback(self, endblock, tofile, filename):
+    def startplayback(self, endblock, tofile, filename, wait=True):
       self.sendcmd(send_cmd.start_playback)
-      self.sendinfo("QI", endblock, tofile)
-      if tofile:
-        self.sendstr(filename)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      self.sendmsg(protocol.start_playback_args, endblock, int(tofile), filename if tofile else "")
+      return self.reply(lambda: self.readmsgc(protocol.start_playback_reply).started, wait)
+
+    def seek(self, sample):
+      """Move playback to sample. Notes sounding there start again, and CCs, pitch bend and parameters take
+      the values they'd have had playing from the start"""
+      self.sendcmd(send_cmd.seek)
+      self.sendmsg(protocol.seek_args, sample)
+      self.flushcmd()
+
+    def setloop(self, start, end, wait=True):
+      """Loop playback between samples start and end, chasing at each wrap as seek does. MIDI, parameter
+      changes and automation all loop on the sample. setloop(0, 0) stops looping
+      Returns (success, errmsg)
+      """
+      self.sendcmd(send_cmd.set_loop)
+      self.sendmsg(protocol.set_loop_args, start, end)
+      return self.reply(lambda: tuple(self.readmsgc(protocol.set_loop_reply)), wait)
+
+    def streammidieventfile(self, path, wait=True):
+      """Play the events in a file written by writemidieventfile along with everything scheduled, without
+      uploading them. The server maps the file and reads it a few seconds ahead of the playhead, so a song
+      can be far bigger than memory. seek and setloop apply to it too; an empty path stops streaming
+      Returns (success, errmsg)
+      """
+      self.sendcmd(send_cmd.stream_midi_event_file)
+      self.sendmsg(protocol.stream_midi_event_file_args, os.path.abspath(path) if path else "")
+      return self.reply(lambda: tuple(self.readmsgc(protocol.stream_midi_event_file_reply)), wait)
+
+    def editschedule(self, deletes=(), moves=(), events=(), paramdeletes=(), parammoves=(), paramchanges=()):
+      """Edit what was scheduled with IDs, in one command. IDs are the caller's; events and parameter changes
+      have separate ones
+
+      Args:
+        deletes: IDs of events to delete
+        moves: (id, sampleTime) to move an event to start at sampleTime; a note keeps its duration
+        events: (id, key, status, data1, data2, sampleTime, duration) to insert, sampleTime absolute. A note on
+                with a duration gets its note off too. An ID already scheduled is replaced
+        paramdeletes, parammoves, paramchanges: the same for parameter changes, as IDs, (id, atBlock) and
+                (id, key, parameterIndex, value, atBlock)
+      Deletes go first, then moves, then inserts. Unknown IDs are ignored
+      """
+      self.sendcmd(send_cmd.edit_schedule)
+      self.sendmsg(protocol.edit_schedule_args, [(id,) for id in deletes], moves, events,
+        [(id,) for id in paramdeletes], parammoves, paramchanges)
+      self.flushcmd()
+
+    def replaceeventrange(self, key, start, end, events=()):
+      """Replace key's events with IDs that start in samples [start, end), e.g. one bar, with events, as in editschedule"""
+      self.sendcmd(send_cmd.replace_event_range)
+      self.sendmsg(protocol.replace_event_range_args, key, start, end, events)
+      self.flushcmd()
+
+    def replaceparamchangerange(self, key, firstBlock, endBlock, changes=()):
+      """Replace key's parameter changes with IDs in blocks [firstBlock, endBlock) with changes, as in editschedule"""
+      self.sendcmd(send_cmd.replace_param_change_range)
+      self.sendmsg(protocol.replace_param_change_range_args, key, firstBlock, endBlock, changes)
+      self.flushcmd()
+
+    def schedulemidicurve(self, key, status, controller, points, resolution=64):
+      """Schedule a CC, channel pressure or pitch bend curve as breakpoints, expanded by the server as it plays
+
+      Args:
+        key: Plugin unique id
+        status: 0xB0-0xBF for a CC, 0xD0-0xDF for channel pressure, 0xE0-0xEF for pitch bend
+        controller: CC number (ignored for pressure and pitch bend)
+        points: (sampleTime, value, shape) breakpoints, sampleTime relative to the current position, value
+                0-127 (0-16383 for pitch bend) and shape a protocol.CurveShape for the segment that follows
+        resolution: samples between messages; a message is only sent when the value has changed
+      """
+      self.sendcmd(send_cmd.schedule_midi_curve)
+      self.sendmsg(protocol.schedule_midi_curve_args, key, status, controller, resolution, points)
+      self.flushcmd()
 
-    def routekeyboardinput(self, pluginId, use_velocity=True, fixed_velocity=1.0):
+    def definemidiclip(self, clipId, events):
+      """Store a pattern once in the server, to be played by scheduleclipinstances on any plugin
+
+      Args:
+        clipId: the caller's ID for the clip; defining it again replaces it wherever it plays
+        events: (status, data1, data2, sampleTime) tuples, sampleTime from the start of the clip
+      """
+      self.sendcmd(send_cmd.define_midi_clip)
+      self.sendmsg(protocol.define_midi_clip_args, clipId, events)
+      self.flushcmd()
+
+    def scheduleclipinstances(self, key, instances):
+      """Play clips on a plugin, each from (clipId, sampleTime, transpose, velocityScale), sampleTime relative to
+      the current position. Only the instances are sent, so a repeated bar costs the same however long it plays"""
+      self.sendcmd(send_cmd.schedule_clip_instances)
+      self.sendmsg(protocol.schedule_clip_instances_args, key, instances)
+      self.flushcmd()
+
+    def routekeyboardinput(self, pluginId, use_velocity=True, fixed_velocity=1.0, wait=True):
       """Route MIDI keyboard input to a specific plugin
 
       Args:
@@ -462,37 +1198,33 @@ class JuceAudioClient:
         fixed_velocity: Fixed velocity value (0.0-1.0) when use_velocity is False
       """
       self.sendcmd(send_cmd.route_keyboard_input)
-      self.sendinfo("IIf", pluginId, int(use_velocity), fixed_velocity)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      self.sendmsg(protocol.route_keyboard_input_args, pluginId, int(use_velocity), fixed_velocity)
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def unroutekeyboardinput(self):
+    def unroutekeyboardinput(self, wait=True):
       """Disable keyboard routing"""
       self.sendcmd(send_cmd.unroute_keyboard_input)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def showvirtualkeyboard(self):
+    def showvirtualkeyboard(self, wait=True):
       """Show the virtual MIDI keyboard window
 
       Returns:
         success: 1 if successful, 0 otherwise
       """
       self.sendcmd(send_cmd.show_virtual_keyboard)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def hidevirtualkeyboard(self):
+    def hidevirtualkeyboard(self, wait=True):
       """Hide the virtual MIDI keyboard window
 
       Returns:
         success: 1 if successful, 0 otherwise
       """
       self.sendcmd(send_cmd.hide_virtual_keyboard)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def routevirtualkeyboard(self, pluginId, use_velocity=True, fixed_velocity=1.0):
+    def routevirtualkeyboard(self, pluginId, use_velocity=True, fixed_velocity=1.0, wait=True):
       """Route virtual keyboard input to a specific plugin
 
       Args:
@@ -501,17 +1233,15 @@ class JuceAudioClient:
         fixed_velocity: Fixed velocity value (0.0-1.0) when use_velocity is False
       """
       self.sendcmd(send_cmd.route_virtual_keyboard)
-      self.sendinfo("IIf", pluginId, int(use_velocity), fixed_velocity)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      self.sendmsg(protocol.route_virtual_keyboard_args, pluginId, int(use_velocity), fixed_velocity)
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def unroutevirtualkeyboard(self):
+    def unroutevirtualkeyboard(self, wait=True):
       """Disable virtual keyboard routing"""
       self.sendcmd(send_cmd.unroute_virtual_keyboard)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def scheduleorderednotes(self, notes):
+    def scheduleorderednotes(self, notes, wait=True):
       """Schedule notes to be triggered in order by any MIDI key press
 
       Args:
@@ -519,13 +1249,10 @@ class JuceAudioClient:
                Notes with same order_number will be triggered simultaneously
       """
       self.sendcmd(send_cmd.schedule_ordered_notes)
-      self.sendinfo("I", len(notes))
-      for order, note, velocity, channel, duration in notes:
-        self.sendinfo("IIIII", order, note, velocity, channel, duration)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")  # Returns count of notes added
+      self.sendmsg(protocol.schedule_ordered_notes_args, notes)
+      return self.reply(lambda: self.readinfo1c("I"), wait)  # Returns count of notes added
 
-    def startorderedplayback(self, use_keyboard_velocity=True, use_keyboard_duration=True):
+    def startorderedplayback(self, use_keyboard_velocity=True, use_keyboard_duration=True, wait=True):
       """Start ordered note playback mode
 
       Args:
@@ -536,21 +1263,24 @@ class JuceAudioClient:
       If not running, will activate when playback starts.
       """
       self.sendcmd(send_cmd.start_ordered_playback)
-      self.sendinfo("II", int(use_keyboard_velocity), int(use_keyboard_duration))
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      self.sendmsg(protocol.start_ordered_playback_args, int(use_keyboard_velocity), int(use_keyboard_duration))
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def stoporderedplayback(self):
+    def stoporderedplayback(self, wait=True):
       """Stop ordered note playback mode"""
       self.sendcmd(send_cmd.stop_ordered_playback)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      return self.reply(lambda: self.readinfo1c("I"), wait)
 
-    def clearorderednotes(self):
+    def clearorderednotes(self, wait=True):
       """Clear all scheduled ordered notes"""
       self.sendcmd(send_cmd.clear_ordered_notes)
-      self.commands_pipe_handle.flush()
-      return self.readinfo1c("I")
+      return self.reply(lambda: self.readinfo1c("I"), wait)
+
+    def controlaudioplayback(self, playerId, action, startSample=0, fileStartPosition=0, wait=True):
+      """Stop (action 0), start (1) or schedule (2, at startSample) an audio file loaded on the server"""
+      self.sendcmd(send_cmd.control_audio_playback)
+      self.sendmsg(protocol.control_audio_playback_args, playerId, action, startSample, fileStartPosition)
+      return self.reply(lambda: self.readmsgc(protocol.control_audio_playback_reply).success, wait)
 
 class ParamSchedule(list):
   def __init__(self, *args):
@@ -658,8 +1388,8 @@ class MidiToParamConnections(list):
     if type(item) in (list, tuple):
       self.append(
 
-class Processors(dict):
-  def __init__(self, arg):
+class Processors(dict): #key -> Processor
+  def __init__(self, arg=()):
     super().__init__(arg)
 
 class MidiCcSchedule(list):
@@ -675,6 +1405,9 @@ class Song:
     self.processors = processors or Processors()
     self.paramSchedules = paramSchedules or []
     self.client = client
+    self.sentIds = {} #schedule record -> IDs the server has it under, see send
+    self.nextId = 1
+    self.sentProcessors = None #key -> uid loaded on the server, see send
   def add(self, *items):
     for item in items:
       if type(item) is ParamSchedule:
@@ -690,7 +1423,7 @@ class Song:
       elif type(item) is Processors:
         self.processors = item
       elif type(item) is Processor:
-        self.processors.append(item)
+        self.processors[item.key] = item
   def remove(self, *items): #todo: reverse merge instead of just remove? but that would practically require a single list of each type rather than multiple
     for item in items:
       if type(item) is ParamSchedule:
@@ -703,28 +1436,85 @@ class Song:
       elif type(item) is AudioTrack:
         self.audioTracks.remove(item)
       elif type(item) is Processors:
-        self.processors = None
-      elif type(item) is Proessor:
-        self.processors.remove(item)
-  def send(self):
-    self.client.clearparamschedule()
-    for paramschedule in self.paramSchedules:
-      self.client.scheduleparamchanges(paramschedule)
-    self.client.clearmidiccschedule()
-    for midiccschedule in self.midiCcSchedules:
-      self.client.schedulemidiccs(self.midiccschedule)
-    self.client.clearmidischedule()
+        self.processors = Processors()
+      elif type(item) is Processor:
+        del self.processors[item.key]
+  def schedulerecords(self):
+    """The song's notes, CCs and parameter changes as ('event', key, status, data1, data2, sampleTime, duration)
+    and ('param', key, parameterIndex, value, atBlock) tuples, times counted from the start of the song at the
+    engine's sample rate"""
+    rate = self.client.samplerate
+    records = []
     for midischedule in self.midiSchedules:
-      self.client.schedulemidinotes(midischedule)
-    self.client.clearorderednotes()
-    self.client.scheduleorderednotes(self.orderednotesschedule)
-    self.client.clearallplugins()
-    if self.availablePlugins is None:
-      self.scanplugins()
-    for processor in self.processors: 
-      for index, availablePlugin in enumerate(self.client.availablePlugins):
-        if availablePlugin.pluginInfo.uid==processor.pluginInfo.uid:
-          self.client.loadpluginbyindex(index)
+      for key, note, velocity, startTime, duration, channel in midischedule:
+        records.append(('event', key, 0x90 | (channel - 1), note, int(velocity * 127), int(startTime * rate), int(duration * rate)))
+    for midiccschedule in self.midiCcSchedules:
+      for key, controller, value, time, channel in midiccschedule:
+        records.append(('event', key, 0xb0 | (channel - 1), controller, value, int(time * rate), 0))
+    for paramschedule in self.paramSchedules:
+      for key, parameterIndex, value, atBlock in paramschedule:
+        records.append(('param', key, parameterIndex, value, atBlock))
+    return records
+  def send(self):
+    """Bring the server up to date with the song. The first send clears the server's schedules and sends
+    everything, each note, CC and parameter change under its own ID; later sends only send the difference
+    from the last one, as one edit_schedule command, so editing a bar costs a few records instead of a reload.
+    Something that only changed time is moved, keeping its ID. Processors are diffed by key the same way: new
+    ones are loaded, dropped ones removed and ones whose plugin changed reloaded"""
+    if not self.sentIds:
+      self.client.clearparamschedule()
+      self.client.clearmidiccschedule()
+      self.client.clearmidischedule()
+    current = collections.Counter(self.schedulerecords())
+    untimed = lambda record: record[:5] + record[6:] if record[0] == 'event' else record[:4]
+    movable = collections.defaultdict(list) #untimed record -> IDs of ones no longer in the song
+    for record, ids in list(self.sentIds.items()):
+      while len(ids) > current[record]:
+        movable[untimed(record)].append(ids.pop())
+      if not ids:
+        del self.sentIds[record]
+    moves, events, parammoves, paramchanges = [], [], [], []
+    for record, count in current.items():
+      ids = self.sentIds.setdefault(record, [])
+      while len(ids) < count:
+        candidates = movable.get(untimed(record))
+        if candidates:
+          id = candidates.pop()
+          if record[0] == 'event':
+            moves.append((id, record[5]))
+          else:
+            parammoves.append((id, record[4]))
+        else:
+          id = self.nextId
+          self.nextId += 1
+          if record[0] == 'event':
+            events.append((id,) + record[1:])
+          else:
+            paramchanges.append((id,) + record[1:])
+        ids.append(id)
+    deletes = [id for record, ids in movable.items() if record[0] == 'event' for id in ids]
+    paramdeletes = [id for record, ids in movable.items() if record[0] == 'param' for id in ids]
+    if deletes or moves or events or paramdeletes or parammoves or paramchanges:
+      self.client.editschedule(deletes, moves, events, paramdeletes, parammoves, paramchanges)
+    if getattr(self, 'orderednotesschedule', None) is not None:
+      self.client.clearorderednotes()
+      self.client.scheduleorderednotes(self.orderednotesschedule)
+    processors = {key: processor.uid if processor.uid is not None else processor.pluginInfo.uid
+                  for key, processor in self.processors.items()}
+    if self.sentProcessors is None:
+      self.client.clearallplugins()
+      self.sentProcessors = {}
+    for key, uid in list(self.sentProcessors.items()):
+      if processors.get(key) != uid:
+        self.client.removeplugin(key)
+        del self.sentProcessors[key]
+    loads = [(key, uid) for key, uid in processors.items() if key not in self.sentProcessors]
+    if loads and self.client.availablePlugins is None:
+      self.client.scanplugins()
+      self.client.listplugins()
+    for key, uid in loads:
+      self.client.loadpluginbyuid(uid, key)
+      self.sentProcessors[key] = uid
   def routecctoparam(self, pluginId, param_index, cc_controller, midi_channel=-1):
     """Map a MIDI CC controller to a plugin parameter
 
@@ -736,14 +1526,12 @@ class Song:
     """
     self.sendcmd(send_cmd.route_cc_to_param)
     self.sendinfo("IIIi", pluginId, param_index, cc_controller, midi_channel)
-    self.commands_pipe_handle.flush()
-    return self.readinfo1c("I")
+    return self.reply(lambda: self.readinfo1c("I"))
   def unroutecctoparam(self, pluginId, param_index, cc_controller):
     """Remove a MIDI CC to parameter mapping"""
     self.sendcmd(send_cmd.unroute_cc_to_param)
     self.sendinfo("III", pluginId, param_index, cc_controller)
-    self.commands_pipe_handle.flush()
-    return self.readinfo1c("I")
+    return self.reply(lambda: self.readinfo1c("I"))
   def save(self, filePath=None):
     filePath = filePath or self.filePath or "song"
     if os.path.exists(filePath):
@@ -792,9 +1580,24 @@ def main():
     while True:
       try:
         cmd = client.readinfo1n("B")
-        if cmd==recv_cmd.param_change:
-          pluginId, parameterIndex, value = client.readinfon("IIf")
-          atBlock = client.readinfo1n("Q")
+        if cmd==recv_cmd.notification_batch:
+          params, notes, ccs, virtualNotes, virtualCCs = client.readnotificationbatch()
+          for pluginId, parameterIndex, value, atBlock in params.tolist():
+            p_c = dummy()
+            p_c.pluginId = pluginId
+            p_c.parameterIndex = parameterIndex
+            p_c.value = value
+            p_c.atBlock = atBlock
+            param_changes.append(p_c)
+          if len(params):
+            print(f"{len(params)} parameter changes")
+          for noteNumber, velocity, channel, isNoteOn, samplePosition in itertools.chain(notes.tolist(), virtualNotes.tolist()):
+            event_type = "NOTE ON" if isNoteOn else "NOTE OFF"
+            print(f"MIDI {event_type}: note={noteNumber}, velocity={velocity}, channel={channel}, sample={samplePosition}")
+          for controller, value, channel, atBlock in itertools.chain(ccs.tolist(), virtualCCs.tolist()):
+            print(f"MIDI CC: controller={controller}, value={value}, channel={channel}, atBlock={atBlock}")
+        elif cmd==recv_cmd.param_changed:
+          pluginId, parameterIndex, value, atBlock = client.readmsgn(protocol.param_changed_notification)
           print(f"parameter change: {pluginId=}, {parameterIndex=}, {value=}, atBlock={atBlock}")
           p_c = dummy()
           p_c.pluginId = pluginId
@@ -803,27 +1606,27 @@ def main():
           p_c.atBlock = atBlock
           param_changes.append(p_c)
         elif cmd==recv_cmd.midi_note_event:
-          noteNumber, velocity, channel, isNoteOn, samplePosition = client.readinfon("IIIIQ")
+          noteNumber, velocity, channel, isNoteOn, samplePosition = client.readmsgn(protocol.midi_note_event_notification)
           event_type = "NOTE ON" if isNoteOn else "NOTE OFF"
           print(f"MIDI {event_type}: note={noteNumber}, velocity={velocity}, channel={channel}, sample={samplePosition}")
         elif cmd==recv_cmd.midi_cc_event:
-          controller, value, channel, atBlock = client.readinfon("IIIQ")
+          controller, value, channel, atBlock = client.readmsgn(protocol.midi_cc_event_notification)
           print(f"MIDI CC: controller={controller}, value={value}, channel={channel}, atBlock={atBlock}")
         elif cmd==recv_cmd.virtual_keyboard_note_event:
-          noteNumber, velocity, channel, isNoteOn, samplePosition = client.readinfon("IIIIQ")
+          noteNumber, velocity, channel, isNoteOn, samplePosition = client.readmsgn(protocol.virtual_keyboard_note_event_notification)
           event_type = "NOTE ON" if isNoteOn else "NOTE OFF"
           print(f"VIRTUAL KEYBOARD {event_type}: note={noteNumber}, velocity={velocity}, channel={channel}, sample={samplePosition}")
         elif cmd==recv_cmd.virtual_keyboard_cc_event:
-          controller, value, channel, atBlock = client.readinfon("IIIQ")
+          controller, value, channel, atBlock = client.readmsgn(protocol.virtual_keyboard_cc_event_notification)
           print(f"VIRTUAL KEYBOARD CC: controller={controller}, value={value}, channel={channel}, atBlock={atBlock}")
         elif cmd==recv_cmd.midi_keyboard_routed:
-          pluginId, samplePosition = client.readinfon("iQ")
+          pluginId, samplePosition = client.readmsgn(protocol.midi_keyboard_routed_notification)
           if pluginId == -3: #todo: check this value
             print(f"MIDI keyboard unrouted at sample {samplePosition}")
           else:
             print(f"MIDI keyboard routed to plugin {pluginId} at sample {samplePosition}")
         elif cmd==recv_cmd.virtual_keyboard_routed:
-          pluginId, samplePosition = client.readinfon("iQ")
+          pluginId, samplePosition = client.readmsgn(protocol.virtual_keyboard_routed_notification)
           if pluginId == -3: #todo: check this value
             print(f"Virtual keyboard unrouted at sample {samplePosition}")
           else:
@@ -857,7 +1660,7 @@ def main():
         print(f"{x}: {a}: {getattr(p, a)}")
   client.startplayback(15*sampleRate//blockSize, False, "")
   x = input()
-  client.commands_pipe_handle.flush()  
+  client.flushcmd()  
   client.disconnect()  
 
 if __name__ == "__main__":
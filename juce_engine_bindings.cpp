@@ -0,0 +1,419 @@
+// In-process Python module around the same CompletePluginHost that juce_gui_server runs, for offline batch
+// rendering without the server process or the pipes. Built by the juce_engine target in CMakeLists.txt:
+//
+//   import juce_engine, numpy as np
+//   engine = juce_engine.Engine(48000, 512)
+//   engine.scanplugins(["/usr/lib/vst3"])
+//   engine.loadpluginbyuid(uid, 0)
+//   engine.connectaudio(0, 0, -1, 0); engine.connectaudio(0, 1, -1, 1)
+//   engine.schedulemidinote(0, 60, 0.8, 0.0, 1.0)
+//   audio = engine.rendersamples(48000 * 2)   # (channels, samples) float32
+//
+// Method names match JuceAudioClient's, so batch scripts can move between the two.
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#define JUCE_ENGINE_MODULE 1
+#include "juce_gui_server.cpp"
+
+namespace py = pybind11;
+
+class InProcessEngine
+{
+public:
+  InProcessEngine(double rate, int samplesPerBlock)
+  {
+    if (app != nullptr)
+      throw runtime_error("only one Engine can exist per process");
+    if (rate <= 0 || samplesPerBlock <= 0)
+      throw invalid_argument("samplerate and blocksize must be positive");
+
+    // The engine's globals; plugins are created at this rate and block size
+    sampleRate = int(rate);
+    blockSize = samplesPerBlock;
+
+    host = make_unique<CompletePluginHost>();
+    app = host.get();
+    host->prepareOffline(rate, samplesPerBlock);
+    cout << "in-process engine ready: " << rate << " Hz, " << samplesPerBlock << " samples per block" << endl;
+  }
+
+  ~InProcessEngine()
+  {
+    host = nullptr;
+    app = nullptr;
+  }
+
+  uint32_t scanPlugins(const vector<string>& directories, const vector<string>& badPaths)
+  {
+    py::gil_scoped_release release;
+    {
+      std::lock_guard<std::shared_mutex> lock(host->hostMutex);
+      host->badPaths.insert(badPaths.begin(), badPaths.end());
+    }
+    uint32_t numFound = 0;
+    for (const auto& directory : directories)
+      numFound += host->scanPluginDirectory(juce::File(directory));
+    return numFound;
+  }
+
+  py::list listPlugins()
+  {
+    py::list plugins;
+    for (const auto& plugin : host->availablePlugins)
+    {
+      const auto& desc = plugin.desc;
+      py::dict p;
+      p["isInstrument"] = desc.isInstrument;
+      p["uid"] = desc.uniqueId;
+      p["numInputChannels"] = desc.numInputChannels;
+      p["numOutputChannels"] = desc.numOutputChannels;
+      p["name"] = desc.name.toStdString();
+      p["descriptiveName"] = desc.descriptiveName.toStdString();
+      p["pluginFormatName"] = desc.pluginFormatName.toStdString();
+      p["category"] = desc.category.toStdString();
+      p["manufacturerName"] = desc.manufacturerName.toStdString();
+      p["version"] = desc.version.toStdString();
+      p["fileOrIdentifier"] = desc.fileOrIdentifier.toStdString();
+      p["path"] = plugin.path;
+      plugins.append(p);
+    }
+    return plugins;
+  }
+
+  vector<string> listBadPaths()
+  {
+    return vector<string>(host->badPaths.begin(), host->badPaths.end());
+  }
+
+  string loadPlugin(const string& path, int key)
+  {
+    auto resp = host->loadPlugin(path, key);
+    if (!resp.success)
+      throw runtime_error("loading " + path + " failed: " + resp.errmsg);
+    return resp.name;
+  }
+
+  string loadPluginByUid(int uid, int key)
+  {
+    auto resp = host->loadPluginByUid(uid, key);
+    if (!resp.success)
+      throw runtime_error("loading plugin " + to_string(uid) + " failed: " + resp.errmsg);
+    return resp.name;
+  }
+
+  void setParameter(int key, int parameterIndex, float value)
+  {
+    auto resp = host->setParameter(key, parameterIndex, value);
+    if (!resp.success)
+      throw runtime_error(resp.errmsg);
+  }
+
+  float getParameter(int key, int parameterIndex)
+  {
+    auto resp = host->getParameter(key, parameterIndex);
+    if (!resp.success)
+      throw runtime_error(resp.errmsg.empty() ? "Plugin not loaded" : resp.errmsg);
+    return resp.value;
+  }
+
+  tuple<uint32_t, uint32_t> getParameterHandles(int key)
+  {
+    auto resp = host->getParameterHandles(key);
+    if (!resp.success)
+      throw runtime_error("no plugin loaded with key " + to_string(key));
+    return { resp.firstHandle, resp.numParams };
+  }
+
+  void setAutomationLane(int key, int parameterIndex, py::buffer points, int resolution)
+  {
+    auto [pointRecords, numPoints] = records<AutomationPointRecord>(points, "points", "AutomationPointRecord");
+    host->scheduler.setAutomationLane(key, parameterIndex, resolution, pointRecords, numPoints);
+  }
+
+  void addAutomationPoints(int key, int parameterIndex, py::buffer points)
+  {
+    auto [pointRecords, numPoints] = records<AutomationPointRecord>(points, "points", "AutomationPointRecord");
+    host->scheduler.addAutomationPoints(key, parameterIndex, pointRecords, numPoints);
+  }
+
+  void setParametersByHandle(py::buffer changes)
+  {
+    auto [changeRecords, numChanges] = records<ParameterHandleValueRecord>(changes, "changes", "ParameterHandleValueRecord");
+    host->setParametersByHandle(changeRecords, numChanges);
+  }
+
+  // events: a contiguous buffer of packed MidiEventRecords, e.g. a numpy array of
+  // juce_protocol.MidiEventRecord.dtype, or the bytes JuceAudioClient would send
+  void scheduleMidiEventsBulk(py::buffer events)
+  {
+    py::buffer_info info = events.request();
+    if (info.ndim > 1 || (info.ndim == 1 && info.strides[0] != info.itemsize))
+      throw invalid_argument("events must be a contiguous 1-d buffer of MidiEventRecords");
+    size_t bytes = size_t(info.size) * size_t(info.itemsize);
+    if (bytes % sizeof(MidiEventRecord) != 0)
+      throw invalid_argument("events size isn't a whole number of " + to_string(sizeof(MidiEventRecord)) + " byte MidiEventRecords");
+    // MidiEventRecord is packed, so reading it straight out of the caller's buffer has no alignment concern
+    host->midiScheduler->scheduleEventsBulk(static_cast<const MidiEventRecord*>(info.ptr), bytes / sizeof(MidiEventRecord));
+  }
+
+  // tempos: (beat, bpm, ramp) tuples; signatures: (bar, numerator, denominator) tuples
+  void setTempoMap(const vector<tuple<double, double, bool>>& tempos, const vector<tuple<int, int, int>>& signatures)
+  {
+    vector<TempoMap::TempoPoint> points;
+    for (const auto& [beat, bpm, ramp] : tempos)
+      points.push_back({ beat, bpm, ramp });
+    vector<TempoMap::TimeSignature> meters;
+    for (const auto& [bar, numerator, denominator] : signatures)
+      meters.push_back({ bar, numerator, denominator });
+    auto resp = host->setTempoMap(std::move(points), std::move(meters));
+    if (!resp.success)
+      throw invalid_argument(resp.errmsg);
+  }
+
+  void scheduleMidiEventsBulkAtBeats(py::buffer events)
+  {
+    py::buffer_info info = events.request();
+    if (info.ndim > 1 || (info.ndim == 1 && info.strides[0] != info.itemsize))
+      throw invalid_argument("events must be a contiguous 1-d buffer of MidiBeatEventRecords");
+    size_t bytes = size_t(info.size) * size_t(info.itemsize);
+    if (bytes % sizeof(MidiBeatEventRecord) != 0)
+      throw invalid_argument("events size isn't a whole number of " + to_string(sizeof(MidiBeatEventRecord)) + " byte MidiBeatEventRecords");
+    host->midiScheduler->scheduleEventsBulkAtBeats(static_cast<const MidiBeatEventRecord*>(info.ptr), bytes / sizeof(MidiBeatEventRecord));
+  }
+
+  // Edits what was scheduled with IDs; each argument is a buffer of its protocol records, e.g. a numpy
+  // array with that record's dtype, used in place
+  void editSchedule(py::buffer deletes, py::buffer moves, py::buffer events,
+    py::buffer paramDeletes, py::buffer paramMoves, py::buffer paramChanges)
+  {
+    auto [deleteRecords, numDeletes] = records<IdRecord>(deletes, "deletes", "IdRecord");
+    auto [moveRecords, numMoves] = records<EventMoveRecord>(moves, "moves", "EventMoveRecord");
+    auto [eventRecords, numEvents] = records<IdentifiedEventRecord>(events, "events", "IdentifiedEventRecord");
+    auto [paramDeleteRecords, numParamDeletes] = records<IdRecord>(paramDeletes, "paramdeletes", "IdRecord");
+    auto [paramMoveRecords, numParamMoves] = records<ParamMoveRecord>(paramMoves, "parammoves", "ParamMoveRecord");
+    auto [changeRecords, numChanges] = records<IdentifiedParamChangeRecord>(paramChanges, "paramchanges", "IdentifiedParamChangeRecord");
+    host->midiScheduler->editEvents(deleteRecords, numDeletes, moveRecords, numMoves, eventRecords, numEvents);
+    host->scheduler.editChanges(paramDeleteRecords, numParamDeletes, paramMoveRecords, numParamMoves, changeRecords, numChanges);
+  }
+
+  void replaceEventRange(int key, int64_t start, int64_t end, py::buffer events)
+  {
+    auto [eventRecords, numEvents] = records<IdentifiedEventRecord>(events, "events", "IdentifiedEventRecord");
+    host->midiScheduler->replaceEventRange(key, start, end, eventRecords, numEvents);
+  }
+
+  void replaceParamChangeRange(int key, uint64_t firstBlock, uint64_t endBlock, py::buffer changes)
+  {
+    auto [changeRecords, numChanges] = records<IdentifiedParamChangeRecord>(changes, "changes", "IdentifiedParamChangeRecord");
+    host->scheduler.replaceChangeRange(key, firstBlock, endBlock, changeRecords, numChanges);
+  }
+
+  void scheduleMidiCurve(int key, uint8_t status, uint8_t controller, py::buffer points, int resolution)
+  {
+    auto [pointRecords, numPoints] = records<CurvePointRecord>(points, "points", "CurvePointRecord");
+    if (!host->midiScheduler->scheduleCurve(key, status, controller, resolution, pointRecords, numPoints))
+      throw invalid_argument("a curve needs points and a CC, channel pressure or pitch bend status");
+  }
+
+  void defineMidiClip(uint32_t clipId, py::buffer events)
+  {
+    auto [eventRecords, numEvents] = records<ClipEventRecord>(events, "events", "ClipEventRecord");
+    host->midiScheduler->defineClip(clipId, eventRecords, numEvents);
+  }
+
+  void scheduleClipInstances(int key, py::buffer instances)
+  {
+    auto [instanceRecords, numInstances] = records<ClipInstanceRecord>(instances, "instances", "ClipInstanceRecord");
+    host->midiScheduler->scheduleClipInstances(key, instanceRecords, numInstances);
+  }
+
+  // Renders into out, a writable C-contiguous float32 array of (channels, samples), without copying.
+  // samples must be a whole number of blocks, since scheduled parameter changes are counted in blocks
+  py::array render(py::array out)
+  {
+    if (!py::isinstance<py::array_t<float>>(out) || !(out.flags() & py::array::c_style))
+      throw invalid_argument("out must be a C-contiguous float32 array");
+    py::buffer_info info = out.request(true);
+    if (info.ndim != 2)
+      throw invalid_argument("out must have shape (channels, samples)");
+    int numChannels = int(info.shape[0]);
+    int64_t numSamples = info.shape[1];
+    int samplesPerBlock = host->processorGraph->getBlockSize();
+    if (numChannels != host->processorGraph->getTotalNumOutputChannels())
+      throw invalid_argument("out has " + to_string(numChannels) + " channels, the graph has "
+        + to_string(host->processorGraph->getTotalNumOutputChannels()));
+    if (numSamples % samplesPerBlock != 0)
+      throw invalid_argument("samples must be a multiple of the block size, " + to_string(samplesPerBlock));
+
+    vector<float*> channels(numChannels);
+    {
+      py::gil_scoped_release release;
+      host->midiScheduler->sync();
+      host->scheduler.sync();
+      juce::MidiBuffer midiBuffer;
+      for (int64_t start = 0; start < numSamples; start += samplesPerBlock)
+      {
+        for (int chan = 0; chan < numChannels; ++chan)
+          channels[chan] = static_cast<float*>(info.ptr) + chan * numSamples + start;
+        juce::AudioBuffer<float> block(channels.data(), numChannels, samplesPerBlock);  // Refers to out, doesn't copy
+        host->renderBlock(block, midiBuffer);
+      }
+    }
+    return out;
+  }
+
+  py::array renderSamples(int64_t numSamples)
+  {
+    py::array_t<float> out({ py::ssize_t(host->processorGraph->getTotalNumOutputChannels()), py::ssize_t(numSamples) });
+    return render(out);
+  }
+
+  // Back to the start of the timeline with everything still scheduled, to render the same song again
+  void rewind()
+  {
+    seek(0);
+    host->processorGraph->reset();
+  }
+
+  // The next render starts at sample, with held notes, controllers and parameters chased
+  void seek(int64_t sample)
+  {
+    host->seekTo(sample);
+    py::gil_scoped_release release;
+    host->midiScheduler->sync();
+  }
+
+  void setLoop(int64_t start, int64_t end)
+  {
+    auto resp = host->setLoop(start, end);
+    if (!resp.success)
+      throw invalid_argument(resp.errmsg);
+    py::gil_scoped_release release;
+    host->midiScheduler->sync();
+  }
+
+  // Streams the events in a file written by juce_client.writemidieventfile; renders wait for the window
+  // around the playhead to be read in, so nothing is missed however fast they go
+  void streamMidiEventFile(const string& path)
+  {
+    auto resp = host->streamMidiEventFile(path);
+    if (!resp.success)
+      throw runtime_error(resp.errmsg);
+    py::gil_scoped_release release;
+    host->midiScheduler->sync();
+  }
+
+  unique_ptr<CompletePluginHost> host;
+
+private:
+  template<typename Record>
+  static pair<const Record*, size_t> records(py::buffer buffer, const string& name, const string& recordName)
+  {
+    py::buffer_info info = buffer.request();
+    if (info.ndim > 1 || (info.ndim == 1 && info.strides[0] != info.itemsize))
+      throw invalid_argument(name + " must be a contiguous 1-d buffer of " + recordName + "s");
+    size_t bytes = size_t(info.size) * size_t(info.itemsize);
+    if (bytes % sizeof(Record) != 0)
+      throw invalid_argument(name + " size isn't a whole number of " + to_string(sizeof(Record)) + " byte " + recordName + "s");
+    return { static_cast<const Record*>(info.ptr), bytes / sizeof(Record) };
+  }
+
+  juce::ScopedJuceInitialiser_GUI juceInitialiser;  // Makes the constructing thread JUCE's message thread
+};
+
+PYBIND11_MODULE(juce_engine, m)
+{
+  m.doc() = "The juce_gui_server engine in-process: load plugins, schedule MIDI and parameter changes, and render into numpy arrays";
+
+  py::class_<InProcessEngine>(m, "Engine")
+    .def(py::init<double, int>(), py::arg("samplerate") = 48000.0, py::arg("blocksize") = 512)
+    .def_property_readonly("samplerate", [](InProcessEngine& e) { return e.host->processorGraph->getSampleRate(); })
+    .def_property_readonly("blocksize", [](InProcessEngine& e) { return e.host->processorGraph->getBlockSize(); })
+    .def_property_readonly("channels", [](InProcessEngine& e) { return e.host->processorGraph->getTotalNumOutputChannels(); })
+    .def_property_readonly("position", [](InProcessEngine& e) { return e.host->midiScheduler->getCurrentPosition(); },
+      "Where the next render starts, in samples from the start of the timeline")
+    .def("scanplugins", &InProcessEngine::scanPlugins, py::arg("directories"), py::arg("badpaths") = vector<string>(),
+      "Scan directories for plugins, skipping badpaths. Returns how many were found")
+    .def("listplugins", &InProcessEngine::listPlugins)
+    .def("listbadpaths", &InProcessEngine::listBadPaths)
+    .def("loadplugin", &InProcessEngine::loadPlugin, py::arg("path"), py::arg("key"),
+      "Load the plugin at path as key. Returns its name; raises RuntimeError if it won't load")
+    .def("loadpluginbyuid", &InProcessEngine::loadPluginByUid, py::arg("uid"), py::arg("key"),
+      "Load a scanned plugin as key, with a MIDI source node for scheduled MIDI. Returns its name")
+    .def("removeplugin", [](InProcessEngine& e, int key) { e.host->removePlugin(key); })
+    .def("clearallplugins", [](InProcessEngine& e) { e.host->clearAllPlugins(); e.host->setupAudioIO(); })
+    .def("connectaudio", [](InProcessEngine& e, int sourceKey, int sourceChannel, int destKey, int destChannel) {
+        return bool(e.host->connectAudio(sourceKey, sourceChannel, destKey, destChannel));
+      }, "Keys -1 and -2 are the graph's audio output and input")
+    .def("connectmidi", [](InProcessEngine& e, int sourceKey, int destKey) { return bool(e.host->connectMidi(sourceKey, destKey)); })
+    .def("setparameter", &InProcessEngine::setParameter, py::arg("key"), py::arg("parameterIndex"), py::arg("value"))
+    .def("getparameter", &InProcessEngine::getParameter, py::arg("key"), py::arg("parameterIndex"))
+    .def("getparameterhandles", &InProcessEngine::getParameterHandles, py::arg("key"))
+    .def("setparametersbyhandle", &InProcessEngine::setParametersByHandle, py::arg("changes"))
+    .def("schedulemidinote", [](InProcessEngine& e, int key, int note, float velocity, double startTime, double duration, int channel) {
+        e.host->midiScheduler->scheduleNote(key, note, velocity, startTime, duration, channel);
+      }, py::arg("key"), py::arg("note"), py::arg("velocity"), py::arg("startTime"), py::arg("duration"), py::arg("channel") = 1,
+      "Times are in seconds from the current position")
+    .def("schedulemidicc", [](InProcessEngine& e, int key, int controller, int value, double time, int channel) {
+        e.host->midiScheduler->scheduleCC(key, controller, value, time, channel);
+      }, py::arg("key"), py::arg("controller"), py::arg("value"), py::arg("time"), py::arg("channel") = 1)
+    .def("schedulemidieventsbulk", &InProcessEngine::scheduleMidiEventsBulk, py::arg("events"))
+    .def("scheduleparamchange", [](InProcessEngine& e, int key, int parameterIndex, float value, uint64_t atBlock) {
+        e.host->scheduler.scheduleParameterChange(key, parameterIndex, value, atBlock);
+      }, py::arg("key"), py::arg("parameterIndex"), py::arg("value"), py::arg("atBlock"))
+    .def("scheduleparamchangeatsample", [](InProcessEngine& e, int key, int parameterIndex, float value, uint64_t sample) {
+        e.host->scheduler.scheduleParameterChangeAtSample(key, parameterIndex, value, sample);
+      }, py::arg("key"), py::arg("parameterIndex"), py::arg("value"), py::arg("sample"))
+    .def("setautomationlane", &InProcessEngine::setAutomationLane, py::arg("key"), py::arg("parameterIndex"), py::arg("points"),
+      py::arg("resolution") = 0)
+    .def("addautomationpoints", &InProcessEngine::addAutomationPoints, py::arg("key"), py::arg("parameterIndex"), py::arg("points"))
+    .def("settempomap", &InProcessEngine::setTempoMap, py::arg("tempos"), py::arg("signatures") = vector<tuple<int, int, int>>(),
+      "tempos: (beat, bpm, ramp) tuples, beats in quarter notes from the start; signatures: (bar, numerator, denominator). "
+      "Everything scheduled in beats moves to match")
+    .def("schedulemidinoteatbeat", [](InProcessEngine& e, int key, int note, float velocity, double startBeat, double durationBeats, int channel) {
+        e.host->midiScheduler->scheduleNoteAtBeat(key, note, velocity, startBeat, durationBeats, channel);
+      }, py::arg("key"), py::arg("note"), py::arg("velocity"), py::arg("startBeat"), py::arg("durationBeats"), py::arg("channel") = 1)
+    .def("schedulemidiccatbeat", [](InProcessEngine& e, int key, int controller, int value, double beat, int channel) {
+        e.host->midiScheduler->scheduleCCAtBeat(key, controller, value, beat, channel);
+      }, py::arg("key"), py::arg("controller"), py::arg("value"), py::arg("beat"), py::arg("channel") = 1)
+    .def("scheduleparamchangeatbeat", [](InProcessEngine& e, int key, int parameterIndex, float value, double beat) {
+        e.host->scheduler.scheduleParameterChangeAtBeat(key, parameterIndex, value, beat, *e.host->tempoMap, e.host->midiScheduler->getSampleRate());
+      }, py::arg("key"), py::arg("parameterIndex"), py::arg("value"), py::arg("beat"))
+    .def("schedulemidieventsbulkatbeats", &InProcessEngine::scheduleMidiEventsBulkAtBeats, py::arg("events"))
+    .def("clearmidischedule", [](InProcessEngine& e) { e.host->midiScheduler->clearSchedule(); })
+    .def("clearmidiccschedule", [](InProcessEngine& e) { e.host->midiScheduler->clearCCSchedule(); })
+    .def("clearmidievents", [](InProcessEngine& e, int key, uint32_t categories, int64_t start, int64_t end) {
+        e.host->midiScheduler->clearEvents(key, categories, start, end);
+      }, py::arg("key") = -1, py::arg("categories") = (1u << uint32_t(EventCategory::count)) - 1,
+      py::arg("start") = numeric_limits<int64_t>::min(), py::arg("end") = numeric_limits<int64_t>::max(),
+      "Clear key's (or every key's, for -1) events of categories, a mask of 1 << juce_protocol.EventCategory, starting in [start, end)")
+    .def("clearparamschedule", [](InProcessEngine& e) { e.host->scheduler.clearSchedule(); })
+    .def("render", &InProcessEngine::render, py::arg("out"),
+      "Render into out, a C-contiguous float32 (channels, samples) array, in place. Returns out")
+    .def("rendersamples", &InProcessEngine::renderSamples, py::arg("samples"),
+      "Render into a new (channels, samples) float32 array")
+    .def("rewind", &InProcessEngine::rewind)
+    .def("seek", &InProcessEngine::seek, py::arg("sample"),
+      "Move to sample. Notes sounding there start again, and controllers and parameters take the values they'd have")
+    .def("setloop", &InProcessEngine::setLoop, py::arg("start"), py::arg("end"),
+      "Loop between samples start and end; setloop(0, 0) stops looping")
+    .def("streammidieventfile", &InProcessEngine::streamMidiEventFile, py::arg("path"),
+      "Play the MIDI event file at path, written by juce_client.writemidieventfile, along with everything scheduled; '' stops")
+    .def("editschedule", &InProcessEngine::editSchedule, py::arg("deletes") = py::bytes(), py::arg("moves") = py::bytes(),
+      py::arg("events") = py::bytes(), py::arg("paramdeletes") = py::bytes(), py::arg("parammoves") = py::bytes(),
+      py::arg("paramchanges") = py::bytes(),
+      "Delete, move and insert events and parameter changes by ID. Each argument is a numpy array of its juce_protocol record")
+    .def("replaceeventrange", &InProcessEngine::replaceEventRange, py::arg("key"), py::arg("start"), py::arg("end"), py::arg("events"),
+      "Replace key's events with IDs that start in [start, end) with events")
+    .def("replaceparamchangerange", &InProcessEngine::replaceParamChangeRange, py::arg("key"), py::arg("firstBlock"), py::arg("endBlock"),
+      py::arg("changes"), "Replace key's parameter changes with IDs in blocks [firstBlock, endBlock) with changes")
+    .def("schedulemidicurve", &InProcessEngine::scheduleMidiCurve, py::arg("key"), py::arg("status"), py::arg("controller"),
+      py::arg("points"), py::arg("resolution") = 64,
+      "Schedule a CC, channel pressure or pitch bend curve through points, packed CurvePointRecords with times relative to now")
+    .def("definemidiclip", &InProcessEngine::defineMidiClip, py::arg("clipId"), py::arg("events"),
+      "Store a clip once, as packed ClipEventRecords with times from its start, replacing any clip with this ID")
+    .def("scheduleclipinstances", &InProcessEngine::scheduleClipInstances, py::arg("key"), py::arg("instances"),
+      "Play clips on key, as packed ClipInstanceRecords with times relative to now");
+}
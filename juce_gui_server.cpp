@@ -28,16 +28,26 @@
 #include <atomic>
 #include <queue>
 #include <mutex>
+#include <shared_mutex>
 #include <condition_variable>
 #include <string>
 #include <memory>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
 #include <vector>
 #include <atomic>
 #include <array>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <deque>
+#include <limits>
+#include <new>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -45,368 +55,2576 @@
 #include <io.h>
 #else
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <signal.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <climits>
+#endif
+
+// Command and notification numbers, records and message layouts, generated from protocol.json
+#include "juce_protocol.h"
+
+// The shared memory transport needs a cross-process wait primitive: futexes on Linux, named events on Windows
+#if defined(_WIN32) || defined(__linux__)
+#define SHARED_TRANSPORT_SUPPORTED 1
+#endif
+
+// Extra controllers connect over a Unix socket served by an epoll loop, next to the pipe client
+#ifdef __linux__
+#define SOCKET_SERVER_SUPPORTED 1
 #endif
 
 using namespace std;
 int sampleRate = 44100;
 int blockSize = 64;
 bool isRecording = true;
-bool suppressNotifications = false;
+// Set around our own parameter changes; listeners are called on the thread making the change, so each
+// thread has its own and the audio thread's scheduled changes don't hide a move made from an editor
+thread_local bool suppressNotifications = false;
 string pipeName = "juceclientserver";
 int updateRate = 50;
-
-enum recv_cmd
-{
-  load_plugin, load_plugin_by_uid, scan_plugins, list_plugins, get_plugin_info, show_plugin_ui, hide_plugin_ui, set_parameter, get_parameter, connect_audio, connect_midi, start_playback,
-  cmd_shutdown, remove_plugin, list_bad_paths, get_params_info, get_channels_info, schedule_midi_note, schedule_midi_cc, clear_midi_schedule, schedule_param_change,
-  route_keyboard_input, unroute_keyboard_input, route_cc_to_param, unroute_cc_to_param,
-  show_virtual_keyboard, hide_virtual_keyboard, route_virtual_keyboard, unroute_virtual_keyboard,
-  toggle_recording, toggle_monitoring,
-  load_audio_file, control_audio_playback,
-  schedule_ordered_notes, start_ordered_playback, stop_ordered_playback, clear_ordered_notes,
-  clear_midi_cc_schedule, clear_param_schedule, clear_all_plugins
-};
-
-enum send_cmd : uint8_t
-{
-  param_changed, param_changes_end, stop_playback, midi_note_event, midi_cc_event,
-  virtual_keyboard_note_event, virtual_keyboard_cc_event,
-  midi_keyboard_routed, virtual_keyboard_routed,
-  recording_started, recording_stopped, monitoring_changed,
-  audio_file_loaded, audio_playback_started, audio_playback_stopped,
-  ordered_note_triggered, ordered_playback_started, ordered_playback_stopped
-};
+std::atomic<int> notificationIntervalMs{ 5 };  // How long notifications are collected before a batch goes out
 
 class CompletePluginHost; 
 CompletePluginHost* app = nullptr; 
 
 int64_t currentSamplePosition = 0;
 
-class MidiScheduler 
+// Fixed-capacity ring between one producer thread and one consumer thread. Neither side locks or allocates;
+// the consumer can look at the front entry before deciding to take it
+template<typename T, size_t Capacity>
+class SpscRing
 {
 private:
-  struct ScheduledMidiEvent 
-  {
-    juce::MidiMessage message;
-    int64_t samplePosition;
-    int key;
-  };
-  std::vector<ScheduledMidiEvent> scheduledEvents;
-  std::mutex schedulerMutex;
-  size_t nextEventIndex = 0;
-  int64_t currentSamplePosition = 0;
-  double sampleRate;
-  
+  std::array<T, Capacity> ring;
+  std::atomic<size_t> writeIndex{0};
+  std::atomic<size_t> readIndex{0};
+
 public:
-  void processBlockWithkeys(std::unordered_map<int, juce::MidiBuffer>& buffersByPlugin, 
-    int blockSize) 
+  // Producer
+  bool push(const T& item)
   {
-    // Clear all buffers
-    buffersByPlugin.clear();
-    int64_t blockEnd = currentSamplePosition + blockSize;
-    while (nextEventIndex < scheduledEvents.size()) //todo: figure this out and see if it's as efficient as my solution in the param scheduler
-    {
-      const auto& event = scheduledEvents[nextEventIndex];
-      if (event.samplePosition >= blockEnd) break;
-      if (event.samplePosition >= currentSamplePosition) 
-      {
-        int sampleOffset = static_cast<int>(event.samplePosition - currentSamplePosition);
-        // Add to the appropriate plugin's buffer
-        buffersByPlugin[event.key].addEvent(event.message, sampleOffset);
-      }
-      nextEventIndex++;
-    }
-    currentSamplePosition += blockSize;
+    size_t currentWrite = writeIndex.load(std::memory_order_relaxed);
+    size_t nextWrite = (currentWrite + 1) % Capacity;
+    if (nextWrite == readIndex.load(std::memory_order_acquire))
+      return false; // Full
+    ring[currentWrite] = item;
+    writeIndex.store(nextWrite, std::memory_order_release);
+    return true;
   }
-  explicit MidiScheduler(double sr) 
-    : sampleRate(sr), 
-    currentSamplePosition(0), 
-    nextEventIndex(0) {}
 
-  void scheduleNote(int key, int noteNumber, float velocity, 
-    double startTimeSeconds, double durationSeconds, int channel = 1) 
+  bool full() const
   {
-    int64_t startSample = currentSamplePosition + 
-      static_cast<int64_t>(startTimeSeconds * sampleRate);
-    int64_t endSample = startSample + 
-      static_cast<int64_t>(durationSeconds * sampleRate);
-
-    std::lock_guard<std::mutex> lock(schedulerMutex);
+    return (writeIndex.load(std::memory_order_relaxed) + 1) % Capacity == readIndex.load(std::memory_order_acquire);
+  }
 
-    scheduledEvents.push_back({
-      juce::MidiMessage::noteOn(channel, noteNumber, velocity),
-      startSample, 
-      key
-      });
+  // Consumer
+  T* front()
+  {
+    size_t currentRead = readIndex.load(std::memory_order_relaxed);
+    if (currentRead == writeIndex.load(std::memory_order_acquire))
+      return nullptr; // Empty
+    return &ring[currentRead];
+  }
 
-    scheduledEvents.push_back({
-      juce::MidiMessage::noteOff(channel, noteNumber),
-      endSample,
-      key
-      });
+  void pop()
+  {
+    readIndex.store((readIndex.load(std::memory_order_relaxed) + 1) % Capacity, std::memory_order_release);
+  }
+};
 
-    // Sort only from nextEventIndex onward (unprocessed events)
-    std::sort(scheduledEvents.begin(), scheduledEvents.end(),
-      [](const auto& a, const auto& b) { 
-        return a.samplePosition < b.samplePosition;  // Must return bool
-      });  }
+// Tempo and meter over musical time. Beats are quarter notes counted from the start of the timeline. A tempo
+// point holds its bpm until the next point, or ramps to the next point's bpm linearly in beats. The points
+// are turned into segments up front, so converting a beat is a binary search and a formula. Read-only once
+// built; the compile thread and the command threads share one through a shared_ptr
+class TempoMap
+{
+public:
+  struct TempoPoint
+  {
+    double beat;
+    double bpm;
+    bool ramp;  // Ramp to the next point's bpm instead of jumping there
+  };
 
-  void scheduleMidiMessage(int key, const juce::MidiMessage& msg, 
-    double timeSeconds) 
+  struct TimeSignature
   {
-    int64_t sample = currentSamplePosition + 
-      static_cast<int64_t>(timeSeconds * sampleRate);
+    int bar;  // First bar in this signature, counting from 0
+    int numerator;
+    int denominator;
+  };
 
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    scheduledEvents.push_back({msg, sample, key});
+  // 120 bpm in 4/4
+  TempoMap() : TempoMap({ { 0.0, 120.0, false } }, { { 0, 4, 4 } }) {}
 
-    std::sort(scheduledEvents.begin() + nextEventIndex, scheduledEvents.end(),
-      [](const auto& a, const auto& b) { 
-        return a.samplePosition < b.samplePosition; 
-      });
+  TempoMap(vector<TempoPoint> points, vector<TimeSignature> signatures)
+  {
+    if (points.empty())
+      throw invalid_argument("a tempo map needs at least one tempo");
+    stable_sort(points.begin(), points.end(), [](const auto& a, const auto& b) { return a.beat < b.beat; });
+    for (const auto& point : points)
+      if (!(point.bpm > 0) || !isfinite(point.beat))
+        throw invalid_argument("tempos must be positive and at finite beats");
+    if (points.front().beat > 0)  // The first tempo also covers the time before it
+      points.insert(points.begin(), { 0.0, points.front().bpm, false });
+
+    double seconds = 0;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      const auto& point = points[i];
+      TempoSegment segment{ point.beat, seconds, point.bpm, 0.0 };
+      if (i + 1 < points.size())
+      {
+        const auto& next = points[i + 1];
+        double length = next.beat - point.beat;
+        if (point.ramp && length > 0)
+          segment.bpmPerBeat = (next.bpm - point.bpm) / length;
+        if (length > 0)
+          seconds += segmentSeconds(segment, length);
+      }
+      if (!tempoSegments.empty() && tempoSegments.back().startBeat == segment.startBeat)
+        tempoSegments.back() = segment;  // A jump: the later point wins
+      else
+        tempoSegments.push_back(segment);
+    }
+
+    if (signatures.empty())
+      signatures.push_back({ 0, 4, 4 });
+    stable_sort(signatures.begin(), signatures.end(), [](const auto& a, const auto& b) { return a.bar < b.bar; });
+    if (signatures.front().bar > 0)
+      signatures.insert(signatures.begin(), { 0, signatures.front().numerator, signatures.front().denominator });
+    double beat = 0;
+    for (size_t i = 0; i < signatures.size(); ++i)
+    {
+      const auto& signature = signatures[i];
+      if (signature.numerator <= 0 || signature.denominator <= 0)
+        throw invalid_argument("time signatures must be positive");
+      if (i > 0)
+        beat += (signature.bar - meterSegments.back().startBar) * meterSegments.back().beatsPerBar;
+      MeterSegment segment{ signature.bar, beat, signature.numerator * 4.0 / signature.denominator };
+      if (!meterSegments.empty() && meterSegments.back().startBar == segment.startBar)
+        meterSegments.back() = segment;
+      else
+        meterSegments.push_back(segment);
+    }
   }
 
-  void scheduleCC(int key, int controller, int value, 
-    double timeSeconds, int channel = 1) 
+  double beatToSeconds(double beat) const
   {
-    auto msg = juce::MidiMessage::controllerEvent(channel, controller, value);
-    scheduleMidiMessage(key, msg, timeSeconds);
+    const auto& segment = *(upper_bound(tempoSegments.begin() + 1, tempoSegments.end(), beat,
+      [](double b, const TempoSegment& s) { return b < s.startBeat; }) - 1);
+    return segment.startSeconds + segmentSeconds(segment, beat - segment.startBeat);
   }
 
-  void schedulePitchBend(int key, int value, double timeSeconds, int channel = 1) 
+  double secondsToBeat(double seconds) const
   {
-    auto msg = juce::MidiMessage::pitchWheel(channel, value);
-    scheduleMidiMessage(key, msg, timeSeconds);
+    const auto& segment = *(upper_bound(tempoSegments.begin() + 1, tempoSegments.end(), seconds,
+      [](double t, const TempoSegment& s) { return t < s.startSeconds; }) - 1);
+    double elapsed = seconds - segment.startSeconds;
+    if (segment.bpmPerBeat == 0)
+      return segment.startBeat + elapsed * segment.startBpm / 60.0;
+    return segment.startBeat + segment.startBpm * (exp(segment.bpmPerBeat * elapsed / 60.0) - 1) / segment.bpmPerBeat;
   }
 
-  void processBlock(juce::MidiBuffer& midiBuffer, int blockSize) 
+  int64_t beatToSample(double beat, double sampleRate) const
   {
-    midiBuffer.clear();
-    int64_t blockEnd = currentSamplePosition + blockSize;
-
-    // Process events without locking (only reading at nextEventIndex)
-    while (nextEventIndex < scheduledEvents.size()) 
-    {
-      const auto& event = scheduledEvents[nextEventIndex];
+    return int64_t(llround(beatToSeconds(beat) * sampleRate));
+  }
 
-      // Stop if we've reached events beyond this block
-      if (event.samplePosition >= blockEnd) {
-        break;
-      }
+  // bar can be fractional: 2.5 is halfway through the third bar
+  double barToBeat(double bar) const
+  {
+    const auto& segment = *(upper_bound(meterSegments.begin() + 1, meterSegments.end(), bar,
+      [](double b, const MeterSegment& s) { return b < s.startBar; }) - 1);
+    return segment.startBeat + (bar - segment.startBar) * segment.beatsPerBar;
+  }
 
-      // Add event if it's within this block
-      if (event.samplePosition >= currentSamplePosition) {
-        int sampleOffset = static_cast<int>(event.samplePosition - currentSamplePosition);
-        midiBuffer.addEvent(event.message, sampleOffset);
-      }
+private:
+  // From startBeat on, bpm is startBpm + bpmPerBeat * (beat - startBeat)
+  struct TempoSegment
+  {
+    double startBeat;
+    double startSeconds;
+    double startBpm;
+    double bpmPerBeat;
+  };
 
-      nextEventIndex++;
-    }
+  struct MeterSegment
+  {
+    int startBar;
+    double startBeat;
+    double beatsPerBar;
+  };
 
-    // Advance timeline
-    currentSamplePosition += blockSize;
+  // Seconds from the segment's start to beats into it: the integral of 60 / bpm
+  static double segmentSeconds(const TempoSegment& segment, double beats)
+  {
+    if (segment.bpmPerBeat == 0)
+      return beats * 60.0 / segment.startBpm;
+    return 60.0 / segment.bpmPerBeat * log((segment.startBpm + segment.bpmPerBeat * beats) / segment.startBpm);
   }
 
-  void getEventsForPlugin(int key, juce::MidiBuffer& buffer, int blockSize) 
-  {
-    buffer.clear();
-    int64_t blockEnd = currentSamplePosition + blockSize;
+  vector<TempoSegment> tempoSegments;
+  vector<MeterSegment> meterSegments;
+};
 
-    size_t index = nextEventIndex;
-    while (index < scheduledEvents.size()) 
+// A client-written file of MidiEventRecords sorted by sampleTime, which here counts from the start of the
+// timeline, mapped read-only. Only the pages a reader is using need to be resident: release() hands them
+// back once their events are copied out, so a file of any length costs about the same memory
+class MappedEventFile
+{
+public:
+  explicit MappedEventFile(const string& filePath) : path(filePath)
+  {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+      throw runtime_error("can't open " + path + ": error " + to_string(GetLastError()));
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    size = size_t(fileSize.QuadPart);
+    if (size > 0)
     {
-      const auto& event = scheduledEvents[index];
-      if (event.samplePosition >= blockEnd) break;
-
-      if (event.key == key && 
-        event.samplePosition >= currentSamplePosition) 
+      mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping != NULL)
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+      if (data == nullptr)
       {
-        int offset = static_cast<int>(event.samplePosition - currentSamplePosition);
-        buffer.addEvent(event.message, offset);
+        string error = to_string(GetLastError());
+        if (mapping != NULL)
+          CloseHandle(mapping);
+        CloseHandle(file);
+        throw runtime_error("can't map " + path + ": error " + error);
       }
-      index++;
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw runtime_error("can't open " + path + ": " + string(strerror(errno)));
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+      close(fd);
+      throw runtime_error("can't stat " + path + ": " + string(strerror(errno)));
+    }
+    size = size_t(info.st_size);
+    if (size > 0)
+    {
+      void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped == MAP_FAILED)
+      {
+        close(fd);
+        throw runtime_error("can't map " + path + ": " + string(strerror(errno)));
+      }
+      data = static_cast<const char*>(mapped);
+    }
+    close(fd);
+#endif
+    if (size % sizeof(MidiEventRecord) != 0)
+    {
+      unmap();
+      throw runtime_error(path + " isn't a whole number of " + to_string(sizeof(MidiEventRecord)) + " byte MidiEventRecords");
     }
   }
 
-  void clearSchedule()
+  ~MappedEventFile()
   {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    scheduledEvents.clear();
-    nextEventIndex = 0;
+    unmap();
   }
 
-  void clearCCSchedule()
-  {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    // Remove only CC events, keep notes and other MIDI messages
-    scheduledEvents.erase(
-      std::remove_if(scheduledEvents.begin(), scheduledEvents.end(),
-        [](const ScheduledMidiEvent& event) {
-          return event.message.isController();
-        }),
-      scheduledEvents.end()
-    );
-    nextEventIndex = 0;
-  }
+  MappedEventFile(const MappedEventFile&) = delete;
+  MappedEventFile& operator=(const MappedEventFile&) = delete;
 
-  void reset() 
-  {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    currentSamplePosition = 0;
-    nextEventIndex = 0;
-  }
+  size_t count() const { return size / sizeof(MidiEventRecord); }
 
-  void setSampleRate(double sr) 
+  MidiEventRecord record(size_t i) const
   {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    sampleRate = sr;
+    MidiEventRecord r;
+    memcpy(&r, data + i * sizeof(MidiEventRecord), sizeof(r));
+    return r;
   }
 
-  void cleanupProcessedEvents() 
+  // Index of the first record at or after sample, by binary search, so it touches O(log n) pages
+  size_t firstAt(int64_t sample) const
   {
-    std::lock_guard<std::mutex> lock(schedulerMutex);
-    if (nextEventIndex > 1000) {
-      scheduledEvents.erase(scheduledEvents.begin(), 
-        scheduledEvents.begin() + nextEventIndex);
-      nextEventIndex = 0;
+    size_t first = 0, last = count();
+    while (first < last)
+    {
+      size_t middle = first + (last - first) / 2;
+      if (record(middle).sampleTime < sample)
+        first = middle + 1;
+      else
+        last = middle;
     }
+    return first;
   }
 
-  size_t getNumPendingEvents() const 
+  // Lets the OS drop the pages holding records first to last; reading them again faults them back in
+  void release(size_t first, size_t last) const
   {
-    return scheduledEvents.size() - nextEventIndex;
+    if (first >= last)
+      return;
+#ifdef _WIN32
+    // Unlocking pages that aren't locked takes them out of the working set
+    VirtualUnlock(const_cast<char*>(data) + first * sizeof(MidiEventRecord), (last - first) * sizeof(MidiEventRecord));
+#else
+    size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    size_t start = (first * sizeof(MidiEventRecord) + pageSize - 1) / pageSize * pageSize;
+    size_t end = last * sizeof(MidiEventRecord) / pageSize * pageSize;
+    if (last == count())
+      end = size;
+    if (start < end)
+      madvise(const_cast<char*>(data) + start, end - start, MADV_DONTNEED);
+#endif
   }
 
-  int64_t getCurrentPosition() const 
-  { 
-    return currentSamplePosition; 
-  }
-};
+  const string& getPath() const { return path; }
 
-class MidiSourceNode : public juce::AudioProcessor
-{
 private:
-  MidiScheduler* scheduler;
-  int targetkey;
-
-public:
-  MidiSourceNode(MidiScheduler* s, int key)
-    : AudioProcessor(BusesProperties()  // No audio buses needed
-      .withInput("Input", juce::AudioChannelSet::stereo(), false)
-      .withOutput("Output", juce::AudioChannelSet::stereo(), false)),
-    scheduler(s), 
-    targetkey(key) {}
-
-  // Main processing - just outputs MIDI for this plugin
-  void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+  void unmap()
   {
-    midiMessages.clear();
-    scheduler->getEventsForPlugin(targetkey, midiMessages, buffer.getNumSamples());
+#ifdef _WIN32
+    if (data)
+      UnmapViewOfFile(data);
+    if (mapping != NULL)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+      munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
   }
 
-  // Required AudioProcessor methods
-  const juce::String getName() const override { return "MIDI Source " + juce::String(targetkey); }
-  void prepareToPlay(double sampleRate, int samplesPerBlock) override {}
-  void releaseResources() override {}
-
-  bool acceptsMidi() const override { return false; }  // Doesn't accept external MIDI
-  bool producesMidi() const override { return true; }   // Produces MIDI
-  bool isMidiEffect() const override { return true; }
-
-  double getTailLengthSeconds() const override { return 0; }
-
-  int getNumPrograms() override { return 1; }
-  int getCurrentProgram() override { return 0; }
-  void setCurrentProgram(int index) override {}
-  const juce::String getProgramName(int index) override { return {}; }
-  void changeProgramName(int index, const juce::String& newName) override {}
-
-  void getStateInformation(juce::MemoryBlock& destData) override {}
-  void setStateInformation(const void* data, int sizeInBytes) override {}
-
-  juce::AudioProcessorEditor* createEditor() override { return nullptr; }
-  bool hasEditor() const override { return false; }
+  string path;
+  size_t size = 0;
+  const char* data = nullptr;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#endif
 };
 
-// Audio file player node - plays back audio files through the graph
-class AudioFilePlayerNode : public juce::AudioProcessor
+// How far a CurveShape segment has got from its first value to its last, t of the way through it in time
+static double curveFraction(CurveShape shape, double t)
 {
-private:
-  juce::AudioBuffer<float> audioBuffer;
-  int64_t playbackPosition = 0;
-  int64_t startSamplePosition = 0;
-  bool isScheduled = false;
-  bool isPlaying = false;
-  std::string loadedFilename;
+  switch (shape)
+  {
+    case CurveShape::exponential:
+      return std::expm1(4.0 * t) / std::expm1(4.0);
+    case CurveShape::s_curve:
+      return t * t * (3.0 - 2.0 * t);
+    default:
+      return t;
+  }
+}
 
+// Scheduled MIDI, kept as one lane per plugin key. The schedule* calls stage events for a background compile
+// thread, which merges them into the lane's time-ordered array and buckets it by block. The audio thread
+// picks compiled lanes up at block boundaries, and each MidiSourceNode reads only its own lane from its own
+// cursor, so a block costs a node O(its own events) however many plugins are loaded.
+//
+// Everything the audio thread reads is built and freed by the compile thread. They trade pointers through
+// two SpscRings, new lanes one way and the ones they replace the other, so scheduling while playing never
+// makes the audio thread wait, allocate or free
+class MidiScheduler 
+{
 public:
-  AudioFilePlayerNode()
-    : AudioProcessor(BusesProperties()
-      .withOutput("Output", juce::AudioChannelSet::stereo(), true))
+  // A scheduled message's bytes. length 0 means sysex, whose bytes are in the sysex arena at sysexOffset,
+  // after their uint32_t length
+  struct MidiBytes
   {
-  }
+    uint8_t data[3];
+    uint8_t length;
+    uint32_t sysexOffset;
+  };
 
-  // Load an audio file
-  bool loadAudioFile(const std::string& filename)
+  // Events in time order as columns: the times the cursors scan, and the bytes, only read for events that
+  // are played. 16 bytes an event, and no juce::MidiMessage is made until one goes into a MidiBuffer
+  struct EventColumns
   {
-    juce::File audioFile = juce::File::getCurrentWorkingDirectory().getChildFile(filename);
+    std::vector<int64_t> samplePositions;
+    std::vector<MidiBytes> messages;
+    std::vector<uint8_t> sysex;
+    // Empty unless some event was scheduled in beats; then every event's beat, NaN for the ones scheduled
+    // in samples. Only the compile thread reads it, to re-time the lane when the tempo map changes
+    std::vector<double> beats;
 
-    if (!audioFile.existsAsFile())
+    size_t size() const { return samplePositions.size(); }
+
+    double beatAt(size_t i) const { return beats.empty() ? NAN : beats[i]; }
+
+    void reserve(size_t n)
     {
-      std::cout << "ERROR: Audio file does not exist: " << filename << std::endl;
-      return false;
+      samplePositions.reserve(n);
+      messages.reserve(n);
     }
 
-    juce::AudioFormatManager formatManager;
-    formatManager.registerBasicFormats();
-
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+    // fromSysex is the arena message's sysex bytes are in, if it has any
+    void append(int64_t samplePosition, MidiBytes message, const std::vector<uint8_t>& fromSysex, double beat = NAN)
+    {
+      if (!beats.empty())
+        beats.push_back(beat);
+      else if (!std::isnan(beat))
+      {
+        beats.assign(size(), NAN);
+        beats.push_back(beat);
+      }
+      if (message.length == 0)
+      {
+        uint32_t length;
+        memcpy(&length, &fromSysex[message.sysexOffset], sizeof(length));
+        auto first = fromSysex.begin() + message.sysexOffset;
+        message.sysexOffset = uint32_t(sysex.size());
+        sysex.insert(sysex.end(), first, first + sizeof(length) + length);
+      }
+      samplePositions.push_back(samplePosition);
+      messages.push_back(message);
+    }
 
-    if (reader == nullptr)
+    void addToBuffer(size_t i, juce::MidiBuffer& buffer, int sampleOffset) const
     {
-      std::cout << "ERROR: Failed to create reader for: " << filename << std::endl;
-      return false;
+      const MidiBytes& message = messages[i];
+      if (message.length != 0)
+      {
+        buffer.addEvent(message.data, message.length, sampleOffset);
+        return;
+      }
+      uint32_t length;
+      memcpy(&length, &sysex[message.sysexOffset], sizeof(length));
+      buffer.addEvent(&sysex[message.sysexOffset + sizeof(length)], int(length), sampleOffset);
     }
+  };
+  static_assert(sizeof(int64_t) + sizeof(MidiBytes) == 16, "scheduled events are 16 bytes");
 
-    // Load the audio into our buffer
-    audioBuffer.setSize(reader->numChannels, (int)reader->lengthInSamples);
-    reader->read(&audioBuffer, 0, (int)reader->lengthInSamples, 0, true, true);
+  // Message's bytes, with sysex (or anything longer than a short message) copied into sysex
+  static MidiBytes toMidiBytes(const juce::MidiMessage& message, std::vector<uint8_t>& sysex)
+  {
+    MidiBytes bytes{};
+    int size = message.getRawDataSize();
+    if (!message.isSysEx() && size <= 3)
+    {
+      memcpy(bytes.data, message.getRawData(), size_t(size));
+      bytes.length = uint8_t(size);
+      return bytes;
+    }
+    uint32_t length = uint32_t(size);
+    bytes.sysexOffset = uint32_t(sysex.size());
+    sysex.insert(sysex.end(), reinterpret_cast<const uint8_t*>(&length), reinterpret_cast<const uint8_t*>(&length) + sizeof(length));
+    sysex.insert(sysex.end(), message.getRawData(), message.getRawData() + size);
+    return bytes;
+  }
 
-    loadedFilename = filename;
-    playbackPosition = 0;
-    isPlaying = false;
+private:
+  struct StagedEvent
+  {
+    int64_t samplePosition;  // Filled in by the compile thread for events in beats
+    int key;
+    MidiBytes message;
+    double beat;  // NaN for events in samples
+  };
 
-    std::cout << "Audio file loaded into player node: " << filename
-              << ", channels=" << reader->numChannels
-              << ", samples=" << reader->lengthInSamples << std::endl;
+  // A block that has events: where it starts and the index of its first event. Its events run up to the
+  // next bucket's first event
+  struct BlockBucket
+  {
+    int64_t startSample;
+    uint32_t firstEvent;
+  };
 
-    return true;
-  }
+  static constexpr uint32_t noNoteOff = std::numeric_limits<uint32_t>::max();
 
-  // Schedule playback to start at a specific sample position
-  void schedulePlayback(int64_t startSample, int64_t fileStartPosition = 0)
+  // A note from its note on to its note off (or the end of time, if it has none)
+  struct NoteSpan
   {
-    startSamplePosition = startSample;
-    playbackPosition = juce::jmin(fileStartPosition, (int64_t)audioBuffer.getNumSamples());
-    isScheduled = true;
-    isPlaying = false;
-    std::cout << "Playback scheduled for sample " << startSample
-              << ", starting at file position " << playbackPosition << std::endl;
-  }
+    int64_t start;
+    int64_t end;
+    uint32_t noteOn;  // Index in events
+    uint32_t noteOff = noNoteOff;
+  };
 
-  // Start playing immediately
-  void startPlayback(int64_t fileStartPosition = 0)
+  static constexpr uint32_t notesPerCheckpoint = 64;
+
+  // A curve's breakpoint: the curve passes through value at samplePosition, and shape is how it gets to the
+  // next one
+  struct CurvePoint
   {
-    playbackPosition = juce::jmin(fileStartPosition, (int64_t)audioBuffer.getNumSamples());
-    isPlaying = true;
-    isScheduled = false;
-    std::cout << "Playback started immediately at file position " << playbackPosition << std::endl;
-  }
+    int64_t samplePosition;
+    float value;
+    CurveShape shape;
+  };
 
-  // Stop playback
-  void stopPlayback()
+  // A CC, channel pressure or pitch bend curve from its first breakpoint to its last. It sends a message
+  // every resolution samples from start when the value has changed, and its last value at end
+  struct Curve
+  {
+    int64_t start;
+    int64_t end;
+    uint8_t status;
+    uint8_t controller;  // CCs only
+    int32_t resolution;
+    uint32_t firstPoint;  // Into the lane's curvePoints
+    uint32_t endPoint;
+  };
+
+  struct CompiledLane;
+
+  // A clip played on a lane from start: its events are read straight out of the clip as the blocks reach
+  // them, with the notes transposed and the note on velocities scaled
+  struct ClipInstance
+  {
+    int64_t start;
+    int64_t end;  // The clip's last event, or start if it has none
+    uint32_t clipId;
+    int32_t transpose;
+    float velocityScale;
+    const CompiledLane* clip;  // Null until a clip with clipId is defined
+  };
+
+  // One key's schedule as built by the compile thread; not changed once published
+  struct CompiledLane
+  {
+    EventColumns events;  // By sample, events on the same sample in the order scheduled
+    std::vector<BlockBucket> buckets;
+    int samplesPerBucket = 1;
+    // Events added since the version the audio thread had before this one. Any already due when it picks
+    // this one up (a note scheduled for "now" while playing) go out at the start of the block
+    EventColumns added;
+
+    // What a seek or loop needs to chase, so it doesn't replay the lane up to where it lands. notes is by
+    // start, and every notesPerCheckpoint notes a checkpoint lists the earlier notes still sounding there
+    std::vector<NoteSpan> notes;
+    std::vector<uint32_t> checkpointFirst;  // Into checkpointNotes, plus one past the last checkpoint
+    std::vector<uint32_t> checkpointNotes;
+    // Indices of the controllers, program changes, channel pressure and pitch bends in events, grouped
+    // by channel and controller with each group in time order. CCs sort first, so bank selects go out
+    // before the program change they qualify
+    std::vector<uint32_t> stateEvents;
+    std::vector<uint32_t> stateGroupFirst;  // Into stateEvents, plus one past the last group
+    std::vector<uint32_t> stateGroupKeys;   // Each group's (type >> 4) << 11 | channel << 7 | controller
+
+    // Curves by start, expanded into messages only as the blocks they cover are played. curveEndsSoFar[i]
+    // is the latest end of curves 0 to i, so a block finds the curves it overlaps by binary search
+    std::vector<Curve> curves;
+    std::vector<CurvePoint> curvePoints;
+    std::vector<int64_t> curveEndsSoFar;
+    // For chasing, as stateEvents: curves grouped by channel and controller, each group by start
+    std::vector<uint32_t> groupedCurves;
+    std::vector<uint32_t> curveGroupFirst;  // Into groupedCurves, plus one past the last group
+    std::vector<uint32_t> curveGroupKeys;
+
+    // Clip instances by start, found as curves are. A clip is itself a CompiledLane, with its events from
+    // the clip's start, indexed for chasing but not bucketed. instanceClips keeps the ones used here alive
+    std::vector<ClipInstance> instances;
+    std::vector<int64_t> instanceEndsSoFar;
+    std::vector<std::shared_ptr<const CompiledLane>> instanceClips;
+  };
+
+  // The audio thread's state for one key. Created by the compile thread the first time the key is
+  // scheduled and kept until the scheduler goes; only the audio thread touches the fields
+  struct Lane
+  {
+    const CompiledLane* compiled = nullptr;
+    size_t bucket = 0;            // First bucket that may still have events to play
+    size_t lateEvents = 0;        // Leading entries of compiled->added that were already due
+    uint64_t adoptedInBlock = 0;  // When compiled was picked up
+    uint64_t jumpsSeen = 0;       // The transport jumps this lane has chased
+    const CompiledLane* window = nullptr;  // The streamed file's events around the playhead, if any
+    size_t windowBucket = 0;
+  };
+  using LaneTable = std::unordered_map<int, Lane*>;
+
+  // A seek, a new loop region, or both. loopEnd <= loopStart turns looping off
+  struct TransportChange
+  {
+    int64_t seekTo = -1;  // -1: stay where it is
+    bool setsLoop = false;
+    int64_t loopStart = 0;
+    int64_t loopEnd = 0;
+  };
+
+  // Compile thread -> audio thread: a new version of a lane or (if window) of its streamed window, a new
+  // lane table once a key is added, or, with all three null, a transport change. They come in the order
+  // they were staged, so a seek lands on everything scheduled before it
+  struct LaneUpdate
+  {
+    Lane* lane;
+    const CompiledLane* compiled;
+    const LaneTable* table;
+    TransportChange transport;
+    bool window = false;
+  };
+
+  // Audio thread -> compile thread: what a LaneUpdate replaced, for the compile thread to free
+  struct RetiredLane
+  {
+    const CompiledLane* compiled;
+    const LaneTable* table;
+  };
+
+  struct StagedEdit
+  {
+    enum Kind { add, clearAll, clearCCs, clearRange, retime, transport, stream, slide, edit, replaceRange, addCurve, defineClip,
+      addInstances } kind;
+    std::vector<StagedEvent> events;
+    std::vector<uint8_t> sysex;  // Sysex arena for events
+    std::shared_ptr<const TempoMap> tempoMap;  // retime: the new map, or null to keep it
+    double sampleRate = 0;  // retime: the new sample rate, or 0 to keep it
+    TransportChange transportChange;
+    std::shared_ptr<const MappedEventFile> eventFile;  // stream: the file to stream, or null to stop
+    // edit: deletes, then moves, then inserts. replaceRange: the key's identified events starting in
+    // [rangeStart, rangeEnd) go, then identified come in. clearRange: the key's (or, for key -1, every
+    // lane's) events of the categories starting in [rangeStart, rangeEnd) go
+    std::vector<uint64_t> deletes;
+    std::vector<EventMoveRecord> moves;
+    std::vector<IdentifiedEventRecord> identified;
+    int key = 0;  // replaceRange, clearRange, addCurve and addInstances: the lane
+    uint32_t categories = 0;  // clearRange: bit i for EventCategory i
+    uint32_t clipId = 0;  // defineClip: the clip its events become
+    int64_t rangeStart = 0;
+    int64_t rangeEnd = 0;
+    Curve curve{};  // addCurve: its points are curvePoints, sorted
+    std::vector<CurvePoint> curvePoints;
+    std::vector<ClipInstance> instances;  // addInstances: with absolute starts, not yet resolved
+  };
+
+  // An event scheduled with an ID: a note's note on and note off, or one short message. Kept by the
+  // compile thread so edits can find it in its lane
+  struct IdentifiedEvent
+  {
+    int key;
+    uint8_t count;  // 2 for a note
+    int64_t samplePositions[2];
+    MidiBytes messages[2];
+  };
+
+  // Command threads -> compile thread, under schedulerMutex. There are several command threads (the pipe,
+  // socket clients, MIDI input) and none of them is the audio thread, so this side keeps its mutex
+  std::mutex schedulerMutex;
+  std::condition_variable schedulerCv;
+  std::vector<StagedEdit> stagedEdits;
+  bool compiling = false;  // Also true while compiled lanes are waiting for room in publishedLanes
+  bool stopping = false;
+
+  // Compile thread only
+  std::shared_ptr<const TempoMap> tempoMap = std::make_shared<TempoMap>();
+  double compileSampleRate;
+  std::unordered_map<int, const CompiledLane*> compiledLanes;  // Latest version of every key
+  std::unordered_map<int, CompiledLane*> unpublishedLanes;     // Built, waiting for room in publishedLanes
+  std::unordered_map<int, CompiledLane*> unpublishedWindows;   // Null to take a key's window away
+  std::vector<TransportChange> unpublishedTransport;          // Go out after the lanes and windows
+  std::map<uint64_t, IdentifiedEvent> identifiedEvents;
+  std::set<std::tuple<int, int64_t, uint64_t>> identifiedByStart;  // (key, start, ID), for replaceRange
+  std::unordered_map<uint32_t, std::shared_ptr<const CompiledLane>> clips;  // Lanes hold on to the ones they play
+
+  // Streaming: the file and the span of it the windows cover, compile thread only
+  static constexpr double streamAheadSeconds = 10;
+  static constexpr double streamBehindSeconds = 2;  // Kept behind the playhead, for chasing a seek back
+  std::shared_ptr<const MappedEventFile> eventFile;
+  int64_t windowStart = 0;
+  int64_t windowEnd = 0;
+  bool windowStale = false;
+  std::vector<int> windowKeys;
+  int64_t seekingTo = -1;  // A seek in the batch being compiled
+  int64_t streamLoopStart = 0;
+  int64_t streamLoopEnd = 0;
+  bool windowUnpublished = false;  // windowStart/End not yet in windowReadyFrom/Until
+
+  // The span the published windows cover, for waitForStream. windowReadyUntil is 0 when not streaming
+  std::mutex windowMutex;
+  int64_t windowReadyFrom = 0;
+  int64_t windowReadyUntil = 0;
+  LaneTable laneIndex;
+  std::vector<std::unique_ptr<Lane>> laneStorage;
+  bool laneIndexChanged = false;
+
+  static constexpr size_t handoffCapacity = 4096;
+  SpscRing<LaneUpdate, handoffCapacity> publishedLanes;
+  SpscRing<RetiredLane, handoffCapacity> retiredLanes;
+
+  // Audio thread only
+  const LaneTable* laneTable = nullptr;
+  uint64_t blocksBegun = 0;
+  uint64_t jumps = 0;       // Seeks and loop wraps so far; lanes catch up with the last one when next read
+  int64_t jumpFrom = 0;     // Where the last jump left
+  int64_t loopStart = 0;
+  int64_t loopEnd = 0;      // Not looping unless after loopStart
+
+  std::atomic<int64_t> currentSamplePosition{ 0 };  // Start of the block being rendered
+  std::atomic<int> renderingThreads{ 0 };  // Inside a block or sync(); the rings have one consumer, so never more than one
+  std::atomic<int> samplesPerBucket{ 512 };
+  std::atomic<double> sampleRate;  // Read from any thread, the audio thread's parameter listeners among them
+  std::thread compileThread;
+
+  // a and b's events in one time order, a's first where they share a sample
+  static EventColumns merge(const EventColumns& a, const EventColumns& b)
+  {
+    EventColumns merged;
+    merged.reserve(a.size() + b.size());
+    merged.sysex.reserve(a.sysex.size() + b.sysex.size());
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size())
+    {
+      if (j == b.size() || (i < a.size() && a.samplePositions[i] <= b.samplePositions[j]))
+      {
+        merged.append(a.samplePositions[i], a.messages[i], a.sysex, a.beatAt(i));
+        i++;
+      }
+      else
+      {
+        merged.append(b.samplePositions[j], b.messages[j], b.sysex, b.beatAt(j));
+        j++;
+      }
+    }
+    return merged;
+  }
+
+  static bool sameMessage(const MidiBytes& a, const MidiBytes& b)
+  {
+    return a.length != 0 && a.length == b.length && memcmp(a.data, b.data, a.length) == 0;
+  }
+
+  // events less one event matching each of removals, found by binary search on its sample. Events on the
+  // same sample with the same bytes are interchangeable, so it doesn't matter which one goes
+  static EventColumns without(const EventColumns& events, const std::vector<std::pair<int64_t, MidiBytes>>& removals)
+  {
+    std::vector<bool> removed(events.size());
+    size_t numRemoved = 0;
+    for (const auto& [samplePosition, message] : removals)
+    {
+      size_t i = size_t(std::lower_bound(events.samplePositions.begin(), events.samplePositions.end(), samplePosition)
+        - events.samplePositions.begin());
+      for (; i < events.size() && events.samplePositions[i] == samplePosition; ++i)
+        if (!removed[i] && sameMessage(events.messages[i], message))
+        {
+          removed[i] = true;
+          numRemoved++;
+          break;
+        }
+    }
+    EventColumns kept;
+    kept.reserve(events.size() - numRemoved);
+    for (size_t i = 0; i < events.size(); ++i)
+      if (!removed[i])
+        kept.append(events.samplePositions[i], events.messages[i], events.sysex, events.beatAt(i));
+    return kept;
+  }
+
+  static EventCategory categoryOf(const MidiBytes& message)
+  {
+    if (message.length == 0)
+      return EventCategory::other;
+    switch (message.data[0] & 0xf0)
+    {
+      case 0x80:
+      case 0x90:
+        return EventCategory::notes;
+      case 0xa0:
+      case 0xd0:
+        return EventCategory::pressure;
+      case 0xb0:
+        return EventCategory::controllers;
+      case 0xc0:
+        return EventCategory::program_changes;
+      case 0xe0:
+        return EventCategory::pitch_bend;
+      default:
+        return EventCategory::other;
+    }
+  }
+
+  static bool inCategories(uint32_t categories, EventCategory category)
+  {
+    return (categories >> uint32_t(category)) & 1;
+  }
+
+  // Into kept, indexed's events less those of categories that start in [start, end): for notes, the note
+  // ons there and their note offs, wherever they are. The range is found by binary search and only the
+  // events in it are looked at. Notes sounding at now get note offs in cutOff. False if nothing goes
+  static bool withoutRange(const CompiledLane& indexed, uint32_t categories, int64_t start, int64_t end, int64_t now,
+    EventColumns& kept, std::vector<MidiBytes>& cutOff)
+  {
+    const EventColumns& events = indexed.events;
+    const auto& positions = events.samplePositions;
+    size_t first = size_t(std::lower_bound(positions.begin(), positions.end(), start) - positions.begin());
+    size_t last = size_t(std::lower_bound(positions.begin(), positions.end(), end) - positions.begin());
+    std::vector<uint32_t> dropped;
+    for (size_t i = first; i < last; ++i)
+    {
+      EventCategory category = categoryOf(events.messages[i]);
+      if (category != EventCategory::notes && inCategories(categories, category))
+        dropped.push_back(uint32_t(i));
+    }
+    if (inCategories(categories, EventCategory::notes))
+    {
+      auto note = std::partition_point(indexed.notes.begin(), indexed.notes.end(), [&](const NoteSpan& n) { return n.start < start; });
+      for (; note != indexed.notes.end() && note->start < end; ++note)
+      {
+        dropped.push_back(note->noteOn);
+        if (note->noteOff != noNoteOff)
+          dropped.push_back(note->noteOff);
+        if (note->start < now && note->end >= now)
+        {
+          const MidiBytes& on = events.messages[note->noteOn];
+          cutOff.push_back({ { uint8_t(0x80 | (on.data[0] & 0x0f)), on.data[1], 0 }, 3, 0 });
+        }
+      }
+    }
+    if (dropped.empty())
+      return false;
+    std::sort(dropped.begin(), dropped.end());
+    kept.reserve(events.size() - dropped.size());
+    size_t next = 0;
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+      if (next < dropped.size() && dropped[next] == i)
+      {
+        next++;
+        continue;
+      }
+      kept.append(positions[i], events.messages[i], events.sysex, events.beatAt(i));
+    }
+    return true;
+  }
+
+  static EventColumns withoutCCs(const EventColumns& events)
+  {
+    EventColumns kept;
+    kept.reserve(events.size());
+    for (size_t i = 0; i < events.size(); ++i)
+      if (events.messages[i].length == 0 || (events.messages[i].data[0] & 0xf0) != 0xb0)
+        kept.append(events.samplePositions[i], events.messages[i], events.sysex, events.beatAt(i));
+    return kept;
+  }
+
+  // events with the ones in beats moved to where the current tempo map puts them, and sorted again
+  EventColumns retimed(const EventColumns& events) const
+  {
+    std::vector<int64_t> positions(events.samplePositions);
+    for (size_t i = 0; i < events.size(); ++i)
+      if (!std::isnan(events.beats[i]))
+        positions[i] = tempoMap->beatToSample(events.beats[i], compileSampleRate);
+    std::vector<uint32_t> order(events.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return positions[a] < positions[b]; });
+    EventColumns sorted;
+    sorted.reserve(events.size());
+    for (uint32_t i : order)
+      sorted.append(positions[i], events.messages[i], events.sysex, events.beats[i]);
+    return sorted;
+  }
+
+  void stage(StagedEdit edit)
+  {
+    {
+      std::lock_guard<std::mutex> lock(schedulerMutex);
+      stagedEdits.push_back(std::move(edit));
+    }
+    schedulerCv.notify_all();
+  }
+
+  void stage(StagedEdit::Kind kind, std::vector<StagedEvent> events = {}, std::vector<uint8_t> sysex = {})
+  {
+    stage({ kind, std::move(events), std::move(sysex) });
+  }
+
+  void compileLoop()
+  {
+    while (true)
+    {
+      std::vector<StagedEdit> edits;
+      {
+        std::unique_lock<std::mutex> lock(schedulerMutex);
+        compiling = !unpublishedLanes.empty() || !unpublishedWindows.empty() || !unpublishedTransport.empty();
+        schedulerCv.notify_all();  // For sync()
+        if (compiling)  // The audio thread hasn't made room yet; try again shortly
+          schedulerCv.wait_for(lock, std::chrono::milliseconds(1), [this] { return stopping || !stagedEdits.empty(); });
+        else if (eventFile)  // Look at the playhead now and then, to keep the window ahead of it
+          schedulerCv.wait_for(lock, std::chrono::milliseconds(20), [this] { return stopping || !stagedEdits.empty(); });
+        else
+          schedulerCv.wait(lock, [this] { return stopping || !stagedEdits.empty(); });
+        if (stopping)
+          return;
+        edits.swap(stagedEdits);
+        compiling = true;
+      }
+      freeRetiredLanes();
+      if (!edits.empty())
+        compile(edits);
+      if (eventFile || windowStale)
+        slideWindow();
+      publishLanes();
+    }
+  }
+
+  void freeRetiredLanes()
+  {
+    while (RetiredLane* retired = retiredLanes.front())
+    {
+      delete retired->compiled;
+      delete retired->table;
+      retiredLanes.pop();
+    }
+  }
+
+  // Applies a batch of edits in order and builds a new version of every lane they changed
+  void compile(std::vector<StagedEdit>& edits)
+  {
+    struct AddedEvents
+    {
+      std::vector<StagedEvent> events;
+      std::vector<uint8_t> sysex;
+    };
+    std::unordered_map<int, EventColumns> rewritten;  // Lanes a clear changed, whole
+    std::unordered_map<int, AddedEvents> added;       // New events by key, unsorted
+    bool retimeLanes = false;
+    auto rewrite = [&](int key) -> EventColumns& {
+      auto it = rewritten.find(key);
+      if (it != rewritten.end())
+        return it->second;
+      auto& events = rewritten[key];
+      auto compiled = compiledLanes.find(key);
+      if (compiled != compiledLanes.end())
+        events = compiled->second->events;
+      return events;
+    };
+
+    struct LaneCurves
+    {
+      std::vector<Curve> curves;
+      std::vector<CurvePoint> points;
+    };
+    std::unordered_map<int, LaneCurves> rewrittenCurves;  // Lanes whose curves changed
+    auto rewriteCurves = [&](int key) -> LaneCurves& {
+      auto it = rewrittenCurves.find(key);
+      if (it != rewrittenCurves.end())
+        return it->second;
+      auto& laneCurves = rewrittenCurves[key];
+      auto compiled = compiledLanes.find(key);
+      if (compiled != compiledLanes.end())
+      {
+        laneCurves.curves = compiled->second->curves;
+        laneCurves.points = compiled->second->curvePoints;
+      }
+      return laneCurves;
+    };
+    std::unordered_map<int, std::vector<ClipInstance>> rewrittenInstances;  // Lanes whose instances or their clips changed
+    auto rewriteInstances = [&](int key) -> std::vector<ClipInstance>& {
+      auto it = rewrittenInstances.find(key);
+      if (it != rewrittenInstances.end())
+        return it->second;
+      auto& instances = rewrittenInstances[key];
+      auto compiled = compiledLanes.find(key);
+      if (compiled != compiledLanes.end())
+        instances = compiled->second->instances;
+      return instances;
+    };
+    auto rewriteLanesPlaying = [&](uint32_t clipId) {
+      for (const auto& [key, lane] : compiledLanes)
+        for (const auto& instance : lane->instances)
+          if (instance.clipId == clipId)
+          {
+            rewriteInstances(key);
+            break;
+          }
+    };
+
+    // Identified events come out of their lanes by sample and bytes, all at once after the batch, unless
+    // they were inserted in this batch and are still waiting in added
+    std::unordered_map<int, std::vector<std::pair<int64_t, MidiBytes>>> removals;
+    std::unordered_set<uint64_t> insertedInBatch;
+    int64_t now = currentSamplePosition;
+    auto addIdentified = [&](uint64_t id, const IdentifiedEvent& event) {
+      auto& lane = added[event.key];
+      for (uint8_t i = 0; i < event.count; ++i)
+        lane.events.push_back({ event.samplePositions[i], event.key, event.messages[i], NAN });
+      identifiedEvents[id] = event;
+      identifiedByStart.insert({ event.key, event.samplePositions[0], id });
+      insertedInBatch.insert(id);
+    };
+    auto removeIdentified = [&](uint64_t id) {
+      auto it = identifiedEvents.find(id);
+      if (it == identifiedEvents.end())
+        return;
+      const IdentifiedEvent& event = it->second;
+      bool pending = insertedInBatch.count(id) != 0;
+      for (uint8_t i = 0; i < event.count; ++i)
+      {
+        if (pending)
+        {
+          auto& events = added[event.key].events;
+          auto match = std::find_if(events.begin(), events.end(), [&](const StagedEvent& staged) {
+            return staged.samplePosition == event.samplePositions[i] && sameMessage(staged.message, event.messages[i]);
+          });
+          if (match != events.end())
+          {
+            events.erase(match);
+            continue;
+          }
+        }
+        removals[event.key].emplace_back(event.samplePositions[i], event.messages[i]);
+      }
+      // A note that's sounding still gets its note off, now
+      if (!pending && event.count == 2 && event.samplePositions[0] < now && event.samplePositions[1] >= now)
+        added[event.key].events.push_back({ now, event.key, event.messages[1], NAN });
+      identifiedByStart.erase({ event.key, event.samplePositions[0], id });
+      identifiedEvents.erase(it);
+    };
+    auto insertIdentified = [&](const IdentifiedEventRecord& r) {
+      removeIdentified(r.id);
+      int length = juce::MidiMessage::getMessageLengthFromFirstByte(r.status);
+      IdentifiedEvent event{ r.key, 1, { r.sampleTime, 0 }, { { { r.status, r.data1, r.data2 }, uint8_t(juce::jlimit(1, 3, length)), 0 } } };
+      if ((r.status & 0xf0) == 0x90 && r.data2 != 0 && r.duration > 0)
+      {
+        event.count = 2;
+        event.samplePositions[1] = r.sampleTime + r.duration;
+        event.messages[1] = { { uint8_t(0x80 | (r.status & 0x0f)), r.data1, 0 }, 3, 0 };
+      }
+      addIdentified(r.id, event);
+    };
+
+    auto removeCurves = [&](LaneCurves& laneCurves, auto removes) {
+      LaneCurves kept;
+      for (Curve curve : laneCurves.curves)
+      {
+        if (removes(curve))
+          continue;
+        kept.points.insert(kept.points.end(), laneCurves.points.begin() + curve.firstPoint, laneCurves.points.begin() + curve.endPoint);
+        curve.firstPoint = uint32_t(kept.points.size()) - (curve.endPoint - curve.firstPoint);
+        curve.endPoint = uint32_t(kept.points.size());
+        kept.curves.push_back(curve);
+      }
+      laneCurves = std::move(kept);
+    };
+    // A lane as it stands so far in the batch, with its added events and pending removals folded in
+    auto fold = [&](int key) -> EventColumns& {
+      auto& events = rewrite(key);
+      auto pending = removals.find(key);
+      if (pending != removals.end())
+      {
+        events = without(events, pending->second);
+        removals.erase(pending);
+      }
+      auto laneAdded = added.find(key);
+      if (laneAdded != added.end())
+      {
+        auto& staged = laneAdded->second.events;
+        for (auto& event : staged)
+          if (!std::isnan(event.beat))
+            event.samplePosition = tempoMap->beatToSample(event.beat, compileSampleRate);
+        std::stable_sort(staged.begin(), staged.end(),
+          [](const StagedEvent& a, const StagedEvent& b) { return a.samplePosition < b.samplePosition; });
+        EventColumns columns;
+        columns.reserve(staged.size());
+        for (const auto& event : staged)
+          columns.append(event.samplePosition, event.message, laneAdded->second.sysex, event.beat);
+        events = merge(events, columns);
+        added.erase(laneAdded);
+      }
+      return events;
+    };
+    // Only touches the lanes, curves and instances that have something to clear. A lane no edit in the
+    // batch has changed yet is cleared using the chase index it already has
+    auto clearLane = [&](int key, uint32_t categories, int64_t start, int64_t end) {
+      std::vector<MidiBytes> cutOff;
+      EventColumns kept;
+      auto compiled = compiledLanes.find(key);
+      if (compiled != compiledLanes.end() && !rewritten.count(key) && !added.count(key) && !removals.count(key))
+      {
+        if (withoutRange(*compiled->second, categories, start, end, now, kept, cutOff))
+          rewritten[key] = std::move(kept);
+      }
+      else if (rewritten.count(key) || added.count(key) || removals.count(key))
+      {
+        CompiledLane scratch;
+        scratch.events = std::move(fold(key));
+        indexForChase(scratch);
+        rewritten[key] = withoutRange(scratch, categories, start, end, now, kept, cutOff) ? std::move(kept) : std::move(scratch.events);
+      }
+      for (const auto& off : cutOff)
+        added[key].events.push_back({ now, key, off, NAN });
+
+      for (auto it = identifiedByStart.lower_bound({ key, start, 0 }); it != identifiedByStart.end()
+        && std::get<0>(*it) == key && std::get<1>(*it) < end; )
+      {
+        auto event = identifiedEvents.find(std::get<2>(*it));
+        if (!inCategories(categories, categoryOf(event->second.messages[0])))
+        {
+          ++it;
+          continue;
+        }
+        insertedInBatch.erase(event->first);
+        identifiedEvents.erase(event);
+        it = identifiedByStart.erase(it);
+      }
+
+      auto inRange = [&](int64_t position) { return position >= start && position < end; };
+      auto clearsCurve = [&](const Curve& curve) {
+        return inRange(curve.start) && inCategories(categories, categoryOf({ { curve.status, curve.controller, 0 }, 3, 0 }));
+      };
+      auto curves = rewrittenCurves.find(key);
+      const std::vector<Curve>* laneCurves = curves != rewrittenCurves.end() ? &curves->second.curves
+        : compiled != compiledLanes.end() ? &compiled->second->curves : nullptr;
+      if (laneCurves && std::any_of(laneCurves->begin(), laneCurves->end(), clearsCurve))
+        removeCurves(rewriteCurves(key), clearsCurve);
+
+      if (!inCategories(categories, EventCategory::clips))
+        return;
+      auto instances = rewrittenInstances.find(key);
+      const std::vector<ClipInstance>* laneInstances = instances != rewrittenInstances.end() ? &instances->second
+        : compiled != compiledLanes.end() ? &compiled->second->instances : nullptr;
+      auto clearsInstance = [&](const ClipInstance& instance) { return inRange(instance.start); };
+      if (laneInstances && std::any_of(laneInstances->begin(), laneInstances->end(), clearsInstance))
+      {
+        auto& kept = rewriteInstances(key);
+        kept.erase(std::remove_if(kept.begin(), kept.end(), clearsInstance), kept.end());
+      }
+    };
+    auto laneKeys = [&] {
+      std::set<int> keys;
+      for (const auto& lane : compiledLanes)
+        keys.insert(lane.first);
+      for (const auto& lane : added)
+        keys.insert(lane.first);
+      for (const auto& lane : rewritten)
+        keys.insert(lane.first);
+      for (const auto& lane : rewrittenCurves)
+        keys.insert(lane.first);
+      for (const auto& lane : rewrittenInstances)
+        keys.insert(lane.first);
+      return keys;
+    };
+
+    for (auto& edit : edits)
+    {
+      switch (edit.kind)
+      {
+      case StagedEdit::add:
+        for (const auto& event : edit.events)
+        {
+          auto& lane = added[event.key];
+          lane.events.push_back(event);
+          if (event.message.length == 0)
+          {
+            // Into the lane's own arena, so the lanes of one edit don't share one
+            uint32_t length;
+            memcpy(&length, &edit.sysex[event.message.sysexOffset], sizeof(length));
+            auto first = edit.sysex.begin() + event.message.sysexOffset;
+            lane.events.back().message.sysexOffset = uint32_t(lane.sysex.size());
+            lane.sysex.insert(lane.sysex.end(), first, first + sizeof(length) + length);
+          }
+        }
+        break;
+      case StagedEdit::clearAll:
+        added.clear();
+        for (const auto& lane : compiledLanes)
+          rewritten[lane.first] = {};
+        for (auto& lane : rewritten)
+          lane.second = {};
+        removals.clear();
+        identifiedEvents.clear();
+        identifiedByStart.clear();
+        insertedInBatch.clear();
+        for (const auto& lane : compiledLanes)
+          rewrittenCurves[lane.first] = {};
+        for (auto& lane : rewrittenCurves)
+          lane.second = {};
+        for (const auto& lane : compiledLanes)
+          rewrittenInstances[lane.first] = {};
+        for (auto& lane : rewrittenInstances)
+          lane.second = {};
+        break;
+      case StagedEdit::clearCCs:
+      {
+        for (int key : laneKeys())
+          clearLane(key, 1u << uint32_t(EventCategory::controllers), std::numeric_limits<int64_t>::min(),
+            std::numeric_limits<int64_t>::max());
+        for (auto& [clipId, clip] : clips)
+        {
+          auto kept = std::make_shared<CompiledLane>();
+          kept->events = withoutCCs(clip->events);
+          indexForChase(*kept);
+          clip = std::move(kept);
+          rewriteLanesPlaying(clipId);
+        }
+        break;
+      }
+      case StagedEdit::clearRange:
+        if (edit.key >= 0)
+          clearLane(edit.key, edit.categories, edit.rangeStart, edit.rangeEnd);
+        else
+          for (int key : laneKeys())
+            clearLane(key, edit.categories, edit.rangeStart, edit.rangeEnd);
+        break;
+      case StagedEdit::addCurve:
+      {
+        auto& laneCurves = rewriteCurves(edit.key);
+        Curve curve = edit.curve;
+        curve.firstPoint = uint32_t(laneCurves.points.size());
+        laneCurves.points.insert(laneCurves.points.end(), edit.curvePoints.begin(), edit.curvePoints.end());
+        curve.endPoint = uint32_t(laneCurves.points.size());
+        laneCurves.curves.push_back(curve);
+        break;
+      }
+      case StagedEdit::defineClip:
+      {
+        std::stable_sort(edit.events.begin(), edit.events.end(),
+          [](const StagedEvent& a, const StagedEvent& b) { return a.samplePosition < b.samplePosition; });
+        auto clip = std::make_shared<CompiledLane>();
+        clip->events.reserve(edit.events.size());
+        for (const auto& event : edit.events)
+          clip->events.append(event.samplePosition, event.message, edit.sysex);
+        indexForChase(*clip);
+        clips[edit.clipId] = std::move(clip);
+        rewriteLanesPlaying(edit.clipId);
+        break;
+      }
+      case StagedEdit::addInstances:
+      {
+        auto& instances = rewriteInstances(edit.key);
+        instances.insert(instances.end(), edit.instances.begin(), edit.instances.end());
+        break;
+      }
+      case StagedEdit::edit:
+        for (uint64_t id : edit.deletes)
+          removeIdentified(id);
+        for (const auto& move : edit.moves)
+        {
+          auto it = identifiedEvents.find(move.id);
+          if (it == identifiedEvents.end())
+            continue;
+          IdentifiedEvent event = it->second;
+          removeIdentified(move.id);
+          int64_t shift = move.sampleTime - event.samplePositions[0];
+          for (uint8_t i = 0; i < event.count; ++i)
+            event.samplePositions[i] += shift;
+          addIdentified(move.id, event);
+        }
+        for (const auto& r : edit.identified)
+          insertIdentified(r);
+        break;
+      case StagedEdit::replaceRange:
+      {
+        std::vector<uint64_t> inRange;
+        for (auto it = identifiedByStart.lower_bound({ edit.key, edit.rangeStart, 0 });
+          it != identifiedByStart.end() && std::get<0>(*it) == edit.key && std::get<1>(*it) < edit.rangeEnd; ++it)
+          inRange.push_back(std::get<2>(*it));
+        for (uint64_t id : inRange)
+          removeIdentified(id);
+        for (const auto& r : edit.identified)
+          insertIdentified(r);
+        break;
+      }
+      case StagedEdit::retime:
+        if (edit.tempoMap)
+          tempoMap = edit.tempoMap;
+        if (edit.sampleRate > 0)
+          compileSampleRate = edit.sampleRate;
+        retimeLanes = true;
+        break;
+      case StagedEdit::transport:
+        unpublishedTransport.push_back(edit.transportChange);
+        if (edit.transportChange.seekTo >= 0)
+          seekingTo = edit.transportChange.seekTo;
+        if (edit.transportChange.setsLoop)
+        {
+          streamLoopStart = edit.transportChange.loopStart;
+          streamLoopEnd = edit.transportChange.loopEnd;
+          windowStale = true;
+        }
+        break;
+      case StagedEdit::stream:
+        eventFile = edit.eventFile;
+        windowStale = true;
+        break;
+      case StagedEdit::slide:
+        break;
+      }
+    }
+
+    for (const auto& [key, events] : removals)
+      rewritten[key] = without(rewrite(key), events);
+    for (const auto& lane : rewrittenCurves)
+      rewrite(lane.first);
+    for (const auto& lane : rewrittenInstances)
+      rewrite(lane.first);
+
+    // Lanes with events in beats follow the tempo map as it is after the whole batch
+    if (retimeLanes)
+    {
+      for (const auto& lane : compiledLanes)
+        if (!lane.second->events.beats.empty())
+          rewrite(lane.first);
+      for (auto& lane : rewritten)
+        if (!lane.second.beats.empty())
+          lane.second = retimed(lane.second);
+    }
+
+    std::vector<std::pair<int, CompiledLane*>> built;
+    for (auto& [key, events] : added)
+    {
+      for (auto& event : events.events)
+        if (!std::isnan(event.beat))
+          event.samplePosition = tempoMap->beatToSample(event.beat, compileSampleRate);
+      std::stable_sort(events.events.begin(), events.events.end(),
+        [](const StagedEvent& a, const StagedEvent& b) { return a.samplePosition < b.samplePosition; });
+      auto lane = new CompiledLane;
+      lane->added.reserve(events.events.size());
+      for (const auto& event : events.events)
+        lane->added.append(event.samplePosition, event.message, events.sysex, event.beat);
+      lane->events = merge(rewrite(key), lane->added);
+      rewritten.erase(key);
+      built.emplace_back(key, lane);
+    }
+    for (auto& [key, events] : rewritten)
+    {
+      auto lane = new CompiledLane;
+      lane->events = std::move(events);
+      built.emplace_back(key, lane);
+    }
+
+    int bucketLength = samplesPerBucket.load();
+    for (auto& [key, lane] : built)
+    {
+      auto curves = rewrittenCurves.find(key);
+      auto compiled = compiledLanes.find(key);
+      if (curves != rewrittenCurves.end())
+      {
+        lane->curves = std::move(curves->second.curves);
+        lane->curvePoints = std::move(curves->second.points);
+      }
+      else if (compiled != compiledLanes.end())
+      {
+        lane->curves = compiled->second->curves;
+        lane->curvePoints = compiled->second->curvePoints;
+      }
+      auto instances = rewrittenInstances.find(key);
+      if (instances != rewrittenInstances.end())
+        resolveInstances(*lane, std::move(instances->second));
+      else if (compiled != compiledLanes.end())
+      {
+        lane->instances = compiled->second->instances;
+        lane->instanceEndsSoFar = compiled->second->instanceEndsSoFar;
+        lane->instanceClips = compiled->second->instanceClips;
+      }
+      indexLane(*lane, bucketLength);
+
+      // Replaces a version the audio thread never saw: it only needs that one's added events, they may be late too
+      auto unpublished = unpublishedLanes.find(key);
+      if (unpublished != unpublishedLanes.end())
+      {
+        lane->added = merge(unpublished->second->added, lane->added);
+        delete unpublished->second;
+      }
+      unpublishedLanes[key] = lane;
+      compiledLanes[key] = lane;
+      addToLaneIndex(key);
+    }
+  }
+
+  // Compile thread: points lane's clip instances at the clips as they are now, sorted by start
+  void resolveInstances(CompiledLane& lane, std::vector<ClipInstance> instances) const
+  {
+    std::stable_sort(instances.begin(), instances.end(), [](const ClipInstance& a, const ClipInstance& b) { return a.start < b.start; });
+    for (auto& instance : instances)
+    {
+      instance.clip = nullptr;
+      instance.end = instance.start;
+      auto clip = clips.find(instance.clipId);
+      if (clip == clips.end())
+        continue;
+      instance.clip = clip->second.get();
+      if (clip->second->events.size() != 0)
+        instance.end = instance.start + clip->second->events.samplePositions.back();
+      if (std::find(lane.instanceClips.begin(), lane.instanceClips.end(), clip->second) == lane.instanceClips.end())
+        lane.instanceClips.push_back(clip->second);
+    }
+    for (size_t i = 0; i < instances.size(); ++i)
+      lane.instanceEndsSoFar.push_back(i == 0 ? instances[i].end : std::max(lane.instanceEndsSoFar.back(), instances[i].end));
+    lane.instances = std::move(instances);
+  }
+
+  // Buckets lane's events by block and indexes them for chasing
+  static void indexLane(CompiledLane& lane, int bucketLength)
+  {
+    lane.samplesPerBucket = bucketLength;
+    for (uint32_t i = 0; i < lane.events.size(); ++i)
+    {
+      int64_t position = lane.events.samplePositions[i];
+      int64_t start = position - ((position % bucketLength) + bucketLength) % bucketLength;
+      if (lane.buckets.empty() || lane.buckets.back().startSample != start)
+        lane.buckets.push_back({ start, i });
+    }
+    indexForChase(lane);
+    indexCurves(lane);
+  }
+
+  void addToLaneIndex(int key)
+  {
+    if (laneIndex.find(key) == laneIndex.end())
+    {
+      laneStorage.push_back(std::make_unique<Lane>());
+      laneIndex[key] = laneStorage.back().get();
+      laneIndexChanged = true;
+    }
+  }
+
+  // Compile thread, while a file is streaming: rebuilds every key's window of file events when the playhead
+  // (or the seek about to move it) gets within half the lookahead of the window's end or leaves it. A loop
+  // keeps its start loaded too, so wrapping doesn't wait for the file
+  void slideWindow()
+  {
+    int64_t playhead = seekingTo >= 0 ? seekingTo : currentSamplePosition.load();
+    seekingTo = -1;
+    int64_t ahead = int64_t(streamAheadSeconds * compileSampleRate);
+    int64_t behind = int64_t(streamBehindSeconds * compileSampleRate);
+    if (!windowStale && playhead >= windowStart && playhead + ahead / 2 <= windowEnd)
+      return;
+    windowStale = false;
+
+    std::vector<std::pair<int64_t, int64_t>> spans;
+    if (eventFile)
+    {
+      windowStart = std::max<int64_t>(0, playhead - behind);
+      windowEnd = playhead + ahead;
+      if (streamLoopEnd > streamLoopStart && streamLoopStart < windowStart)
+        spans.emplace_back(std::max<int64_t>(0, streamLoopStart - behind), std::min(streamLoopEnd, streamLoopStart + ahead));
+      if (!spans.empty() && spans.back().second >= windowStart)
+        spans.back().second = windowEnd;
+      else
+        spans.emplace_back(windowStart, windowEnd);
+    }
+
+    std::unordered_map<int, EventColumns> windows;
+    std::vector<uint8_t> noSysex;
+    size_t outOfOrder = 0;
+    for (const auto& [start, end] : spans)
+    {
+      size_t first = eventFile->firstAt(start);
+      size_t last = eventFile->firstAt(end);
+      int64_t previous = start;
+      for (size_t i = first; i < last; ++i)
+      {
+        MidiEventRecord r = eventFile->record(i);
+        if (r.sampleTime < previous)
+        {
+          outOfOrder++;
+          continue;
+        }
+        previous = r.sampleTime;
+        int length = juce::MidiMessage::getMessageLengthFromFirstByte(r.status);
+        windows[r.key].append(r.sampleTime, { { r.status, r.data1, r.data2 }, uint8_t(juce::jlimit(1, 3, length)), 0 }, noSysex);
+      }
+      eventFile->release(first, last);
+    }
+    if (outOfOrder > 0)
+      std::cout << "Skipped " << outOfOrder << " out of order events in " << eventFile->getPath() << std::endl;
+
+    int bucketLength = samplesPerBucket.load();
+    for (int key : windowKeys)
+      if (windows.find(key) == windows.end())
+        setUnpublishedWindow(key, nullptr);
+    windowKeys.clear();
+    for (auto& [key, events] : windows)
+    {
+      auto window = new CompiledLane;
+      window->events = std::move(events);
+      indexLane(*window, bucketLength);
+      setUnpublishedWindow(key, window);
+      windowKeys.push_back(key);
+      addToLaneIndex(key);
+    }
+    if (!eventFile)
+      windowEnd = 0;
+    windowUnpublished = true;
+  }
+
+  void setUnpublishedWindow(int key, CompiledLane* window)
+  {
+    auto unpublished = unpublishedWindows.find(key);
+    if (unpublished != unpublishedWindows.end())
+      delete unpublished->second;
+    unpublishedWindows[key] = window;
+  }
+
+  // Hands built lanes to the audio thread, as many as publishedLanes has room for. A new key's lane table
+  // goes first, so the audio thread can find the lane by the time it gets the lane's events
+  void publishLanes()
+  {
+    if (laneIndexChanged)
+    {
+      auto table = new LaneTable(laneIndex);
+      if (!publishedLanes.push({ nullptr, nullptr, table }))
+      {
+        delete table;
+        return;
+      }
+      laneIndexChanged = false;
+    }
+    for (auto it = unpublishedLanes.begin(); it != unpublishedLanes.end(); )
+    {
+      if (!publishedLanes.push({ laneIndex[it->first], it->second, nullptr }))
+        return;
+      it = unpublishedLanes.erase(it);
+    }
+    for (auto it = unpublishedWindows.begin(); it != unpublishedWindows.end(); )
+    {
+      if (!publishedLanes.push({ laneIndex[it->first], it->second, nullptr, {}, true }))
+        return;
+      it = unpublishedWindows.erase(it);
+    }
+    if (windowUnpublished)
+    {
+      std::lock_guard<std::mutex> lock(windowMutex);
+      windowReadyFrom = windowStart;
+      windowReadyUntil = windowEnd;
+      windowUnpublished = false;
+    }
+    size_t published = 0;
+    while (published < unpublishedTransport.size()
+      && publishedLanes.push({ nullptr, nullptr, nullptr, unpublishedTransport[published] }))
+      published++;
+    unpublishedTransport.erase(unpublishedTransport.begin(), unpublishedTransport.begin() + published);
+  }
+
+  // CCs that make no sense replayed on their own: data entry and (N)RPN selection, which only mean something
+  // in sequence, and the channel mode messages
+  static bool isChasedController(int controller)
+  {
+    return controller != 6 && controller != 38 && !(controller >= 96 && controller <= 101) && controller < 120;
+  }
+
+  // Compile thread: pairs lane's note ons with their note offs, first on with first off for a repeated
+  // note, and groups the events a chase replays
+  static void indexForChase(CompiledLane& lane)
+  {
+    const EventColumns& events = lane.events;
+    std::unordered_map<int, std::deque<uint32_t>> sounding;  // channel << 7 | note -> notes not yet off
+    std::vector<std::pair<uint32_t, uint32_t>> state;        // (group, event)
+    for (uint32_t i = 0; i < events.size(); ++i)
+    {
+      const MidiBytes& message = events.messages[i];
+      if (message.length < 2)
+        continue;
+      int type = message.data[0] & 0xf0;
+      int channel = message.data[0] & 0x0f;
+      int number = message.data[1] & 0x7f;
+      if (type == 0x90 && message.length == 3 && message.data[2] != 0)
+      {
+        sounding[channel << 7 | number].push_back(uint32_t(lane.notes.size()));
+        lane.notes.push_back({ events.samplePositions[i], std::numeric_limits<int64_t>::max(), i, noNoteOff });
+      }
+      else if (type == 0x80 || type == 0x90)
+      {
+        auto it = sounding.find(channel << 7 | number);
+        if (it != sounding.end() && !it->second.empty())
+        {
+          lane.notes[it->second.front()].end = events.samplePositions[i];
+          lane.notes[it->second.front()].noteOff = i;
+          it->second.pop_front();
+        }
+      }
+      else if ((type == 0xb0 && isChasedController(number)) || type == 0xc0 || type == 0xd0 || type == 0xe0)
+      {
+        int controller = type == 0xb0 ? number : 0;
+        state.emplace_back(stateGroupKey(message.data[0], uint8_t(controller)), i);
+      }
+    }
+
+    std::vector<uint32_t> stillSounding;
+    for (uint32_t n = 0; n < lane.notes.size(); ++n)
+    {
+      if (n % notesPerCheckpoint == 0)
+      {
+        int64_t at = lane.notes[n].start;
+        stillSounding.erase(std::remove_if(stillSounding.begin(), stillSounding.end(),
+          [&](uint32_t earlier) { return lane.notes[earlier].end <= at; }), stillSounding.end());
+        lane.checkpointFirst.push_back(uint32_t(lane.checkpointNotes.size()));
+        lane.checkpointNotes.insert(lane.checkpointNotes.end(), stillSounding.begin(), stillSounding.end());
+      }
+      stillSounding.push_back(n);
+    }
+    lane.checkpointFirst.push_back(uint32_t(lane.checkpointNotes.size()));
+
+    std::stable_sort(state.begin(), state.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    lane.stateEvents.reserve(state.size());
+    for (size_t i = 0; i < state.size(); ++i)
+    {
+      if (i == 0 || state[i].first != state[i - 1].first)
+      {
+        lane.stateGroupFirst.push_back(uint32_t(i));
+        lane.stateGroupKeys.push_back(state[i].first);
+      }
+      lane.stateEvents.push_back(state[i].second);
+    }
+    lane.stateGroupFirst.push_back(uint32_t(state.size()));
+  }
+
+  static uint32_t stateGroupKey(uint8_t status, uint8_t controller)
+  {
+    int type = status & 0xf0;
+    return uint32_t((type >> 4) << 11 | (status & 0x0f) << 7 | (type == 0xb0 ? controller & 0x7f : 0));
+  }
+
+  static void indexCurves(CompiledLane& lane)
+  {
+    std::stable_sort(lane.curves.begin(), lane.curves.end(), [](const Curve& a, const Curve& b) { return a.start < b.start; });
+    std::vector<std::pair<uint32_t, uint32_t>> grouped;  // (group, curve)
+    for (uint32_t c = 0; c < lane.curves.size(); ++c)
+    {
+      const Curve& curve = lane.curves[c];
+      lane.curveEndsSoFar.push_back(c == 0 ? curve.end : std::max(lane.curveEndsSoFar.back(), curve.end));
+      if ((curve.status & 0xf0) != 0xb0 || isChasedController(curve.controller))
+        grouped.emplace_back(stateGroupKey(curve.status, curve.controller), c);
+    }
+    std::stable_sort(grouped.begin(), grouped.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 0; i < grouped.size(); ++i)
+    {
+      if (i == 0 || grouped[i].first != grouped[i - 1].first)
+      {
+        lane.curveGroupFirst.push_back(uint32_t(i));
+        lane.curveGroupKeys.push_back(grouped[i].first);
+      }
+      lane.groupedCurves.push_back(grouped[i].second);
+    }
+    lane.curveGroupFirst.push_back(uint32_t(grouped.size()));
+  }
+
+  // Calls visit with each of compiled's notes that started before position and is still sounding at it,
+  // counting the ones that end right there if endingThere
+  template <typename Visit>
+  static void forNotesSoundingAt(const CompiledLane& compiled, int64_t position, bool endingThere, Visit visit)
+  {
+    const auto& notes = compiled.notes;
+    size_t started = size_t(std::partition_point(notes.begin(), notes.end(),
+      [&](const NoteSpan& note) { return note.start < position; }) - notes.begin());
+    if (started == 0)
+      return;
+    auto sounds = [&](const NoteSpan& note) { return endingThere ? note.end >= position : note.end > position; };
+    size_t checkpoint = (started - 1) / notesPerCheckpoint;
+    for (uint32_t i = compiled.checkpointFirst[checkpoint]; i < compiled.checkpointFirst[checkpoint + 1]; ++i)
+      if (sounds(notes[compiled.checkpointNotes[i]]))
+        visit(notes[compiled.checkpointNotes[i]]);
+    for (size_t n = checkpoint * notesPerCheckpoint; n < started; ++n)
+      if (sounds(notes[n]))
+        visit(notes[n]);
+  }
+
+  // A curve's value at position, between the breakpoints either side of it
+  static float curveValueAt(const CompiledLane& compiled, const Curve& curve, int64_t position)
+  {
+    auto first = compiled.curvePoints.begin() + curve.firstPoint;
+    auto last = compiled.curvePoints.begin() + curve.endPoint;
+    auto next = std::partition_point(first, last, [&](const CurvePoint& point) { return point.samplePosition <= position; });
+    if (next == first)
+      return first->value;
+    if (next == last)
+      return (last - 1)->value;
+    const CurvePoint& previous = *(next - 1);
+    double t = double(position - previous.samplePosition) / double(next->samplePosition - previous.samplePosition);
+    return float(previous.value + (next->value - previous.value) * curveFraction(previous.shape, t));
+  }
+
+  static MidiBytes curveMessage(const Curve& curve, float value)
+  {
+    MidiBytes message{};
+    message.data[0] = curve.status;
+    if ((curve.status & 0xf0) == 0xe0)
+    {
+      int bend = juce::jlimit(0, 16383, juce::roundToInt(value));
+      message.data[1] = uint8_t(bend & 0x7f);
+      message.data[2] = uint8_t(bend >> 7);
+      message.length = 3;
+    }
+    else if ((curve.status & 0xf0) == 0xd0)
+    {
+      message.data[1] = uint8_t(juce::jlimit(0, 127, juce::roundToInt(value)));
+      message.length = 2;
+    }
+    else
+    {
+      message.data[1] = curve.controller;
+      message.data[2] = uint8_t(juce::jlimit(0, 127, juce::roundToInt(value)));
+      message.length = 3;
+    }
+    return message;
+  }
+
+  static bool sameCurveMessage(const CompiledLane& compiled, const Curve& curve, int64_t a, int64_t b)
+  {
+    return sameMessage(curveMessage(curve, curveValueAt(compiled, curve, a)), curveMessage(curve, curveValueAt(compiled, curve, b)));
+  }
+
+  // The last sample before position (and after the curve's start) where curve sent, or might have sent, a message
+  static int64_t lastCurveSampleBefore(const Curve& curve, int64_t position)
+  {
+    if (curve.end < position)
+      return curve.end;
+    return curve.start + (position - 1 - curve.start) / curve.resolution * curve.resolution;
+  }
+
+  static void addCurveMessage(const CompiledLane& compiled, const Curve& curve, int64_t samplePosition,
+    juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    MidiBytes message = curveMessage(curve, curveValueAt(compiled, curve, samplePosition));
+    buffer.addEvent(message.data, message.length, sampleOffset);
+  }
+
+  // Audio thread: the messages compiled's curves send from start up to end, worked out afresh each block. A
+  // curve sends on its grid of resolution samples, skipping points where the message wouldn't change, and
+  // its last value at its end
+  static void addCurvesInRange(const CompiledLane& compiled, int64_t start, int64_t end, juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    auto firstCurve = std::partition_point(compiled.curveEndsSoFar.begin(), compiled.curveEndsSoFar.end(),
+      [&](int64_t curveEnd) { return curveEnd < start; });
+    for (size_t c = size_t(firstCurve - compiled.curveEndsSoFar.begin()); c < compiled.curves.size() && compiled.curves[c].start < end; ++c)
+    {
+      const Curve& curve = compiled.curves[c];
+      if (curve.end < start)
+        continue;
+      int64_t resolution = curve.resolution;
+      int64_t gridEnd = std::min(end, curve.end);
+      int64_t first = start <= curve.start ? curve.start : curve.start + (start - curve.start + resolution - 1) / resolution * resolution;
+      for (int64_t samplePosition = first; samplePosition < gridEnd; samplePosition += resolution)
+        if (samplePosition == curve.start || !sameCurveMessage(compiled, curve, samplePosition, samplePosition - resolution))
+          addCurveMessage(compiled, curve, samplePosition, buffer, static_cast<int>(samplePosition - start) + sampleOffset);
+      if (curve.end >= start && curve.end < end
+        && (curve.end == curve.start || !sameCurveMessage(compiled, curve, curve.end, lastCurveSampleBefore(curve, curve.end))))
+        addCurveMessage(compiled, curve, curve.end, buffer, static_cast<int>(curve.end - start) + sampleOffset);
+    }
+  }
+
+  static size_t findGroup(const std::vector<uint32_t>& keys, uint32_t key)
+  {
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    return it != keys.end() && *it == key ? size_t(it - keys.begin()) : keys.size();
+  }
+
+  // The curve in a group of compiled's curves that last sent before position, or nullptr
+  static const Curve* lastCurveBefore(const CompiledLane& compiled, size_t group, int64_t position)
+  {
+    if (group + 1 >= compiled.curveGroupFirst.size())
+      return nullptr;
+    auto first = compiled.groupedCurves.begin() + compiled.curveGroupFirst[group];
+    auto last = compiled.groupedCurves.begin() + compiled.curveGroupFirst[group + 1];
+    auto after = std::partition_point(first, last, [&](uint32_t c) { return compiled.curves[c].start < position; });
+    return after != first ? &compiled.curves[*(after - 1)] : nullptr;
+  }
+
+  // message as instance plays it: notes transposed and note on velocities scaled. False for a note
+  // transposed out of range
+  static bool played(MidiBytes& message, const ClipInstance& instance)
+  {
+    int type = message.data[0] & 0xf0;
+    if (message.length == 0 || (type != 0x80 && type != 0x90 && type != 0xa0))
+      return true;
+    int note = message.data[1] + instance.transpose;
+    if (note < 0 || note > 127)
+      return false;
+    message.data[1] = uint8_t(note);
+    if (type == 0x90 && message.data[2] != 0 && instance.velocityScale != 1.0f)
+      message.data[2] = uint8_t(juce::jlimit(1, 127, juce::roundToInt(message.data[2] * instance.velocityScale)));
+    return true;
+  }
+
+  // events.addToBuffer, through instance if the events are a clip's
+  static void addPlayed(const EventColumns& events, size_t i, const ClipInstance* instance, juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    MidiBytes message = events.messages[i];
+    if (!instance || message.length == 0)
+      events.addToBuffer(i, buffer, sampleOffset);
+    else if (played(message, *instance))
+      buffer.addEvent(message.data, message.length, sampleOffset);
+  }
+
+  // Calls visit with each of compiled's clip instances that started before position and hasn't played its
+  // last event before it
+  template <typename Visit>
+  static void forInstancesAround(const CompiledLane& compiled, int64_t position, Visit visit)
+  {
+    auto first = std::partition_point(compiled.instanceEndsSoFar.begin(), compiled.instanceEndsSoFar.end(),
+      [&](int64_t instanceEnd) { return instanceEnd < position; });
+    for (size_t i = size_t(first - compiled.instanceEndsSoFar.begin()); i < compiled.instances.size() && compiled.instances[i].start < position; ++i)
+      if (compiled.instances[i].clip && compiled.instances[i].end >= position)
+        visit(compiled.instances[i]);
+  }
+
+  // The chase's parts, for compiled's own events or, with instance, for a clip's with from and to measured
+  // from the instance's start
+  static void chaseNoteOffs(const CompiledLane& compiled, int64_t from, const ClipInstance* instance, juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    forNotesSoundingAt(compiled, from, true, [&](const NoteSpan& note) {
+      MidiBytes on = compiled.events.messages[note.noteOn];
+      if (instance && !played(on, *instance))
+        return;
+      uint8_t off[3] = { uint8_t(0x80 | (on.data[0] & 0x0f)), on.data[1], 0 };
+      buffer.addEvent(off, 3, sampleOffset);
+    });
+  }
+
+  static void chaseState(const CompiledLane& compiled, int64_t to, const ClipInstance* instance, juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    const EventColumns& events = compiled.events;
+    auto lastStateEventBefore = [&](size_t group) -> int64_t {
+      if (group + 1 >= compiled.stateGroupFirst.size())
+        return -1;
+      auto first = compiled.stateEvents.begin() + compiled.stateGroupFirst[group];
+      auto last = compiled.stateEvents.begin() + compiled.stateGroupFirst[group + 1];
+      auto after = std::partition_point(first, last, [&](uint32_t i) { return events.samplePositions[i] < to; });
+      return after != first ? int64_t(*(after - 1)) : -1;
+    };
+    for (size_t group = 0; group + 1 < compiled.stateGroupFirst.size(); ++group)
+    {
+      int64_t event = lastStateEventBefore(group);
+      if (event < 0)
+        continue;
+      const Curve* curve = lastCurveBefore(compiled, findGroup(compiled.curveGroupKeys, compiled.stateGroupKeys[group]), to);
+      if (!curve || lastCurveSampleBefore(*curve, to) < events.samplePositions[size_t(event)])
+        addPlayed(events, size_t(event), instance, buffer, sampleOffset);
+    }
+    for (size_t group = 0; group + 1 < compiled.curveGroupFirst.size(); ++group)
+    {
+      const Curve* curve = lastCurveBefore(compiled, group, to);
+      if (!curve)
+        continue;
+      int64_t samplePosition = lastCurveSampleBefore(*curve, to);
+      int64_t event = lastStateEventBefore(findGroup(compiled.stateGroupKeys, compiled.curveGroupKeys[group]));
+      if (event < 0 || events.samplePositions[size_t(event)] <= samplePosition)
+        addCurveMessage(compiled, *curve, samplePosition, buffer, sampleOffset);
+    }
+  }
+
+  static void chaseNoteOns(const CompiledLane& compiled, int64_t to, const ClipInstance* instance, juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    forNotesSoundingAt(compiled, to, false, [&](const NoteSpan& note) {
+      addPlayed(compiled.events, note.noteOn, instance, buffer, sampleOffset);
+    });
+  }
+
+  // Audio thread, at a jump from one position to another: note offs for compiled's notes sounding at from,
+  // then its controllers, programs, pressure and pitch bend as they stand at to, whether last set by an
+  // event or a curve, then note ons for the notes sounding at to. Events right at to are left for the block
+  // to play as usual. Clip instances are chased the same way, except that only the last one to start before
+  // to sends its controllers, after the lane's own
+  static void chase(const CompiledLane& compiled, int64_t from, int64_t to, juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    chaseNoteOffs(compiled, from, nullptr, buffer, sampleOffset);
+    forInstancesAround(compiled, from, [&](const ClipInstance& instance) {
+      chaseNoteOffs(*instance.clip, from - instance.start, &instance, buffer, sampleOffset);
+    });
+    chaseState(compiled, to, nullptr, buffer, sampleOffset);
+    auto playing = std::partition_point(compiled.instances.begin(), compiled.instances.end(),
+      [&](const ClipInstance& instance) { return instance.start < to; });
+    if (playing != compiled.instances.begin() && (playing - 1)->clip)
+      chaseState(*(playing - 1)->clip, to - (playing - 1)->start, &*(playing - 1), buffer, sampleOffset);
+    chaseNoteOns(compiled, to, nullptr, buffer, sampleOffset);
+    forInstancesAround(compiled, to, [&](const ClipInstance& instance) {
+      chaseNoteOns(*instance.clip, to - instance.start, &instance, buffer, sampleOffset);
+    });
+  }
+
+  // Audio thread: the events compiled's clip instances play from start up to end, found in each clip by
+  // binary search
+  static void addInstancesInRange(const CompiledLane& compiled, int64_t start, int64_t end, juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    auto first = std::partition_point(compiled.instanceEndsSoFar.begin(), compiled.instanceEndsSoFar.end(),
+      [&](int64_t instanceEnd) { return instanceEnd < start; });
+    for (size_t i = size_t(first - compiled.instanceEndsSoFar.begin()); i < compiled.instances.size() && compiled.instances[i].start < end; ++i)
+    {
+      const ClipInstance& instance = compiled.instances[i];
+      if (!instance.clip || instance.end < start)
+        continue;
+      const EventColumns& events = instance.clip->events;
+      size_t e = size_t(std::lower_bound(events.samplePositions.begin(), events.samplePositions.end(), start - instance.start)
+        - events.samplePositions.begin());
+      for (; e < events.size() && instance.start + events.samplePositions[e] < end; ++e)
+        addPlayed(events, e, &instance, buffer, static_cast<int>(instance.start + events.samplePositions[e] - start) + sampleOffset);
+    }
+  }
+
+  // Audio thread: compiled's events from start up to end, with start at sampleOffset in the buffer. bucket is
+  // the cursor into compiled, moved up to start
+  static void addEventsInRange(const CompiledLane& compiled, size_t& bucket, int64_t start, int64_t end,
+    juce::MidiBuffer& buffer, int sampleOffset)
+  {
+    const auto& buckets = compiled.buckets;
+    while (bucket < buckets.size() && buckets[bucket].startSample + compiled.samplesPerBucket <= start)
+      bucket++;
+    for (size_t b = bucket; b < buckets.size() && buckets[b].startSample < end; ++b)
+    {
+      size_t last = b + 1 < buckets.size() ? buckets[b + 1].firstEvent : compiled.events.size();
+      for (size_t i = buckets[b].firstEvent; i < last; ++i)
+      {
+        int64_t samplePosition = compiled.events.samplePositions[i];
+        if (samplePosition >= end)
+          break;
+        if (samplePosition >= start)
+          compiled.events.addToBuffer(i, buffer, static_cast<int>(samplePosition - start) + sampleOffset);
+      }
+    }
+    if (!compiled.curves.empty())
+      addCurvesInRange(compiled, start, end, buffer, sampleOffset);
+    if (!compiled.instances.empty())
+      addInstancesInRange(compiled, start, end, buffer, sampleOffset);
+  }
+
+  // Calls visit with each of lane's event sources, the scheduled events and the streamed window, and its cursor
+  template <typename Visit>
+  static void forEachSource(Lane& lane, Visit visit)
+  {
+    if (lane.compiled)
+      visit(*lane.compiled, lane.bucket);
+    if (lane.window)
+      visit(*lane.window, lane.windowBucket);
+  }
+
+  static size_t firstBucketAt(const CompiledLane& compiled, int64_t position)
+  {
+    auto it = std::lower_bound(compiled.buckets.begin(), compiled.buckets.end(), position,
+      [&](const BlockBucket& bucket, int64_t p) { return bucket.startSample + compiled.samplesPerBucket <= p; });
+    return size_t(it - compiled.buckets.begin());
+  }
+
+  // Audio thread. Stops early, leaving the rest for the next block, when there's no room to hand back what
+  // an update replaces, or when a lane's late events from an update picked up this block haven't been played
+  void adoptCompiledLanes()
+  {
+    int64_t position = currentSamplePosition;
+    while (LaneUpdate* update = publishedLanes.front())
+    {
+      if (retiredLanes.full())
+        return;
+      if (update->table)
+      {
+        if (laneTable)
+          retiredLanes.push({ nullptr, laneTable });
+        laneTable = update->table;
+      }
+      else if (!update->lane)
+      {
+        // Lanes catch up with a seek when they're next read, so it costs the same however many there are
+        const TransportChange& change = update->transport;
+        if (change.setsLoop)
+        {
+          loopStart = change.loopStart;
+          loopEnd = change.loopEnd;
+        }
+        if (change.seekTo >= 0)
+        {
+          jumps++;
+          jumpFrom = position;
+          position = change.seekTo;
+          currentSamplePosition = position;
+        }
+      }
+      else if (update->window)
+      {
+        Lane& lane = *update->lane;
+        if (lane.window)
+          retiredLanes.push({ lane.window, nullptr });
+        else if (!lane.compiled)
+          lane.jumpsSeen = jumps;
+        lane.window = update->compiled;
+        if (lane.window)
+          lane.windowBucket = firstBucketAt(*lane.window, position);
+      }
+      else
+      {
+        Lane& lane = *update->lane;
+        if (lane.lateEvents > 0 && lane.adoptedInBlock == blocksBegun)
+          return;
+        if (lane.compiled)
+          retiredLanes.push({ lane.compiled, nullptr });
+        else if (!lane.window)
+          lane.jumpsSeen = jumps;  // A new lane has nothing sounding to chase
+        lane.compiled = update->compiled;
+        lane.adoptedInBlock = blocksBegun;
+        lane.bucket = firstBucketAt(*lane.compiled, position);
+        const auto& added = lane.compiled->added.samplePositions;
+        lane.lateEvents = size_t(std::lower_bound(added.begin(), added.end(), position) - added.begin());
+      }
+      publishedLanes.pop();
+    }
+  }
+
+public:
+  explicit MidiScheduler(double sr) 
+    : compileSampleRate(sr),
+    sampleRate(sr)
+  {
+    compileThread = std::thread([this] { compileLoop(); });
+  }
+
+  ~MidiScheduler()
+  {
+    {
+      std::lock_guard<std::mutex> lock(schedulerMutex);
+      stopping = true;
+    }
+    schedulerCv.notify_all();
+    compileThread.join();
+
+    // Every compiled lane is now in exactly one place: unpublished, in publishedLanes, in use, or retired
+    for (auto& lane : unpublishedLanes)
+      delete lane.second;
+    for (auto& window : unpublishedWindows)
+      delete window.second;
+    while (LaneUpdate* update = publishedLanes.front())
+    {
+      delete update->compiled;
+      delete update->table;
+      publishedLanes.pop();
+    }
+    for (auto& lane : laneStorage)
+    {
+      delete lane->compiled;
+      delete lane->window;
+    }
+    delete laneTable;
+    freeRetiredLanes();
+  }
+
+  void scheduleNote(int key, int noteNumber, float velocity, 
+    double startTimeSeconds, double durationSeconds, int channel = 1) 
+  {
+    int64_t startSample = currentSamplePosition + 
+      static_cast<int64_t>(startTimeSeconds * sampleRate);
+    int64_t endSample = startSample + 
+      static_cast<int64_t>(durationSeconds * sampleRate);
+
+    std::vector<uint8_t> sysex;
+    stage(StagedEdit::add, {
+      { startSample, key, toMidiBytes(juce::MidiMessage::noteOn(channel, noteNumber, velocity), sysex), NAN },
+      { endSample, key, toMidiBytes(juce::MidiMessage::noteOff(channel, noteNumber), sysex), NAN }
+      });
+  }
+
+  void scheduleMidiMessage(int key, const juce::MidiMessage& msg, 
+    double timeSeconds) 
+  {
+    int64_t sample = currentSamplePosition + 
+      static_cast<int64_t>(timeSeconds * sampleRate);
+
+    std::vector<uint8_t> sysex;
+    MidiBytes bytes = toMidiBytes(msg, sysex);
+    stage(StagedEdit::add, { { sample, key, bytes, NAN } }, std::move(sysex));
+  }
+
+  // The batch is staged as one edit, so the compile thread sorts it once and merges it into each lane in
+  // a single pass
+  void scheduleEventsBulk(const MidiEventRecord* records, size_t count)
+  {
+    int64_t now = currentSamplePosition;
+    std::vector<StagedEvent> batch;
+    batch.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const auto& r = records[i];
+      int length = juce::MidiMessage::getMessageLengthFromFirstByte(r.status);
+      batch.push_back({
+        now + r.sampleTime,
+        r.key,
+        { { r.status, r.data1, r.data2 }, uint8_t(juce::jlimit(1, 3, length)), 0 },
+        NAN
+        });
+    }
+    stage(StagedEdit::add, std::move(batch));
+  }
+
+  // A CC (status 0xB0-0xBF), channel pressure (0xD0-0xDF) or pitch bend (0xE0-0xEF) curve through points,
+  // with times relative to now. It's kept as its breakpoints and turned into messages a block at a time, one
+  // every resolution samples where the value changes. Returns false for any other status or no points
+  bool scheduleCurve(int key, uint8_t status, uint8_t controller, int resolution, const CurvePointRecord* points, size_t count)
+  {
+    int type = status & 0xf0;
+    if (count == 0 || (type != 0xb0 && type != 0xd0 && type != 0xe0))
+      return false;
+    int64_t now = currentSamplePosition;
+    StagedEdit edit{ StagedEdit::addCurve };
+    edit.key = key;
+    edit.curvePoints.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const auto& p = points[i];
+      auto shape = p.shape < uint8_t(CurveShape::count) ? CurveShape(p.shape) : CurveShape::linear;
+      edit.curvePoints.push_back({ now + p.sampleTime, p.value, shape });
+    }
+    std::stable_sort(edit.curvePoints.begin(), edit.curvePoints.end(),
+      [](const CurvePoint& a, const CurvePoint& b) { return a.samplePosition < b.samplePosition; });
+    edit.curve.start = edit.curvePoints.front().samplePosition;
+    edit.curve.end = edit.curvePoints.back().samplePosition;
+    edit.curve.status = status;
+    edit.curve.controller = type == 0xb0 ? uint8_t(controller & 0x7f) : 0;
+    edit.curve.resolution = std::max(1, resolution);
+    stage(std::move(edit));
+    return true;
+  }
+
+  // Stores a pattern once, with times from its start (negative ones are moved to 0), to be played by
+  // instances on any lane. Defining a clip that exists replaces it everywhere it plays
+  void defineClip(uint32_t clipId, const ClipEventRecord* records, size_t count)
+  {
+    StagedEdit edit{ StagedEdit::defineClip };
+    edit.clipId = clipId;
+    edit.events.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const auto& r = records[i];
+      int length = juce::MidiMessage::getMessageLengthFromFirstByte(r.status);
+      edit.events.push_back({
+        std::max<int64_t>(0, r.sampleTime),
+        0,
+        { { r.status, r.data1, r.data2 }, uint8_t(juce::jlimit(1, 3, length)), 0 },
+        NAN
+        });
+    }
+    stage(std::move(edit));
+  }
+
+  // Plays clips on key's lane from the records' times, relative to now. An instance of a clip that isn't
+  // defined yet stays silent until it is. Memory is a few dozen bytes an instance, whatever the clip's size
+  void scheduleClipInstances(int key, const ClipInstanceRecord* records, size_t count)
+  {
+    int64_t now = currentSamplePosition;
+    StagedEdit edit{ StagedEdit::addInstances };
+    edit.key = key;
+    edit.instances.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const auto& r = records[i];
+      edit.instances.push_back({ now + r.sampleTime, now + r.sampleTime, r.clipId, r.transpose, r.velocityScale, nullptr });
+    }
+    stage(std::move(edit));
+  }
+
+  // Musical time: beats are absolute, counted from the start of the timeline, and the events stay in beats,
+  // so a new tempo map moves them without scheduling them again
+  void scheduleNoteAtBeat(int key, int noteNumber, float velocity,
+    double startBeat, double durationBeats, int channel = 1)
+  {
+    std::vector<uint8_t> sysex;
+    stage(StagedEdit::add, {
+      { 0, key, toMidiBytes(juce::MidiMessage::noteOn(channel, noteNumber, velocity), sysex), startBeat },
+      { 0, key, toMidiBytes(juce::MidiMessage::noteOff(channel, noteNumber), sysex), startBeat + durationBeats }
+      });
+  }
+
+  void scheduleMidiMessageAtBeat(int key, const juce::MidiMessage& msg, double beat)
+  {
+    std::vector<uint8_t> sysex;
+    MidiBytes bytes = toMidiBytes(msg, sysex);
+    stage(StagedEdit::add, { { 0, key, bytes, beat } }, std::move(sysex));
+  }
+
+  void scheduleCCAtBeat(int key, int controller, int value, double beat, int channel = 1)
+  {
+    scheduleMidiMessageAtBeat(key, juce::MidiMessage::controllerEvent(channel, controller, value), beat);
+  }
+
+  void scheduleEventsBulkAtBeats(const MidiBeatEventRecord* records, size_t count)
+  {
+    std::vector<StagedEvent> batch;
+    batch.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const auto& r = records[i];
+      int length = juce::MidiMessage::getMessageLengthFromFirstByte(r.status);
+      batch.push_back({ 0, r.key, { { r.status, r.data1, r.data2 }, uint8_t(juce::jlimit(1, 3, length)), 0 }, r.beat });
+    }
+    stage(StagedEdit::add, std::move(batch));
+  }
+
+  // Events in beats move to where map puts them
+  void setTempoMap(std::shared_ptr<const TempoMap> map)
+  {
+    StagedEdit edit{ StagedEdit::retime };
+    edit.tempoMap = std::move(map);
+    stage(std::move(edit));
+  }
+
+  void scheduleCC(int key, int controller, int value, 
+    double timeSeconds, int channel = 1) 
+  {
+    auto msg = juce::MidiMessage::controllerEvent(channel, controller, value);
+    scheduleMidiMessage(key, msg, timeSeconds);
+  }
+
+  void schedulePitchBend(int key, int value, double timeSeconds, int channel = 1) 
+  {
+    auto msg = juce::MidiMessage::pitchWheel(channel, value);
+    scheduleMidiMessage(key, msg, timeSeconds);
+  }
+
+  // Waits until everything scheduled so far is compiled, so an offline render starting now sees all of it
+  // Only from the thread that renders, when it isn't rendering: it picks the lanes up itself, so a render
+  // of more lanes than publishedLanes holds doesn't have to wait for them block by block
+  void sync()
+  {
+    enterRendering();
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    while (!stagedEdits.empty() || compiling)
+    {
+      lock.unlock();
+      adoptCompiledLanes();
+      lock.lock();
+      schedulerCv.wait_for(lock, std::chrono::milliseconds(1), [this] { return stagedEdits.empty() && !compiling; });
+    }
+    lock.unlock();
+    adoptCompiledLanes();
+    renderingThreads--;
+  }
+
+  // Audio thread, before the graph renders a block: picks up newly compiled lanes and transport changes
+  void beginBlock()
+  {
+    enterRendering();
+    blocksBegun++;
+    adoptCompiledLanes();
+  }
+
+  // Audio thread, after the graph has rendered the block. A block that reaches the loop's end carries on
+  // from its start, going round as many times as a loop shorter than the block takes to fill it
+  void endBlock(int numSamples)
+  {
+    int64_t blockStart = currentSamplePosition;
+    int64_t position = blockStart + numSamples;
+    if (loopEnd > loopStart && blockStart < loopEnd && position >= loopEnd)
+    {
+      jumps++;
+      jumpFrom = loopEnd;
+      while (position >= loopEnd)
+        position -= loopEnd - loopStart;
+    }
+    currentSamplePosition = position;
+    renderingThreads--;
+  }
+
+  // Catches a second thread rendering, such as an offline render while an audio device's callback runs
+  void enterRendering()
+  {
+    int others = renderingThreads++;
+    jassert(others == 0);
+    juce::ignoreUnused(others);
+  }
+
+  // Audio thread, from key's MidiSourceNode: the lane's events in the block being rendered
+  void getEventsForPlugin(int key, juce::MidiBuffer& buffer, int numSamples) 
+  {
+    buffer.clear();
+    if (!laneTable)
+      return;
+    auto it = laneTable->find(key);
+    if (it == laneTable->end())
+      return;
+    Lane& lane = *it->second;
+    int64_t blockStart = currentSamplePosition;
+    int64_t blockEnd = blockStart + numSamples;
+
+    if (lane.jumpsSeen != jumps)
+    {
+      forEachSource(lane, [&](const CompiledLane& source, size_t& bucket) {
+        bucket = firstBucketAt(source, blockStart);
+        chase(source, jumpFrom, blockStart, buffer, 0);
+      });
+      lane.jumpsSeen = jumps;
+    }
+
+    for (size_t i = 0; i < lane.lateEvents; ++i)
+      lane.compiled->added.addToBuffer(i, buffer, 0);
+    lane.lateEvents = 0;
+
+    if (loopEnd > loopStart && blockStart < loopEnd && blockEnd > loopEnd)
+    {
+      // The loop wraps inside this block, as many times as it takes to fill it; endBlock counts one jump
+      int64_t loopLength = loopEnd - loopStart;
+      forEachSource(lane, [&](const CompiledLane& source, size_t& bucket) {
+        addEventsInRange(source, bucket, blockStart, loopEnd, buffer, 0);
+        int64_t filled = loopEnd - blockStart;
+        while (filled < numSamples)
+        {
+          chase(source, loopEnd, loopStart, buffer, static_cast<int>(filled));
+          bucket = firstBucketAt(source, loopStart);
+          int64_t length = std::min(loopLength, numSamples - filled);
+          addEventsInRange(source, bucket, loopStart, loopStart + length, buffer, static_cast<int>(filled));
+          filled += length;
+        }
+      });
+      // A block that ends right on the loop's end leaves the wrap back to its start for the next block to chase
+      bool endsOnLoopEnd = (blockEnd - loopEnd) % loopLength == 0;
+      lane.jumpsSeen = endsOnLoopEnd ? jumps : jumps + 1;
+      return;
+    }
+    forEachSource(lane, [&](const CompiledLane& source, size_t& bucket) {
+      addEventsInRange(source, bucket, blockStart, blockEnd, buffer, 0);
+    });
+  }
+
+  void clearSchedule()
+  {
+    stage(StagedEdit::clearAll);
+  }
+
+  // Edits events scheduled with IDs, so a client can change part of a song without sending all of it
+  // again: deletes, then moves (to a new start; a note keeps its length), then inserts, where an ID that's
+  // already scheduled replaces that event. The compile thread finds each by ID in O(log n). Unknown IDs
+  // are ignored
+  void editEvents(const IdRecord* deletes, size_t numDeletes, const EventMoveRecord* moves, size_t numMoves,
+    const IdentifiedEventRecord* events, size_t numEvents)
+  {
+    StagedEdit edit{ StagedEdit::edit };
+    for (size_t i = 0; i < numDeletes; ++i)
+      edit.deletes.push_back(deletes[i].id);
+    edit.moves.assign(moves, moves + numMoves);
+    edit.identified.assign(events, events + numEvents);
+    stage(std::move(edit));
+  }
+
+  // Replaces key's identified events that start in [start, end) with events, e.g. to rewrite one bar
+  void replaceEventRange(int key, int64_t start, int64_t end, const IdentifiedEventRecord* events, size_t numEvents)
+  {
+    StagedEdit edit{ StagedEdit::replaceRange };
+    edit.key = key;
+    edit.rangeStart = start;
+    edit.rangeEnd = end;
+    edit.identified.assign(events, events + numEvents);
+    stage(std::move(edit));
+  }
+
+  // Remove only CC events, keep notes and other MIDI messages
+  void clearCCSchedule()
+  {
+    stage(StagedEdit::clearCCs);
+  }
+
+  // Removes key's events (every key's, for key -1) of categories, a mask of 1 << EventCategory, that start
+  // in [start, end) of the timeline. A note goes with its note off, and one sounding now is cut off. The
+  // compile thread finds the range by binary search, and lanes with nothing to clear aren't rebuilt;
+  // playback carries on from where it is
+  void clearEvents(int key, uint32_t categories, int64_t start, int64_t end)
+  {
+    StagedEdit edit{ StagedEdit::clearRange };
+    edit.key = key;
+    edit.categories = categories;
+    edit.rangeStart = start;
+    edit.rangeEnd = end;
+    stage(std::move(edit));
+  }
+
+  // Moves playback to sample. Each lane's cursor is found by binary search when it's next read, and the lane
+  // chases: notes sounding where playback was get note offs, and the notes, controllers, program changes,
+  // pressure and pitch bends in effect at sample are sent again, at the start of that block
+  void seek(int64_t sample)
+  {
+    StagedEdit edit{ StagedEdit::transport };
+    edit.transportChange.seekTo = std::max<int64_t>(0, sample);
+    stage(std::move(edit));
+  }
+
+  // Playback reaching end carries on from start, sample-accurately, chasing as a seek does. end <= start
+  // stops looping
+  void setLoop(int64_t start, int64_t end)
+  {
+    StagedEdit edit{ StagedEdit::transport };
+    edit.transportChange.setsLoop = true;
+    edit.transportChange.loopStart = start;
+    edit.transportChange.loopEnd = end;
+    stage(std::move(edit));
+  }
+
+  // Streams file's events (absolute sample times) into the lanes of their keys, alongside what's scheduled.
+  // The compile thread copies a window of them around the playhead out of the mapping, and slides it
+  // along, so only the window is ever in memory. Null stops streaming
+  void streamEventFile(std::shared_ptr<const MappedEventFile> file)
+  {
+    StagedEdit edit{ StagedEdit::stream };
+    edit.eventFile = std::move(file);
+    stage(std::move(edit));
+  }
+
+  // Offline rendering, before each block: an audio device's pace leaves the compile thread time to slide
+  // the streamed window along, a render as fast as it can go has to wait for it. Only from the thread
+  // that renders
+  void waitForStream()
+  {
+    {
+      std::lock_guard<std::mutex> lock(windowMutex);
+      int64_t position = currentSamplePosition;
+      if (windowReadyUntil == 0
+        || (position >= windowReadyFrom && position + int64_t(streamAheadSeconds * sampleRate) / 2 <= windowReadyUntil))
+        return;
+    }
+    stage(StagedEdit::slide);
+    sync();
+  }
+
+  // Back to the start of the timeline
+  void reset() 
+  {
+    seek(0);
+  }
+
+  void setSampleRate(double sr) 
+  {
+    sampleRate = sr;
+    StagedEdit edit{ StagedEdit::retime };
+    edit.sampleRate = sr;
+    stage(std::move(edit));
+  }
+
+  // Never locks, so the recorder can stamp a parameter move with it on the audio thread
+  double getSampleRate() const
+  {
+    return sampleRate;
+  }
+
+  // Lanes are bucketed by the graph's block size, so a block usually reads exactly one bucket
+  void setBlockSize(int samplesPerBlock)
+  {
+    samplesPerBucket = std::max(1, samplesPerBlock);
+  }
+
+  int64_t getCurrentPosition() const 
+  { 
+    return currentSamplePosition; 
+  }
+};
+
+class MidiSourceNode : public juce::AudioProcessor
+{
+private:
+  MidiScheduler* scheduler;
+  int targetkey;
+
+public:
+  MidiSourceNode(MidiScheduler* s, int key)
+    : AudioProcessor(BusesProperties()  // No audio buses needed
+      .withInput("Input", juce::AudioChannelSet::stereo(), false)
+      .withOutput("Output", juce::AudioChannelSet::stereo(), false)),
+    scheduler(s), 
+    targetkey(key) {}
+
+  // Main processing - just outputs MIDI for this plugin
+  void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+  {
+    midiMessages.clear();
+    scheduler->getEventsForPlugin(targetkey, midiMessages, buffer.getNumSamples());
+  }
+
+  // Required AudioProcessor methods
+  const juce::String getName() const override { return "MIDI Source " + juce::String(targetkey); }
+  void prepareToPlay(double sampleRate, int samplesPerBlock) override {}
+  void releaseResources() override {}
+
+  bool acceptsMidi() const override { return false; }  // Doesn't accept external MIDI
+  bool producesMidi() const override { return true; }   // Produces MIDI
+  bool isMidiEffect() const override { return true; }
+
+  double getTailLengthSeconds() const override { return 0; }
+
+  int getNumPrograms() override { return 1; }
+  int getCurrentProgram() override { return 0; }
+  void setCurrentProgram(int index) override {}
+  const juce::String getProgramName(int index) override { return {}; }
+  void changeProgramName(int index, const juce::String& newName) override {}
+
+  void getStateInformation(juce::MemoryBlock& destData) override {}
+  void setStateInformation(const void* data, int sizeInBytes) override {}
+
+  juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+  bool hasEditor() const override { return false; }
+};
+
+// Audio file player node - plays back audio files through the graph
+class AudioFilePlayerNode : public juce::AudioProcessor
+{
+private:
+  juce::AudioBuffer<float> audioBuffer;
+  int64_t playbackPosition = 0;
+  int64_t startSamplePosition = 0;
+  bool isScheduled = false;
+  bool isPlaying = false;
+  std::string loadedFilename;
+
+public:
+  AudioFilePlayerNode()
+    : AudioProcessor(BusesProperties()
+      .withOutput("Output", juce::AudioChannelSet::stereo(), true))
+  {
+  }
+
+  // Load an audio file
+  bool loadAudioFile(const std::string& filename)
+  {
+    juce::File audioFile = juce::File::getCurrentWorkingDirectory().getChildFile(filename);
+
+    if (!audioFile.existsAsFile())
+    {
+      std::cout << "ERROR: Audio file does not exist: " << filename << std::endl;
+      return false;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+
+    if (reader == nullptr)
+    {
+      std::cout << "ERROR: Failed to create reader for: " << filename << std::endl;
+      return false;
+    }
+
+    // Load the audio into our buffer
+    audioBuffer.setSize(reader->numChannels, (int)reader->lengthInSamples);
+    reader->read(&audioBuffer, 0, (int)reader->lengthInSamples, 0, true, true);
+
+    loadedFilename = filename;
+    playbackPosition = 0;
+    isPlaying = false;
+
+    std::cout << "Audio file loaded into player node: " << filename
+              << ", channels=" << reader->numChannels
+              << ", samples=" << reader->lengthInSamples << std::endl;
+
+    return true;
+  }
+
+  // Schedule playback to start at a specific sample position
+  void schedulePlayback(int64_t startSample, int64_t fileStartPosition = 0)
+  {
+    startSamplePosition = startSample;
+    playbackPosition = juce::jmin(fileStartPosition, (int64_t)audioBuffer.getNumSamples());
+    isScheduled = true;
+    isPlaying = false;
+    std::cout << "Playback scheduled for sample " << startSample
+              << ", starting at file position " << playbackPosition << std::endl;
+  }
+
+  // Start playing immediately
+  void startPlayback(int64_t fileStartPosition = 0)
+  {
+    playbackPosition = juce::jmin(fileStartPosition, (int64_t)audioBuffer.getNumSamples());
+    isPlaying = true;
+    isScheduled = false;
+    std::cout << "Playback started immediately at file position " << playbackPosition << std::endl;
+  }
+
+  // Stop playback
+  void stopPlayback()
   {
     isPlaying = false;
     isScheduled = false;
@@ -414,50 +2632,1722 @@ public:
     std::cout << "Playback stopped" << std::endl;
   }
 
-  bool isCurrentlyPlaying() const { return isPlaying; }
-  std::string getLoadedFilename() const { return loadedFilename; }
+  bool isCurrentlyPlaying() const { return isPlaying; }
+  std::string getLoadedFilename() const { return loadedFilename; }
+
+  void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+  {
+    buffer.clear();
+
+    // Check if scheduled playback should start
+    if (isScheduled && !isPlaying && currentSamplePosition >= startSamplePosition)
+    {
+      isPlaying = true;
+      isScheduled = false;
+      std::cout << "Started scheduled playback at sample " << currentSamplePosition << std::endl;
+    }
+
+    if (!isPlaying || audioBuffer.getNumSamples() == 0)
+      return;
+
+    int numSamples = buffer.getNumSamples();
+    int samplesToPlay = juce::jmin(numSamples,
+      (int)(audioBuffer.getNumSamples() - playbackPosition));
+
+    if (samplesToPlay > 0)
+    {
+      // Copy audio to output
+      for (int ch = 0; ch < buffer.getNumChannels() && ch < audioBuffer.getNumChannels(); ++ch)
+      {
+        buffer.copyFrom(ch, 0, audioBuffer, ch, (int)playbackPosition, samplesToPlay);
+      }
+
+      playbackPosition += samplesToPlay;
+    }
+
+    // Check if finished
+    if (playbackPosition >= audioBuffer.getNumSamples())
+    {
+      std::cout << "Playback finished" << std::endl;
+      isPlaying = false;
+      playbackPosition = 0;
+    }
+  }
+
+  const juce::String getName() const override { return "Audio File Player"; }
+  void prepareToPlay(double sampleRate, int samplesPerBlock) override {}
+  void releaseResources() override {}
+
+  bool acceptsMidi() const override { return false; }
+  bool producesMidi() const override { return false; }
+
+  double getTailLengthSeconds() const override { return 0; }
+
+  int getNumPrograms() override { return 1; }
+  int getCurrentProgram() override { return 0; }
+  void setCurrentProgram(int index) override {}
+  const juce::String getProgramName(int index) override { return {}; }
+  void changeProgramName(int index, const juce::String& newName) override {}
+
+  void getStateInformation(juce::MemoryBlock& destData) override {}
+  void setStateInformation(const void* data, int sizeInBytes) override {}
+
+  juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+  bool hasEditor() const override { return false; }
+};
+
+// Forward declaration
+class CompletePluginHost;
+
+// Audio callback wrapper for recording
+class RecordingAudioCallback : public juce::AudioIODeviceCallback
+{
+private:
+  juce::AudioIODeviceCallback* wrappedCallback;  // The actual callback (graphPlayer)
+  CompletePluginHost* host;
+
+public:
+  RecordingAudioCallback(juce::AudioIODeviceCallback* callback, CompletePluginHost* h)
+    : wrappedCallback(callback), host(h) {}
+
+  void audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
+                                        int numInputChannels,
+                                        float* const* outputChannelData,
+                                        int numOutputChannels,
+                                        int numSamples,
+                                        const juce::AudioIODeviceCallbackContext& context) override;
+
+  void audioDeviceAboutToStart(juce::AudioIODevice* device) override
+  {
+    if (wrappedCallback)
+      wrappedCallback->audioDeviceAboutToStart(device);
+  }
+
+  void audioDeviceStopped() override
+  {
+    if (wrappedCallback)
+      wrappedCallback->audioDeviceStopped();
+  }
+};
+
+// A sorted sequence kept as a run of shared, immutable chunks. Copying one copies only the chunk pointers, and
+// an insert or erase copies only the chunk it falls in, so a long schedule can be handed to another thread
+// again and again without copying what's in it. Positions are only good until the next edit
+template<typename T>
+class ChunkedSequence
+{
+public:
+  struct Position
+  {
+    size_t chunk = 0;
+    size_t index = 0;
+  };
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const T& front() const { return chunks.front()->front(); }
+  const T& back() const { return chunks.back()->back(); }
+
+  Position begin() const { return {}; }
+  bool atBegin(Position p) const { return p.chunk == 0 && p.index == 0; }
+  bool atEnd(Position p) const { return p.chunk >= chunks.size(); }
+  const T& at(Position p) const { return (*chunks[p.chunk])[p.index]; }
+  // The one before p, which mustn't be at the beginning
+  const T& before(Position p) const { return p.index > 0 ? (*chunks[p.chunk])[p.index - 1] : chunks[p.chunk - 1]->back(); }
+
+  Position next(Position p) const
+  {
+    if (++p.index == chunks[p.chunk]->size())
+      p = { p.chunk + 1, 0 };
+    return p;
+  }
+
+  // The first element pred is false for, where it's true for every one before it and false for every one after
+  template<typename Pred>
+  Position partitionPoint(Pred pred) const
+  {
+    auto chunk = partition_point(chunks.begin(), chunks.end(), [&](const ChunkPointer& c) { return pred(c->back()); });
+    if (chunk == chunks.end())
+      return { chunks.size(), 0 };
+    return { size_t(chunk - chunks.begin()), size_t(partition_point((*chunk)->begin(), (*chunk)->end(), pred) - (*chunk)->begin()) };
+  }
+
+  void insert(Position p, const T& value)
+  {
+    if (chunks.empty())
+    {
+      chunks.push_back(make_shared<const vector<T>>(1, value));
+      count = 1;
+      return;
+    }
+    if (atEnd(p))
+      p = { chunks.size() - 1, chunks.back()->size() };
+    auto chunk = make_shared<vector<T>>(*chunks[p.chunk]);
+    chunk->insert(chunk->begin() + p.index, value);
+    count++;
+    if (chunk->size() <= 2 * chunkSize)
+    {
+      chunks[p.chunk] = move(chunk);
+      return;
+    }
+    auto second = make_shared<const vector<T>>(chunk->begin() + chunkSize, chunk->end());
+    chunk->erase(chunk->begin() + chunkSize, chunk->end());
+    chunks[p.chunk] = move(chunk);
+    chunks.insert(chunks.begin() + p.chunk + 1, move(second));
+  }
+
+  void erase(Position p)
+  {
+    count--;
+    if (chunks[p.chunk]->size() == 1)
+    {
+      chunks.erase(chunks.begin() + p.chunk);
+      return;
+    }
+    auto chunk = make_shared<vector<T>>(*chunks[p.chunk]);
+    chunk->erase(chunk->begin() + p.index);
+    chunks[p.chunk] = move(chunk);
+  }
+
+  // Replaces everything with values, already in order
+  void assign(const vector<T>& values)
+  {
+    chunks.clear();
+    for (size_t start = 0; start < values.size(); start += chunkSize)
+      chunks.push_back(make_shared<const vector<T>>(values.begin() + start, values.begin() + min(values.size(), start + chunkSize)));
+    count = values.size();
+  }
+
+  vector<T> values() const
+  {
+    vector<T> all;
+    all.reserve(count);
+    for (const auto& chunk : chunks)
+      all.insert(all.end(), chunk->begin(), chunk->end());
+    return all;
+  }
+
+  void clear()
+  {
+    chunks.clear();
+    count = 0;
+  }
+
+private:
+  using ChunkPointer = shared_ptr<const vector<T>>;
+  static constexpr size_t chunkSize = 128;  // What assign fills a chunk with; an insert splits one past twice this
+  vector<ChunkPointer> chunks;             // None empty
+  size_t count = 0;
+};
+
+struct ScheduledParameterChange 
+{
+  int key;
+  int parameterIndex;
+  float value;
+  int64_t sample;  // When to make it, from the start of playback; the render splits the block there
+  double beat = NAN;  // Scheduled in beats: sample is worked out again whenever the tempo map changes
+  bool identified = false;  // Scheduled with an ID, so it can be edited
+  uint64_t id = 0;
+};
+
+// Parameter changes and automation scheduled by the commands, played by the audio thread. Command threads
+// edit the schedule under editMutex; a publish thread copies it into an immutable ParameterSchedule and hands
+// that to the audio thread through an SpscRing, the way MidiScheduler hands over its compiled lanes. The
+// audio thread hands back the schedule it replaced, which the publish thread frees, so it never locks,
+// allocates or frees. The changes, each parameter's track and each lane's points are ChunkedSequences, so a
+// schedule costs pointers to build and an edit copies only the chunks it touches
+//
+// Playback is kept in samples, seeking and looping on the sample as MidiScheduler does, so parameters stay
+// in step with the notes however the blocks fall. Changes scheduled in blocks are at the block's first sample
+class BlockLevelScheduler 
+{
+private:
+  // A change in a parameter's track, to chase a seek or loop with
+  struct TrackPoint
+  {
+    int64_t sample;
+    float value;
+  };
+
+  // A breakpoint in an automation lane; shape is for the segment to the next one
+  struct AutomationPoint
+  {
+    int64_t sample;
+    float value;
+    CurveShape shape;
+  };
+  // A parameter's envelope, worked out as the render goes instead of scheduled as a change a block. It sets
+  // the parameter from its first point on and holds its last point's value after the end
+  struct AutomationLane
+  {
+    ChunkedSequence<AutomationPoint> points;  // In sample order
+    int resolution = 0;                       // Samples between values along a ramp; 0 sets one value a block
+    uint64_t version = 0;                     // A new one every edit, so the audio thread knows a lane it has set from
+  };
+
+  // What the audio thread plays. Only laneValues changes once it's published, and only the audio thread
+  // changes it
+  struct ScheduledLane
+  {
+    pair<int, int> parameter;
+    AutomationLane lane;
+  };
+  struct ParameterSchedule
+  {
+    ChunkedSequence<ScheduledParameterChange> changes;        // In time order
+    map<pair<int, int>, ChunkedSequence<TrackPoint>> tracks;  // (key, parameter) -> its changes in time order
+    vector<ScheduledLane> lanes;                     // In parameter order
+    vector<float> laneValues;                        // What each lane last set, so a held value isn't set again every block
+    int64_t loopStart = 0;
+    int64_t loopEnd = 0;                             // Not looping unless after loopStart
+    bool cleared = false;                            // Changes scheduled after a clear go out even if they're late
+    bool retimed = false;                            // Changes a retime put before the current block count as done
+  };
+
+  CompletePluginHost* host = nullptr;
+
+  // Command threads -> publish thread, under editMutex. There are several command threads and none of them
+  // is the audio thread
+  mutex editMutex;
+  condition_variable editCv;
+  ChunkedSequence<ScheduledParameterChange> scheduledChanges;
+  map<pair<int, int>, ChunkedSequence<TrackPoint>> parameterTracks;
+  map<pair<int, int>, AutomationLane> automationLanes;
+  // Changes scheduled with IDs by ID, and as (key, sample, ID) to find a plugin's in a range
+  map<uint64_t, ScheduledParameterChange> identifiedChanges;
+  set<tuple<int, int64_t, uint64_t>> identifiedChangesBySample;
+  uint64_t laneEdits = 0;
+  int64_t loopStart = 0;
+  int64_t loopEnd = 0;
+  bool cleared = false;
+  bool retimed = false;
+  bool edited = false;
+  bool publishing = false;  // Also true while a schedule is waiting for room in publishedSchedules
+  bool stopping = false;
+
+  // Publish thread -> audio thread and back. One waiting at a time: a newer schedule replaces an unpublished
+  // one rather than queueing behind it
+  SpscRing<ParameterSchedule*, 2> publishedSchedules;
+  SpscRing<ParameterSchedule*, 8> retiredSchedules;
+  thread publishThread;
+
+  // Audio thread only
+  ParameterSchedule* schedule = new ParameterSchedule();
+  ChunkedSequence<ScheduledParameterChange>::Position nextChange;
+  int64_t doneBefore = 0;  // Changes scheduled before this count as done; seeks chase them
+  int64_t origin = 0;      // Where playback is at the start of the block, less the loop lengths wrapped in it
+  int blockOffset = 0;     // How far into the current block processChangesUpTo has got
+
+  atomic<int64_t> blockStart{ 0 };  // Where playback was at the start of the block being rendered
+  atomic<int64_t> seekSample{ -1 };  // Taken by the audio thread at the next block
+
+
+  // Command threads: makes an edit under editMutex and wakes the publish thread to hand it on
+  template<typename Edit>
+  void edit(Edit&& apply)
+  {
+    {
+      lock_guard<mutex> lock(editMutex);
+      apply();
+      edited = true;
+    }
+    editCv.notify_all();
+  }
+
+  // The first of sequence's elements after sample, or at it if not after
+  template<typename T>
+  static typename ChunkedSequence<T>::Position firstAfter(const ChunkedSequence<T>& sequence, int64_t sample)
+  {
+    return sequence.partitionPoint([sample](const T& element) { return element.sample <= sample; });
+  }
+  template<typename T>
+  static typename ChunkedSequence<T>::Position firstAt(const ChunkedSequence<T>& sequence, int64_t sample)
+  {
+    return sequence.partitionPoint([sample](const T& element) { return element.sample < sample; });
+  }
+
+  void addToTrack(const ScheduledParameterChange& change)
+  {
+    auto& track = parameterTracks[{ change.key, change.parameterIndex }];
+    track.insert(firstAfter(track, change.sample), { change.sample, change.value });
+  }
+
+  // Whether nothing comes after the change at nextChange in its parameter's track before the current block,
+  // so catching up with blocks gone by can skip the changes it overrides
+  bool lastBeforeCurrentBlock() const
+  {
+    const auto& changes = schedule->changes;
+    const ScheduledParameterChange& change = changes.at(nextChange);
+    for (auto p = changes.next(nextChange); !changes.atEnd(p) && changes.at(p).sample == change.sample; p = changes.next(p))
+      if (changes.at(p).key == change.key && changes.at(p).parameterIndex == change.parameterIndex)
+        return false;
+    auto track = schedule->tracks.find({ change.key, change.parameterIndex });
+    if (track == schedule->tracks.end())
+      return true;
+    auto next = firstAfter(track->second, change.sample);
+    return track->second.atEnd(next) || track->second.at(next).sample >= origin;
+  }
+
+  // Inserts change in time order, copying only the chunks it lands in. One the audio thread has already
+  // gone past counts as done, though seeks chase it
+  void insertInOrder(const ScheduledParameterChange& change)
+  {
+    scheduledChanges.insert(firstAfter(scheduledChanges, change.sample), change);
+    addToTrack(change);
+  }
+
+  void insertChange(const ScheduledParameterChange& change)
+  {
+    insertInOrder(change);
+    identifiedChanges[change.id] = change;
+    identifiedChangesBySample.insert({ change.key, change.sample, change.id });
+  }
+
+  // Finds the change by binary search on its sample
+  void removeIdentified(uint64_t id)
+  {
+    auto it = identifiedChanges.find(id);
+    if (it == identifiedChanges.end())
+      return;
+    const ScheduledParameterChange& change = it->second;
+    for (auto p = firstAt(scheduledChanges, change.sample);
+      !scheduledChanges.atEnd(p) && scheduledChanges.at(p).sample == change.sample; p = scheduledChanges.next(p))
+      if (scheduledChanges.at(p).identified && scheduledChanges.at(p).id == id)
+      {
+        scheduledChanges.erase(p);
+        break;
+      }
+    auto track = parameterTracks.find({ change.key, change.parameterIndex });
+    if (track != parameterTracks.end())
+    {
+      auto& points = track->second;
+      for (auto p = firstAt(points, change.sample); !points.atEnd(p) && points.at(p).sample == change.sample; p = points.next(p))
+        if (points.at(p).value == change.value)
+        {
+          points.erase(p);
+          break;
+        }
+      if (points.empty())
+        parameterTracks.erase(track);
+    }
+    identifiedChangesBySample.erase({ change.key, change.sample, id });
+    identifiedChanges.erase(it);
+  }
+
+  void insertIdentified(const IdentifiedParamChangeRecord& r)
+  {
+    removeIdentified(r.id);
+    ScheduledParameterChange change;
+    change.key = r.key;
+    change.parameterIndex = r.parameterIndex;
+    change.value = r.value;
+    change.sample = int64_t(r.atBlock) * blockSize;
+    change.identified = true;
+    change.id = r.id;
+    insertChange(change);
+  }
+
+  void publishLoop()
+  {
+    ParameterSchedule* unpublished = nullptr;  // Built, waiting for room in publishedSchedules
+    while (true)
+    {
+      {
+        unique_lock<mutex> lock(editMutex);
+        publishing = unpublished != nullptr;
+        editCv.notify_all();  // For sync()
+        if (publishing)  // The audio thread hasn't made room yet; try again shortly
+          editCv.wait_for(lock, chrono::milliseconds(1), [this] { return stopping || edited; });
+        else
+          editCv.wait(lock, [this] { return stopping || edited; });
+        if (stopping)
+          break;
+        ParameterSchedule* built = nullptr;
+        if (edited)
+        {
+          built = takeSchedule();
+          edited = false;
+        }
+        publishing = true;
+        lock.unlock();
+        if (built)
+        {
+          finishSchedule(*built);
+          if (unpublished)
+          {
+            built->cleared |= unpublished->cleared;
+            built->retimed |= unpublished->retimed;
+            delete unpublished;
+          }
+          unpublished = built;
+        }
+      }
+      freeRetiredSchedules();
+      if (unpublished && publishedSchedules.push(unpublished))
+        unpublished = nullptr;
+    }
+    delete unpublished;
+  }
+
+  // Publish thread, under editMutex: takes what the commands have scheduled, copying only chunk pointers, so
+  // command threads aren't held up
+  ParameterSchedule* takeSchedule()
+  {
+    auto* built = new ParameterSchedule();
+    built->changes = scheduledChanges;
+    built->tracks = parameterTracks;
+    built->lanes.reserve(automationLanes.size());
+    for (const auto& [parameter, lane] : automationLanes)
+      built->lanes.push_back({ parameter, lane });
+    built->loopStart = loopStart;
+    built->loopEnd = loopEnd;
+    built->cleared = cleared;
+    built->retimed = retimed;
+    cleared = retimed = false;
+    return built;
+  }
+
+  // Publish thread, after takeSchedule: what the audio thread works out as it plays starts out unset
+  static void finishSchedule(ParameterSchedule& built)
+  {
+    built.laneValues.assign(built.lanes.size(), NAN);
+  }
+
+  void freeRetiredSchedules()
+  {
+    while (ParameterSchedule** retired = retiredSchedules.front())
+    {
+      delete *retired;
+      retiredSchedules.pop();
+    }
+  }
+
+  // Audio thread: takes up the latest schedule, carrying on from where the render has got in it. A lane the
+  // commands haven't touched since keeps the value it last set
+  void adoptSchedule()
+  {
+    while (ParameterSchedule** published = publishedSchedules.front())
+    {
+      if (retiredSchedules.full())
+        return;
+      ParameterSchedule* next = *published;
+      for (size_t i = 0, j = 0; i < next->lanes.size(); ++i)
+      {
+        while (j < schedule->lanes.size() && schedule->lanes[j].parameter < next->lanes[i].parameter)
+          j++;
+        if (j < schedule->lanes.size() && schedule->lanes[j].parameter == next->lanes[i].parameter
+          && schedule->lanes[j].lane.version == next->lanes[i].lane.version)
+          next->laneValues[i] = schedule->laneValues[j];
+      }
+      if (next->cleared)
+        doneBefore = 0;
+      if (next->retimed)
+        doneBefore = max(doneBefore, origin);
+      nextChange = firstAt(next->changes, doneBefore);
+      retiredSchedules.push(schedule);
+      schedule = next;
+      publishedSchedules.pop();
+    }
+  }
+
+  // Audio thread: the change at nextChange has been made, or skipped as overridden
+  void changeDone()
+  {
+    doneBefore = schedule->changes.at(nextChange).sample + 1;
+    nextChange = schedule->changes.next(nextChange);
+  }
+
+  // Audio thread: goes round the loop as many times as getting offset into the block takes, chasing its start
+  // each time. Playback already past the loop's end carries on
+  void wrapLoop(int offset)
+  {
+    int64_t start = schedule->loopStart;
+    int64_t end = schedule->loopEnd;
+    if (end <= start || origin + blockOffset >= end)
+      return;
+    while (origin + offset >= end)
+    {
+      origin -= end - start;
+      jumpTo(start);
+    }
+  }
+
+  // Audio thread: carries on from sample, with every parameter set to its last scheduled value before it
+  void jumpTo(int64_t sample);
+
+  // Audio thread: sets each automated parameter to its lane's value at position, where that's changed
+  void applyAutomation(int64_t position);
+
+  static float automationValueAt(const ChunkedSequence<AutomationPoint>& points, int64_t position)
+  {
+    auto next = firstAfter(points, position);
+    if (points.atBegin(next))
+      return points.front().value;
+    if (points.atEnd(next))
+      return points.back().value;
+    const AutomationPoint& previous = points.before(next);
+    const AutomationPoint& following = points.at(next);
+    double t = double(position - previous.sample) / double(following.sample - previous.sample);
+    return float(previous.value + (following.value - previous.value) * curveFraction(previous.shape, t));
+  }
+
+public:
+  BlockLevelScheduler()
+  {
+    publishThread = thread([this] { publishLoop(); });
+  }
+
+  ~BlockLevelScheduler()
+  {
+    {
+      lock_guard<mutex> lock(editMutex);
+      stopping = true;
+    }
+    editCv.notify_all();
+    publishThread.join();
+
+    // Every schedule is now in exactly one place: in publishedSchedules, in use, or retired
+    while (ParameterSchedule** published = publishedSchedules.front())
+    {
+      delete *published;
+      publishedSchedules.pop();
+    }
+    delete schedule;
+    freeRetiredSchedules();
+  }
+
+  void setHost(CompletePluginHost* h) { host = h; }
+  void setBlockSize(int size) { blockSize = size; }
+  // Python calls this to schedule changes
+  void scheduleParameterChange(int key, int paramIndex, float value, uint64_t atBlock) 
+  {
+    scheduleParameterChangeAtSample(key, paramIndex, value, atBlock * uint64_t(blockSize));
+  }
+
+  // To the sample: the render splits the block the change falls in, so it lines up with scheduled MIDI
+  void scheduleParameterChangeAtSample(int key, int paramIndex, float value, uint64_t sample)
+  {
+    ScheduledParameterChange change;
+    change.key = key;
+    change.parameterIndex = paramIndex;
+    change.value = value;
+    change.sample = int64_t(sample);
+
+    edit([&] { insertInOrder(change); });
+  }
+
+  void scheduleParameterChangeAtBeat(int key, int paramIndex, float value, double beat, const TempoMap& tempoMap, double rate)
+  {
+    ScheduledParameterChange change;
+    change.key = key;
+    change.parameterIndex = paramIndex;
+    change.value = value;
+    change.beat = beat;
+    placeAtBeat(change, tempoMap, rate);
+
+    edit([&] { insertInOrder(change); });
+  }
+
+  // Replaces the parameter's automation lane with points, in samples from the start of playback; no points
+  // removes it. resolution is the samples between values along a ramp, 0 for one value a block
+  void setAutomationLane(int key, int paramIndex, int resolution, const AutomationPointRecord* points, size_t numPoints)
+  {
+    vector<AutomationPoint> sorted;
+    sorted.reserve(numPoints);
+    for (size_t i = 0; i < numPoints; ++i)
+      sorted.push_back({ points[i].sampleTime, points[i].value, CurveShape(points[i].shape) });
+    stable_sort(sorted.begin(), sorted.end(),
+      [](const AutomationPoint& a, const AutomationPoint& b) { return a.sample < b.sample; });
+    ChunkedSequence<AutomationPoint> lanePoints;
+    lanePoints.assign(sorted);
+    edit([&]
+    {
+      if (numPoints == 0)
+      {
+        automationLanes.erase({ key, paramIndex });
+        return;
+      }
+      AutomationLane& lane = automationLanes[{ key, paramIndex }];
+      lane.points = move(lanePoints);
+      lane.resolution = max(0, resolution);
+      lane.version = ++laneEdits;
+    });
+  }
+
+  // Adds points to the parameter's lane, each found its place by binary search and copying only the chunk
+  // it lands in; a new lane sets one value a block
+  void addAutomationPoints(int key, int paramIndex, const AutomationPointRecord* points, size_t numPoints)
+  {
+    if (numPoints == 0)
+      return;
+    edit([&]
+    {
+      AutomationLane& lane = automationLanes[{ key, paramIndex }];
+      for (size_t i = 0; i < numPoints; ++i)
+        lane.points.insert(firstAfter(lane.points, points[i].sampleTime),
+          { points[i].sampleTime, points[i].value, CurveShape(points[i].shape) });
+      lane.version = ++laneEdits;
+    });
+  }
+
+  // Moves the changes scheduled in beats to where tempoMap puts them. Changes now before the current
+  // block count as done
+  void retime(const TempoMap& tempoMap, double rate)
+  {
+    edit([&]
+    {
+      vector<ScheduledParameterChange> changes = scheduledChanges.values();
+      for (auto& change : changes)
+        if (!isnan(change.beat))
+          placeAtBeat(change, tempoMap, rate);
+      stable_sort(changes.begin(), changes.end(),
+        [](const ScheduledParameterChange& a, const ScheduledParameterChange& b) { return a.sample < b.sample; });
+      scheduledChanges.assign(changes);
+      map<pair<int, int>, vector<TrackPoint>> tracks;
+      for (const auto& change : changes)
+        tracks[{ change.key, change.parameterIndex }].push_back({ change.sample, change.value });
+      parameterTracks.clear();
+      for (const auto& [parameter, points] : tracks)
+        parameterTracks[parameter].assign(points);
+      retimed = true;
+    });
+  }
+
+  // Waits until every edit so far is published and takes it up, so an offline render starting now sees all
+  // of it. Only from the thread that renders, when it isn't rendering
+  void sync()
+  {
+    unique_lock<mutex> lock(editMutex);
+    while (edited || publishing)
+    {
+      lock.unlock();
+      adoptSchedule();
+      lock.lock();
+      editCv.wait_for(lock, chrono::milliseconds(1), [this] { return !edited && !publishing; });
+    }
+    lock.unlock();
+    adoptSchedule();
+  }
+
+  // Called at the START of each audio block, before processing
+  void processScheduledChanges() ;
+  // The render's sub-blocks: the sample in the current block of the next change still to make in it, of
+  // the next value an automation lane ramping at its own resolution needs, or of the loop's end (numSamples
+  // if none), and the changes due by offset
+  int nextChangeOffset(int numSamples) const
+  {
+    int64_t position = origin + blockOffset;
+    int64_t next = numSamples;
+    if (!schedule->changes.atEnd(nextChange))
+      next = min(next, schedule->changes.at(nextChange).sample - origin);
+    if (schedule->loopEnd > schedule->loopStart && position < schedule->loopEnd)
+      next = min(next, schedule->loopEnd - origin);
+
+    for (const auto& [parameter, lane] : schedule->lanes)
+    {
+      const auto& points = lane.points;
+      if (lane.resolution == 0 || position >= points.back().sample)
+        continue;
+      auto point = firstAfter(points, position);
+      int64_t due = points.at(point).sample;
+      if (!points.atBegin(point) && points.before(point).value != points.at(point).value)
+        due = min(due, (position / lane.resolution + 1) * lane.resolution);
+      next = min(next, due - origin);
+    }
+    return int(max<int64_t>(next, blockOffset));
+  }
+  void processChangesUpTo(int offset);
+
+  // Audio thread, after the block: playback carries on numSamples later, round the loop if it got to its end
+  void endBlock(int numSamples)
+  {
+    wrapLoop(numSamples);
+    origin += numSamples;
+    blockOffset = 0;
+    blockStart.store(origin, memory_order_relaxed);
+  }
+
+  int64_t getPosition() const { return blockStart.load(memory_order_relaxed); }
+  uint64_t getCurrentBlock() const { return uint64_t(getPosition() / blockSize); }
+
+  // The audio thread moves to sample at the start of the next block, chasing every parameter's value
+  void seek(int64_t sample) { seekSample = max<int64_t>(0, sample); }
+
+  // Chases every parameter's value at the start of the next block where playback is, unless a seek is
+  // already due to
+  void chaseOnNextBlock()
+  {
+    int64_t none = -1;
+    seekSample.compare_exchange_strong(none, getPosition());
+  }
+
+  // Reaching sample end carries on from sample start; end <= start stops looping
+  void setLoop(int64_t start, int64_t end)
+  {
+    edit([&]
+    {
+      loopStart = start;
+      loopEnd = end;
+    });
+  }
+
+  // Edits changes scheduled with IDs: deletes, then moves, then inserts, where an ID that's already
+  // scheduled replaces that change. Unknown IDs are ignored
+  void editChanges(const IdRecord* deletes, size_t numDeletes, const ParamMoveRecord* moves, size_t numMoves,
+    const IdentifiedParamChangeRecord* changes, size_t numChanges)
+  {
+    edit([&]
+    {
+      for (size_t i = 0; i < numDeletes; ++i)
+        removeIdentified(deletes[i].id);
+      for (size_t i = 0; i < numMoves; ++i)
+      {
+        auto it = identifiedChanges.find(moves[i].id);
+        if (it == identifiedChanges.end())
+          continue;
+        ScheduledParameterChange change = it->second;
+        removeIdentified(change.id);
+        change.sample = int64_t(moves[i].atBlock) * blockSize;
+        insertChange(change);
+      }
+      for (size_t i = 0; i < numChanges; ++i)
+        insertIdentified(changes[i]);
+    });
+  }
+
+  // Replaces key's identified changes in blocks [firstBlock, endBlock) with changes
+  void replaceChangeRange(int key, uint64_t firstBlock, uint64_t endBlock, const IdentifiedParamChangeRecord* changes, size_t numChanges)
+  {
+    edit([&]
+    {
+      int64_t first = int64_t(firstBlock) * blockSize;
+      int64_t end = int64_t(endBlock) * blockSize;
+      vector<uint64_t> inRange;
+      for (auto it = identifiedChangesBySample.lower_bound({ key, first, 0 });
+        it != identifiedChangesBySample.end() && get<0>(*it) == key && get<1>(*it) < end; ++it)
+        inRange.push_back(get<2>(*it));
+      for (uint64_t id : inRange)
+        removeIdentified(id);
+      for (size_t i = 0; i < numChanges; ++i)
+        insertIdentified(changes[i]);
+    });
+  }
+
+  void clearSchedule()
+  {
+    edit([&]
+    {
+      scheduledChanges.clear();
+      parameterTracks.clear();
+      identifiedChanges.clear();
+      identifiedChangesBySample.clear();
+      automationLanes.clear();
+      cleared = true;
+    });
+  }
+
+  static void placeAtBeat(ScheduledParameterChange& change, const TempoMap& tempoMap, double rate)
+  {
+    change.sample = max<int64_t>(0, tempoMap.beatToSample(change.beat, rate));
+  }
+};
+
+// Records the parameter moves made while playing, from plugin editors or controllers, stamped to the sample.
+// record() can be called from any thread: it claims a slot in a buffer allocated when recording starts, so
+// it never locks or allocates. stop() waits out writers still inside record(), then thins each parameter's
+// moves into a lane of breakpoints that set_automation_lane plays back
+class AutomationRecorder
+{
+public:
+  struct Move
+  {
+    int key;
+    int parameterIndex;
+    int64_t sample;
+    float value;
+  };
+
+  struct Result
+  {
+    uint32_t recorded = 0;  // Moves recorded, before thinning
+    uint32_t dropped = 0;   // Moves that didn't fit in the buffer
+    vector<RecordedAutomationPointRecord> points;  // By plugin, parameter, then sample
+  };
+
+  // Command thread: starts again with room for capacity moves
+  void start(size_t capacity)
+  {
+    stopWriters();
+    moves.resize(capacity);
+    count = 0;
+    recording = true;
+  }
+
+  void record(int key, int parameterIndex, int64_t sample, float value)
+  {
+    activeWriters.fetch_add(1);
+    if (recording.load())
+    {
+      size_t slot = count.fetch_add(1);
+      if (slot < moves.size())
+        moves[slot] = { key, parameterIndex, sample, value };
+    }
+    activeWriters.fetch_sub(1);
+  }
+
+  bool isRecording() const { return recording.load(); }
+
+  // Command thread: stops recording and thins each parameter's moves with Ramer-Douglas-Peucker, keeping
+  // the points the lane can't be drawn within tolerance of without. A pause longer than holdSamples
+  // before a move keeps the value held up to it, as it was played, rather than ramping across the pause
+  Result stop(float tolerance, int64_t holdSamples)
+  {
+    stopWriters();
+    Result result;
+    size_t total = count.load();
+    size_t n = min(total, moves.size());
+    result.recorded = uint32_t(n);
+    result.dropped = uint32_t(total - n);
+
+    stable_sort(moves.begin(), moves.begin() + n, [](const Move& a, const Move& b) {
+      if (a.key != b.key)
+        return a.key < b.key;
+      if (a.parameterIndex != b.parameterIndex)
+        return a.parameterIndex < b.parameterIndex;
+      return a.sample < b.sample;
+    });
+    vector<Move> lane;
+    for (size_t first = 0; first < n;)
+    {
+      size_t last = first;
+      lane.clear();
+      for (; last < n && moves[last].key == moves[first].key && moves[last].parameterIndex == moves[first].parameterIndex; ++last)
+      {
+        const Move& move = moves[last];
+        if (!lane.empty() && lane.back().sample == move.sample)
+          lane.back().value = move.value;  // The last move in a sample is the one that stuck
+        else
+        {
+          // The hold point needs a sample of its own, or thin would divide by a zero-length span
+          if (!lane.empty() && move.sample - lane.back().sample > holdSamples && move.sample - 1 > lane.back().sample)
+            lane.push_back({ move.key, move.parameterIndex, move.sample - 1, lane.back().value });
+          lane.push_back(move);
+        }
+      }
+      thin(lane, tolerance, result.points);
+      first = last;
+    }
+    count = 0;
+    return result;
+  }
+
+private:
+  void stopWriters()
+  {
+    recording = false;
+    while (activeWriters.load() > 0)
+      this_thread::yield();
+  }
+
+  static void thin(const vector<Move>& lane, float tolerance, vector<RecordedAutomationPointRecord>& out)
+  {
+    vector<bool> keep(lane.size(), false);
+    keep.front() = keep.back() = true;
+    vector<pair<size_t, size_t>> spans{ { 0, lane.size() - 1 } };
+    while (!spans.empty())
+    {
+      auto [a, b] = spans.back();
+      spans.pop_back();
+      float worst = tolerance;
+      size_t split = a;
+      for (size_t i = a + 1; i < b; ++i)
+      {
+        double t = double(lane[i].sample - lane[a].sample) / double(lane[b].sample - lane[a].sample);
+        float error = fabs(lane[i].value - float(lane[a].value + (lane[b].value - lane[a].value) * t));
+        if (error > worst)
+        {
+          worst = error;
+          split = i;
+        }
+      }
+      if (split != a)
+      {
+        keep[split] = true;
+        spans.push_back({ a, split });
+        spans.push_back({ split, b });
+      }
+    }
+    for (size_t i = 0; i < lane.size(); ++i)
+      if (keep[i])
+        out.push_back({ lane[i].key, lane[i].parameterIndex, lane[i].sample, lane[i].value });
+  }
+
+  vector<Move> moves;
+  atomic<size_t> count{ 0 };      // Slots claimed, which can run past the end of moves once it's full
+  atomic<bool> recording{ false };
+  atomic<int> activeWriters{ 0 };
+};
+
+struct ParameterChangeEvent
+{
+  int key;
+  int parameterIndex;
+  float value;
+  uint64_t atBlock;  // Block number when event occurred
+};
+
+struct MidiNoteEvent
+{
+  int noteNumber;
+  int velocity;  // 0-127, or 0 for note off
+  int channel;
+  bool isNoteOn;
+  uint64_t samplePosition;  // Sample position when event occurred
+};
+
+struct MidiCCEvent
+{
+  int controller;
+  int value;  // 0-127
+  int channel;
+  uint64_t atBlock;  // Block number when event occurred
+};
+
+class LockFreeParameterQueue
+{
+private:
+  static constexpr size_t QUEUE_SIZE = 1000000;
+  std::array<ParameterChangeEvent, QUEUE_SIZE> queue;
+  std::atomic<size_t> writeIndex{0};
+  std::atomic<size_t> readIndex{0};
+
+public:
+  // Called from audio thread (fast, lock-free)
+  bool push(const ParameterChangeEvent& event)
+  {
+    size_t currentWrite = writeIndex.load();
+    size_t nextWrite = (currentWrite + 1) % QUEUE_SIZE;
+
+    if (nextWrite == readIndex.load())
+    {
+      return false; // Queue full
+    }
+
+    queue[currentWrite] = event;
+    writeIndex.store(nextWrite);
+    return true;
+  }
+
+  // Called from main thread
+  bool pop(ParameterChangeEvent& event)
+  {
+    size_t currentRead = readIndex.load();
+    if (currentRead == writeIndex.load())
+    {
+      return false; // Queue empty
+    }
+    event = queue[currentRead];
+    readIndex.store((currentRead + 1) % QUEUE_SIZE);
+    return true;
+  }
+};
+
+template<typename T>
+class LockFreeMidiQueue
+{
+private:
+  static constexpr size_t QUEUE_SIZE = 100000;
+  std::array<T, QUEUE_SIZE> queue;
+  std::atomic<size_t> writeIndex{0};
+  std::atomic<size_t> readIndex{0};
+
+public:
+  // Called from audio thread (fast, lock-free)
+  bool push(const T& event)
+  {
+    size_t currentWrite = writeIndex.load();
+    size_t nextWrite = (currentWrite + 1) % QUEUE_SIZE;
+
+    if (nextWrite == readIndex.load())
+    {
+      return false; // Queue full
+    }
+
+    queue[currentWrite] = event;
+    writeIndex.store(nextWrite);
+    return true;
+  }
+
+  // Called from main thread
+  bool pop(T& event)
+  {
+    size_t currentRead = readIndex.load();
+    if (currentRead == writeIndex.load())
+    {
+      return false; // Queue empty
+    }
+    event = queue[currentRead];
+    readIndex.store((currentRead + 1) % QUEUE_SIZE);
+    return true;
+  }
+};
+
+// Both pipes carry length-prefixed frames: a uint32 byte count followed by the message. A command
+// and its reply are one frame each, and so is every notification. An empty frame on the notification
+// pipe means notifications continue on the shared memory transport.
+// Commands start with a uint32 request ID and replies start by echoing it, so replies to slow commands
+// can arrive out of order. Request ID 0 means the client doesn't want a reply.
+class FrameReader
+{
+private:
+  static constexpr size_t maxFrameSize = 256 * 1024 * 1024;
+  std::vector<char> buffer = std::vector<char>(64 * 1024);
+  size_t bufferStart = 0;  // First byte not yet handed out as a frame
+  size_t bufferEnd = 0;    // One past the last byte received
+  const char* frame = nullptr;
+  size_t frameSize = 0;
+  size_t cursor = 0;
+
+public:
+  // Makes the next frame current. readSome(dst, capacity) is only called when the buffer doesn't
+  // already hold a whole frame; the buffer is reused and grows only for oversized frames.
+  template<typename ReadSome>
+  void next(ReadSome&& readSome)
+  {
+    frame = nullptr;
+    frameSize = cursor = 0;
+
+    uint32_t length = 0;
+    for (;;)
+    {
+      size_t buffered = bufferEnd - bufferStart;
+      if (buffered >= sizeof(length))
+      {
+        memcpy(&length, buffer.data() + bufferStart, sizeof(length));
+        if (length > maxFrameSize)
+          throw runtime_error("invalid frame length: " + to_string(length));
+        if (buffered >= sizeof(length) + length)
+          break;
+      }
+
+      // Make room at the end, moving the partial frame to the front first
+      if (bufferStart > 0)
+      {
+        memmove(buffer.data(), buffer.data() + bufferStart, buffered);
+        bufferStart = 0;
+        bufferEnd = buffered;
+      }
+      size_t needed = sizeof(length) + length;
+      if (buffer.size() < needed)
+        buffer.resize(needed);
+      bufferEnd += readSome(buffer.data() + bufferEnd, buffer.size() - bufferEnd);
+    }
+
+    frame = buffer.data() + bufferStart + sizeof(length);
+    frameSize = length;
+    bufferStart += sizeof(length) + length;
+    if (bufferStart == bufferEnd)
+      bufferStart = bufferEnd = 0;
+  }
+
+  const char* readBytes(size_t n)
+  {
+    if (n > frameSize - cursor)
+      throw runtime_error("frame underrun");
+    const char* p = frame + cursor;
+    cursor += n;
+    return p;
+  }
+
+  template<typename T>
+  T read()
+  {
+    T value;
+    memcpy(&value, readBytes(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  // A records:R field, its count then the records, used where they are in the frame. Records are
+  // packed, so there's no alignment concern
+  template<typename Record>
+  const Record* readRecords(uint32_t& count)
+  {
+    count = read<uint32_t>();
+    return reinterpret_cast<const Record*>(readBytes(size_t(count) * sizeof(Record)));
+  }
+
+  string readString()
+  {
+    uint32_t length = read<uint32_t>();
+    if (length > 10000)  // Sanity check
+      throw runtime_error("invalid string length");
+    return string(readBytes(length), length);
+  }
+
+  size_t remaining() const { return frameSize - cursor; }
+
+  // The rest of the frame, without reading it
+  const char* unread() const { return frame + cursor; }
+
+  // Makes a frame that was copied out of the pipe current, for decoding on another thread
+  void assign(const char* data, size_t size)
+  {
+    frame = data;
+    frameSize = size;
+    cursor = 0;
+  }
+
+  // Drops anything buffered, e.g. a partial frame left by a client that went away
+  void reset()
+  {
+    bufferStart = bufferEnd = 0;
+    frame = nullptr;
+    frameSize = cursor = 0;
+  }
+};
+
+// Builds one outgoing frame. Scalars and strings are appended to a reusable arena that starts with
+// room for the length header, so a typical reply is one contiguous write. Large blobs can be added
+// by reference and go out as their own segment of a gather write instead of being copied.
+class FrameWriter
+{
+public:
+  struct Segment
+  {
+    const char* data;
+    size_t length;
+  };
+
+  static constexpr size_t headerSize = sizeof(uint32_t);
+
+  FrameWriter() { clear(); }
+
+  void clear()
+  {
+    arena.resize(headerSize);
+    pieces.clear();
+    pieces.push_back({ nullptr, 0, headerSize });
+    bodySize = 0;
+  }
+
+  bool empty() const { return bodySize == 0; }
+  size_t frameSize() const { return headerSize + bodySize; }
+
+  void append(const void* data, size_t n)
+  {
+    auto& last = pieces.back();
+    if (last.external == nullptr && last.offset + last.length == arena.size())
+      last.length += n;
+    else
+      pieces.push_back({ nullptr, arena.size(), n });
+    const char* p = static_cast<const char*>(data);
+    arena.insert(arena.end(), p, p + n);
+    bodySize += n;
+  }
+
+  // data must stay valid until the frame has been written
+  void appendExternal(const void* data, size_t n)
+  {
+    pieces.push_back({ static_cast<const char*>(data), 0, n });
+    bodySize += n;
+  }
+
+  template<typename T>
+  void write(T value)
+  {
+    append(&value, sizeof(T));
+  }
+
+  void writeString(const string& s)
+  {
+    write(uint32_t(s.length()));
+    append(s.data(), s.length());
+  }
+
+  // Fills in the header and returns the frame as a list of segments, header first
+  const std::vector<Segment>& finish()
+  {
+    uint32_t length = uint32_t(bodySize);
+    memcpy(arena.data(), &length, headerSize);
+    segments.clear();
+    for (auto& piece : pieces)
+      segments.push_back({ piece.external ? piece.external : arena.data() + piece.offset, piece.length });
+    return segments;
+  }
+
+  // Copies a finished multi-segment frame into one buffer, for transports that can't gather
+  const char* coalesce()
+  {
+    gathered.clear();
+    for (auto& seg : segments)
+      gathered.insert(gathered.end(), seg.data, seg.data + seg.length);
+    return gathered.data();
+  }
+
+#ifndef _WIN32
+  std::vector<iovec>& scratchIovecs() { return iovecs; }
+#endif
+
+private:
+  struct Piece
+  {
+    const char* external;  // nullptr for bytes in the arena
+    size_t offset;
+    size_t length;
+  };
+
+  std::vector<char> arena;
+  std::vector<Piece> pieces;
+  std::vector<Segment> segments;
+  std::vector<char> gathered;
+#ifndef _WIN32
+  std::vector<iovec> iovecs;
+#endif
+  size_t bodySize = 0;
+};
+
+// A named shared memory mapping. The server creates it and removes the name when it's destroyed;
+// the client maps it by name (/dev/shm/<name> on Linux, the same tag name on Windows).
+class SharedMemoryRegion
+{
+public:
+  SharedMemoryRegion(const string& regionName, size_t regionSize) : name(regionName), size(regionSize)
+  {
+#ifdef _WIN32
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+      DWORD(uint64_t(size) >> 32), DWORD(size & 0xffffffff), name.c_str());
+    if (mapping == NULL)
+      throw runtime_error("CreateFileMapping failed: " + to_string(GetLastError()));
+    data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+    if (data == nullptr)
+    {
+      CloseHandle(mapping);
+      throw runtime_error("MapViewOfFile failed: " + to_string(GetLastError()));
+    }
+#else
+    shm_unlink(name.c_str());  // Left over from a server that didn't exit cleanly
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+      throw runtime_error("shm_open failed: " + string(strerror(errno)));
+    if (ftruncate(fd, off_t(size)) != 0)
+    {
+      close(fd);
+      shm_unlink(name.c_str());
+      throw runtime_error("ftruncate failed: " + string(strerror(errno)));
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+      shm_unlink(name.c_str());
+      throw runtime_error("mmap failed: " + string(strerror(errno)));
+    }
+    data = static_cast<char*>(mapped);
+#endif
+  }
+
+  ~SharedMemoryRegion()
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+#else
+    munmap(data, size);
+    shm_unlink(name.c_str());
+#endif
+  }
+
+  SharedMemoryRegion(const SharedMemoryRegion&) = delete;
+  SharedMemoryRegion& operator=(const SharedMemoryRegion&) = delete;
+
+  char* bytes() const { return data; }
+  size_t getSize() const { return size; }
+  const string& getName() const { return name; }
+
+private:
+  string name;
+  size_t size;
+  char* data = nullptr;
+#ifdef _WIN32
+  HANDLE mapping = NULL;
+#endif
+};
+
+#ifdef SHARED_TRANSPORT_SUPPORTED
+
+// Control block of one single-producer single-consumer byte ring. The positions count bytes since the
+// ring was created and wrap with a mask, so the data area is a power of two. Each side has its own cache
+// line, and each side has a signal word it bumps after making progress, which the other side sleeps on.
+// The offsets are part of the protocol (see SharedRing in juce_client.py).
+struct RingControl
+{
+  alignas(64) std::atomic<uint64_t> writePos;
+  alignas(64) std::atomic<uint64_t> readPos;
+  alignas(64) std::atomic<uint32_t> dataSignal;    // Bumped by the writer after publishing bytes
+  std::atomic<uint32_t> readerSleeping;
+  alignas(64) std::atomic<uint32_t> spaceSignal;   // Bumped by the reader after consuming bytes
+  std::atomic<uint32_t> writerSleeping;
+};
+static_assert(sizeof(RingControl) == 256, "RingControl layout is shared with the client");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory rings need lock-free 64-bit atomics");
+
+// Sleeps on / wakes one signal word of a ring, across processes
+class RingSignal
+{
+public:
+#ifdef _WIN32
+  void open(std::atomic<uint32_t>* word, const string& eventName)
+  {
+    signalWord = word;
+    event = CreateEventA(NULL, FALSE, FALSE, eventName.c_str());  // Auto-reset, so a wake before the wait isn't lost
+    if (event == NULL)
+      throw runtime_error("CreateEvent failed: " + to_string(GetLastError()));
+  }
+  ~RingSignal() { if (event) CloseHandle(event); }
+  void wait(uint32_t, int timeoutMs) { WaitForSingleObject(event, DWORD(timeoutMs)); }
+  void wake() { SetEvent(event); }
+#else
+  void open(std::atomic<uint32_t>* word, const string&) { signalWord = word; }
+  // Returns at once if the word no longer holds the value seen before deciding to sleep
+  void wait(uint32_t seen, int timeoutMs)
+  {
+    timespec timeout{ timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(signalWord), FUTEX_WAIT, seen, &timeout, nullptr, 0);
+  }
+  void wake() { syscall(SYS_futex, reinterpret_cast<uint32_t*>(signalWord), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0); }
+#endif
+  std::atomic<uint32_t>* word() const { return signalWord; }
+
+private:
+  std::atomic<uint32_t>* signalWord = nullptr;
+#ifdef _WIN32
+  HANDLE event = NULL;
+#endif
+};
+
+// One direction of the shared memory transport. Readers and writers spin briefly before sleeping,
+// so a busy conversation never enters the kernel, and a sleeping peer is only woken when it asked to be.
+class SharedRing
+{
+public:
+  void open(RingControl* ringControl, char* ringData, size_t ringCapacity, const string& eventPrefix)
+  {
+    control = ringControl;
+    data = ringData;
+    capacity = ringCapacity;
+    dataReady.open(&control->dataSignal, eventPrefix + "_data");
+    spaceReady.open(&control->spaceSignal, eventPrefix + "_space");
+  }
+
+  // Copies whatever is available, up to maxBytes, blocking until there's at least one byte.
+  // peerAlive is polled while asleep; if it returns false the ring is treated as closed.
+  template<typename PeerAlive>
+  size_t readSome(char* dst, size_t maxBytes, PeerAlive&& peerAlive)
+  {
+    uint64_t readPos = control->readPos.load(std::memory_order_relaxed);
+    uint64_t available = waitFor([&] { return control->writePos.load(std::memory_order_acquire) - readPos; },
+      dataReady, control->readerSleeping, peerAlive);
+    size_t n = size_t(std::min<uint64_t>(available, maxBytes));
+    copyOut(readPos, dst, n);
+    control->readPos.store(readPos + n, std::memory_order_release);
+    notify(spaceReady, control->writerSleeping);
+    return n;
+  }
+
+  // Writes the segments back to back as one frame. Frames bigger than the ring go through in pieces
+  // as the reader makes room; otherwise the whole frame is published at once.
+  template<typename PeerAlive>
+  void write(const std::vector<FrameWriter::Segment>& segments, PeerAlive&& peerAlive)
+  {
+    uint64_t writePos = control->writePos.load(std::memory_order_relaxed);
+    for (auto& seg : segments)
+    {
+      size_t done = 0;
+      while (done < seg.length)
+      {
+        uint64_t space = capacity - (writePos - control->readPos.load(std::memory_order_acquire));
+        if (space == 0)
+        {
+          publish(writePos);
+          space = waitFor([&] { return capacity - (writePos - control->readPos.load(std::memory_order_acquire)); },
+            spaceReady, control->writerSleeping, peerAlive);
+        }
+        size_t n = size_t(std::min<uint64_t>(space, seg.length - done));
+        copyIn(writePos, seg.data + done, n);
+        writePos += n;
+        done += n;
+      }
+    }
+    publish(writePos);
+  }
+
+  // Wakes anything sleeping on either side, e.g. so it notices the transport is closing
+  void wakeAll()
+  {
+    control->dataSignal.fetch_add(1);
+    control->spaceSignal.fetch_add(1);
+    dataReady.wake();
+    spaceReady.wake();
+  }
+
+private:
+  static constexpr int sleepTimeoutMs = 100;
+  // Spinning only pays off when the peer is running on another core at the same time
+  const int spinCount = std::thread::hardware_concurrency() > 1 ? 2000 : 0;
 
-  void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+  template<typename Available, typename PeerAlive>
+  uint64_t waitFor(Available&& available, RingSignal& signal, std::atomic<uint32_t>& sleeping, PeerAlive&& peerAlive)
   {
-    buffer.clear();
-
-    // Check if scheduled playback should start
-    if (isScheduled && !isPlaying && currentSamplePosition >= startSamplePosition)
+    for (int i = 0; i < spinCount; ++i)
     {
-      isPlaying = true;
-      isScheduled = false;
-      std::cout << "Started scheduled playback at sample " << currentSamplePosition << std::endl;
+      if (uint64_t n = available())
+        return n;
+      std::this_thread::yield();
+    }
+    for (;;)
+    {
+      uint32_t seen = signal.word()->load();
+      sleeping.store(1);
+      uint64_t n = available();
+      if (n == 0)
+        signal.wait(seen, sleepTimeoutMs);
+      sleeping.store(0);
+      if (n || (n = available()))
+        return n;
+      if (!peerAlive())
+        throw runtime_error("shared transport closed");
     }
+  }
 
-    if (!isPlaying || audioBuffer.getNumSamples() == 0)
+  void publish(uint64_t writePos)
+  {
+    if (writePos == control->writePos.load(std::memory_order_relaxed))
       return;
+    control->writePos.store(writePos, std::memory_order_release);
+    notify(dataReady, control->readerSleeping);
+  }
 
-    int numSamples = buffer.getNumSamples();
-    int samplesToPlay = juce::jmin(numSamples,
-      (int)(audioBuffer.getNumSamples() - playbackPosition));
+  void notify(RingSignal& signal, std::atomic<uint32_t>& sleeping)
+  {
+    signal.word()->fetch_add(1);
+    if (sleeping.load())
+      signal.wake();
+  }
 
-    if (samplesToPlay > 0)
+  void copyIn(uint64_t pos, const char* src, size_t n)
+  {
+    size_t offset = size_t(pos & (capacity - 1));
+    size_t first = std::min(n, capacity - offset);
+    memcpy(data + offset, src, first);
+    memcpy(data, src + first, n - first);
+  }
+
+  void copyOut(uint64_t pos, char* dst, size_t n)
+  {
+    size_t offset = size_t(pos & (capacity - 1));
+    size_t first = std::min(n, capacity - offset);
+    memcpy(dst, data + offset, first);
+    memcpy(dst + first, data, n - first);
+  }
+
+  RingControl* control = nullptr;
+  char* data = nullptr;
+  size_t capacity = 0;
+  RingSignal dataReady;
+  RingSignal spaceReady;
+};
+
+// Shared memory alternative to the pipes, negotiated with open_shared_transport. The region holds a
+// header, three ring control blocks (commands, replies, notifications) and then the three data areas.
+// Frames on the rings are the same as on the pipes.
+class SharedTransport
+{
+public:
+  static constexpr uint32_t magic = 0x4d485353;  // "SSHM"
+  static constexpr uint32_t version = 1;
+  static constexpr size_t controlOffset = 64;
+  static constexpr size_t dataOffset = 4096;
+  static constexpr uint32_t defaultRingCapacity = 1 << 20;
+
+  enum RingIndex { commandRing, replyRing, notificationRing, numRings };
+
+  struct Header
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ringCapacity;
+    uint32_t numRings;
+    int64_t serverPid;
+    int64_t clientPid;
+    std::atomic<uint32_t> serverClosed;
+    std::atomic<uint32_t> clientClosed;
+  };
+  static_assert(sizeof(Header) <= controlOffset, "header overlaps the ring control blocks");
+
+  SharedTransport(const string& baseName, uint32_t requestedCapacity, int64_t clientProcessId)
+    : capacity(roundCapacity(requestedCapacity)),
+#ifdef _WIN32
+      region("Local\\" + baseName + "_shm", dataOffset + size_t(numRings) * capacity)
+#else
+      region("/" + baseName + "_shm", dataOffset + size_t(numRings) * capacity)
+#endif
+  {
+    header = new (region.bytes()) Header();
+    header->magic = magic;
+    header->version = version;
+    header->ringCapacity = capacity;
+    header->numRings = numRings;
+    header->clientPid = clientProcessId;
+#ifdef _WIN32
+    header->serverPid = int64_t(GetCurrentProcessId());
+    clientProcess = OpenProcess(SYNCHRONIZE, FALSE, DWORD(clientProcessId));
+#else
+    header->serverPid = int64_t(getpid());
+#endif
+    for (int i = 0; i < numRings; ++i)
     {
-      // Copy audio to output
-      for (int ch = 0; ch < buffer.getNumChannels() && ch < audioBuffer.getNumChannels(); ++ch)
-      {
-        buffer.copyFrom(ch, 0, audioBuffer, ch, (int)playbackPosition, samplesToPlay);
-      }
+      auto* control = new (region.bytes() + controlOffset + i * sizeof(RingControl)) RingControl();
+      rings[i].open(control, region.bytes() + dataOffset + size_t(i) * capacity, capacity,
+#ifdef _WIN32
+        "Local\\" + baseName + "_shm_" + to_string(i));
+#else
+        "");
+#endif
+    }
+  }
 
-      playbackPosition += samplesToPlay;
+  ~SharedTransport()
+  {
+    header->serverClosed.store(1);
+    for (auto& ring : rings)
+      ring.wakeAll();
+#ifdef _WIN32
+    if (clientProcess)
+      CloseHandle(clientProcess);
+#endif
+  }
+
+  bool clientAlive() const
+  {
+    if (header->clientClosed.load())
+      return false;
+#ifdef _WIN32
+    return clientProcess == NULL || WaitForSingleObject(clientProcess, 0) == WAIT_TIMEOUT;
+#else
+    return kill(pid_t(header->clientPid), 0) == 0 || errno != ESRCH;
+#endif
+  }
+
+  size_t readCommands(char* buffer, size_t capacity)
+  {
+    return rings[commandRing].readSome(buffer, capacity, [this] { return clientAlive(); });
+  }
+
+  void write(RingIndex ring, FrameWriter& frame)
+  {
+    rings[ring].write(frame.finish(), [this] { return clientAlive(); });
+  }
+
+  const string& getName() const { return region.getName(); }
+  uint32_t getRingCapacity() const { return capacity; }
+
+private:
+  static uint32_t roundCapacity(uint32_t requested)
+  {
+    if (requested == 0)
+      requested = defaultRingCapacity;
+    requested = std::clamp<uint32_t>(requested, 64 * 1024, 64 * 1024 * 1024);
+    uint32_t rounded = 1;
+    while (rounded < requested)
+      rounded <<= 1;
+    return rounded;
+  }
+
+  uint32_t capacity;
+  SharedMemoryRegion region;
+  Header* header = nullptr;
+  SharedRing rings[numRings];
+#ifdef _WIN32
+  HANDLE clientProcess = NULL;
+#endif
+};
+#endif
+
+// Sink node that copies one bus of another node's output into a shared memory float ring, for Python to
+// read as a numpy array. The audio thread never waits on the reader: a block that doesn't fit is dropped
+// and counted instead. Layout: Header, then numChannels planar float rings of capacity frames each.
+class AudioTapNode : public juce::AudioProcessor
+{
+public:
+  static constexpr uint32_t magic = 0x50415441;  // "ATAP"
+  static constexpr size_t dataOffset = 256;
+
+  struct Header
+  {
+    uint32_t magic;
+    uint32_t numChannels;
+    uint32_t capacity;          // Frames per channel, a power of two
+    std::atomic<uint32_t> closed;  // Set when the node goes, e.g. unsubscribed or cleared with the graph
+    double sampleRate;
+    alignas(64) std::atomic<uint64_t> writePos;  // Frames written, published after the samples
+    std::atomic<uint64_t> droppedFrames;
+    std::atomic<uint64_t> droppedBlocks;
+    alignas(64) std::atomic<uint64_t> readPos;   // Advanced by the reader
+  };
+  static_assert(sizeof(Header) <= dataOffset, "tap header overlaps the sample data");
+
+  AudioTapNode(const string& regionName, int channels, uint32_t requestedFrames, double rate)
+    : AudioProcessor(BusesProperties()
+      .withInput("Input", juce::AudioChannelSet::discreteChannels(std::max(channels, 1)), true)),
+    numChannels(uint32_t(std::max(channels, 1))),
+    capacity(roundCapacity(requestedFrames)),
+    region(regionName, dataOffset + size_t(numChannels) * capacity * sizeof(float))
+  {
+    header = new (region.bytes()) Header();
+    header->magic = magic;
+    header->numChannels = numChannels;
+    header->capacity = capacity;
+    header->sampleRate = rate;
+    samples = reinterpret_cast<float*>(region.bytes() + dataOffset);
+  }
+
+  ~AudioTapNode() override
+  {
+    header->closed.store(1, std::memory_order_release);  // The reader keeps its own mapping
+  }
+
+  void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+  {
+    const uint32_t numSamples = uint32_t(buffer.getNumSamples());
+    const uint64_t writePos = header->writePos.load(std::memory_order_relaxed);
+    const uint64_t readPos = header->readPos.load(std::memory_order_acquire);
+    if (capacity - (writePos - readPos) < numSamples)
+    {
+      header->droppedFrames.fetch_add(numSamples, std::memory_order_relaxed);
+      header->droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+      return;
     }
 
-    // Check if finished
-    if (playbackPosition >= audioBuffer.getNumSamples())
+    const uint32_t offset = uint32_t(writePos & (capacity - 1));
+    const uint32_t first = std::min(numSamples, capacity - offset);
+    const int channels = std::min(int(numChannels), buffer.getNumChannels());
+    for (int ch = 0; ch < channels; ++ch)
     {
-      std::cout << "Playback finished" << std::endl;
-      isPlaying = false;
-      playbackPosition = 0;
+      const float* source = buffer.getReadPointer(ch);
+      float* ring = samples + size_t(ch) * capacity;
+      memcpy(ring + offset, source, first * sizeof(float));
+      memcpy(ring, source + first, (numSamples - first) * sizeof(float));
     }
+    header->writePos.store(writePos + numSamples, std::memory_order_release);
   }
 
-  const juce::String getName() const override { return "Audio File Player"; }
-  void prepareToPlay(double sampleRate, int samplesPerBlock) override {}
+  const string& getRegionName() const { return region.getName(); }
+  uint32_t getNumTapChannels() const { return numChannels; }
+  uint32_t getCapacity() const { return capacity; }
+
+  const juce::String getName() const override { return "Audio Tap"; }
+  void prepareToPlay(double sampleRate, int samplesPerBlock) override { header->sampleRate = sampleRate; }
   void releaseResources() override {}
 
   bool acceptsMidi() const override { return false; }
@@ -476,194 +4366,168 @@ public:
 
   juce::AudioProcessorEditor* createEditor() override { return nullptr; }
   bool hasEditor() const override { return false; }
-};
-
-// Forward declaration
-class CompletePluginHost;
 
-// Audio callback wrapper for recording
-class RecordingAudioCallback : public juce::AudioIODeviceCallback
-{
 private:
-  juce::AudioIODeviceCallback* wrappedCallback;  // The actual callback (graphPlayer)
-  CompletePluginHost* host;
-
-public:
-  RecordingAudioCallback(juce::AudioIODeviceCallback* callback, CompletePluginHost* h)
-    : wrappedCallback(callback), host(h) {}
-
-  void audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
-                                        int numInputChannels,
-                                        float* const* outputChannelData,
-                                        int numOutputChannels,
-                                        int numSamples,
-                                        const juce::AudioIODeviceCallbackContext& context) override;
-
-  void audioDeviceAboutToStart(juce::AudioIODevice* device) override
-  {
-    if (wrappedCallback)
-      wrappedCallback->audioDeviceAboutToStart(device);
-  }
-
-  void audioDeviceStopped() override
+  static uint32_t roundCapacity(uint32_t requested)
   {
-    if (wrappedCallback)
-      wrappedCallback->audioDeviceStopped();
+    if (requested == 0)
+      requested = 1 << 16;
+    requested = std::clamp<uint32_t>(requested, 1024, 1 << 24);
+    uint32_t rounded = 1;
+    while (rounded < requested)
+      rounded <<= 1;
+    return rounded;
   }
-};
 
-struct ScheduledParameterChange 
-{
-  int key;
-  int parameterIndex;
-  float value;
-  uint64_t atBlock;  // Which audio block to execute on
-  bool executed = false;
+  uint32_t numChannels;
+  uint32_t capacity;
+  SharedMemoryRegion region;  // Owned by the node, so it stays mapped until the graph lets go of it
+  Header* header = nullptr;
+  float* samples = nullptr;
 };
 
-class BlockLevelScheduler 
+// The command being decoded, and its reply, on the current thread: the command thread's own frames, or
+// the slow command worker's. READFROMPIPE and WRITEALLC go through these.
+thread_local FrameReader* currentCommandFrame = nullptr;
+thread_local FrameWriter* currentCommandReply = nullptr;
+thread_local uint32_t currentRequestId = 0;
+thread_local int currentClient = 0;  // Who the current command came from: 0 for the pipe client, or a socket client ID
+
+// What a client subscribed to; everything is lock-free. Each client's filter is applied as its batch is
+// built. The combined filter, notificationFilter, is checked where events are produced (audio, MIDI input
+// and message threads), so events nobody subscribed to never reach the queues below.
+class NotificationFilter
 {
-private:
-  CompletePluginHost* host = nullptr;
-  vector<ScheduledParameterChange> scheduledChanges;
-  uint64_t currentBlock = 0;
-  int lastChangeIndex = 0;
-
 public:
-  void setHost(CompletePluginHost* h) { host = h; }
-  void setBlockSize(int size) { blockSize = size; }
-  // Python calls this to schedule changes
-  void scheduleParameterChange(int key, int paramIndex, float value, uint64_t atBlock) 
-  {
-    ScheduledParameterChange change;
-    change.key = key;
-    change.parameterIndex = paramIndex;
-    change.value = value;
-    change.atBlock = atBlock;
-
-    scheduledChanges.push_back(change);
+  static constexpr int maxNamedKeys = 1024;  // A subscription can name plugin keys 0..1023
 
-    // Sort by block number
-    sort(scheduledChanges.begin(), scheduledChanges.end(),
-      [](const auto& a, const auto& b) { return a.atBlock < b.atBlock; });
+  bool wants(NotificationStream stream) const
+  {
+    return (streams.load(std::memory_order_relaxed) >> uint32_t(stream)) & 1;
   }
 
-  // Called at the START of each audio block, before processing
-  void processScheduledChanges() ;
-  void incrementBlock() { currentBlock++; }
-  uint64_t getCurrentBlock() const { return currentBlock; }
-
-  void clearSchedule()
+  // Keys only narrow the parameter stream; keyboard input isn't tied to a plugin
+  bool wantsKey(int key) const
   {
-    scheduledChanges.clear();
-    lastChangeIndex = 0;
+    if (allKeys.load(std::memory_order_relaxed))
+      return true;
+    if (key < 0 || key >= maxNamedKeys)
+      return false;
+    return (keyBits[key / 64].load(std::memory_order_relaxed) >> (key % 64)) & 1;
   }
-};
-
-struct ParameterChangeEvent
-{
-  int key;
-  int parameterIndex;
-  float value;
-  uint64_t atBlock;  // Block number when event occurred
-};
-
-struct MidiNoteEvent
-{
-  int noteNumber;
-  int velocity;  // 0-127, or 0 for note off
-  int channel;
-  bool isNoteOn;
-  uint64_t samplePosition;  // Sample position when event occurred
-};
-
-struct MidiCCEvent
-{
-  int controller;
-  int value;  // 0-127
-  int channel;
-  uint64_t atBlock;  // Block number when event occurred
-};
 
-class LockFreeParameterQueue
-{
-private:
-  static constexpr size_t QUEUE_SIZE = 1000000;
-  std::array<ParameterChangeEvent, QUEUE_SIZE> queue;
-  std::atomic<size_t> writeIndex{0};
-  std::atomic<size_t> readIndex{0};
+  // For the MIDI streams: subscribed, and within the stream's rate. The limit is a generic cell rate
+  // algorithm, one atomic per stream, allowing bursts of a tenth of a second's worth (a chord) at once.
+  bool admit(NotificationStream stream)
+  {
+    if (!wants(stream))
+      return false;
+    auto& limit = limits[size_t(stream)];
+    int64_t interval = limit.intervalNs.load(std::memory_order_relaxed);
+    if (interval == 0)
+      return true;
+    int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t tolerance = limit.toleranceNs.load(std::memory_order_relaxed);
+    int64_t arrival = limit.theoreticalArrival.load(std::memory_order_relaxed);
+    int64_t start;
+    do
+    {
+      start = std::max(arrival, now);
+      if (start - now > tolerance)
+        return false;
+    } while (!limit.theoreticalArrival.compare_exchange_weak(arrival, start + interval, std::memory_order_relaxed));
+    return true;
+  }
 
-public:
-  // Called from audio thread (fast, lock-free)
-  bool push(const ParameterChangeEvent& event)
+  // The parameter stream isn't thinned at the source, since the latest value must always arrive; instead
+  // flushNotifications holds coalesced changes back until this long after the last ones went out
+  chrono::nanoseconds parameterInterval() const
   {
-    size_t currentWrite = writeIndex.load();
-    size_t nextWrite = (currentWrite + 1) % QUEUE_SIZE;
+    return chrono::nanoseconds(limits[size_t(NotificationStream::params)].intervalNs.load(std::memory_order_relaxed));
+  }
 
-    if (nextWrite == readIndex.load())
+  // rates are events per second for each stream, 0 for no limit. An empty keys list means every plugin.
+  void subscribe(uint32_t streamMask, const vector<int>& keys, const float* rates)
+  {
+    for (size_t i = 0; i < size_t(NotificationStream::count); ++i)
     {
-      return false; // Queue full
+      int64_t interval = rates[i] > 0 ? int64_t(1e9 / rates[i]) : 0;
+      int64_t burst = std::max<int64_t>(1, int64_t(rates[i] / 10));
+      limits[i].intervalNs.store(interval, std::memory_order_relaxed);
+      limits[i].toleranceNs.store(interval * (burst - 1), std::memory_order_relaxed);
+      limits[i].theoreticalArrival.store(0, std::memory_order_relaxed);
     }
-
-    queue[currentWrite] = event;
-    writeIndex.store(nextWrite);
-    return true;
+    uint64_t bits[maxNamedKeys / 64] = {};
+    for (int key : keys)
+      if (key >= 0 && key < maxNamedKeys)
+        bits[key / 64] |= uint64_t(1) << (key % 64);
+    for (size_t i = 0; i < keyBits.size(); ++i)
+      keyBits[i].store(bits[i], std::memory_order_relaxed);
+    allKeys.store(keys.empty(), std::memory_order_relaxed);
+    streams.store(streamMask, std::memory_order_relaxed);
   }
 
-  // Called from main thread
-  bool pop(ParameterChangeEvent& event)
+  // Lets through whatever any of filters does, without rate limits: those apply per client
+  void combine(const vector<const NotificationFilter*>& filters)
   {
-    size_t currentRead = readIndex.load();
-    if (currentRead == writeIndex.load())
+    uint32_t streamMask = 0;
+    bool anyKey = false;
+    uint64_t bits[maxNamedKeys / 64] = {};
+    for (auto* filter : filters)
     {
-      return false; // Queue empty
+      streamMask |= filter->streams.load(std::memory_order_relaxed);
+      if (!filter->wants(NotificationStream::params))
+        continue;  // Keys only narrow the parameter stream
+      anyKey = anyKey || filter->allKeys.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < keyBits.size(); ++i)
+        bits[i] |= filter->keyBits[i].load(std::memory_order_relaxed);
     }
-    event = queue[currentRead];
-    readIndex.store((currentRead + 1) % QUEUE_SIZE);
-    return true;
+    for (auto& limit : limits)
+    {
+      limit.intervalNs.store(0, std::memory_order_relaxed);
+      limit.toleranceNs.store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < keyBits.size(); ++i)
+      keyBits[i].store(bits[i], std::memory_order_relaxed);
+    allKeys.store(anyKey, std::memory_order_relaxed);
+    streams.store(streamMask, std::memory_order_relaxed);
   }
-};
 
-template<typename T>
-class LockFreeMidiQueue
-{
 private:
-  static constexpr size_t QUEUE_SIZE = 100000;
-  std::array<T, QUEUE_SIZE> queue;
-  std::atomic<size_t> writeIndex{0};
-  std::atomic<size_t> readIndex{0};
-
-public:
-  // Called from audio thread (fast, lock-free)
-  bool push(const T& event)
+  struct RateLimit
   {
-    size_t currentWrite = writeIndex.load();
-    size_t nextWrite = (currentWrite + 1) % QUEUE_SIZE;
-
-    if (nextWrite == readIndex.load())
-    {
-      return false; // Queue full
-    }
+    std::atomic<int64_t> intervalNs{ 0 };          // Time per event at the stream's rate; 0 for unlimited
+    std::atomic<int64_t> toleranceNs{ 0 };         // How far ahead of the rate a burst may run
+    std::atomic<int64_t> theoreticalArrival{ 0 };  // When the stream will be back within its rate
+  };
+  std::atomic<uint32_t> streams{ (1u << uint32_t(NotificationStream::count)) - 1 };  // Everything until the client subscribes
+  std::atomic<bool> allKeys{ true };
+  std::array<std::atomic<uint64_t>, maxNamedKeys / 64> keyBits{};
+  RateLimit limits[size_t(NotificationStream::count)];
+};
 
-    queue[currentWrite] = event;
-    writeIndex.store(nextWrite);
-    return true;
-  }
+// One recipient of notification batches: the pipe client or a socket client. Parameter changes it isn't
+// due for yet, under its parameter rate, wait in heldParameters, coalesced. Only the notification thread
+// touches anything but the filter.
+struct NotificationSubscriber
+{
+  NotificationFilter filter;
+  vector<ParamChangeRecord> heldParameters;
+  unordered_map<uint64_t, size_t> heldIndex;  // (key << 32 | parameterIndex) -> position in heldParameters
+  chrono::steady_clock::time_point parametersDue;
 
-  // Called from main thread
-  bool pop(T& event)
+  void holdParameter(const ParamChangeRecord& record)
   {
-    size_t currentRead = readIndex.load();
-    if (currentRead == writeIndex.load())
-    {
-      return false; // Queue empty
-    }
-    event = queue[currentRead];
-    readIndex.store((currentRead + 1) % QUEUE_SIZE);
-    return true;
+    uint64_t id = (uint64_t(uint32_t(record.key)) << 32) | uint32_t(record.parameterIndex);
+    auto [it, inserted] = heldIndex.try_emplace(id, heldParameters.size());
+    if (inserted)
+      heldParameters.push_back(record);
+    else
+      heldParameters[it->second] = record;
   }
 };
 
+NotificationFilter notificationFilter;  // Every client's subscription combined
 LockFreeParameterQueue parameterQueue;
 LockFreeMidiQueue<MidiNoteEvent> midiNoteQueue;
 LockFreeMidiQueue<MidiCCEvent> midiCCQueue;
@@ -722,7 +4586,9 @@ public:
     cout << "Added VST3 format" << endl;
     processorGraph = std::make_unique<juce::AudioProcessorGraph>();
 
-#ifdef _WIN32
+#ifdef JUCE_ENGINE_MODULE
+    // Built into the in-process Python module or a benchmark: the engine is called directly, there are no pipes
+#elif defined(_WIN32)
     // Windows named pipe
     cout << "creating pipe" << endl;
     string commandPipeName = "\\\\.\\pipe\\" + pipeName + "_commands";  // Python -> C++
@@ -800,6 +4666,9 @@ public:
 #if JUCE_PLUGINHOST_AU && (JUCE_MAC || JUCE_IOS) //todo: what about Linux?
     formatManager.addFormat(new juce::AudioUnitPluginFormat());
 #endif
+    // Created up front so events can be scheduled before the first start_playback
+    midiScheduler = std::make_unique<MidiScheduler>(sampleRate);
+
     cout << "startTimer(" << updateRate << ")" << endl;
     startTimer(updateRate);
     scheduler.setHost(this);
@@ -810,6 +4679,13 @@ public:
   }
 
   BlockLevelScheduler scheduler;
+  AutomationRecorder automationRecorder;
+  // The block being rendered: where it starts on the timeline and when it started, so a parameter moved
+  // from an editor between device callbacks is recorded where it was heard. The pair is published under a
+  // sequence count, odd while the rendering thread is writing it, so readers never mix two blocks
+  atomic<uint32_t> blockStartSequence{ 0 };
+  atomic<int64_t> blockStartSample{ 0 };
+  atomic<int64_t> blockStartNanos{ 0 };
   int inputIndex = -2;
   int outputIndex = -1;
   bool audioInitialized = false;
@@ -841,7 +4717,8 @@ public:
     stopTimer();
     shutdownAudio();
     processorGraph = nullptr;
-#ifdef _WIN32
+#ifdef JUCE_ENGINE_MODULE
+#elif defined(_WIN32)
     CloseHandle(hCommandPipe);
     CloseHandle(hNotificationPipe);
 #else
@@ -855,6 +4732,103 @@ public:
   unordered_map<int, juce::AudioProcessorGraph::NodeID> loadedPlugins; 
   atomic<bool> running = true;
 
+  // Every loaded plugin's parameters by handle, for the paths that set parameters often: scheduled changes,
+  // CC mappings and set_parameters_by_handle. A plugin's parameters get consecutive handles when it's loaded
+  // and keep them until it's removed, so a client resolves them once with get_parameter_handles. Copied and
+  // swapped in whole when the graph changes, under hostMutex, so readers never see one half built
+  struct ParameterHandles
+  {
+    vector<juce::AudioProcessorParameter*> parameters;    // handle -> parameter; null once its plugin is removed
+    unordered_map<int, pair<uint32_t, uint32_t>> plugins;  // key -> (first handle, number of parameters)
+
+    juce::AudioProcessorParameter* get(uint32_t handle) const
+    {
+      return handle < parameters.size() ? parameters[handle] : nullptr;
+    }
+
+    juce::AudioProcessorParameter* find(int key, int parameterIndex) const
+    {
+      auto it = plugins.find(key);
+      if (it == plugins.end() || parameterIndex < 0 || uint32_t(parameterIndex) >= it->second.second)
+        return nullptr;
+      return parameters[it->second.first + uint32_t(parameterIndex)];
+    }
+
+    void remove(int key)
+    {
+      auto it = plugins.find(key);
+      if (it == plugins.end())
+        return;
+      fill_n(parameters.begin() + it->second.first, it->second.second, nullptr);
+      plugins.erase(it);
+    }
+  };
+  // The table readers see is published through a plain atomic pointer. Readers on the audio and MIDI input
+  // threads pin it with PinnedParameterHandles, which only counts them in and out of the current epoch;
+  // publishParameterHandles flips the epoch and waits for the old one's readers to leave before freeing the
+  // old table on the command thread, so nothing is freed on the audio thread and a removed plugin's
+  // parameters are out of every reader's hands before its node is destroyed
+  unique_ptr<const ParameterHandles> ownedParameterHandles = make_unique<ParameterHandles>();
+  atomic<const ParameterHandles*> parameterHandles{ ownedParameterHandles.get() };
+  atomic<uint32_t> parameterHandleEpoch{ 0 };
+  atomic<int> parameterHandleReaders[2] = {};  // Readers inside each epoch, by its parity
+
+  class PinnedParameterHandles
+  {
+  public:
+    explicit PinnedParameterHandles(CompletePluginHost& host)
+    {
+      for (;;)
+      {
+        uint32_t parity = host.parameterHandleEpoch.load() & 1;
+        readers = &host.parameterHandleReaders[parity];
+        readers->fetch_add(1);
+        if ((host.parameterHandleEpoch.load() & 1) == parity)
+          break;
+        readers->fetch_sub(1);  // The epoch flipped under us, and its writer may already have stopped waiting
+      }
+      handles = host.parameterHandles.load();
+    }
+    ~PinnedParameterHandles() { readers->fetch_sub(1); }
+    PinnedParameterHandles(const PinnedParameterHandles&) = delete;
+    PinnedParameterHandles& operator=(const PinnedParameterHandles&) = delete;
+
+    const ParameterHandles* operator->() const { return handles; }
+
+  private:
+    atomic<int>* readers;
+    const ParameterHandles* handles;
+  };
+
+  // Holding hostMutex. Returns once no reader can still be using the old table or its parameters
+  void publishParameterHandles(unique_ptr<const ParameterHandles> handles)
+  {
+    parameterHandles.store(handles.get());
+    uint32_t oldParity = parameterHandleEpoch.fetch_add(1) & 1;
+    while (parameterHandleReaders[oldParity].load() > 0)
+      this_thread::yield();
+    ownedParameterHandles = move(handles);
+  }
+
+  // Holding hostMutex, after a plugin is added to the graph under key
+  void addParameterHandles(int key, juce::AudioProcessor* processor)
+  {
+    auto handles = make_unique<ParameterHandles>(*ownedParameterHandles);
+    handles->remove(key);
+    const auto& parameters = processor->getParameters();
+    handles->plugins[key] = { uint32_t(handles->parameters.size()), uint32_t(parameters.size()) };
+    handles->parameters.insert(handles->parameters.end(), parameters.begin(), parameters.end());
+    publishParameterHandles(move(handles));
+  }
+
+  // Holding hostMutex, before key's plugin leaves the graph. Its handles aren't reused until every plugin is cleared
+  void removeParameterHandles(int key)
+  {
+    auto handles = make_unique<ParameterHandles>(*ownedParameterHandles);
+    handles->remove(key);
+    publishParameterHandles(move(handles));
+  }
+
 #define WRITEALLC(...) writeAllc(__VA_ARGS__)
 #define WRITEALLN(...) writeAlln(__VA_ARGS__)
 
@@ -871,120 +4845,161 @@ public:
     }
   }
 
-  // Add this method to queue notifications for the command thread
+  // Called from whichever thread changed the parameter. A change to a parameter that already has one
+  // waiting replaces it, so dragging a knob sends at most one value per batch.
   void queueParameterNotification(const ParameterChangeEvent& event) 
   {
-    cout << "queing parameter notification" << endl;
-
-    lock_guard<std::mutex> lock(notificationMutex);
-    pendingNotifications.push(event);
-  }
-
-  // Call this from command thread instead
-  void sendQueuedParameterNotifications() {
-    std::lock_guard<std::mutex> lock(notificationMutex);
-    while (!pendingNotifications.empty())
     {
-      const auto& event = pendingNotifications.front();
-      cout << "sending parameter notification" << " key: " << event.key << " parameterIndex: " << event.parameterIndex << " value: " << event.value << " atBlock: " << event.atBlock << endl;
-      WRITEALLN(param_changed, event.key, event.parameterIndex, event.value, event.atBlock);
-#ifdef _WIN32
-      if (GetLastError() == ERROR_BROKEN_PIPE) {
-        // Pipe disconnected
-        notificationPipeReady = false;
-      }
-#else
-      if (errno == EPIPE) {
-        // Pipe disconnected (broken pipe)
-        notificationPipeReady = false;
-      }
-#endif
-      if (notificationPipeReady)
-        pendingNotifications.pop();
+      lock_guard<std::mutex> lock(notificationMutex);
+      uint64_t id = (uint64_t(uint32_t(event.key)) << 32) | uint32_t(event.parameterIndex);
+      auto [it, inserted] = pendingParameterIndex.try_emplace(id, pendingParameterChanges.size());
+      if (inserted)
+        pendingParameterChanges.push_back(event);
       else
-        cout << "notificationPipeReady = false" << endl; //could probably confuse this with an error generated by the command pipe failing!
+        pendingParameterChanges[it->second] = event;
+      notificationsPending = true;
     }
+    notificationReady.notify_one();
   }
 
-  void sendQueuedMidiNotifications() {
-    // Send MIDI note events
-    MidiNoteEvent noteEvent;
-    while (midiNoteQueue.pop(noteEvent))
+  // Call after pushing to one of the MIDI notification queues
+  void wakeNotificationThread()
+  {
     {
-      if (!notificationPipeReady) break;
-      WRITEALLN(midi_note_event, noteEvent.noteNumber, noteEvent.velocity,
-                noteEvent.channel, uint32_t(noteEvent.isNoteOn), noteEvent.samplePosition);
-#ifdef _WIN32
-      if (GetLastError() == ERROR_BROKEN_PIPE) {
-        notificationPipeReady = false;
-        break;
-      }
-#else
-      if (errno == EPIPE) {
-        notificationPipeReady = false;
-        break;
-      }
-#endif
+      lock_guard<std::mutex> lock(notificationMutex);
+      notificationsPending = true;
     }
+    notificationReady.notify_one();
+  }
+
+  template<typename Record, typename Event, typename Queue, typename Convert>
+  static void drainQueue(Queue& queue, vector<Record>& records, Convert&& convert)
+  {
+    records.clear();
+    Event event;
+    while (queue.pop(event))
+      records.push_back(convert(event));
+  }
+
+  template<typename Record>
+  void writeRecords(const vector<Record>& records)
+  {
+    notificationFrame.write(uint32_t(records.size()));
+    notificationFrame.append(records.data(), records.size() * sizeof(Record));
+  }
 
-    // Send MIDI CC events
-    MidiCCEvent ccEvent;
-    while (midiCCQueue.pop(ccEvent))
+  // Sends everything queued since the last flush to each subscriber as one notification_batch frame,
+  // filtered by what it subscribed to. The frame holds a uint32 count followed by packed records for each
+  // of: parameter changes, MIDI notes, MIDI CCs, virtual keyboard notes and virtual keyboard CCs.
+  void flushNotifications()
+  {
     {
-      if (!notificationPipeReady) break;
-      WRITEALLN(midi_cc_event, ccEvent.controller, ccEvent.value, ccEvent.channel, ccEvent.atBlock);
-#ifdef _WIN32
-      if (GetLastError() == ERROR_BROKEN_PIPE) {
-        notificationPipeReady = false;
-        break;
-      }
-#else
-      if (errno == EPIPE) {
-        notificationPipeReady = false;
-        break;
-      }
-#endif
+      lock_guard<std::mutex> lock(notificationMutex);
+      batchParameterChanges.clear();
+      batchParameterChanges.swap(pendingParameterChanges);
+      pendingParameterIndex.clear();
+      notificationsPending = false;
     }
 
-    // Send virtual keyboard note events (separate from physical keyboard)
-    MidiNoteEvent virtualNoteEvent;
-    while (virtualKeyboardNoteQueue.pop(virtualNoteEvent))
-    {
-      if (!notificationPipeReady) break;
-      WRITEALLN(virtual_keyboard_note_event, virtualNoteEvent.noteNumber, virtualNoteEvent.velocity,
-                virtualNoteEvent.channel, uint32_t(virtualNoteEvent.isNoteOn), virtualNoteEvent.samplePosition);
-#ifdef _WIN32
-      if (GetLastError() == ERROR_BROKEN_PIPE) {
-        notificationPipeReady = false;
-        break;
+    paramRecords.clear();
+    for (auto& event : batchParameterChanges)
+      paramRecords.push_back({ int32_t(event.key), int32_t(event.parameterIndex), event.value, event.atBlock });
+    auto noteRecord = [](const MidiNoteEvent& e) {
+      return MidiNoteRecord{ uint32_t(e.noteNumber), uint32_t(e.velocity), uint32_t(e.channel), uint32_t(e.isNoteOn), e.samplePosition };
+    };
+    auto ccRecord = [](const MidiCCEvent& e) {
+      return MidiCCRecord{ uint32_t(e.controller), uint32_t(e.value), uint32_t(e.channel), e.atBlock };
+    };
+    drainQueue<MidiNoteRecord, MidiNoteEvent>(midiNoteQueue, noteRecords, noteRecord);
+    drainQueue<MidiCCRecord, MidiCCEvent>(midiCCQueue, ccRecords, ccRecord);
+    drainQueue<MidiNoteRecord, MidiNoteEvent>(virtualKeyboardNoteQueue, virtualNoteRecords, noteRecord);
+    drainQueue<MidiCCRecord, MidiCCEvent>(virtualKeyboardCCQueue, virtualCCRecords, ccRecord);
+
+    auto now = chrono::steady_clock::now();
+    bool held = false;
+    auto due = chrono::steady_clock::time_point::max();
+    auto noteHeld = [&](const NotificationSubscriber& subscriber) {
+      if (!subscriber.heldParameters.empty())
+      {
+        held = true;
+        due = std::min(due, subscriber.parametersDue);
       }
-#else
-      if (errno == EPIPE) {
-        notificationPipeReady = false;
-        break;
+    };
+    {
+      std::lock_guard<std::mutex> lock(notificationWriteMutex);
+      if (writeNotificationBatch(pipeSubscriber, now))
+        sendPipeNotificationFrame();
+      noteHeld(pipeSubscriber);
+#ifdef SOCKET_SERVER_SUPPORTED
+      std::lock_guard<std::mutex> clientsLock(socketClientsMutex);
+      for (auto& [id, client] : socketClients)
+      {
+        if (!client->notifications)
+          continue;
+        if (writeNotificationBatch(client->subscriber, now))
+          sendOnSocket(*client->notifications, notificationFrame);
+        noteHeld(client->subscriber);
       }
 #endif
     }
 
-    // Send virtual keyboard CC events (for future use)
-    MidiCCEvent virtualCCEvent;
-    while (virtualKeyboardCCQueue.pop(virtualCCEvent))
+    lock_guard<std::mutex> lock(notificationMutex);
+    parametersHeld = held;
+    parametersDue = due;
+  }
+
+  // Builds subscriber's notification_batch in notificationFrame from this flush's records: the streams and
+  // keys it subscribed to, MIDI thinned to its rates, and parameter changes once its parameter interval is
+  // up. False if there's nothing for it. Caller holds notificationWriteMutex
+  bool writeNotificationBatch(NotificationSubscriber& subscriber, chrono::steady_clock::time_point now)
+  {
+    auto& filter = subscriber.filter;
+    if (filter.wants(NotificationStream::params))
+      for (auto& record : paramRecords)
+        if (filter.wantsKey(record.key))
+          subscriber.holdParameter(record);
+    subscriberParamRecords.clear();
+    if (!subscriber.heldParameters.empty() && now >= subscriber.parametersDue)
     {
-      if (!notificationPipeReady) break;
-      WRITEALLN(virtual_keyboard_cc_event, virtualCCEvent.controller, virtualCCEvent.value,
-                virtualCCEvent.channel, virtualCCEvent.atBlock);
-#ifdef _WIN32
-      if (GetLastError() == ERROR_BROKEN_PIPE) {
-        notificationPipeReady = false;
-        break;
-      }
-#else
-      if (errno == EPIPE) {
-        notificationPipeReady = false;
-        break;
-      }
-#endif
+      subscriberParamRecords.swap(subscriber.heldParameters);
+      subscriber.heldIndex.clear();
+      subscriber.parametersDue = now + filter.parameterInterval();
     }
+    auto admit = [&filter](const auto& records, auto& admitted, NotificationStream stream) {
+      admitted.clear();
+      for (auto& record : records)
+        if (filter.admit(stream))
+          admitted.push_back(record);
+    };
+    admit(noteRecords, subscriberNoteRecords, NotificationStream::midi_notes);
+    admit(ccRecords, subscriberCCRecords, NotificationStream::midi_ccs);
+    admit(virtualNoteRecords, subscriberVirtualNoteRecords, NotificationStream::virtual_notes);
+    admit(virtualCCRecords, subscriberVirtualCCRecords, NotificationStream::virtual_ccs);
+    if (subscriberParamRecords.empty() && subscriberNoteRecords.empty() && subscriberCCRecords.empty()
+      && subscriberVirtualNoteRecords.empty() && subscriberVirtualCCRecords.empty())
+      return false;
+
+    notificationFrame.clear();
+    notificationFrame.write(uint8_t(notification_batch));
+    writeRecords(subscriberParamRecords);
+    writeRecords(subscriberNoteRecords);
+    writeRecords(subscriberCCRecords);
+    writeRecords(subscriberVirtualNoteRecords);
+    writeRecords(subscriberVirtualCCRecords);
+    return true;
+  }
+
+  // Subscriptions changed, or a socket client's notification stream came or went. Under
+  // SOCKET_SERVER_SUPPORTED the caller holds socketClientsMutex
+  void combineSubscriptions()
+  {
+    vector<const NotificationFilter*> filters{ &pipeSubscriber.filter };
+#ifdef SOCKET_SERVER_SUPPORTED
+    for (auto& [id, client] : socketClients)
+      if (client->notifications)
+        filters.push_back(&client->subscriber.filter);
+#endif
+    notificationFilter.combine(filters);
   }
 
   void setupAudioIO()
@@ -1033,6 +5048,13 @@ public:
     std::cout << "initialise: end, app=" << app << std::endl;
 
     notificationThread = thread([this]() { notificationLoop(); });
+    slowCommandThread = thread([this]() { commandWorkerLoop(slowCommands, HostLock::none); });
+#ifdef SOCKET_SERVER_SUPPORTED
+    engineCommandThread = thread([this]() { commandWorkerLoop(engineCommands, HostLock::exclusive); });
+    for (auto& queryThread : queryThreads)
+      queryThread = thread([this]() { commandWorkerLoop(queryCommands, HostLock::shared); });
+    socketServerThread = thread([this]() { socketServerLoop(); });
+#endif
   }
 
 
@@ -1061,21 +5083,12 @@ public:
 
   void setPluginParameter(int key, int parameterIndex, float value) 
   {
-    auto it = loadedPlugins.begin();
-    advance(it, key);  // Move iterator to key position
-    if (it != loadedPlugins.end()) 
+    PinnedParameterHandles handles(*this);
+    if (auto* parameter = handles->find(key, parameterIndex))
     {
-      auto node = processorGraph->getNodeForId(it->second);
-      if (node && node->getProcessor()) 
-      {
-        auto* processor = node->getProcessor();
-        if (parameterIndex >= 0 && parameterIndex < processor->getParameters().size()) 
-        {
-          suppressNotifications = true;  // Prevent recording our own changes
-          processor->getParameters()[parameterIndex]->setValue(value);
-          suppressNotifications = false;
-        }
-      }
+      suppressNotifications = true;  // Prevent recording our own changes
+      parameter->setValue(value);
+      suppressNotifications = false;
     }
   }
 
@@ -1083,11 +5096,32 @@ public:
   {
     running = false;
     commandCv.notify_all();
+    notificationReady.notify_all();
+    wakeCommandWorkers(slowCommands);
+    {
+      std::lock_guard<std::mutex> lock(commandOrderMutex);
+      commandFinished.notify_all();
+    }
+#ifdef SOCKET_SERVER_SUPPORTED
+    wakeCommandWorkers(engineCommands);
+    wakeCommandWorkers(queryCommands);
+#endif
 
     if (commandThread.joinable())
       commandThread.join();
     if (notificationThread.joinable()) 
       notificationThread.join();
+    if (slowCommandThread.joinable())
+      slowCommandThread.join();
+#ifdef SOCKET_SERVER_SUPPORTED
+    if (socketServerThread.joinable())
+      socketServerThread.join();
+    if (engineCommandThread.joinable())
+      engineCommandThread.join();
+    for (auto& queryThread : queryThreads)
+      if (queryThread.joinable())
+        queryThread.join();
+#endif
 
     // Close all plugin windows
     for (auto& pair : pluginWindows)
@@ -1105,7 +5139,7 @@ public:
     juce::MidiMessage routedMessage = message;
 
     // Send MIDI note events to VIRTUAL KEYBOARD notification queue (separate from physical keyboard)
-    if (message.isNoteOn() || message.isNoteOff())
+    if ((message.isNoteOn() || message.isNoteOff()) && notificationFilter.admit(NotificationStream::virtual_notes))
     {
       MidiNoteEvent noteEvent;
       noteEvent.noteNumber = message.getNoteNumber();
@@ -1114,6 +5148,7 @@ public:
       noteEvent.isNoteOn = message.isNoteOn();
       noteEvent.samplePosition = currentSamplePosition;
       virtualKeyboardNoteQueue.push(noteEvent);  // Push to virtual keyboard queue, not regular MIDI queue
+      wakeNotificationThread();
     }
 
     // Handle virtual keyboard routing for notes
@@ -1531,14 +5566,18 @@ public:
     bool shouldRouteToPlugin = false;
     juce::MidiMessage routedMessage = message;
 
-    MidiNoteEvent noteEvent;
-    noteEvent.noteNumber = message.getNoteNumber();
-    noteEvent.velocity = routedMessage.getVelocity();
-    noteEvent.channel = message.getChannel();
-    noteEvent.isNoteOn = message.isNoteOn();
-    noteEvent.samplePosition = currentSamplePosition;
+    if ((message.isNoteOn() || message.isNoteOff()) && notificationFilter.admit(NotificationStream::midi_notes))
+    {
+      MidiNoteEvent noteEvent;
+      noteEvent.noteNumber = message.getNoteNumber();
+      noteEvent.velocity = routedMessage.getVelocity();
+      noteEvent.channel = message.getChannel();
+      noteEvent.isNoteOn = message.isNoteOn();
+      noteEvent.samplePosition = currentSamplePosition;
 
-    midiNoteQueue.push(noteEvent);
+      midiNoteQueue.push(noteEvent);
+      wakeNotificationThread();
+    }
 
     // Check if ordered playback is active
     if (orderedPlaybackActive)
@@ -1603,51 +5642,29 @@ public:
       int channel = message.getChannel();
 
       // Queue CC notification event
-      MidiCCEvent ccEvent;
-      ccEvent.controller = cc;
-      ccEvent.value = value;
-      ccEvent.channel = channel;
-      ccEvent.atBlock = scheduler.getCurrentBlock() + 1;  // Effect takes place in next block
-      midiCCQueue.push(ccEvent);
-
-      // Apply CC to parameter mappings
-      for (const auto& mapping : ccMappings)
-      {
-        if (mapping.ccController == cc &&
-            (mapping.midiChannel == -1 || mapping.midiChannel == channel))
+      if (notificationFilter.admit(NotificationStream::midi_ccs))
+      {
+        MidiCCEvent ccEvent;
+        ccEvent.controller = cc;
+        ccEvent.value = value;
+        ccEvent.channel = channel;
+        ccEvent.atBlock = scheduler.getCurrentBlock() + 1;  // Effect takes place in next block
+        midiCCQueue.push(ccEvent);
+        wakeNotificationThread();
+      }
+
+      // Apply CC to parameter mappings. setValue takes the normalized 0-1 value whatever the parameter's range
+      if (!ccMappings.empty())
+      {
+        PinnedParameterHandles handles(*this);
+        float normalizedValue = value / 127.0f;
+        for (const auto& mapping : ccMappings)
         {
-          auto it = loadedPlugins.find(mapping.key);
-          if (it != loadedPlugins.end())
+          if (mapping.ccController == cc &&
+              (mapping.midiChannel == -1 || mapping.midiChannel == channel))
           {
-            auto node = processorGraph->getNodeForId(it->second);
-            if (node && node->getProcessor())
-            {
-              auto* processor = node->getProcessor();
-              const auto& params = processor->getParameters();
-
-              if (mapping.parameterIndex >= 0 && mapping.parameterIndex < params.size())
-              {
-                auto* param = params[mapping.parameterIndex];
-
-                // Normalize CC value (0-127) to 0.0-1.0
-                float normalizedValue = value / 127.0f;
-
-                // If it's a RangedAudioParameter, we can use the range
-                if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*>(param))
-                {
-                  auto range = rangedParam->getNormalisableRange();
-                  // Convert normalized value to actual parameter value using the range
-                  float actualValue = range.convertFrom0to1(normalizedValue);
-                  // Set the parameter (setValue expects normalized 0-1 value)
-                  param->setValue(normalizedValue);
-                }
-                else
-                {
-                  // For non-ranged parameters, just use the normalized value
-                  param->setValue(normalizedValue);
-                }
-              }
-            }
+            if (auto* param = handles->find(mapping.key, mapping.parameterIndex))
+              param->setValue(normalizedValue);
           }
         }
       }
@@ -1658,19 +5675,59 @@ public:
       midiCollector->addMessageToQueue(message);
   }
 
-  void processScheduledEvents()  // Called from audio thread
+  // Audio thread, around each block the device renders, so the MIDI source nodes read scheduled MIDI for it
+  // and, while playing, scheduled parameter changes and automation go out at its start. The device's
+  // blocks aren't split: a change inside one goes out at the start of the next
+  void beginAudioBlock()
   {
     if (isPlaying)
-    {
       scheduler.processScheduledChanges();
+    midiScheduler->beginBlock();
+    markBlockStart();
+  }
+
+  // Rendering thread only
+  void markBlockStart()
+  {
+    uint32_t sequence = blockStartSequence.load(std::memory_order_relaxed);
+    blockStartSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    blockStartSample.store(scheduler.getPosition(), std::memory_order_relaxed);
+    blockStartNanos.store(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count(),
+      std::memory_order_relaxed);
+    blockStartSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Where playback is now, to the sample, within the block being rendered. Any thread
+  int64_t samplePositionNow()
+  {
+    int64_t startSample, startNanos;
+    uint32_t before, after;
+    do
+    {
+      before = blockStartSequence.load(std::memory_order_acquire);
+      startSample = blockStartSample.load(std::memory_order_relaxed);
+      startNanos = blockStartNanos.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = blockStartSequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    int64_t elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count() - startNanos;
+    int64_t into = int64_t(double(max<int64_t>(0, elapsed)) * midiScheduler->getSampleRate() / 1e9);
+    return startSample + min<int64_t>(into, blockSize - 1);
+  }
 
+  void endAudioBlock(int numSamples)
+  {
+    midiScheduler->endBlock(numSamples);
+    if (isPlaying)
+    {
       // Check if we've reached the end
       if (scheduler.getCurrentBlock() >= playbackEndBlock)
       {
         stopPlayback();
       }
 
-      scheduler.incrementBlock();
+      scheduler.endBlock(numSamples);
     }
   }
 
@@ -1678,226 +5735,625 @@ public:
 
   bool offlineMode = true;
   uint64_t playbackEndBlock = 0;
-  queue<ParameterChangeEvent> pendingNotifications;
+  // Parameter changes waiting for the next batch, one per (key, parameterIndex); guarded by notificationMutex
+  vector<ParameterChangeEvent> pendingParameterChanges;
+  unordered_map<uint64_t, size_t> pendingParameterIndex;  // (key << 32 | parameterIndex) -> position in pendingParameterChanges
+  bool notificationsPending = false;
+  bool parametersHeld = false;                   // A subscriber's parameter changes are waiting out its rate limit
+  chrono::steady_clock::time_point parametersDue;  // When the first of those may go out
   mutex notificationMutex;
+  condition_variable notificationReady;
+  // Reused by flushNotifications on the notification thread
+  vector<ParameterChangeEvent> batchParameterChanges;
+  vector<ParamChangeRecord> paramRecords;
+  vector<MidiNoteRecord> noteRecords;
+  vector<MidiCCRecord> ccRecords;
+  vector<MidiNoteRecord> virtualNoteRecords;
+  vector<MidiCCRecord> virtualCCRecords;
+  // The part of those that goes to one subscriber
+  vector<ParamChangeRecord> subscriberParamRecords;
+  vector<MidiNoteRecord> subscriberNoteRecords;
+  vector<MidiCCRecord> subscriberCCRecords;
+  vector<MidiNoteRecord> subscriberVirtualNoteRecords;
+  vector<MidiCCRecord> subscriberVirtualCCRecords;
+  NotificationSubscriber pipeSubscriber;
+
+  FrameReader commandFrame;        // Current command, decoded in place from the pipe's read buffer
+  FrameWriter commandReply;        // Reply to the current command, sent as one frame
+  mutex replyWriteMutex;
+  FrameWriter notificationFrame;   // Reused for every notification, guarded by notificationWriteMutex
+  mutex notificationWriteMutex;
+#ifdef SHARED_TRANSPORT_SUPPORTED
+  unique_ptr<SharedTransport> sharedTransport;  // Set while a client is using the shared memory transport
+  bool sharedNotifications = false;             // Guarded by notificationWriteMutex
+  unique_ptr<SharedTransport> offeredTransport; // Sent to the client, waiting for confirm_shared_transport
+  chrono::steady_clock::time_point offeredTransportDeadline;
+  static constexpr int sharedTransportConfirmSeconds = 10;
+#endif
+
+  // Write a complete frame to a pipe handle. A frame whose pieces all live in the writer's arena is
+  // already contiguous and goes out in one call; frames with external blobs are gathered.
+#ifdef _WIN32
+  void writeFrame(HANDLE pipe, FrameWriter& frame)
+  {
+    // Byte-mode named pipes have no gather write, so coalesce the segments if there's more than one
+    auto& segments = frame.finish();
+    const char* data = segments[0].data;
+    size_t tosend = segments[0].length;
+    if (segments.size() > 1)
+    {
+      data = frame.coalesce();
+      tosend = frame.frameSize();
+    }
+    while (tosend > 0) {
+      DWORD bytesWritten;
+      if (!WriteFile(pipe, data, DWORD(tosend), &bytesWritten, NULL) || bytesWritten == 0) {
+        throw runtime_error("Error writing to pipe (Windows error: " + to_string(GetLastError()) + ")");
+      }
+      tosend -= bytesWritten;
+      data += bytesWritten;
+    }
+  }
+#else
+  void writeFrame(int fd, FrameWriter& frame)
+  {
+    auto& segments = frame.finish();
+    vector<iovec>& iov = frame.scratchIovecs();
+    iov.clear();
+    for (auto& seg : segments)
+      iov.push_back({const_cast<char*>(seg.data), seg.length});
+
+    size_t first = 0;
+    while (first < iov.size()) {
+      ssize_t byteswritten = writev(fd, iov.data() + first, int(iov.size() - first));
+      if (byteswritten <= 0) {
+        throw runtime_error("Error writing to pipe (errno: " + to_string(errno) + ")");
+      }
+      // Skip fully written segments and trim a partially written one
+      size_t n = size_t(byteswritten);
+      while (first < iov.size() && n >= iov[first].iov_len) {
+        n -= iov[first].iov_len;
+        first++;
+      }
+      if (n > 0) {
+        iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + n;
+        iov[first].iov_len -= n;
+      }
+    }
+  }
+#endif
+
+  // Starts the reply to the current command; every reply begins with the request ID
+  void beginReply()
+  {
+    currentCommandReply->clear();
+    currentCommandReply->write(currentRequestId);
+  }
+
+  // Sends the reply to the current command, unless it's already gone out or the client didn't ask for one.
+  // A reply with nothing but the request ID just tells the client the command has finished.
+  void flushReply()
+  {
+    FrameWriter& reply = *currentCommandReply;
+    if (reply.empty())
+      return;
+    if (currentRequestId == 0)
+    {
+      reply.clear();
+      return;
+    }
+#ifdef SOCKET_SERVER_SUPPORTED
+    if (currentClient != 0)
+    {
+      sendToSocketClient(currentClient, reply);
+      reply.clear();
+      return;
+    }
+#endif
+    std::lock_guard<std::mutex> lock(replyWriteMutex);  // The command thread and the slow command worker both reply
+#ifdef SHARED_TRANSPORT_SUPPORTED
+    if (sharedTransport)
+    {
+      sharedTransport->write(SharedTransport::replyRing, reply);
+      reply.clear();
+      return;
+    }
+#endif
+#ifdef _WIN32
+    writeFrame(hCommandPipe, reply);
+#else
+    writeFrame(commandPipe_fd, reply);
+#endif
+    reply.clear();
+  }
+
+  // Overloaded write2 functions; replies accumulate in one frame that's sent when the command finishes
+  inline void write2c(const string& s)
+  {
+    currentCommandReply->writeString(s);
+  }
+
+  template<typename T>
+  inline void write2c(T n)
+  {
+    currentCommandReply->write(n);
+  }
+
+  inline void write2n(const string& s)
+  {
+    notificationFrame.writeString(s);
+  }
+
+  template<typename T>
+  inline void write2n(T n)
+  {
+    notificationFrame.write(n);
+  }
+    
+  template<typename... Args>
+  void writeAllc(Args&&... args) 
+  {
+    ((write2c(std::forward<Args>(args))), ...);  // C++17 fold expression
+  }
+
+  // Each WRITEALLN is one notification and goes out as one frame
+  template<typename... Args>
+  void writeAlln(Args&&... args) 
+  {
+    std::lock_guard<std::mutex> lock(notificationWriteMutex);
+    notificationFrame.clear();
+    ((write2n(std::forward<Args>(args))), ...);  // C++17 fold expression
+    sendNotificationFrame();
+  }
+
+  // Caller holds notificationWriteMutex. Goes to every client
+  void sendNotificationFrame()
+  {
+    sendPipeNotificationFrame();
+#ifdef SOCKET_SERVER_SUPPORTED
+    broadcastToSocketClients(notificationFrame);
+#endif
+  }
+
+  // Caller holds notificationWriteMutex
+  void sendPipeNotificationFrame()
+  {
+    try {
+#ifdef SHARED_TRANSPORT_SUPPORTED
+      if (sharedNotifications)
+        sharedTransport->write(SharedTransport::notificationRing, notificationFrame);
+      else
+#endif
+#ifdef _WIN32
+      writeFrame(hNotificationPipe, notificationFrame);
+#else
+      writeFrame(notificationPipe_fd, notificationFrame);
+#endif
+    } catch (const exception& e) {
+      cout << "Notification write failed: " << e.what() << endl;
+      notificationPipeReady = false;
+    }
+  }
+
+  // Read whatever is available on the command pipe, up to capacity bytes
+  size_t readSomeFromCommandPipe(char* buffer, size_t capacity)
+  {
+#ifdef SHARED_TRANSPORT_SUPPORTED
+    if (sharedTransport)
+      return sharedTransport->readCommands(buffer, capacity);
+#endif
+#ifdef _WIN32
+    DWORD bytesRead;
+    if (!ReadFile(hCommandPipe, buffer, DWORD(capacity), &bytesRead, NULL)) {
+      throw runtime_error("ReadFile failed: " + to_string(GetLastError()));
+    }
+#else
+    ssize_t bytesRead = read(commandPipe_fd, buffer, capacity);
+    if (bytesRead < 0) {
+      throw runtime_error("read failed: " + string(strerror(errno)));
+    }
+#endif
+    if (bytesRead == 0) {
+      throw runtime_error("pipe closed");
+    }
+    return size_t(bytesRead);
+  }
+
+  // Pulls the next command frame off the pipe. Usually this is one read, and a read often picks up
+  // several queued frames at once, which later calls then decode without touching the pipe.
+  void readCommandFrame()
+  {
+    commandFrame.next([this](char* buffer, size_t capacity) {
+      return readSomeFromCommandPipe(buffer, capacity);
+    });
+  }
+
+  // Template function to read any type from the current command frame
+  template<typename T>
+  T readFromPipe() 
+  {
+    return currentCommandFrame->read<T>();
+  }
+
+  // Specialization for strings (reads length-prefixed strings)
+  template<>
+  string readFromPipe<string>() {
+    return currentCommandFrame->readString();
+  }
+
+#define READFROMPIPE(type) readFromPipe<type>()
 
-  int write4c(void* buff, int n)
+#ifdef SHARED_TRANSPORT_SUPPORTED
+  // Called for confirm_shared_transport once the client has mapped the region. The confirm reply is the
+  // last reply on the pipe; it goes out under the reply lock so no worker's reply can land between it and
+  // the switch. The client sends nothing more on the pipe after the confirm, so commands move over with it.
+  // Notifications are marked with an empty frame on the pipe so the client's reader knows where the
+  // pipe's notifications end.
+  void switchToSharedTransport(unique_ptr<SharedTransport> transport)
   {
+    std::lock_guard<std::mutex> replyLock(replyWriteMutex);
+    std::lock_guard<std::mutex> lock(notificationWriteMutex);
 #ifdef _WIN32
-    DWORD bytesWritten;
-    if (WriteFile(hCommandPipe, buff, n, &bytesWritten, NULL)) {
-      return bytesWritten;
-    }
-    return -1;  // Error
+    writeFrame(hCommandPipe, *currentCommandReply);
+#else
+    writeFrame(commandPipe_fd, *currentCommandReply);
+#endif
+    currentCommandReply->clear();
+    sharedTransport = std::move(transport);
+    notificationFrame.clear();
+    try {
+#ifdef _WIN32
+      writeFrame(hNotificationPipe, notificationFrame);
 #else
-    return write(commandPipe_fd, buff, n);
+      writeFrame(notificationPipe_fd, notificationFrame);
 #endif
+    } catch (const exception& e) {
+      cout << "Notification write failed: " << e.what() << endl;
+    }
+    sharedNotifications = true;
+    cout << "Switched to shared memory transport " << sharedTransport->getName() << endl;
   }
+#endif
 
-  int write4n(void* buff, int n)
+  // Back to the pipes for whoever connects next
+  void closeSharedTransport()
   {
-#ifdef _WIN32
-    DWORD bytesWritten;
-    if (WriteFile(hNotificationPipe, buff, n, &bytesWritten, NULL)) {
-      return bytesWritten;
-    }
-    return -1;  // Error
-#else
-    return write(notificationPipe_fd, buff, n);
+#ifdef SHARED_TRANSPORT_SUPPORTED
+    offeredTransport.reset();
+    if (!sharedTransport)
+      return;
+    std::lock_guard<std::mutex> replyLock(replyWriteMutex);
+    std::lock_guard<std::mutex> lock(notificationWriteMutex);
+    sharedNotifications = false;
+    sharedTransport.reset();
+    cout << "Shared memory transport closed" << endl;
 #endif
   }
 
-  void write2c_string(const string& s)
+  // One client's commands that haven't finished, numbered in the order the client sent them. The pipe
+  // client's commands run on the command thread and the slow command worker, a socket client's on any worker.
+  struct ClientCommands
   {
-    int l1 = static_cast<int>(s.length());
-    int l2 = 4 + l1;  // 4 bytes for length + string content
-    int tosend = l2;
+    uint64_t sent = 0;                         // Numbers handed out, by the thread reading the client
+    map<uint64_t, pair<char, int>> unfinished;  // Number -> command and its key, guarded by commandOrderMutex
+  };
 
-    char* buff = new char[l2];
+#ifdef SOCKET_SERVER_SUPPORTED
+  // One Unix socket connection. Writers never block on a slow peer: whatever the socket won't take right
+  // away waits in pending until the epoll thread sees it writable, and a peer that lets more than
+  // maxPendingSocketBytes pile up is disconnected. Only the epoll thread closes fd, under writeMutex.
+  struct SocketConnection
+  {
+    enum Role { unknown, commands, notifications };
+
+    int fd = -1;
+    Role role = unknown;
+    int clientId = 0;
+    vector<char> input;  // Received bytes not yet decoded into frames, epoll thread only
+    mutex writeMutex;
+    vector<char> pending;
+    bool failed = false;
+    shared_ptr<ClientCommands> order = make_shared<ClientCommands>();  // Commands connection only
+  };
 
-    // Copy length as first 4 bytes
-    memcpy(buff, &l1, 4);
-    // Copy string content
-    memcpy(buff + 4, s.c_str(), l1);
+  // A controller: commands and replies on one connection, and its own notification stream on another
+  struct SocketClient
+  {
+    shared_ptr<SocketConnection> commands;
+    shared_ptr<SocketConnection> notifications;  // Null until the client opens its notification connection
+    NotificationSubscriber subscriber;
+  };
 
-    // Send all data, handling partial writes
-    char* current_pos = buff;
-    while (tosend > 0) {
-      int byteswritten = write4c(current_pos, tosend);
-      if (byteswritten > 0) {
-        tosend -= byteswritten;
-        current_pos += byteswritten;
-      }
-      else 
-      {
-#ifdef _WIN32
-        throw runtime_error("Error writing to pipe (Windows error: " + to_string(GetLastError()) + ")");
-#else
-        throw runtime_error("Error writing to pipe (errno: " + to_string(errno) + ")";)
-#endif
-          break;  // Exit on error
-      }
-    }
-    delete[] buff;
-  }
+  static constexpr size_t maxPendingSocketBytes = 16 * 1024 * 1024;
 
- 
-  // Write binary data for non-string types
-  template<typename T>
-  void write2c_binary(T n)
-  {
-    int tosend = sizeof(T);
-    char* current_pos = reinterpret_cast<char*>(&n);
+  string socketPath() const { return "/tmp/" + pipeName + ".sock"; }
 
-    while (tosend > 0) {
-      int byteswritten = write4c(current_pos, tosend);
-      if (byteswritten > 0) {
-        tosend -= byteswritten;
-        current_pos += byteswritten;
-      }
-      else 
-      {
-#ifdef _WIN32
-        throw runtime_error("Error writing to pipe (Windows error: " + to_string(GetLastError()) + ")");
-#else
-        throw runtime_error("Error writing to pipe (errno: " + to_string(errno) + ")";)
-#endif
-          break;  // Exit on error
-      }
-    }
+  void watchSocket(SocketConnection& connection, bool wantWritable)
+  {
+    epoll_event ev{};
+    ev.events = EPOLLIN | (wantWritable ? EPOLLOUT : 0);
+    ev.data.fd = connection.fd;
+    epoll_ctl(socketEpollFd, EPOLL_CTL_MOD, connection.fd, &ev);
   }
 
-  // Write binary data for non-string types
-  template<typename T>
-  void write2n_binary(T n)
+  // Caller holds connection.writeMutex. Sends as much of pending as the socket takes; false on error
+  bool writePendingSocketBytes(SocketConnection& connection)
   {
-    int tosend = sizeof(T);
-    char* current_pos = reinterpret_cast<char*>(&n);
-
-    while (tosend > 0) {
-      int byteswritten = write4n(current_pos, tosend);
-      if (byteswritten > 0) {
-        tosend -= byteswritten;
-        current_pos += byteswritten;
-      }
-      else 
+    size_t sent = 0;
+    while (sent < connection.pending.size())
+    {
+      ssize_t n = send(connection.fd, connection.pending.data() + sent, connection.pending.size() - sent, MSG_NOSIGNAL);
+      if (n < 0)
       {
-#ifdef _WIN32
-        throw runtime_error("Error writing to pipe (Windows error: " + to_string(GetLastError()) + ")");
-#else
-        throw runtime_error("Error writing to pipe (errno: " + to_string(errno) + ")";)
-#endif
-          break;  // Exit on error
+        if (errno == EINTR)
+          continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+          break;
+        return false;
       }
+      sent += size_t(n);
     }
+    connection.pending.erase(connection.pending.begin(), connection.pending.begin() + sent);
+    return true;
   }
-    
-  
-  // Overloaded write2 functions
-  inline void write2c(const string& s)
+
+  // Queues a frame on a connection and sends what the socket takes without waiting. Called from any thread
+  void sendOnSocket(SocketConnection& connection, FrameWriter& frame)
   {
-    write2c_string(s);
+    auto& segments = frame.finish();
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    if (connection.failed)
+      return;
+    bool wasIdle = connection.pending.empty();
+    for (auto& seg : segments)
+      connection.pending.insert(connection.pending.end(), seg.data, seg.data + seg.length);
+    if (wasIdle && !writePendingSocketBytes(connection))
+      connection.failed = true;
+    else if (connection.pending.size() > maxPendingSocketBytes)
+    {
+      cout << "Socket client " << connection.clientId << " isn't keeping up, disconnecting" << endl;
+      connection.failed = true;
+    }
+    if (connection.failed)
+      shutdown(connection.fd, SHUT_RDWR);  // The epoll thread sees the hangup and cleans up
+    else if (wasIdle && !connection.pending.empty())
+      watchSocket(connection, true);
   }
 
-  template<typename T>
-  inline void write2c(T n)
+  void sendToSocketClient(int clientId, FrameWriter& frame)
   {
-    write2c_binary(n);
+    shared_ptr<SocketConnection> connection;
+    {
+      std::lock_guard<std::mutex> lock(socketClientsMutex);
+      auto it = socketClients.find(clientId);
+      if (it == socketClients.end())
+        return;  // Gone before its reply was ready
+      connection = it->second->commands;
+    }
+    sendOnSocket(*connection, frame);
   }
 
-  template<typename T>
-  inline void write2n(T n)
+  // Caller holds notificationWriteMutex
+  void broadcastToSocketClients(FrameWriter& frame)
   {
-    write2n_binary(n);
+    std::lock_guard<std::mutex> lock(socketClientsMutex);
+    for (auto& [id, client] : socketClients)
+      if (client->notifications)
+        sendOnSocket(*client->notifications, frame);
   }
-    
-  template<typename... Args>
-  void writeAllc(Args&&... args) 
+
+  // The first frame on a connection says what it's for: [uint8 0] opens a client, answered with
+  // [uint32 client ID]; [uint8 1][uint32 client ID] makes this that client's notification stream
+  bool handleSocketHello(const shared_ptr<SocketConnection>& connection)
   {
-    ((write2c(std::forward<Args>(args))), ...);  // C++17 fold expression
+    uint8_t role = READFROMPIPE(uint8_t);
+    std::lock_guard<std::mutex> lock(socketClientsMutex);
+    if (role == 0)
+    {
+      connection->role = SocketConnection::commands;
+      connection->clientId = nextSocketClientId++;
+      auto client = make_shared<SocketClient>();
+      client->commands = connection;
+      socketClients[connection->clientId] = client;
+      FrameWriter hello;
+      hello.write(uint32_t(connection->clientId));
+      sendOnSocket(*connection, hello);
+      cout << "Socket client " << connection->clientId << " connected" << endl;
+      return true;
+    }
+    int clientId = int(READFROMPIPE(uint32_t));
+    auto it = socketClients.find(clientId);
+    if (role != 1 || it == socketClients.end() || it->second->notifications)
+      return false;
+    connection->role = SocketConnection::notifications;
+    connection->clientId = clientId;
+    it->second->notifications = connection;
+    combineSubscriptions();
+    cout << "Socket client " << clientId << " subscribed to notifications" << endl;
+    return true;
   }
 
-  template<typename... Args>
-  void writeAlln(Args&&... args) 
+  // Hands a command frame to the worker that runs its kind of command
+  void dispatchSocketCommand(const shared_ptr<SocketConnection>& connection)
   {
-    ((write2n(std::forward<Args>(args))), ...);  // C++17 fold expression
+    currentClient = connection->clientId;
+    currentRequestId = READFROMPIPE(uint32_t);
+    char command = READFROMPIPE(char);
+    if (isSlowCommand(command))
+      queueCommand(slowCommands, command, connection->order);
+    else if (isReadOnlyCommand(command))
+      queueCommand(queryCommands, command, connection->order);
+    else
+      queueCommand(engineCommands, command, connection->order);
   }
 
-  // Template function to read any type from pipe
-  template<typename T>
-  T readFromPipe() 
+  // Reads whatever has arrived and dispatches every complete frame; false once the connection is done
+  bool readSocket(const shared_ptr<SocketConnection>& connection)
   {
-    T value;
-#ifdef _WIN32
-    char* buffer = reinterpret_cast<char*>(&value);
-    int totalRead = 0;
-    while (totalRead < sizeof(T)) {
-      DWORD bytesRead;
-      if (!ReadFile(hCommandPipe, buffer + totalRead, 
-        sizeof(T) - totalRead, &bytesRead, NULL)) {
-        throw runtime_error("ReadFile failed: " + to_string(GetLastError()));
+    char chunk[64 * 1024];
+    for (;;)
+    {
+      ssize_t n = recv(connection->fd, chunk, sizeof(chunk), 0);
+      if (n > 0)
+      {
+        connection->input.insert(connection->input.end(), chunk, chunk + n);
+        continue;
+      }
+      if (n == 0)
+        return false;
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      return false;
+    }
+
+    auto& input = connection->input;
+    size_t start = 0;
+    while (input.size() - start >= sizeof(uint32_t))
+    {
+      uint32_t length;
+      memcpy(&length, input.data() + start, sizeof(length));
+      if (length > 256 * 1024 * 1024)
+        return false;
+      if (input.size() - start < sizeof(length) + length)
+        break;
+      currentCommandFrame->assign(input.data() + start + sizeof(length), length);
+      start += sizeof(length) + length;
+      if (connection->role == SocketConnection::unknown)
+      {
+        if (!handleSocketHello(connection))
+          return false;
       }
-      if (bytesRead == 0) {
-        throw runtime_error("Pipe closed");
+      else if (connection->role == SocketConnection::commands)
+      {
+        dispatchSocketCommand(connection);
       }
-      totalRead += bytesRead;
-    }
-    return value;
-#else
-    if (read(pipe_fd, &value, sizeof(T)) == sizeof(T)) {
-      return value;
     }
-    throw runtime_error("couldn't read from pipe");
-#endif
+    input.erase(input.begin(), input.begin() + start);
+    return true;
   }
 
-  // Specialization for strings (reads length-prefixed strings)
-  template<>
-  string readFromPipe<string>() {
-    // Read 4-byte length first
-    uint32_t length = readFromPipe<uint32_t>();
-    if (length <= 0 || length > 10000) {  // Sanity check
-      throw runtime_error("invalid string length");
+  void closeSocket(const shared_ptr<SocketConnection>& connection)
+  {
+    if (connection->fd < 0)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(socketClientsMutex);
+      auto it = socketClients.find(connection->clientId);
+      if (it != socketClients.end())
+      {
+        if (connection->role == SocketConnection::commands)
+        {
+          if (it->second->notifications)
+            shutdown(it->second->notifications->fd, SHUT_RDWR);
+          socketClients.erase(it);
+          combineSubscriptions();
+          cout << "Socket client " << connection->clientId << " disconnected" << endl;
+        }
+        else if (connection->role == SocketConnection::notifications && it->second->notifications == connection)
+        {
+          it->second->notifications.reset();
+          combineSubscriptions();
+        }
+      }
     }
+    std::lock_guard<std::mutex> lock(connection->writeMutex);
+    epoll_ctl(socketEpollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    socketConnections.erase(connection->fd);
+    close(connection->fd);
+    connection->fd = -1;
+    connection->failed = true;
+  }
 
-    char* buffer = new char[length + 1];  // +1 for null terminator
-    int totalRead = 0;
-
-#ifdef _WIN32
-    while (totalRead < length) {
-      DWORD bytesRead;
-      if (!ReadFile(hCommandPipe, buffer + totalRead, length - totalRead, &bytesRead, NULL)) {
-        delete[] buffer;
-        throw runtime_error("ReadFile failed: " + to_string(GetLastError()));
-      }
-      if (bytesRead == 0) {
-        delete[] buffer;
-        throw runtime_error("pipe closed");
-      }
-      totalRead += bytesRead;
+  // Accepts controllers on /tmp/<pipeName>.sock. This thread only does socket IO and decoding: mutating
+  // commands go to the engine thread one at a time, read-only ones to the query threads, slow ones to the
+  // slow command worker, so a long command never holds up another client's IO.
+  void socketServerLoop()
+  {
+    FrameReader frame;
+    currentCommandFrame = &frame;
+
+    string path = socketPath();
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(path.c_str());
+    if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 16) != 0)
+    {
+      cerr << "Socket server unavailable on " << path << ": " << strerror(errno) << endl;
+      if (listenFd >= 0)
+        close(listenFd);
+      return;
     }
-#else
-    while (totalRead < length) {
-      ssize_t bytesRead = read(commandPipe_fd, buffer + totalRead, length - totalRead);
-      if (bytesRead < 0) {
-        delete[] buffer;
-        throw runtime_error("read failed: " + string(strerror(errno)));
+    socketEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(socketEpollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    cout << "Socket server listening on " << path << endl;
+
+    epoll_event events[64];
+    while (running)
+    {
+      int n = epoll_wait(socketEpollFd, events, 64, 100);
+      if (n < 0 && errno != EINTR)
+      {
+        cerr << "epoll_wait failed: " << strerror(errno) << endl;
+        break;
       }
-      if (bytesRead == 0) {
-        delete[] buffer;
-        throw runtime_error("pipe closed");
+      for (int i = 0; i < n; ++i)
+      {
+        if (events[i].data.fd == listenFd)
+        {
+          int fd;
+          while ((fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+          {
+            auto connection = make_shared<SocketConnection>();
+            connection->fd = fd;
+            socketConnections[fd] = connection;
+            epoll_event clientEv{};
+            clientEv.events = EPOLLIN;
+            clientEv.data.fd = fd;
+            epoll_ctl(socketEpollFd, EPOLL_CTL_ADD, fd, &clientEv);
+          }
+          continue;
+        }
+
+        auto it = socketConnections.find(events[i].data.fd);
+        if (it == socketConnections.end())
+          continue;
+        auto connection = it->second;
+        bool open = true;
+        if (events[i].events & EPOLLOUT)
+        {
+          std::lock_guard<std::mutex> lock(connection->writeMutex);
+          open = !connection->failed && writePendingSocketBytes(*connection);
+          if (open && connection->pending.empty())
+            watchSocket(*connection, false);
+        }
+        if (open && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        {
+          try {
+            open = readSocket(connection);
+          } catch (const exception& e) {
+            cout << "Socket client " << connection->clientId << " sent a bad frame: " << e.what() << endl;
+            open = false;
+          }
+        }
+        if (!open)
+          closeSocket(connection);
       }
-      totalRead += bytesRead;
     }
-#endif
 
-    // Create string with explicit length to handle embedded nulls
-    string result(buffer, length);
-    delete[] buffer;
-    return result;
+    while (!socketConnections.empty())
+      closeSocket(socketConnections.begin()->second);
+    close(socketEpollFd);
+    close(listenFd);
+    unlink(path.c_str());
   }
-
-#define READFROMPIPE(type) readFromPipe<type>()
+#endif
 
   void renderToFile(uint64_t endBlock, string outputFile)
   {
@@ -1919,28 +6375,19 @@ public:
 
     // Calculate total samples needed
     uint64_t totalBlocks = endBlock;
+    midiScheduler->sync();
+    scheduler.sync();
+    scheduler.chaseOnNextBlock();
 
     for (uint64_t block = 0; block < totalBlocks; ++block)
     {
-      buffer.clear();
-      midiBuffer.clear();
-
-      // Process scheduled changes
-      scheduler.processScheduledChanges();
-
-      // Process scheduled MIDI
-      midiScheduler->processBlock(midiBuffer, samplesPerBlock);
-
-      // Process the graph
-      processorGraph->processBlock(buffer, midiBuffer);
+      renderBlock(buffer, midiBuffer);
 
       // Write to file
       if (audioFileWriter)
       {
         audioFileWriter->writeFromAudioSampleBuffer(buffer, 0, samplesPerBlock);
       }
-
-      scheduler.incrementBlock();
     }
 
     // Flush and close file
@@ -1948,8 +6395,73 @@ public:
     cout << "Offline rendering complete" << endl;
   }
 
+  // Sets the graph up for rendering without an audio device, for renderToFile and the in-process module
+  void prepareOffline(double rate, int samplesPerBlock)
+  {
+    processorGraph->prepareToPlay(rate, samplesPerBlock);
+    setupAudioIO();
+    midiScheduler->setSampleRate(rate);
+    midiScheduler->setBlockSize(samplesPerBlock);
+    scheduler.setBlockSize(samplesPerBlock);
+    audioInitialized = true;
+  }
+
+  // Renders one block offline: scheduled parameter changes, then the graph, whose MIDI source nodes read
+  // their plugins' scheduled MIDI. buffer can refer to memory the caller owns, so the module renders
+  // straight into numpy arrays. Call midiScheduler->sync() and scheduler.sync() before the first block
+  //
+  // A parameter change scheduled to the sample splits the block there, so the graph renders up to it with
+  // the old value and on from it with the new one; so does the loop's end, so parameters go round with the
+  // notes. Changes less than minSubBlock after the last split go
+  // out at minSubBlock rather than making the plugins render a handful of samples at a time
+  void renderBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiBuffer)
+  {
+    buffer.clear();
+    midiBuffer.clear();
+
+    // Process scheduled changes
+    scheduler.processScheduledChanges();
+
+    // Process the graph
+    midiScheduler->waitForStream();
+    markBlockStart();
+    int numSamples = buffer.getNumSamples();
+    int split = scheduler.nextChangeOffset(numSamples);
+    if (split >= numSamples)
+    {
+      midiScheduler->beginBlock();
+      processorGraph->processBlock(buffer, midiBuffer);
+      midiScheduler->endBlock(numSamples);
+    }
+    else
+    {
+      for (int start = 0; start < numSamples;)
+      {
+        int end = min(numSamples, max(split, start + minSubBlock));
+        juce::AudioBuffer<float> subBlock(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, end - start);
+        subBlockMidi.clear();
+        midiScheduler->beginBlock();
+        processorGraph->processBlock(subBlock, subBlockMidi);
+        midiScheduler->endBlock(end - start);
+        midiBuffer.addEvents(subBlockMidi, 0, end - start, start);
+
+        start = end;
+        scheduler.processChangesUpTo(start);
+        split = scheduler.nextChangeOffset(numSamples);
+      }
+    }
+
+    scheduler.endBlock(numSamples);
+  }
+
+  static constexpr int minSubBlock = 32;
+  static constexpr size_t defaultRecordingCapacity = 1 << 20;  // Parameter moves, 24 bytes each
+  static constexpr double recordingHoldSeconds = 0.1;  // A pause longer than this before a recorded move holds the value
+  juce::MidiBuffer subBlockMidi;  // The graph's MIDI out for a sub-block of renderBlock
+
   unordered_map<int, juce::AudioProcessorGraph::NodeID> midiSourceNodes;  // key -> MIDI source node
   unique_ptr<MidiScheduler> midiScheduler;
+  shared_ptr<const TempoMap> tempoMap = make_shared<TempoMap>();  // Also held by midiScheduler's compile thread
   juce::AudioPluginFormatManager formatManager;
   unordered_map<int, juce::AudioProcessorGraph::NodeID> midiRouterNodes;
   juce::AudioProcessorGraph::NodeID audioOutputNode;
@@ -1964,29 +6476,281 @@ public:
       cerr << "Failed to connect notification pipe" << endl;
       return;
     }
-    cout << "Notification pipe connected" << endl;
-    notificationPipeReady = true;
-#endif
+    cout << "Notification pipe connected" << endl;
+    notificationPipeReady = true;
+#endif
+
+    auto lastFlush = chrono::steady_clock::now();
+    while (running) {
+      {
+        unique_lock<std::mutex> lock(notificationMutex);
+        // Parameter changes held back by a rate limit need a flush once they're due, even if nothing new arrives
+        auto wakeAt = chrono::steady_clock::now() + chrono::milliseconds(100);
+        if (parametersHeld)
+          wakeAt = std::min(wakeAt, parametersDue);
+        notificationReady.wait_until(lock, wakeAt, [this] { return notificationsPending || !running; });
+        if (!notificationsPending && !(parametersHeld && chrono::steady_clock::now() >= parametersDue))
+          continue;
+      }
+      // Give changes until the end of the flush interval to pile up, so they're coalesced into one batch
+      this_thread::sleep_until(lastFlush + chrono::milliseconds(notificationIntervalMs.load()));
+      flushNotifications();
+      lastFlush = chrono::steady_clock::now();
+    }
+  }
+
+  void shutdownAudio()
+  {
+    if (recordingCallback)
+      deviceManager.removeAudioCallback(recordingCallback.get());
+    deviceManager.closeAudioDevice();
+    graphPlayer.setProcessor(nullptr);
+    recordingCallback.reset();
+  }
+
+ 
+  // Commands that can take seconds. They run in order on their own thread, so the command thread keeps
+  // answering everything else and their replies can overtake or be overtaken by later requests. Later
+  // commands that need what one produces wait for it, see waitsFor.
+  static bool isSlowCommand(char command)
+  {
+    return command == load_plugin || command == load_plugin_by_uid || command == scan_plugins;
+  }
+
+  // Commands whose arguments start with the key of the one plugin they use
+  static bool startsWithKey(char command)
+  {
+    switch (command)
+    {
+      case show_plugin_ui:
+      case hide_plugin_ui:
+      case set_parameter:
+      case get_parameter:
+      case remove_plugin:
+      case get_params_info:
+      case get_channels_info:
+      case schedule_midi_note:
+      case schedule_midi_cc:
+      case schedule_param_change:
+      case route_keyboard_input:
+      case route_cc_to_param:
+      case unroute_cc_to_param:
+      case route_virtual_keyboard:
+      case subscribe_audio_tap:
+      case schedule_midi_note_at_beat:
+      case schedule_midi_cc_at_beat:
+      case schedule_param_change_at_beat:
+      case replace_event_range:
+      case replace_param_change_range:
+      case schedule_midi_curve:
+      case schedule_clip_instances:
+      case clear_midi_events:
+      case schedule_param_change_at_sample:
+      case get_parameter_handles:
+      case set_automation_lane:
+      case add_automation_points:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // The plugin key a command loads or uses, or -1 if it names none or several
+  static int commandKey(char command, const char* args, size_t size)
+  {
+    size_t offset = 0;
+    if (command == load_plugin)
+    {
+      uint32_t pathLength;
+      if (size < sizeof(pathLength))
+        return -1;
+      memcpy(&pathLength, args, sizeof(pathLength));
+      offset = sizeof(pathLength) + pathLength;
+    }
+    else if (command == load_plugin_by_uid)
+      offset = sizeof(uint32_t);  // uid
+    else if (!startsWithKey(command))
+      return -1;
+    int32_t key;
+    if (size < offset + sizeof(key))
+      return -1;
+    memcpy(&key, args + offset, sizeof(key));
+    return key < 0 ? -1 : key;
+  }
+
+  // Whether a command has to wait for an earlier one from the same client to finish. Everything but slow
+  // commands runs in the order the client sent it, and a slow command waits for what was sent before it;
+  // a later command only waits for a slow one when it needs the plugin it loads or the list a scan makes.
+  static bool waitsFor(char command, int key, char earlier, int earlierKey)
+  {
+    if (!isSlowCommand(earlier) || isSlowCommand(command))
+      return true;
+    bool readsPluginList = command == list_plugins || command == get_plugin_info || command == list_bad_paths;
+    if (earlier == scan_plugins)
+      return readsPluginList;
+    return !readsPluginList && (key < 0 || earlierKey < 0 || key == earlierKey);
+  }
+
+  // Commands that only read host state. They run under a shared hold on hostMutex, so queries from
+  // several clients are answered side by side instead of queueing behind each other.
+  static bool isReadOnlyCommand(char command)
+  {
+    switch (command)
+    {
+      case list_plugins:
+      case get_plugin_info:
+      case get_parameter:
+      case get_parameter_handles:
+      case list_bad_paths:
+      case get_params_info:
+      case get_channels_info:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  struct QueuedCommand
+  {
+    int client;          // Where the reply goes, see currentClient
+    uint32_t requestId;
+    char command;
+    vector<char> args;   // The rest of the frame, copied since the reader's buffer gets reused
+    shared_ptr<ClientCommands> order;
+    uint64_t number;     // In order
+  };
+
+  struct CommandQueue
+  {
+    queue<QueuedCommand> commands;
+    mutex queueMutex;
+    condition_variable ready;
+  };
+
+  enum class HostLock { none, shared, exclusive };
+
+  // Numbers the current command among its client's, before anything later from that client is read
+  uint64_t startCommand(ClientCommands& order, char command)
+  {
+    int key = commandKey(command, currentCommandFrame->unread(), currentCommandFrame->remaining());
+    std::lock_guard<std::mutex> lock(commandOrderMutex);
+    uint64_t number = order.sent++;
+    order.unfinished[number] = { command, key };
+    return number;
+  }
+
+  // Blocks until the earlier commands this one depends on have finished, see waitsFor
+  void waitForEarlierCommands(ClientCommands& order, uint64_t number)
+  {
+    std::unique_lock<std::mutex> lock(commandOrderMutex);
+    const pair<char, int> self = order.unfinished.at(number);
+    commandFinished.wait(lock, [&] {
+      if (!running)
+        return true;
+      for (auto it = order.unfinished.begin(); it != order.unfinished.end() && it->first < number; ++it)
+        if (waitsFor(self.first, self.second, it->second.first, it->second.second))
+          return false;
+      return true;
+    });
+  }
+
+  void finishCommand(ClientCommands& order, uint64_t number)
+  {
+    {
+      std::lock_guard<std::mutex> lock(commandOrderMutex);
+      order.unfinished.erase(number);
+    }
+    commandFinished.notify_all();
+  }
+
+  void queueCommand(CommandQueue& target, char command, const shared_ptr<ClientCommands>& order)
+  {
+    uint64_t number = startCommand(*order, command);
+    size_t n = currentCommandFrame->remaining();
+    const char* args = currentCommandFrame->readBytes(n);
+    {
+      std::lock_guard<std::mutex> lock(target.queueMutex);
+      target.commands.push({ currentClient, currentRequestId, command, vector<char>(args, args + n), order, number });
+    }
+    target.ready.notify_one();
+  }
+
+  // Runs a command holding hostMutex the way it needs: slow commands lock for themselves, read-only
+  // commands share it, everything else has the host to itself
+  void runCommand(char command, HostLock hostLock)
+  {
+    if (hostLock == HostLock::exclusive)
+    {
+      std::lock_guard<std::shared_mutex> lock(hostMutex);
+      processCommand(command);
+    }
+    else if (hostLock == HostLock::shared)
+    {
+      std::shared_lock<std::shared_mutex> lock(hostMutex);
+      processCommand(command);
+    }
+    else
+    {
+      processCommand(command);
+    }
+  }
 
-    while (running) {
-      sendQueuedParameterNotifications();
-      sendQueuedMidiNotifications();
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  // Worker thread: runs one queue's commands in order, with its own frames, replying to whoever sent each one
+  void commandWorkerLoop(CommandQueue& source, HostLock hostLock)
+  {
+    FrameReader frame;
+    FrameWriter reply;
+    currentCommandFrame = &frame;
+    currentCommandReply = &reply;
+
+    while (running)
+    {
+      QueuedCommand job;
+      {
+        std::unique_lock<std::mutex> lock(source.queueMutex);
+        source.ready.wait(lock, [&] { return !source.commands.empty() || !running; });
+        if (!running)
+          break;
+        job = std::move(source.commands.front());
+        source.commands.pop();
+      }
+      waitForEarlierCommands(*job.order, job.number);
+      frame.assign(job.args.data(), job.args.size());
+      currentClient = job.client;
+      currentRequestId = job.requestId;
+      beginReply();
+      try {
+        runCommand(job.command, hostLock);
+        flushReply();
+      } catch (const exception& e) {
+        cout << "Queued command " << int(job.command) << " failed: " << e.what() << endl;
+        if (!reply.empty())  // Empty once the handler's own reply has gone out
+          replyCommandFailed(e.what());
+      }
+      finishCommand(*job.order, job.number);
     }
   }
 
-  void shutdownAudio()
+  // Answers a command whose handler threw before replying, so the client isn't left waiting on it: a
+  // command_failed reply, which the client raises as an error whatever the command was
+  void replyCommandFailed(const string& message)
   {
-    if (recordingCallback)
-      deviceManager.removeAudioCallback(recordingCallback.get());
-    deviceManager.closeAudioDevice();
-    graphPlayer.setProcessor(nullptr);
-    recordingCallback.reset();
+    currentCommandReply->clear();
+    currentCommandReply->write(uint32_t(currentRequestId | commandFailedBit));
+    WRITEALLC(message);
+    flushReply();
+  }
+
+  void wakeCommandWorkers(CommandQueue& target)
+  {
+    std::lock_guard<std::mutex> lock(target.queueMutex);
+    target.ready.notify_all();
   }
 
- 
   void processCommands() {
     std::cout << "Thread: processCommands started" << endl;
+    currentCommandFrame = &commandFrame;
+    currentCommandReply = &commandReply;
 
     while (running) {
       try {
@@ -2030,8 +6794,25 @@ public:
         cout << "Thread: Starting command loop" << endl;
         while (running && commandPipeReady) {
           try {
+            readCommandFrame();
+            currentRequestId = READFROMPIPE(uint32_t);
             char command = READFROMPIPE(char);
-            processCommand(command);
+            if (isSlowCommand(command))
+            {
+              queueCommand(slowCommands, command, pipeCommands);
+              continue;
+            }
+            uint64_t number = startCommand(*pipeCommands, command);
+            waitForEarlierCommands(*pipeCommands, number);
+            beginReply();
+            try {
+              runCommand(command, isReadOnlyCommand(command) ? HostLock::shared : HostLock::exclusive);
+            } catch (...) {
+              finishCommand(*pipeCommands, number);
+              throw;
+            }
+            finishCommand(*pipeCommands, number);
+            flushReply();
           } catch (const exception& e) {
             // Pipe disconnected or read error
             cout << "Read error: " << e.what() << endl;
@@ -2042,6 +6823,8 @@ public:
 
         cout << "Exited command loop. running=" << running 
           << " commandPipeReady=" << commandPipeReady << endl;
+        closeSharedTransport();
+        commandFrame.reset();
 
 #ifdef _WIN32
         // Disconnect on Windows
@@ -2384,7 +7167,12 @@ public:
     for (const auto& pluginFile : pluginFiles)
     {
       string pathname = pluginFile.getFullPathName().toStdString();
-      if (!badPaths.count(pathname))
+      bool known;
+      {
+        std::lock_guard<std::shared_mutex> lock(hostMutex);
+        known = badPaths.count(pathname) > 0;
+      }
+      if (!known)
       {
 
         for (auto* format : formatManager.getFormats())
@@ -2392,7 +7180,8 @@ public:
           if (format->fileMightContainThisPluginType(pluginFile.getFullPathName()))
           {
             juce::OwnedArray<juce::PluginDescription> descriptions;
-            format->findAllTypesForFile(descriptions, pathname);
+            format->findAllTypesForFile(descriptions, pathname);  // The slow part, done without holding hostMutex
+            std::lock_guard<std::shared_mutex> lock(hostMutex);
             for (auto description : descriptions)
             {
               num_found++;
@@ -2425,7 +7214,9 @@ public:
     n = READFROMPIPE(uint32_t);
     for (int x = 0; x < n; x++)
     {
-      badPaths.insert(READFROMPIPE(string));
+      string badPath = READFROMPIPE(string);
+      std::lock_guard<std::shared_mutex> lock(hostMutex);
+      badPaths.insert(badPath);
     }
     for (auto directory : directories)
     {
@@ -2480,6 +7271,9 @@ public:
         auto plugin = formatManager.createPluginInstance(
           availablePlugin.desc, sampleRate, blockSize, errorMessage);
 
+        // availablePlugins is only written by scan_plugins, which runs on this same thread, so only
+        // the changes below need the lock
+        std::lock_guard<std::shared_mutex> lock(hostMutex);
         if (plugin != nullptr)
         {
           if (realtime)
@@ -2494,6 +7288,7 @@ public:
           {
             loadedPlugins[key] = node->nodeID;
             processorToKey[processorPtr] = key;
+            addParameterHandles(key, processorPtr);
             resp.name = availablePlugin.desc.name.toStdString();
             resp.success = true;
 
@@ -2581,6 +7376,7 @@ public:
         errorMessage
       );
 
+      std::lock_guard<std::shared_mutex> lock(hostMutex);
       if (instance)
       {
         auto* rawPointer = instance.release();
@@ -2592,6 +7388,7 @@ public:
         {
           loadedPlugins[key] = node->nodeID;
           processorToKey[rawPointer] = key;  // Track reverse mapping
+          addParameterHandles(key, rawPointer);
 
           resp.success = true;
           resp.name = desc.name.toStdString();
@@ -2770,6 +7567,76 @@ public:
     return 1;  // Success
   }
 
+  struct setTempoMapR { uint32_t success = false; string errmsg; };
+  // Replaces the tempo map. Everything scheduled in beats, MIDI and parameter changes, moves to match
+  setTempoMapR setTempoMap(vector<TempoMap::TempoPoint> tempos, vector<TempoMap::TimeSignature> signatures)
+  {
+    setTempoMapR resp;
+    try
+    {
+      auto map = make_shared<const TempoMap>(std::move(tempos), std::move(signatures));
+      tempoMap = map;
+      midiScheduler->setTempoMap(map);
+      scheduler.retime(*map, midiScheduler->getSampleRate());
+      resp.success = true;
+    }
+    catch (const invalid_argument& e)
+    {
+      resp.errmsg = e.what();
+    }
+    return resp;
+  }
+
+  // Moves playback to sample. Scheduled MIDI and parameter changes chase, so it sounds as it would have
+  // had playback got there from the start
+  void seekTo(int64_t sample)
+  {
+    sample = max<int64_t>(0, sample);
+    midiScheduler->seek(sample);
+    scheduler.seek(sample);
+  }
+
+  struct setLoopR { uint32_t success = false; string errmsg; };
+  // Loops playback between start and end, in samples; both 0 turns looping off. MIDI and parameter changes
+  // both loop on the sample
+  setLoopR setLoop(int64_t start, int64_t end)
+  {
+    setLoopR resp;
+    if (start == 0 && end == 0)
+    {
+      midiScheduler->setLoop(0, 0);
+      scheduler.setLoop(0, 0);
+      resp.success = true;
+    }
+    else if (start < 0 || end - start < blockSize)
+      resp.errmsg = "the loop must start at 0 or later and be at least one block (" + to_string(blockSize) + " samples) long";
+    else
+    {
+      midiScheduler->setLoop(start, end);
+      scheduler.setLoop(start, end);
+      resp.success = true;
+    }
+    return resp;
+  }
+
+  struct streamMidiEventFileR { uint32_t success = false; string errmsg; };
+  // Plays the MIDI event file at path, sorted MidiEventRecords at absolute sample times, alongside the
+  // schedule, reading it in a window around the playhead; an empty path stops streaming
+  streamMidiEventFileR streamMidiEventFile(const string& path)
+  {
+    streamMidiEventFileR resp;
+    try
+    {
+      midiScheduler->streamEventFile(path.empty() ? nullptr : make_shared<const MappedEventFile>(path));
+      resp.success = true;
+    }
+    catch (const runtime_error& e)
+    {
+      resp.errmsg = e.what();
+    }
+    return resp;
+  }
+
   struct setParameterR { uint32_t success = false; string errmsg; };
   setParameterR setParameter(int id, int paramIndex, float value)
   {
@@ -2839,6 +7706,30 @@ public:
     return resp;
   }
 
+  struct getParameterHandlesR { uint32_t success = false; uint32_t firstHandle = 0; uint32_t numParams = 0; };
+  getParameterHandlesR getParameterHandles(int key)
+  {
+    getParameterHandlesR resp;
+    PinnedParameterHandles handles(*this);
+    auto it = handles->plugins.find(key);
+    if (it != handles->plugins.end())
+    {
+      resp.success = true;
+      resp.firstHandle = it->second.first;
+      resp.numParams = it->second.second;
+    }
+    return resp;
+  }
+
+  // Sets parameters straight from their handles; handles of removed plugins are skipped
+  void setParametersByHandle(const ParameterHandleValueRecord* changes, size_t numChanges)
+  {
+    PinnedParameterHandles handles(*this);
+    for (size_t i = 0; i < numChanges; ++i)
+      if (auto* parameter = handles->get(changes[i].handle))
+        parameter->setValue(changes[i].value);
+  }
+
   uint32_t connectAudio(const int sourceId, int sourceChannel,
     const int destId, int destChannel)
   {
@@ -2881,9 +7772,7 @@ public:
       if (toFile) 
       {
         // No hardware needed for file rendering
-        processorGraph->prepareToPlay(48000, 512);
-        setupAudioIO();
-        midiScheduler = std::make_unique<MidiScheduler>(48000);
+        prepareOffline(48000, 512);
       }
       else 
       {
@@ -2923,7 +7812,9 @@ public:
 
         setupAudioIO();
 
-        midiScheduler = std::make_unique<MidiScheduler>(setup.sampleRate);
+        midiScheduler->setSampleRate(setup.sampleRate);
+        midiScheduler->setBlockSize(setup.bufferSize);
+        scheduler.setBlockSize(setup.bufferSize);
 
         // Setup MIDI collection
         midiCollector = make_unique<juce::MidiMessageCollector>();
@@ -2942,10 +7833,18 @@ public:
     // Now start actual playback
     if (toFile)
     {
+      // The schedulers hand what they've compiled to one rendering thread at a time, so the device's
+      // callback comes off it while the file is rendered. removeAudioCallback waits out a block in progress
+      if (recordingCallback)
+        deviceManager.removeAudioCallback(recordingCallback.get());
       renderToFile(endBlock, fileName);
+      if (recordingCallback)
+        deviceManager.addAudioCallback(recordingCallback.get());
     }
     else
     {
+      // Parameters start from the values they'd have had playing up to here
+      scheduler.chaseOnNextBlock();
       isPlaying = true;
       playbackEndBlock = endBlock;
 
@@ -2982,16 +7881,21 @@ public:
       {
         processorToKey.erase(node->getProcessor());
       }
+      removeParameterHandles(key);
       processorGraph->removeNode(it->second);
       loadedPlugins.erase(it);
     }
   }
   
   void clearAllPlugins() {
+    publishParameterHandles(make_unique<ParameterHandles>());
     processorToKey.clear();
     loadedPlugins.clear();
     pluginWindows.clear();
-    processorGraph->clear();
+    processorGraph->clear();  // Takes the audio tap nodes with it
+    for (auto& [tapId, nodeId] : audioTapNodes)
+      WRITEALLN(audio_tap_closed, int32_t(tapId));
+    audioTapNodes.clear();
   }
 
   void processCommand(char command)
@@ -3015,8 +7919,9 @@ public:
       }
       case load_plugin_by_uid:
       {
-        int uid = READFROMPIPE(uint32_t); 
-        int key = READFROMPIPE(uint32_t);
+        auto args = READFROMPIPE(load_plugin_by_uid_args);
+        int uid = args.uid;
+        int key = args.key;
         auto response = loadPluginByUid(uid, key);
         WRITEALLC(response.success, response.name, response.errmsg); //todo: change this in juce_client.py too
 
@@ -3058,37 +7963,49 @@ public:
       }
       case set_parameter: //probably won't be used.
       {
-        auto response = setParameter(READFROMPIPE(uint32_t), READFROMPIPE(uint32_t), READFROMPIPE(float));
+        auto args = READFROMPIPE(set_parameter_args);
+        auto response = setParameter(args.key, args.parameterIndex, args.value);
         WRITEALLC(response.success, response.errmsg);
         break;
-        break;
       }
       case get_parameter: //probably won't be used.
       {
-        auto response = getParameter(READFROMPIPE(uint32_t), READFROMPIPE(uint32_t));
+        auto args = READFROMPIPE(get_parameter_args);
+        auto response = getParameter(args.key, args.parameterIndex);
         WRITEALLC(response.success, response.value, response.errmsg);
-        if(response.success) WRITEALLC(response.value);
-        else WRITEALLC(response.errmsg);
+        break;
+      }
+      case get_parameter_handles:
+      {
+        auto args = READFROMPIPE(get_parameter_handles_args);
+        auto response = getParameterHandles(args.key);
+        WRITEALLC(response.success, response.firstHandle, response.numParams);
+        break;
+      }
+      case set_parameters_by_handle:
+      {
+        uint32_t count;
+        auto* records = currentCommandFrame->readRecords<ParameterHandleValueRecord>(count);
+        setParametersByHandle(records, count);
         break;
       }
       case connect_audio:
       {
-        WRITEALLC(connectAudio(READFROMPIPE(uint32_t), READFROMPIPE(uint32_t), READFROMPIPE(uint32_t), READFROMPIPE(uint32_t)));
+        auto args = READFROMPIPE(connect_audio_args);
+        WRITEALLC(connectAudio(args.sourceKey, args.sourceChannel, args.destKey, args.destChannel));
         break;
       }
       case connect_midi:
       {
-        WRITEALLC(connectMidi(READFROMPIPE(uint32_t), READFROMPIPE(uint32_t)));
+        auto args = READFROMPIPE(connect_midi_args);
+        WRITEALLC(connectMidi(args.sourceKey, args.destKey));
         break;
       }
       case start_playback:
       {
         uint64_t lastBlock = READFROMPIPE(uint64_t);
         bool toFile = READFROMPIPE(uint32_t);
-        std::string fileName = "";
-        if (toFile) {
-          fileName = READFROMPIPE(string);
-        }
+        std::string fileName = READFROMPIPE(string);  // Empty unless toFile
         startPlayback(lastBlock, toFile, fileName);
         WRITEALLC(uint32_t(1));
         break;
@@ -3171,23 +8088,14 @@ public:
       }
       case schedule_midi_note:
       {
-        int key = READFROMPIPE(uint32_t);
-        int note = READFROMPIPE(uint32_t);
-        float velocity = READFROMPIPE(float);
-        double startTime = READFROMPIPE(double);
-        double duration = READFROMPIPE(double);
-        int channel = READFROMPIPE(uint32_t);
-        midiScheduler->scheduleNote(key, note, velocity, startTime, duration, channel);
+        auto args = READFROMPIPE(schedule_midi_note_args);
+        midiScheduler->scheduleNote(args.key, args.note, args.velocity, args.startTime, args.duration, args.channel);
         break;
       }
       case schedule_midi_cc:
       {
-        int key = READFROMPIPE(uint32_t);
-        int controller = READFROMPIPE(uint32_t);
-        int value = READFROMPIPE(uint32_t);
-        double time = READFROMPIPE(double);
-        int channel = READFROMPIPE(uint32_t);
-        midiScheduler->scheduleCC(key, controller, value, time, channel);
+        auto args = READFROMPIPE(schedule_midi_cc_args);
+        midiScheduler->scheduleCC(args.key, args.controller, args.value, args.time, args.channel);
         break;
       }
       case clear_midi_schedule:
@@ -3197,18 +8105,59 @@ public:
       }
       case schedule_param_change:
       {
-        int key = READFROMPIPE(uint32_t);
-        int parameterIndex = READFROMPIPE(uint32_t);
-        float value = READFROMPIPE(float);
-        uint64_t atBlock = READFROMPIPE(uint64_t);
-        scheduler.scheduleParameterChange(key, parameterIndex, value, atBlock);
+        auto args = READFROMPIPE(schedule_param_change_args);
+        scheduler.scheduleParameterChange(args.key, args.parameterIndex, args.value, args.atBlock);
+        break;
+      }
+      case schedule_param_change_at_sample:
+      {
+        auto args = READFROMPIPE(schedule_param_change_at_sample_args);
+        scheduler.scheduleParameterChangeAtSample(args.key, args.parameterIndex, args.value, args.sample);
+        break;
+      }
+      case start_automation_recording:
+      {
+        auto args = READFROMPIPE(start_automation_recording_args);
+        automationRecorder.start(args.capacity != 0 ? args.capacity : defaultRecordingCapacity);
+        cout << "Recording automation" << endl;
+        break;
+      }
+      case stop_automation_recording:
+      {
+        auto args = READFROMPIPE(stop_automation_recording_args);
+        auto result = automationRecorder.stop(args.tolerance, int64_t(midiScheduler->getSampleRate() * recordingHoldSeconds));
+        cout << "Recorded " << result.recorded << " parameter moves (" << result.dropped << " dropped), thinned to "
+             << result.points.size() << " points" << endl;
+        WRITEALLC(result.recorded, result.dropped, uint32_t(result.points.size()));
+        currentCommandReply->append(result.points.data(), result.points.size() * sizeof(RecordedAutomationPointRecord));
+        break;
+      }
+      case set_automation_lane:
+      {
+        int32_t key = READFROMPIPE(int32_t);
+        int32_t parameterIndex = READFROMPIPE(int32_t);
+        uint32_t resolution = READFROMPIPE(uint32_t);
+        uint32_t count;
+        auto* records = currentCommandFrame->readRecords<AutomationPointRecord>(count);
+        scheduler.setAutomationLane(key, parameterIndex, int(resolution), records, count);
+        cout << "Set automation lane of " << count << " points for plugin " << key << " parameter " << parameterIndex << endl;
+        break;
+      }
+      case add_automation_points:
+      {
+        int32_t key = READFROMPIPE(int32_t);
+        int32_t parameterIndex = READFROMPIPE(int32_t);
+        uint32_t count;
+        auto* records = currentCommandFrame->readRecords<AutomationPointRecord>(count);
+        scheduler.addAutomationPoints(key, parameterIndex, records, count);
         break;
       }
       case route_keyboard_input:
       {
-        int key = READFROMPIPE(uint32_t);
-        uint32_t useVelocity = READFROMPIPE(uint32_t);
-        float fixedVel = READFROMPIPE(float);
+        auto args = READFROMPIPE(route_keyboard_input_args);
+        int key = args.key;
+        uint32_t useVelocity = args.useVelocity;
+        float fixedVel = args.fixedVelocity;
 
         keyboardRoutedPlugin = key;
         useKeyboardVelocity = (useVelocity != 0);
@@ -3230,10 +8179,11 @@ public:
       }
       case route_cc_to_param:
       {
-        int key = READFROMPIPE(uint32_t);
-        int parameterIndex = READFROMPIPE(uint32_t);
-        int ccController = READFROMPIPE(uint32_t);
-        int midiChannel = READFROMPIPE(int32_t);  // -1 for any channel
+        auto args = READFROMPIPE(route_cc_to_param_args);
+        int key = args.key;
+        int parameterIndex = args.parameterIndex;
+        int ccController = args.ccController;
+        int midiChannel = args.midiChannel;  // -1 for any channel
 
         CCMapping mapping;
         mapping.key = key;
@@ -3251,9 +8201,10 @@ public:
       }
       case unroute_cc_to_param:
       {
-        int key = READFROMPIPE(uint32_t);
-        int parameterIndex = READFROMPIPE(uint32_t);
-        int ccController = READFROMPIPE(uint32_t);
+        auto args = READFROMPIPE(unroute_cc_to_param_args);
+        int key = args.key;
+        int parameterIndex = args.parameterIndex;
+        int ccController = args.ccController;
 
         // Remove matching mapping
         ccMappings.erase(
@@ -3286,9 +8237,10 @@ public:
       }
       case route_virtual_keyboard:
       {
-        int key = READFROMPIPE(uint32_t);
-        uint32_t useVelocity = READFROMPIPE(uint32_t);
-        float fixedVel = READFROMPIPE(float);
+        auto args = READFROMPIPE(route_virtual_keyboard_args);
+        int key = args.key;
+        uint32_t useVelocity = args.useVelocity;
+        float fixedVel = args.fixedVelocity;
 
         virtualKeyboardRoutedPlugin = key;
         useVirtualKeyboardVelocity = (useVelocity != 0);
@@ -3360,20 +8312,11 @@ public:
       }
       case control_audio_playback:
       {
-        int playerId = READFROMPIPE(uint32_t);
-        uint8_t action = READFROMPIPE(uint8_t);  // 0=stop, 1=start, 2=schedule
-        int64_t startSample = 0;
-        int64_t fileStartPosition = 0;
-
-        if (action == 1)  // start immediately
-        {
-          fileStartPosition = READFROMPIPE(uint64_t);
-        }
-        else if (action == 2)  // schedule
-        {
-          startSample = READFROMPIPE(uint64_t);
-          fileStartPosition = READFROMPIPE(uint64_t);
-        }
+        auto args = READFROMPIPE(control_audio_playback_args);
+        int playerId = args.playerId;
+        uint8_t action = args.action;  // 0=stop, 1=start, 2=schedule
+        int64_t startSample = args.startSample;  // Only used when scheduling
+        int64_t fileStartPosition = args.fileStartPosition;
 
         auto it = audioFilePlayerNodes.find(playerId);
         if (it != audioFilePlayerNodes.end())
@@ -3437,16 +8380,13 @@ public:
       case schedule_ordered_notes:
       {
         uint32_t count = READFROMPIPE(uint32_t);
+        const char* records = currentCommandFrame->readBytes(size_t(count) * sizeof(OrderedNoteRecord));
 
         for (uint32_t i = 0; i < count; ++i)
         {
-          int orderNumber = READFROMPIPE(uint32_t);
-          int noteNumber = READFROMPIPE(uint32_t);
-          int velocity = READFROMPIPE(uint32_t);
-          int channel = READFROMPIPE(uint32_t);
-          int duration = READFROMPIPE(uint32_t);
-
-          scheduleOrderedNote(orderNumber, noteNumber, velocity, channel, duration);
+          OrderedNoteRecord note;
+          memcpy(&note, records + i * sizeof(OrderedNoteRecord), sizeof(note));
+          scheduleOrderedNote(note.orderNumber, note.noteNumber, note.velocity, note.channel, note.duration);
         }
 
         // Sort the notes by order number
@@ -3457,9 +8397,8 @@ public:
       }
       case start_ordered_playback:
       {
-        uint32_t useKeyboardVelocity = READFROMPIPE(uint32_t);
-        uint32_t useKeyboardDuration = READFROMPIPE(uint32_t);
-        startOrderedPlayback(useKeyboardVelocity != 0, useKeyboardDuration != 0);
+        auto args = READFROMPIPE(start_ordered_playback_args);
+        startOrderedPlayback(args.useKeyboardVelocity != 0, args.useKeyboardDuration != 0);
         WRITEALLC(uint32_t(1));  // Success
         break;
       }
@@ -3480,6 +8419,16 @@ public:
         midiScheduler->clearCCSchedule();
         break;
       }
+      case clear_midi_events:
+      {
+        int32_t key = READFROMPIPE(int32_t);
+        uint32_t categories = READFROMPIPE(uint32_t);
+        int64_t start = READFROMPIPE(int64_t);
+        int64_t end = READFROMPIPE(int64_t);
+        midiScheduler->clearEvents(key, categories, start, end);
+        cout << "Cleared MIDI categories " << categories << " in samples " << start << "-" << end << " of plugin " << key << endl;
+        break;
+      }
       case clear_param_schedule:
       {
         scheduler.clearSchedule();
@@ -3490,6 +8439,320 @@ public:
         clearAllPlugins();
         break;
       }
+      case schedule_midi_events_bulk:
+      {
+        uint32_t count = READFROMPIPE(uint32_t);
+        // Decoded straight out of the frame; MidiEventRecord is packed so there's no alignment concern
+        auto* records = reinterpret_cast<const MidiEventRecord*>(
+          currentCommandFrame->readBytes(size_t(count) * sizeof(MidiEventRecord)));
+        midiScheduler->scheduleEventsBulk(records, count);
+        cout << "Scheduled " << count << " MIDI events in bulk" << endl;
+        break;
+      }
+      case set_tempo_map:
+      {
+        vector<TempoMap::TempoPoint> tempos(READFROMPIPE(uint32_t));
+        for (auto& tempo : tempos)
+        {
+          auto record = READFROMPIPE(TempoPointRecord);
+          tempo = { record.beat, record.bpm, record.ramp != 0 };
+        }
+        vector<TempoMap::TimeSignature> signatures(READFROMPIPE(uint32_t));
+        for (auto& signature : signatures)
+        {
+          auto record = READFROMPIPE(TimeSignatureRecord);
+          signature = { record.bar, int(record.numerator), int(record.denominator) };
+        }
+        auto response = setTempoMap(std::move(tempos), std::move(signatures));
+        cout << "Set tempo map: " << (response.success ? "ok" : response.errmsg) << endl;
+        WRITEALLC(response.success, response.errmsg);
+        break;
+      }
+      case schedule_midi_note_at_beat:
+      {
+        auto args = READFROMPIPE(schedule_midi_note_at_beat_args);
+        midiScheduler->scheduleNoteAtBeat(args.key, args.note, args.velocity, args.startBeat, args.durationBeats, args.channel);
+        break;
+      }
+      case schedule_midi_cc_at_beat:
+      {
+        auto args = READFROMPIPE(schedule_midi_cc_at_beat_args);
+        midiScheduler->scheduleCCAtBeat(args.key, args.controller, args.value, args.beat, args.channel);
+        break;
+      }
+      case schedule_param_change_at_beat:
+      {
+        auto args = READFROMPIPE(schedule_param_change_at_beat_args);
+        scheduler.scheduleParameterChangeAtBeat(args.key, args.parameterIndex, args.value, args.beat,
+          *tempoMap, midiScheduler->getSampleRate());
+        break;
+      }
+      case schedule_midi_events_bulk_at_beats:
+      {
+        uint32_t count = READFROMPIPE(uint32_t);
+        auto* records = reinterpret_cast<const MidiBeatEventRecord*>(
+          currentCommandFrame->readBytes(size_t(count) * sizeof(MidiBeatEventRecord)));
+        midiScheduler->scheduleEventsBulkAtBeats(records, count);
+        cout << "Scheduled " << count << " MIDI events in beats in bulk" << endl;
+        break;
+      }
+      case seek:
+      {
+        int64_t sample = READFROMPIPE(int64_t);
+        seekTo(sample);
+        cout << "Seek to sample " << sample << endl;
+        break;
+      }
+      case set_loop:
+      {
+        int64_t start = READFROMPIPE(int64_t);
+        int64_t end = READFROMPIPE(int64_t);
+        auto response = setLoop(start, end);
+        cout << "Set loop " << start << "-" << end << ": " << (response.success ? "ok" : response.errmsg) << endl;
+        WRITEALLC(response.success, response.errmsg);
+        break;
+      }
+      case stream_midi_event_file:
+      {
+        string path = READFROMPIPE(string);
+        auto response = streamMidiEventFile(path);
+        cout << "Stream MIDI event file " << (path.empty() ? "(none)" : path) << ": " << (response.success ? "ok" : response.errmsg) << endl;
+        WRITEALLC(response.success, response.errmsg);
+        break;
+      }
+      case edit_schedule:
+      {
+        uint32_t numDeletes, numMoves, numEvents, numParamDeletes, numParamMoves, numParamChanges;
+        auto* deletes = currentCommandFrame->readRecords<IdRecord>(numDeletes);
+        auto* moves = currentCommandFrame->readRecords<EventMoveRecord>(numMoves);
+        auto* events = currentCommandFrame->readRecords<IdentifiedEventRecord>(numEvents);
+        auto* paramDeletes = currentCommandFrame->readRecords<IdRecord>(numParamDeletes);
+        auto* paramMoves = currentCommandFrame->readRecords<ParamMoveRecord>(numParamMoves);
+        auto* paramChanges = currentCommandFrame->readRecords<IdentifiedParamChangeRecord>(numParamChanges);
+        midiScheduler->editEvents(deletes, numDeletes, moves, numMoves, events, numEvents);
+        scheduler.editChanges(paramDeletes, numParamDeletes, paramMoves, numParamMoves, paramChanges, numParamChanges);
+        cout << "Edited schedule: " << numDeletes << "/" << numMoves << "/" << numEvents << " events deleted/moved/inserted, "
+             << numParamDeletes << "/" << numParamMoves << "/" << numParamChanges << " parameter changes" << endl;
+        break;
+      }
+      case replace_event_range:
+      {
+        int32_t key = READFROMPIPE(int32_t);
+        int64_t start = READFROMPIPE(int64_t);
+        int64_t end = READFROMPIPE(int64_t);
+        uint32_t count;
+        auto* records = currentCommandFrame->readRecords<IdentifiedEventRecord>(count);
+        midiScheduler->replaceEventRange(key, start, end, records, count);
+        cout << "Replaced events " << start << "-" << end << " of plugin " << key << " with " << count << endl;
+        break;
+      }
+      case replace_param_change_range:
+      {
+        int32_t key = READFROMPIPE(int32_t);
+        uint64_t firstBlock = READFROMPIPE(uint64_t);
+        uint64_t endBlock = READFROMPIPE(uint64_t);
+        uint32_t count;
+        auto* records = currentCommandFrame->readRecords<IdentifiedParamChangeRecord>(count);
+        scheduler.replaceChangeRange(key, firstBlock, endBlock, records, count);
+        cout << "Replaced parameter changes in blocks " << firstBlock << "-" << endBlock << " of plugin " << key << " with " << count << endl;
+        break;
+      }
+      case schedule_midi_curve:
+      {
+        int32_t key = READFROMPIPE(int32_t);
+        uint8_t status = READFROMPIPE(uint8_t);
+        uint8_t controller = READFROMPIPE(uint8_t);
+        uint32_t resolution = READFROMPIPE(uint32_t);
+        uint32_t count;
+        auto* points = currentCommandFrame->readRecords<CurvePointRecord>(count);
+        if (midiScheduler->scheduleCurve(key, status, controller, int(std::min(resolution, uint32_t(INT32_MAX))), points, count))
+          cout << "Scheduled a curve of " << count << " points for plugin " << key << ", status " << int(status) << endl;
+        else
+          cout << "Ignored a curve for plugin " << key << ": status " << int(status) << ", " << count << " points" << endl;
+        break;
+      }
+      case define_midi_clip:
+      {
+        uint32_t clipId = READFROMPIPE(uint32_t);
+        uint32_t count;
+        auto* records = currentCommandFrame->readRecords<ClipEventRecord>(count);
+        midiScheduler->defineClip(clipId, records, count);
+        cout << "Defined clip " << clipId << " with " << count << " events" << endl;
+        break;
+      }
+      case schedule_clip_instances:
+      {
+        int32_t key = READFROMPIPE(int32_t);
+        uint32_t count;
+        auto* records = currentCommandFrame->readRecords<ClipInstanceRecord>(count);
+        midiScheduler->scheduleClipInstances(key, records, count);
+        cout << "Scheduled " << count << " clip instances for plugin " << key << endl;
+        break;
+      }
+      case set_notification_interval:
+      {
+        notificationIntervalMs = int(READFROMPIPE(uint32_t));
+        cout << "Notification interval set to " << notificationIntervalMs << " ms" << endl;
+        break;
+      }
+      case subscribe:
+      {
+        uint32_t streams = READFROMPIPE(uint32_t);
+        uint32_t count = READFROMPIPE(uint32_t);
+        const char* keyRecords = currentCommandFrame->readBytes(size_t(count) * sizeof(KeyRecord));
+        vector<int> keys(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+          KeyRecord record;
+          memcpy(&record, keyRecords + i * sizeof(KeyRecord), sizeof(record));
+          keys[i] = record.key;
+        }
+        float rates[size_t(NotificationStream::count)];
+        for (auto& rate : rates)
+          rate = READFROMPIPE(float);
+        {
+#ifdef SOCKET_SERVER_SUPPORTED
+          std::lock_guard<std::mutex> lock(socketClientsMutex);
+          if (currentClient != 0)
+          {
+            auto it = socketClients.find(currentClient);
+            if (it == socketClients.end())
+              break;  // Gone already
+            it->second->subscriber.filter.subscribe(streams, keys, rates);
+          }
+          else
+#endif
+          pipeSubscriber.filter.subscribe(streams, keys, rates);
+          combineSubscriptions();
+        }
+        cout << "Subscribed " << (currentClient == 0 ? string("pipe client") : "socket client " + to_string(currentClient))
+          << " to notification streams " << streams << " for "
+          << (keys.empty() ? string("every plugin") : to_string(keys.size()) + " plugins") << endl;
+        break;
+      }
+      case open_shared_transport:
+      {
+        auto args = READFROMPIPE(open_shared_transport_args);
+        uint32_t ringCapacity = args.ringCapacity;  // 0 for the default
+        int64_t clientPid = args.clientPid;
+        cout << "Opening shared memory transport, ring capacity " << ringCapacity << " client pid " << clientPid << endl;
+#ifdef SHARED_TRANSPORT_SUPPORTED
+        try
+        {
+          if (currentClient != 0)
+            throw runtime_error("shared memory transport is only available to the pipe client");
+          if (sharedTransport)
+            throw runtime_error("shared memory transport already open");
+          // Both sides stay on the pipe until the client confirms it has mapped the region
+          offeredTransport = make_unique<SharedTransport>(pipeName, ringCapacity, clientPid);
+          offeredTransportDeadline = chrono::steady_clock::now() + chrono::seconds(sharedTransportConfirmSeconds);
+          WRITEALLC(int32_t(1), offeredTransport->getName(), offeredTransport->getRingCapacity());
+        }
+        catch (const exception& e)
+        {
+          cout << "Shared memory transport unavailable: " << e.what() << endl;
+          WRITEALLC(int32_t(0), string(e.what()), uint32_t(0));
+        }
+#else
+        WRITEALLC(int32_t(0), string("shared memory transport not supported on this platform"), uint32_t(0));
+#endif
+        break;
+      }
+      case confirm_shared_transport:
+      {
+        uint32_t attached = READFROMPIPE(uint32_t);
+        string error = READFROMPIPE(string);
+#ifdef SHARED_TRANSPORT_SUPPORTED
+        if (currentClient != 0 || !offeredTransport)
+        {
+          cout << "Shared memory transport confirmed, but none was offered" << endl;
+          WRITEALLC(uint32_t(0));
+          break;
+        }
+        auto transport = std::move(offeredTransport);
+        if (!attached)
+        {
+          cout << "Client couldn't attach the shared memory transport, staying on the pipe: " << error << endl;
+          break;
+        }
+        if (chrono::steady_clock::now() > offeredTransportDeadline)
+        {
+          cout << "Shared memory transport confirmed too late, staying on the pipe" << endl;
+          WRITEALLC(uint32_t(0));
+          break;
+        }
+        // The reply marks where the pipe ends for the client, so a confirm that asks for none stays on the pipe
+        if (currentRequestId == 0)
+          break;
+        WRITEALLC(uint32_t(1));
+        switchToSharedTransport(std::move(transport));  // Sends the reply on the pipe, then moves over
+#else
+        WRITEALLC(uint32_t(0));
+#endif
+        break;
+      }
+      case subscribe_audio_tap:
+      {
+        auto args = READFROMPIPE(subscribe_audio_tap_args);
+        int key = args.key;
+        int bus = args.bus;
+        uint32_t ringFrames = args.ringFrames;  // 0 for the default
+        cout << "Subscribing audio tap on key " << key << " bus " << bus << ", ring frames " << ringFrames << endl;
+        try
+        {
+          auto it = loadedPlugins.find(key);
+          auto sourceNode = it != loadedPlugins.end() ? processorGraph->getNodeForId(it->second) : nullptr;
+          if (sourceNode == nullptr)
+            throw runtime_error("no plugin with key " + to_string(key));
+          auto* source = sourceNode->getProcessor();
+          auto* sourceBus = source->getBus(false, bus);
+          if (sourceBus == nullptr || sourceBus->getNumberOfChannels() == 0)
+            throw runtime_error("node has no output bus " + to_string(bus));
+          int firstChannel = source->getChannelIndexInProcessBlockBuffer(false, bus, 0);
+          int numChannels = sourceBus->getNumberOfChannels();
+
+          int tapId = nextAudioTapId++;
+#ifdef _WIN32
+          string regionName = "Local\\" + pipeName + "_tap" + to_string(tapId);
+#else
+          string regionName = "/" + pipeName + "_tap" + to_string(tapId);
+#endif
+          auto tap = make_unique<AudioTapNode>(regionName, numChannels, ringFrames, double(sampleRate));
+          string name = tap->getRegionName();
+          uint32_t capacity = tap->getCapacity();
+          auto node = processorGraph->addNode(std::move(tap));
+          if (node == nullptr)
+            throw runtime_error("failed to add tap node to graph");
+          for (int ch = 0; ch < numChannels; ++ch)
+            processorGraph->addConnection({ { it->second, firstChannel + ch }, { node->nodeID, ch } });
+          audioTapNodes[tapId] = node->nodeID;
+
+          cout << "Audio tap " << tapId << " on " << name << ": " << numChannels << " channels, " << capacity << " frames" << endl;
+          WRITEALLC(tapId, name, uint32_t(numChannels), capacity, string(""));
+        }
+        catch (const exception& e)
+        {
+          cout << "ERROR: Audio tap failed: " << e.what() << endl;
+          WRITEALLC(-1, string(""), uint32_t(0), uint32_t(0), string(e.what()));
+        }
+        break;
+      }
+      case unsubscribe_audio_tap:
+      {
+        int tapId = READFROMPIPE(uint32_t);
+        auto it = audioTapNodes.find(tapId);
+        if (it != audioTapNodes.end())
+        {
+          processorGraph->removeNode(it->second);  // The node unmaps its ring once the graph releases it
+          audioTapNodes.erase(it);
+          cout << "Audio tap " << tapId << " removed" << endl;
+        }
+        else
+        {
+          cout << "ERROR: No audio tap " << tapId << endl;
+        }
+        break;
+      }
       default:
       {
         cout << "command not recognized: " << commandtype << endl;
@@ -4022,6 +9285,8 @@ private:
   // Audio file playback (using processor graph nodes)
   unordered_map<int, juce::AudioProcessorGraph::NodeID> audioFilePlayerNodes;  // player ID -> node ID
   int nextAudioPlayerId = 0;
+  unordered_map<int, juce::AudioProcessorGraph::NodeID> audioTapNodes;  // tap ID -> tap node ID
+  int nextAudioTapId = 0;
 
   // Ordered note playback - triggered by any MIDI keyboard key press
   struct OrderedNote
@@ -4058,10 +9323,31 @@ private:
   // Communication
   thread commandThread;
   thread notificationThread;
+  thread slowCommandThread;
+  CommandQueue slowCommands;
+  shared_ptr<ClientCommands> pipeCommands = make_shared<ClientCommands>();
+  mutex commandOrderMutex;
+  condition_variable commandFinished;  // Some client's command finished, see waitForEarlierCommands
+#ifdef SOCKET_SERVER_SUPPORTED
+  thread socketServerThread;
+  thread engineCommandThread;   // Socket clients' mutating commands, one at a time
+  thread queryThreads[2];       // Socket clients' read-only commands
+  CommandQueue engineCommands;
+  CommandQueue queryCommands;
+  int socketEpollFd = -1;
+  int nextSocketClientId = 1;
+  unordered_map<int, shared_ptr<SocketConnection>> socketConnections;  // fd -> connection, epoll thread only
+  unordered_map<int, shared_ptr<SocketClient>> socketClients;          // client ID -> client
+  mutex socketClientsMutex;
+#endif
+  // Held exclusively by whichever thread runs a mutating command, and by the slow command worker while
+  // it touches the graph, the plugin maps, availablePlugins or badPaths; shared by read-only commands
+  shared_mutex hostMutex;
   //queue<Command> commandQueue;
   mutex commandMutex;
   condition_variable commandCv;
 
+  friend class InProcessEngine;  // The Python module's wrapper, in juce_engine_bindings.cpp
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompletePluginHost)
 };
 
@@ -4075,9 +9361,13 @@ void RecordingAudioCallback::audioDeviceIOCallbackWithContext(
   const juce::AudioIODeviceCallbackContext& context)
 {
   // Call the wrapped callback first (this processes the audio from plugins and graph nodes)
+  if (host)
+    host->beginAudioBlock();
   wrappedCallback->audioDeviceIOCallbackWithContext(inputChannelData, numInputChannels,
                                                     outputChannelData, numOutputChannels,
                                                     numSamples, context);
+  if (host)
+    host->endAudioBlock(numSamples);
 
   // Capture the final output for recording if enabled
   if (host)
@@ -4098,25 +9388,34 @@ void VirtualKeyboardListener::routeToHost(const juce::MidiMessage& message)
 void audioProcessorParameterChanged(juce::AudioProcessor* processor, int paramIndex, float value)
 {
   cout << "audioProcessorParameterChanged" << endl;
-  if (!suppressNotifications)
+  if (!suppressNotifications && notificationFilter.wants(NotificationStream::params))
   {
     cout << "!suppressNotifications" << endl;
     ParameterChangeEvent event{app->findkey(processor), paramIndex, value, app->scheduler.getCurrentBlock()};
-    parameterQueue.push(event);  // Lock-free, real-time safe
+    if (notificationFilter.wantsKey(event.key))
+      parameterQueue.push(event);  // Lock-free, real-time safe
   }
 }
 
 void ParameterChangeListener::audioProcessorParameterChanged(juce::AudioProcessor* processor, int paramIndex, float value) {
-  if (!suppressNotifications && app) {
+  // Our own scheduled changes and automation aren't recorded
+  if (!suppressNotifications && app && app->automationRecorder.isRecording()) {
+    int key = app->findkey(processor);
+    if (key != -1)
+      app->automationRecorder.record(key, paramIndex, app->samplePositionNow(), value);
+  }
+  if (!suppressNotifications && app && notificationFilter.wants(NotificationStream::params)) {
     int key = app->findkey(processor);
-    if (key != -1) {
+    if (key != -1 && notificationFilter.wantsKey(key)) {
       ParameterChangeEvent event{key, paramIndex, value, app->scheduler.getCurrentBlock() + 1};  // Effect takes place in next block
       app->queueParameterNotification(event);  // Queue instead of direct pipe write
     }
   }
 }
-// Entry point
-#ifdef _WIN32
+// Entry point. The in-process Python module and the benchmarks have none; the Python interpreter or the
+// benchmark is the host process
+#ifdef JUCE_ENGINE_MODULE
+#elif defined(_WIN32)
 // Use extern "C" to ensure proper linkage
 
 bool isAllWhitespace(const std::string& str) 
@@ -4213,16 +9512,75 @@ int main(int argc, char* argv[])
 #endif
 
 
+void BlockLevelScheduler::jumpTo(int64_t sample)
+{
+  doneBefore = sample;
+  nextChange = firstAt(schedule->changes, sample);
+  if (!host) return;
+
+  for (const auto& [parameter, track] : schedule->tracks)
+  {
+    auto after = firstAt(track, sample);
+    if (!track.atBegin(after))
+      host->setPluginParameter(parameter.first, parameter.second, track.before(after).value);
+  }
+  // Lanes set their value at the new position whatever they set before
+  fill(schedule->laneValues.begin(), schedule->laneValues.end(), NAN);
+}
+
 void BlockLevelScheduler::processScheduledChanges() 
 {
+  adoptSchedule();
+  int64_t target = seekSample.exchange(-1);
+  if (target >= 0)
+  {
+    origin = target;
+    blockStart.store(origin, memory_order_relaxed);
+    jumpTo(target);
+  }
+  if (!host) return;
+
+  processChangesUpTo(0);
+}
+
+void BlockLevelScheduler::applyAutomation(int64_t position)
+{
+  for (size_t i = 0; i < schedule->lanes.size(); ++i)
+  {
+    const auto& [parameter, lane] = schedule->lanes[i];
+    if (position < lane.points.front().sample)
+      continue;
+    float value = automationValueAt(lane.points, position);
+    if (value != schedule->laneValues[i])
+    {
+      host->setPluginParameter(parameter.first, parameter.second, value);
+      schedule->laneValues[i] = value;
+    }
+  }
+}
+
+void BlockLevelScheduler::processChangesUpTo(int offset)
+{
+  wrapLoop(offset);
+  blockOffset = offset;
   if (!host) return;
 
-  while (lastChangeIndex < scheduledChanges.size() && 
-    currentBlock == scheduledChanges[lastChangeIndex].atBlock)
+  // Changes from before the block, scheduled late or left behind by blocks that went unprocessed, go out
+  // now rather than holding the rest up: only the last of each parameter's, so a long gap is caught up
+  // with one value a parameter
+  const auto& changes = schedule->changes;
+  while (!changes.atEnd(nextChange) && changes.at(nextChange).sample < origin)
+  {
+    const ScheduledParameterChange& change = changes.at(nextChange);
+    if (lastBeforeCurrentBlock())
+      host->setPluginParameter(change.key, change.parameterIndex, change.value);
+    changeDone();
+  }
+  while (!changes.atEnd(nextChange) && changes.at(nextChange).sample <= origin + offset)
   {
-    ScheduledParameterChange& change = scheduledChanges[lastChangeIndex];
+    const ScheduledParameterChange& change = changes.at(nextChange);
     host->setPluginParameter(change.key, change.parameterIndex, change.value);
-    change.executed = true;
-    lastChangeIndex++;
+    changeDone();
   }
-}
\ No newline at end of file
+  applyAutomation(origin + offset);
+}
@@ -0,0 +1,1088 @@
+// Generated by gen_protocol.py from protocol.json. Do not edit.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Commands, client -> server
+enum recv_cmd
+{
+  load_plugin,
+  load_plugin_by_uid,
+  scan_plugins,
+  list_plugins,
+  get_plugin_info,
+  show_plugin_ui,
+  hide_plugin_ui,
+  set_parameter,
+  get_parameter,
+  connect_audio,
+  connect_midi,
+  start_playback,
+  cmd_shutdown,
+  remove_plugin,
+  list_bad_paths,
+  get_params_info,
+  get_channels_info,
+  schedule_midi_note,
+  schedule_midi_cc,
+  clear_midi_schedule,
+  schedule_param_change,
+  route_keyboard_input,
+  unroute_keyboard_input,
+  route_cc_to_param,
+  unroute_cc_to_param,
+  show_virtual_keyboard,
+  hide_virtual_keyboard,
+  route_virtual_keyboard,
+  unroute_virtual_keyboard,
+  toggle_recording,
+  toggle_monitoring,
+  load_audio_file,
+  control_audio_playback,
+  schedule_ordered_notes,
+  start_ordered_playback,
+  stop_ordered_playback,
+  clear_ordered_notes,
+  clear_midi_cc_schedule,
+  clear_param_schedule,
+  clear_all_plugins,
+  schedule_midi_events_bulk,
+  open_shared_transport,
+  set_notification_interval,
+  subscribe_audio_tap,
+  unsubscribe_audio_tap,
+  subscribe,
+  set_tempo_map,
+  schedule_midi_note_at_beat,
+  schedule_midi_cc_at_beat,
+  schedule_param_change_at_beat,
+  schedule_midi_events_bulk_at_beats,
+  seek,
+  set_loop,
+  stream_midi_event_file,
+  edit_schedule,
+  replace_event_range,
+  replace_param_change_range,
+  schedule_midi_curve,
+  define_midi_clip,
+  schedule_clip_instances,
+  clear_midi_events,
+  schedule_param_change_at_sample,
+  get_parameter_handles,
+  set_parameters_by_handle,
+  set_automation_lane,
+  add_automation_points,
+  start_automation_recording,
+  stop_automation_recording,
+  confirm_shared_transport
+};
+
+// Notifications, server -> client; the first byte of every notification frame
+enum send_cmd : uint8_t
+{
+  param_changed,
+  param_changes_end,
+  stop_playback,
+  midi_note_event,
+  midi_cc_event,
+  virtual_keyboard_note_event,
+  virtual_keyboard_cc_event,
+  midi_keyboard_routed,
+  virtual_keyboard_routed,
+  recording_started,
+  recording_stopped,
+  monitoring_changed,
+  audio_file_loaded,
+  audio_playback_started,
+  audio_playback_stopped,
+  ordered_note_triggered,
+  ordered_playback_started,
+  ordered_playback_stopped,
+  notification_batch,
+  audio_tap_closed
+};
+
+// Streams in a notification_batch. Bit i of a subscribe command's streams mask selects stream i
+enum class NotificationStream : uint32_t
+{
+  params,
+  midi_notes,
+  midi_ccs,
+  virtual_notes,
+  virtual_ccs,
+  count
+};
+
+// How a curve gets from one breakpoint to the next: a straight line, an exponential rise (slow, then fast), or an S-curve
+enum class CurveShape : uint32_t
+{
+  linear,
+  exponential,
+  s_curve,
+  count
+};
+
+// Kinds of scheduled MIDI. Bit i of a clear_midi_events command's categories mask selects category i. Pressure is channel and polyphonic; other is sysex and system messages; clips are clip instances. Curves count as the messages they send
+enum class EventCategory : uint32_t
+{
+  notes,
+  controllers,
+  program_changes,
+  pressure,
+  pitch_bend,
+  other,
+  clips,
+  count
+};
+
+// Sent in place of a command's reply when its handler fails. Its frame carries the request ID with this bit set, then the error message
+constexpr uint32_t commandFailedBit = 1u << 31;
+
+#pragma pack(push, 1)
+// One event in a schedule_midi_events_bulk upload. sampleTime is relative to the scheduler's current position
+struct MidiEventRecord
+{
+  int32_t key;
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+  int64_t sampleTime;
+  static constexpr size_t wireSize = 15;
+};
+static_assert(sizeof(MidiEventRecord) == MidiEventRecord::wireSize, "MidiEventRecord layout");
+
+// One note in a schedule_ordered_notes upload
+struct OrderedNoteRecord
+{
+  uint32_t orderNumber;
+  uint32_t noteNumber;
+  uint32_t velocity;
+  uint32_t channel;
+  uint32_t duration;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(OrderedNoteRecord) == OrderedNoteRecord::wireSize, "OrderedNoteRecord layout");
+
+// A parameter change in a notification_batch
+struct ParamChangeRecord
+{
+  int32_t key;
+  int32_t parameterIndex;
+  float value;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(ParamChangeRecord) == ParamChangeRecord::wireSize, "ParamChangeRecord layout");
+
+// A MIDI note from a keyboard in a notification_batch
+struct MidiNoteRecord
+{
+  uint32_t noteNumber;
+  uint32_t velocity;
+  uint32_t channel;
+  uint32_t isNoteOn;
+  uint64_t samplePosition;
+  static constexpr size_t wireSize = 24;
+};
+static_assert(sizeof(MidiNoteRecord) == MidiNoteRecord::wireSize, "MidiNoteRecord layout");
+
+// A plugin key in a subscribe command
+struct KeyRecord
+{
+  int32_t key;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(KeyRecord) == KeyRecord::wireSize, "KeyRecord layout");
+
+// One event in a schedule_midi_events_bulk_at_beats upload. beat counts quarter notes from the start of the timeline
+struct MidiBeatEventRecord
+{
+  int32_t key;
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+  double beat;
+  static constexpr size_t wireSize = 15;
+};
+static_assert(sizeof(MidiBeatEventRecord) == MidiBeatEventRecord::wireSize, "MidiBeatEventRecord layout");
+
+// A tempo in a set_tempo_map command. ramp 1 ramps linearly to the next point's bpm
+struct TempoPointRecord
+{
+  double beat;
+  double bpm;
+  uint32_t ramp;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(TempoPointRecord) == TempoPointRecord::wireSize, "TempoPointRecord layout");
+
+// A time signature in a set_tempo_map command, from bar (counting from 0) on
+struct TimeSignatureRecord
+{
+  int32_t bar;
+  uint32_t numerator;
+  uint32_t denominator;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(TimeSignatureRecord) == TimeSignatureRecord::wireSize, "TimeSignatureRecord layout");
+
+// A MIDI CC from a keyboard in a notification_batch
+struct MidiCCRecord
+{
+  uint32_t controller;
+  uint32_t value;
+  uint32_t channel;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(MidiCCRecord) == MidiCCRecord::wireSize, "MidiCCRecord layout");
+
+// A MIDI event with a client-chosen ID in an edit_schedule command. sampleTime is absolute, from the start of the timeline. A note on with a duration gets its note off too, under the same ID
+struct IdentifiedEventRecord
+{
+  uint64_t id;
+  int32_t key;
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+  int64_t sampleTime;
+  int64_t duration;
+  static constexpr size_t wireSize = 31;
+};
+static_assert(sizeof(IdentifiedEventRecord) == IdentifiedEventRecord::wireSize, "IdentifiedEventRecord layout");
+
+// A parameter change with a client-chosen ID in an edit_schedule command
+struct IdentifiedParamChangeRecord
+{
+  uint64_t id;
+  int32_t key;
+  int32_t parameterIndex;
+  float value;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 28;
+};
+static_assert(sizeof(IdentifiedParamChangeRecord) == IdentifiedParamChangeRecord::wireSize, "IdentifiedParamChangeRecord layout");
+
+// An event or parameter change to delete, by the ID it was scheduled with
+struct IdRecord
+{
+  uint64_t id;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(IdRecord) == IdRecord::wireSize, "IdRecord layout");
+
+// Moves the event with this ID to start at sampleTime; a note keeps its duration
+struct EventMoveRecord
+{
+  uint64_t id;
+  int64_t sampleTime;
+  static constexpr size_t wireSize = 16;
+};
+static_assert(sizeof(EventMoveRecord) == EventMoveRecord::wireSize, "EventMoveRecord layout");
+
+// A breakpoint in a schedule_midi_curve command. sampleTime is relative to the scheduler's current position; value is in the message's own range (0-127, or 0-16383 for pitch bend); shape is a CurveShape, for the segment to the next breakpoint
+struct CurvePointRecord
+{
+  int64_t sampleTime;
+  float value;
+  uint8_t shape;
+  static constexpr size_t wireSize = 13;
+};
+static_assert(sizeof(CurvePointRecord) == CurvePointRecord::wireSize, "CurvePointRecord layout");
+
+// Moves the parameter change with this ID to atBlock
+struct ParamMoveRecord
+{
+  uint64_t id;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 16;
+};
+static_assert(sizeof(ParamMoveRecord) == ParamMoveRecord::wireSize, "ParamMoveRecord layout");
+
+// One event of a clip in a define_midi_clip command. sampleTime is from the start of the clip
+struct ClipEventRecord
+{
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+  int64_t sampleTime;
+  static constexpr size_t wireSize = 11;
+};
+static_assert(sizeof(ClipEventRecord) == ClipEventRecord::wireSize, "ClipEventRecord layout");
+
+// A clip played at sampleTime, relative to the scheduler's current position, in a schedule_clip_instances command. Its notes are moved by transpose semitones and its note on velocities multiplied by velocityScale
+struct ClipInstanceRecord
+{
+  uint32_t clipId;
+  int64_t sampleTime;
+  int32_t transpose;
+  float velocityScale;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(ClipInstanceRecord) == ClipInstanceRecord::wireSize, "ClipInstanceRecord layout");
+
+// A value for the parameter with a handle from get_parameter_handles, in a set_parameters_by_handle command
+struct ParameterHandleValueRecord
+{
+  uint32_t handle;
+  float value;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(ParameterHandleValueRecord) == ParameterHandleValueRecord::wireSize, "ParameterHandleValueRecord layout");
+
+// A breakpoint in a parameter's automation lane. sampleTime counts from the start of playback; value is the parameter's normalised 0-1 value; shape is a CurveShape, for the segment to the next breakpoint
+struct AutomationPointRecord
+{
+  int64_t sampleTime;
+  float value;
+  uint8_t shape;
+  static constexpr size_t wireSize = 13;
+};
+static_assert(sizeof(AutomationPointRecord) == AutomationPointRecord::wireSize, "AutomationPointRecord layout");
+
+// A breakpoint of a recorded parameter in a stop_automation_recording reply, sorted by key, parameterIndex then sampleTime. Each parameter's points, joined by straight lines, are a lane for set_automation_lane
+struct RecordedAutomationPointRecord
+{
+  int32_t key;
+  int32_t parameterIndex;
+  int64_t sampleTime;
+  float value;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(RecordedAutomationPointRecord) == RecordedAutomationPointRecord::wireSize, "RecordedAutomationPointRecord layout");
+
+// Messages made only of scalars decode with one memcpy: READFROMPIPE(set_parameter_args).
+// The rest are read and written field by field in the order given.
+// load_plugin_args: str path, u32 key
+
+// load_plugin_reply: u32 success, str name, u32 uid, str errmsg
+
+// load_plugin_by_uid command
+struct load_plugin_by_uid_args
+{
+  uint32_t uid;
+  uint32_t key;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(load_plugin_by_uid_args) == load_plugin_by_uid_args::wireSize, "load_plugin_by_uid_args layout");
+
+// load_plugin_by_uid_reply: u32 success, str name, str errmsg
+
+// scan_plugins_args: strs directories, strs badPaths
+
+// scan_plugins reply
+struct scan_plugins_reply
+{
+  uint32_t numFound;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(scan_plugins_reply) == scan_plugins_reply::wireSize, "scan_plugins_reply layout");
+
+// list_plugins_reply: list:PluginDescription plugins
+
+// get_plugin_info command
+struct get_plugin_info_args
+{
+  uint32_t index;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(get_plugin_info_args) == get_plugin_info_args::wireSize, "get_plugin_info_args layout");
+
+// get_plugin_info_reply: u32 isInstrument, u32 uid, u32 numInputChannels, u32 numOutputChannels, str name, str descriptiveName, str pluginFormatName, str category, str manufacturerName, str version, str fileOrIdentifier, str lastFileModTime, str path
+
+// show_plugin_ui command
+struct show_plugin_ui_args
+{
+  uint32_t key;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(show_plugin_ui_args) == show_plugin_ui_args::wireSize, "show_plugin_ui_args layout");
+
+// show_plugin_ui_reply: u32 success, str errmsg
+
+// hide_plugin_ui command
+struct hide_plugin_ui_args
+{
+  uint32_t key;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(hide_plugin_ui_args) == hide_plugin_ui_args::wireSize, "hide_plugin_ui_args layout");
+
+// hide_plugin_ui reply
+struct hide_plugin_ui_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(hide_plugin_ui_reply) == hide_plugin_ui_reply::wireSize, "hide_plugin_ui_reply layout");
+
+// set_parameter command
+struct set_parameter_args
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  float value;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(set_parameter_args) == set_parameter_args::wireSize, "set_parameter_args layout");
+
+// set_parameter_reply: u32 success, str errmsg
+
+// get_parameter command
+struct get_parameter_args
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(get_parameter_args) == get_parameter_args::wireSize, "get_parameter_args layout");
+
+// get_parameter_reply: u32 success, f32 value, str errmsg
+
+// connect_audio command
+struct connect_audio_args
+{
+  uint32_t sourceKey;
+  uint32_t sourceChannel;
+  uint32_t destKey;
+  uint32_t destChannel;
+  static constexpr size_t wireSize = 16;
+};
+static_assert(sizeof(connect_audio_args) == connect_audio_args::wireSize, "connect_audio_args layout");
+
+// connect_audio reply
+struct connect_audio_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(connect_audio_reply) == connect_audio_reply::wireSize, "connect_audio_reply layout");
+
+// connect_midi command
+struct connect_midi_args
+{
+  uint32_t sourceKey;
+  uint32_t destKey;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(connect_midi_args) == connect_midi_args::wireSize, "connect_midi_args layout");
+
+// connect_midi reply
+struct connect_midi_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(connect_midi_reply) == connect_midi_reply::wireSize, "connect_midi_reply layout");
+
+// start_playback_args: u64 endBlock, u32 toFile, str fileName
+
+// start_playback reply
+struct start_playback_reply
+{
+  uint32_t started;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(start_playback_reply) == start_playback_reply::wireSize, "start_playback_reply layout");
+
+// remove_plugin command
+struct remove_plugin_args
+{
+  uint32_t key;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(remove_plugin_args) == remove_plugin_args::wireSize, "remove_plugin_args layout");
+
+// list_bad_paths_reply: strs paths
+
+// get_params_info command
+struct get_params_info_args
+{
+  uint32_t key;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(get_params_info_args) == get_params_info_args::wireSize, "get_params_info_args layout");
+
+// get_params_info_reply: u32 success, u32 numParams, str errmsg, list:ParamInfo params (count in numParams)
+
+// get_channels_info command
+struct get_channels_info_args
+{
+  uint32_t key;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(get_channels_info_args) == get_channels_info_args::wireSize, "get_channels_info_args layout");
+
+// get_channels_info_reply: u32 success, u32 acceptsMidi, u32 producesMidi, list:BusInfo inputBuses, list:BusInfo outputBuses, str errmsg
+
+// schedule_midi_note command
+struct schedule_midi_note_args
+{
+  uint32_t key;
+  uint32_t note;
+  float velocity;
+  double startTime;
+  double duration;
+  uint32_t channel;
+  static constexpr size_t wireSize = 32;
+};
+static_assert(sizeof(schedule_midi_note_args) == schedule_midi_note_args::wireSize, "schedule_midi_note_args layout");
+
+// schedule_midi_cc command
+struct schedule_midi_cc_args
+{
+  uint32_t key;
+  uint32_t controller;
+  uint32_t value;
+  double time;
+  uint32_t channel;
+  static constexpr size_t wireSize = 24;
+};
+static_assert(sizeof(schedule_midi_cc_args) == schedule_midi_cc_args::wireSize, "schedule_midi_cc_args layout");
+
+// schedule_param_change command
+struct schedule_param_change_args
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  float value;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(schedule_param_change_args) == schedule_param_change_args::wireSize, "schedule_param_change_args layout");
+
+// route_keyboard_input command
+struct route_keyboard_input_args
+{
+  uint32_t key;
+  uint32_t useVelocity;
+  float fixedVelocity;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(route_keyboard_input_args) == route_keyboard_input_args::wireSize, "route_keyboard_input_args layout");
+
+// route_keyboard_input reply
+struct route_keyboard_input_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(route_keyboard_input_reply) == route_keyboard_input_reply::wireSize, "route_keyboard_input_reply layout");
+
+// unroute_keyboard_input reply
+struct unroute_keyboard_input_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(unroute_keyboard_input_reply) == unroute_keyboard_input_reply::wireSize, "unroute_keyboard_input_reply layout");
+
+// route_cc_to_param command
+struct route_cc_to_param_args
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  uint32_t ccController;
+  int32_t midiChannel;
+  static constexpr size_t wireSize = 16;
+};
+static_assert(sizeof(route_cc_to_param_args) == route_cc_to_param_args::wireSize, "route_cc_to_param_args layout");
+
+// route_cc_to_param reply
+struct route_cc_to_param_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(route_cc_to_param_reply) == route_cc_to_param_reply::wireSize, "route_cc_to_param_reply layout");
+
+// unroute_cc_to_param command
+struct unroute_cc_to_param_args
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  uint32_t ccController;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(unroute_cc_to_param_args) == unroute_cc_to_param_args::wireSize, "unroute_cc_to_param_args layout");
+
+// unroute_cc_to_param reply
+struct unroute_cc_to_param_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(unroute_cc_to_param_reply) == unroute_cc_to_param_reply::wireSize, "unroute_cc_to_param_reply layout");
+
+// show_virtual_keyboard reply
+struct show_virtual_keyboard_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(show_virtual_keyboard_reply) == show_virtual_keyboard_reply::wireSize, "show_virtual_keyboard_reply layout");
+
+// hide_virtual_keyboard reply
+struct hide_virtual_keyboard_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(hide_virtual_keyboard_reply) == hide_virtual_keyboard_reply::wireSize, "hide_virtual_keyboard_reply layout");
+
+// route_virtual_keyboard command
+struct route_virtual_keyboard_args
+{
+  uint32_t key;
+  uint32_t useVelocity;
+  float fixedVelocity;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(route_virtual_keyboard_args) == route_virtual_keyboard_args::wireSize, "route_virtual_keyboard_args layout");
+
+// route_virtual_keyboard reply
+struct route_virtual_keyboard_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(route_virtual_keyboard_reply) == route_virtual_keyboard_reply::wireSize, "route_virtual_keyboard_reply layout");
+
+// unroute_virtual_keyboard reply
+struct unroute_virtual_keyboard_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(unroute_virtual_keyboard_reply) == unroute_virtual_keyboard_reply::wireSize, "unroute_virtual_keyboard_reply layout");
+
+// toggle_recording reply
+struct toggle_recording_reply
+{
+  uint32_t recording;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(toggle_recording_reply) == toggle_recording_reply::wireSize, "toggle_recording_reply layout");
+
+// toggle_monitoring reply
+struct toggle_monitoring_reply
+{
+  uint32_t monitoring;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(toggle_monitoring_reply) == toggle_monitoring_reply::wireSize, "toggle_monitoring_reply layout");
+
+// load_audio_file_args: str fileName
+
+// load_audio_file reply
+struct load_audio_file_reply
+{
+  int32_t playerId;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(load_audio_file_reply) == load_audio_file_reply::wireSize, "load_audio_file_reply layout");
+
+// control_audio_playback command
+struct control_audio_playback_args
+{
+  uint32_t playerId;
+  uint8_t action;
+  uint64_t startSample;
+  uint64_t fileStartPosition;
+  static constexpr size_t wireSize = 21;
+};
+static_assert(sizeof(control_audio_playback_args) == control_audio_playback_args::wireSize, "control_audio_playback_args layout");
+
+// control_audio_playback reply
+struct control_audio_playback_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(control_audio_playback_reply) == control_audio_playback_reply::wireSize, "control_audio_playback_reply layout");
+
+// schedule_ordered_notes_args: records:OrderedNoteRecord notes
+
+// schedule_ordered_notes reply
+struct schedule_ordered_notes_reply
+{
+  uint32_t count;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(schedule_ordered_notes_reply) == schedule_ordered_notes_reply::wireSize, "schedule_ordered_notes_reply layout");
+
+// start_ordered_playback command
+struct start_ordered_playback_args
+{
+  uint32_t useKeyboardVelocity;
+  uint32_t useKeyboardDuration;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(start_ordered_playback_args) == start_ordered_playback_args::wireSize, "start_ordered_playback_args layout");
+
+// start_ordered_playback reply
+struct start_ordered_playback_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(start_ordered_playback_reply) == start_ordered_playback_reply::wireSize, "start_ordered_playback_reply layout");
+
+// stop_ordered_playback reply
+struct stop_ordered_playback_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(stop_ordered_playback_reply) == stop_ordered_playback_reply::wireSize, "stop_ordered_playback_reply layout");
+
+// clear_ordered_notes reply
+struct clear_ordered_notes_reply
+{
+  uint32_t success;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(clear_ordered_notes_reply) == clear_ordered_notes_reply::wireSize, "clear_ordered_notes_reply layout");
+
+// schedule_midi_events_bulk_args: records:MidiEventRecord events
+
+// open_shared_transport command
+struct open_shared_transport_args
+{
+  uint32_t ringCapacity;
+  int64_t clientPid;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(open_shared_transport_args) == open_shared_transport_args::wireSize, "open_shared_transport_args layout");
+
+// open_shared_transport_reply: i32 ok, str nameOrError, u32 ringCapacity
+
+// set_notification_interval command
+struct set_notification_interval_args
+{
+  uint32_t ms;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(set_notification_interval_args) == set_notification_interval_args::wireSize, "set_notification_interval_args layout");
+
+// subscribe_audio_tap command
+struct subscribe_audio_tap_args
+{
+  uint32_t key;
+  uint32_t bus;
+  uint32_t ringFrames;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(subscribe_audio_tap_args) == subscribe_audio_tap_args::wireSize, "subscribe_audio_tap_args layout");
+
+// subscribe_audio_tap_reply: i32 tapId, str name, u32 channels, u32 capacity, str errmsg
+
+// unsubscribe_audio_tap command
+struct unsubscribe_audio_tap_args
+{
+  uint32_t tapId;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(unsubscribe_audio_tap_args) == unsubscribe_audio_tap_args::wireSize, "unsubscribe_audio_tap_args layout");
+
+// subscribe_args: u32 streams, records:KeyRecord keys, f32 paramRate, f32 noteRate, f32 ccRate, f32 virtualNoteRate, f32 virtualCCRate
+
+// set_tempo_map_args: records:TempoPointRecord tempos, records:TimeSignatureRecord signatures
+
+// set_tempo_map_reply: u32 success, str errmsg
+
+// schedule_midi_note_at_beat command
+struct schedule_midi_note_at_beat_args
+{
+  uint32_t key;
+  uint32_t note;
+  float velocity;
+  double startBeat;
+  double durationBeats;
+  uint32_t channel;
+  static constexpr size_t wireSize = 32;
+};
+static_assert(sizeof(schedule_midi_note_at_beat_args) == schedule_midi_note_at_beat_args::wireSize, "schedule_midi_note_at_beat_args layout");
+
+// schedule_midi_cc_at_beat command
+struct schedule_midi_cc_at_beat_args
+{
+  uint32_t key;
+  uint32_t controller;
+  uint32_t value;
+  double beat;
+  uint32_t channel;
+  static constexpr size_t wireSize = 24;
+};
+static_assert(sizeof(schedule_midi_cc_at_beat_args) == schedule_midi_cc_at_beat_args::wireSize, "schedule_midi_cc_at_beat_args layout");
+
+// schedule_param_change_at_beat command
+struct schedule_param_change_at_beat_args
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  float value;
+  double beat;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(schedule_param_change_at_beat_args) == schedule_param_change_at_beat_args::wireSize, "schedule_param_change_at_beat_args layout");
+
+// schedule_midi_events_bulk_at_beats_args: records:MidiBeatEventRecord events
+
+// seek command
+struct seek_args
+{
+  int64_t sample;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(seek_args) == seek_args::wireSize, "seek_args layout");
+
+// set_loop command
+struct set_loop_args
+{
+  int64_t start;
+  int64_t end;
+  static constexpr size_t wireSize = 16;
+};
+static_assert(sizeof(set_loop_args) == set_loop_args::wireSize, "set_loop_args layout");
+
+// set_loop_reply: u32 success, str errmsg
+
+// stream_midi_event_file_args: str path
+
+// stream_midi_event_file_reply: u32 success, str errmsg
+
+// edit_schedule_args: records:IdRecord deletes, records:EventMoveRecord moves, records:IdentifiedEventRecord events, records:IdRecord paramDeletes, records:ParamMoveRecord paramMoves, records:IdentifiedParamChangeRecord paramChanges
+
+// replace_event_range_args: i32 key, i64 start, i64 end, records:IdentifiedEventRecord events
+
+// replace_param_change_range_args: i32 key, u64 firstBlock, u64 endBlock, records:IdentifiedParamChangeRecord changes
+
+// schedule_midi_curve_args: i32 key, u8 status, u8 controller, u32 resolution, records:CurvePointRecord points
+
+// define_midi_clip_args: u32 clipId, records:ClipEventRecord events
+
+// schedule_clip_instances_args: i32 key, records:ClipInstanceRecord instances
+
+// clear_midi_events command
+struct clear_midi_events_args
+{
+  int32_t key;
+  uint32_t categories;
+  int64_t startSample;
+  int64_t endSample;
+  static constexpr size_t wireSize = 24;
+};
+static_assert(sizeof(clear_midi_events_args) == clear_midi_events_args::wireSize, "clear_midi_events_args layout");
+
+// schedule_param_change_at_sample command
+struct schedule_param_change_at_sample_args
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  float value;
+  uint64_t sample;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(schedule_param_change_at_sample_args) == schedule_param_change_at_sample_args::wireSize, "schedule_param_change_at_sample_args layout");
+
+// get_parameter_handles command
+struct get_parameter_handles_args
+{
+  int32_t key;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(get_parameter_handles_args) == get_parameter_handles_args::wireSize, "get_parameter_handles_args layout");
+
+// get_parameter_handles reply
+struct get_parameter_handles_reply
+{
+  uint32_t success;
+  uint32_t firstHandle;
+  uint32_t numParams;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(get_parameter_handles_reply) == get_parameter_handles_reply::wireSize, "get_parameter_handles_reply layout");
+
+// set_parameters_by_handle_args: records:ParameterHandleValueRecord changes
+
+// set_automation_lane_args: i32 key, i32 parameterIndex, u32 resolution, records:AutomationPointRecord points
+
+// add_automation_points_args: i32 key, i32 parameterIndex, records:AutomationPointRecord points
+
+// start_automation_recording command
+struct start_automation_recording_args
+{
+  uint32_t capacity;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(start_automation_recording_args) == start_automation_recording_args::wireSize, "start_automation_recording_args layout");
+
+// stop_automation_recording command
+struct stop_automation_recording_args
+{
+  float tolerance;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(stop_automation_recording_args) == stop_automation_recording_args::wireSize, "stop_automation_recording_args layout");
+
+// stop_automation_recording_reply: u32 recorded, u32 dropped, records:RecordedAutomationPointRecord points
+
+// confirm_shared_transport_args: u32 attached, str error
+
+// confirm_shared_transport reply
+struct confirm_shared_transport_reply
+{
+  uint32_t switched;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(confirm_shared_transport_reply) == confirm_shared_transport_reply::wireSize, "confirm_shared_transport_reply layout");
+
+// command_failed_reply: str message
+
+// param_changed notification, after its type byte
+struct param_changed_notification
+{
+  uint32_t key;
+  uint32_t parameterIndex;
+  float value;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(param_changed_notification) == param_changed_notification::wireSize, "param_changed_notification layout");
+
+// midi_note_event notification, after its type byte
+struct midi_note_event_notification
+{
+  uint32_t noteNumber;
+  uint32_t velocity;
+  uint32_t channel;
+  uint32_t isNoteOn;
+  uint64_t samplePosition;
+  static constexpr size_t wireSize = 24;
+};
+static_assert(sizeof(midi_note_event_notification) == midi_note_event_notification::wireSize, "midi_note_event_notification layout");
+
+// midi_cc_event notification, after its type byte
+struct midi_cc_event_notification
+{
+  uint32_t controller;
+  uint32_t value;
+  uint32_t channel;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(midi_cc_event_notification) == midi_cc_event_notification::wireSize, "midi_cc_event_notification layout");
+
+// virtual_keyboard_note_event notification, after its type byte
+struct virtual_keyboard_note_event_notification
+{
+  uint32_t noteNumber;
+  uint32_t velocity;
+  uint32_t channel;
+  uint32_t isNoteOn;
+  uint64_t samplePosition;
+  static constexpr size_t wireSize = 24;
+};
+static_assert(sizeof(virtual_keyboard_note_event_notification) == virtual_keyboard_note_event_notification::wireSize, "virtual_keyboard_note_event_notification layout");
+
+// virtual_keyboard_cc_event notification, after its type byte
+struct virtual_keyboard_cc_event_notification
+{
+  uint32_t controller;
+  uint32_t value;
+  uint32_t channel;
+  uint64_t atBlock;
+  static constexpr size_t wireSize = 20;
+};
+static_assert(sizeof(virtual_keyboard_cc_event_notification) == virtual_keyboard_cc_event_notification::wireSize, "virtual_keyboard_cc_event_notification layout");
+
+// midi_keyboard_routed notification, after its type byte
+struct midi_keyboard_routed_notification
+{
+  int32_t key;
+  int64_t samplePosition;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(midi_keyboard_routed_notification) == midi_keyboard_routed_notification::wireSize, "midi_keyboard_routed_notification layout");
+
+// virtual_keyboard_routed notification, after its type byte
+struct virtual_keyboard_routed_notification
+{
+  int32_t key;
+  int64_t samplePosition;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(virtual_keyboard_routed_notification) == virtual_keyboard_routed_notification::wireSize, "virtual_keyboard_routed_notification layout");
+
+// recording_started_notification: str fileName, i64 samplePosition
+
+// recording_stopped_notification: str fileName, i64 samplePosition
+
+// monitoring_changed notification, after its type byte
+struct monitoring_changed_notification
+{
+  uint8_t monitoring;
+  int64_t samplePosition;
+  static constexpr size_t wireSize = 9;
+};
+static_assert(sizeof(monitoring_changed_notification) == monitoring_changed_notification::wireSize, "monitoring_changed_notification layout");
+
+// audio_file_loaded_notification: str fileName, i32 playerId
+
+// audio_playback_started notification, after its type byte
+struct audio_playback_started_notification
+{
+  int32_t playerId;
+  int64_t samplePosition;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(audio_playback_started_notification) == audio_playback_started_notification::wireSize, "audio_playback_started_notification layout");
+
+// audio_playback_stopped notification, after its type byte
+struct audio_playback_stopped_notification
+{
+  int32_t playerId;
+  int64_t samplePosition;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(audio_playback_stopped_notification) == audio_playback_stopped_notification::wireSize, "audio_playback_stopped_notification layout");
+
+// ordered_note_triggered notification, after its type byte
+struct ordered_note_triggered_notification
+{
+  int32_t orderNumber;
+  int32_t orderIndex;
+  int32_t numNotes;
+  static constexpr size_t wireSize = 12;
+};
+static_assert(sizeof(ordered_note_triggered_notification) == ordered_note_triggered_notification::wireSize, "ordered_note_triggered_notification layout");
+
+// ordered_playback_started notification, after its type byte
+struct ordered_playback_started_notification
+{
+  int64_t samplePosition;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(ordered_playback_started_notification) == ordered_playback_started_notification::wireSize, "ordered_playback_started_notification layout");
+
+// ordered_playback_stopped notification, after its type byte
+struct ordered_playback_stopped_notification
+{
+  int64_t samplePosition;
+  static constexpr size_t wireSize = 8;
+};
+static_assert(sizeof(ordered_playback_stopped_notification) == ordered_playback_stopped_notification::wireSize, "ordered_playback_stopped_notification layout");
+
+// notification_batch_notification: records:ParamChangeRecord params, records:MidiNoteRecord notes, records:MidiCCRecord ccs, records:MidiNoteRecord virtualNotes, records:MidiCCRecord virtualCCs
+
+// audio_tap_closed notification, after its type byte
+struct audio_tap_closed_notification
+{
+  int32_t tapId;
+  static constexpr size_t wireSize = 4;
+};
+static_assert(sizeof(audio_tap_closed_notification) == audio_tap_closed_notification::wireSize, "audio_tap_closed_notification layout");
+
+#pragma pack(pop)
@@ -0,0 +1,409 @@
+# Generated by gen_protocol.py from protocol.json. Do not edit.
+import struct, collections
+import numpy as np
+
+class send_cmd: #commands, client -> server
+  load_plugin = 0
+  load_plugin_by_uid = 1
+  scan_plugins = 2
+  list_plugins = 3
+  get_plugin_info = 4
+  show_plugin_ui = 5
+  hide_plugin_ui = 6
+  set_parameter = 7
+  get_parameter = 8
+  connect_audio = 9
+  connect_midi = 10
+  start_playback = 11
+  cmd_shutdown = 12
+  remove_plugin = 13
+  list_bad_paths = 14
+  get_params_info = 15
+  get_channels_info = 16
+  schedule_midi_note = 17
+  schedule_midi_cc = 18
+  clear_midi_schedule = 19
+  schedule_param_change = 20
+  route_keyboard_input = 21
+  unroute_keyboard_input = 22
+  route_cc_to_param = 23
+  unroute_cc_to_param = 24
+  show_virtual_keyboard = 25
+  hide_virtual_keyboard = 26
+  route_virtual_keyboard = 27
+  unroute_virtual_keyboard = 28
+  toggle_recording = 29
+  toggle_monitoring = 30
+  load_audio_file = 31
+  control_audio_playback = 32
+  schedule_ordered_notes = 33
+  start_ordered_playback = 34
+  stop_ordered_playback = 35
+  clear_ordered_notes = 36
+  clear_midi_cc_schedule = 37
+  clear_param_schedule = 38
+  clear_all_plugins = 39
+  schedule_midi_events_bulk = 40
+  open_shared_transport = 41
+  set_notification_interval = 42
+  subscribe_audio_tap = 43
+  unsubscribe_audio_tap = 44
+  subscribe = 45
+  set_tempo_map = 46
+  schedule_midi_note_at_beat = 47
+  schedule_midi_cc_at_beat = 48
+  schedule_param_change_at_beat = 49
+  schedule_midi_events_bulk_at_beats = 50
+  seek = 51
+  set_loop = 52
+  stream_midi_event_file = 53
+  edit_schedule = 54
+  replace_event_range = 55
+  replace_param_change_range = 56
+  schedule_midi_curve = 57
+  define_midi_clip = 58
+  schedule_clip_instances = 59
+  clear_midi_events = 60
+  schedule_param_change_at_sample = 61
+  get_parameter_handles = 62
+  set_parameters_by_handle = 63
+  set_automation_lane = 64
+  add_automation_points = 65
+  start_automation_recording = 66
+  stop_automation_recording = 67
+  confirm_shared_transport = 68
+
+class recv_cmd: #notifications, server -> client
+  param_changed = 0
+  param_changes_end = 1
+  stop_playback = 2
+  midi_note_event = 3
+  midi_cc_event = 4
+  virtual_keyboard_note_event = 5
+  virtual_keyboard_cc_event = 6
+  midi_keyboard_routed = 7
+  virtual_keyboard_routed = 8
+  recording_started = 9
+  recording_stopped = 10
+  monitoring_changed = 11
+  audio_file_loaded = 12
+  audio_playback_started = 13
+  audio_playback_stopped = 14
+  ordered_note_triggered = 15
+  ordered_playback_started = 16
+  ordered_playback_stopped = 17
+  notification_batch = 18
+  audio_tap_closed = 19
+
+class NotificationStream: #Streams in a notification_batch. Bit i of a subscribe command's streams mask selects stream i
+  params = 0
+  midi_notes = 1
+  midi_ccs = 2
+  virtual_notes = 3
+  virtual_ccs = 4
+  count = 5
+
+class CurveShape: #How a curve gets from one breakpoint to the next: a straight line, an exponential rise (slow, then fast), or an S-curve
+  linear = 0
+  exponential = 1
+  s_curve = 2
+  count = 3
+
+class EventCategory: #Kinds of scheduled MIDI. Bit i of a clear_midi_events command's categories mask selects category i. Pressure is channel and polyphonic; other is sysex and system messages; clips are clip instances. Curves count as the messages they send
+  notes = 0
+  controllers = 1
+  program_changes = 2
+  pressure = 3
+  pitch_bend = 4
+  other = 5
+  clips = 6
+  count = 7
+
+command_failed_bit = 1 << 31 #Sent in place of a command's reply when its handler fails. Its frame carries the request ID with this bit set, then the error message
+
+scalars = {'u8': 'B', 'i32': 'i', 'u32': 'I', 'i64': 'q', 'u64': 'Q', 'f32': 'f', 'f64': 'd'}
+dtypes = {'u8': 'u1', 'i32': '<i4', 'u32': '<u4', 'i64': '<i8', 'u64': '<u8', 'f32': '<f4', 'f64': '<f8'}
+
+u32 = struct.Struct("<I")
+
+class Record:
+  """A packed record type: struct format for packing, numpy dtype for zero-copy arrays"""
+  def __init__(self, name, fields):
+    self.name = name
+    self.fields = fields
+    self.format = "".join(scalars[kind] for field, kind in fields)
+    self.struct = struct.Struct("<" + self.format)
+    self.size = self.struct.size
+    self.dtype = np.dtype([(field, dtypes[kind]) for field, kind in fields])
+
+  def tobytes(self, records):
+    """records as bytes: a numpy array or bytes-like object already in this layout, or a sequence of tuples,
+    converted in one go through a structured array rather than packed one record at a time"""
+    if hasattr(records, "tobytes"):
+      return records.tobytes()
+    if isinstance(records, (bytes, bytearray, memoryview)):
+      return bytes(records)
+    return np.array([tuple(record) for record in records], dtype=self.dtype).tobytes()
+
+class Message:
+  """Wire layout of one message body. Runs of scalar fields pack and unpack with one precompiled Struct;
+  the rest is handled field by field. unpack_from returns a namedtuple, with records as numpy views"""
+  def __init__(self, name, fields):
+    self.name = name
+    self.fields = fields
+    self.tuple = collections.namedtuple(name, [field[0] for field in fields])
+    index = {field[0]: i for i, field in enumerate(fields)}
+    self.steps = [] #(Struct, number of fields) or (kind, count field index or None)
+    run = ""
+    for field, kind, *count in fields:
+      if kind in scalars:
+        run += scalars[kind]
+        continue
+      if run:
+        self.steps.append((struct.Struct("<" + run), len(run)))
+        run = ""
+      self.steps.append((kind, index[count[0]] if count else None))
+    if run:
+      self.steps.append((struct.Struct("<" + run), len(run)))
+    self.struct = self.steps[0][0] if len(self.steps) == 1 and isinstance(self.steps[0][0], struct.Struct) else None
+
+  def pack(self, *values):
+    if self.struct:
+      return self.struct.pack(*values)
+    out = bytearray()
+    i = 0
+    for step, arg in self.steps:
+      if isinstance(step, struct.Struct):
+        out += step.pack(*values[i:i + arg])
+        i += arg
+        continue
+      value = values[i]
+      i += 1
+      if step == "str":
+        packstr(out, value)
+      elif step == "strs":
+        out += u32.pack(len(value))
+        for s in value:
+          packstr(out, s)
+      elif step.startswith("records:"):
+        record = records[step[8:]]
+        data = record.tobytes(value)
+        if arg is None:
+          out += u32.pack(len(data) // record.size)
+        out += data
+      elif step.startswith("list:"):
+        group = groups[step[5:]]
+        if arg is None:
+          out += u32.pack(len(value))
+        for item in value:
+          out += group.pack(*item)
+    return bytes(out)
+
+  def unpack_from(self, buffer, offset=0):
+    """Returns (namedtuple, offset after the message)"""
+    if self.struct:
+      return self.tuple._make(self.struct.unpack_from(buffer, offset)), offset + self.struct.size
+    values = []
+    for step, arg in self.steps:
+      if isinstance(step, struct.Struct):
+        values += step.unpack_from(buffer, offset)
+        offset += step.size
+        continue
+      if step == "str":
+        value, offset = unpackstr(buffer, offset)
+      elif step == "strs":
+        count, = u32.unpack_from(buffer, offset)
+        offset += 4
+        value = []
+        for x in range(count):
+          s, offset = unpackstr(buffer, offset)
+          value.append(s)
+      else:
+        if arg is None:
+          count, = u32.unpack_from(buffer, offset)
+          offset += 4
+        else:
+          count = values[arg]
+        if step.startswith("records:"):
+          record = records[step[8:]]
+          if offset + count * record.size > len(buffer):
+            raise struct.error(f"{self.name}: {count} {record.name} records overrun the frame")
+          value = np.frombuffer(buffer, record.dtype, count, offset) if count else np.empty(0, record.dtype)
+          offset += count * record.size
+        else:
+          group = groups[step[5:]]
+          value = []
+          for x in range(count):
+            item, offset = group.unpack_from(buffer, offset)
+            value.append(item)
+      values.append(value)
+    return self.tuple._make(values), offset
+
+def packstr(out, s):
+  data = s.encode("utf-8")
+  out += u32.pack(len(data))
+  out += data
+
+def unpackstr(buffer, offset):
+  n, = u32.unpack_from(buffer, offset)
+  offset += 4
+  if offset + n > len(buffer):
+    raise struct.error("string overruns the frame")
+  return bytes(buffer[offset:offset + n]).decode("utf-8"), offset + n
+
+records = {}
+MidiEventRecord = records['MidiEventRecord'] = Record('MidiEventRecord', [('key', 'i32'), ('status', 'u8'), ('data1', 'u8'), ('data2', 'u8'), ('sampleTime', 'i64')]) #One event in a schedule_midi_events_bulk upload. sampleTime is relative to the scheduler's current position
+OrderedNoteRecord = records['OrderedNoteRecord'] = Record('OrderedNoteRecord', [('orderNumber', 'u32'), ('noteNumber', 'u32'), ('velocity', 'u32'), ('channel', 'u32'), ('duration', 'u32')]) #One note in a schedule_ordered_notes upload
+ParamChangeRecord = records['ParamChangeRecord'] = Record('ParamChangeRecord', [('key', 'i32'), ('parameterIndex', 'i32'), ('value', 'f32'), ('atBlock', 'u64')]) #A parameter change in a notification_batch
+MidiNoteRecord = records['MidiNoteRecord'] = Record('MidiNoteRecord', [('noteNumber', 'u32'), ('velocity', 'u32'), ('channel', 'u32'), ('isNoteOn', 'u32'), ('samplePosition', 'u64')]) #A MIDI note from a keyboard in a notification_batch
+KeyRecord = records['KeyRecord'] = Record('KeyRecord', [('key', 'i32')]) #A plugin key in a subscribe command
+MidiBeatEventRecord = records['MidiBeatEventRecord'] = Record('MidiBeatEventRecord', [('key', 'i32'), ('status', 'u8'), ('data1', 'u8'), ('data2', 'u8'), ('beat', 'f64')]) #One event in a schedule_midi_events_bulk_at_beats upload. beat counts quarter notes from the start of the timeline
+TempoPointRecord = records['TempoPointRecord'] = Record('TempoPointRecord', [('beat', 'f64'), ('bpm', 'f64'), ('ramp', 'u32')]) #A tempo in a set_tempo_map command. ramp 1 ramps linearly to the next point's bpm
+TimeSignatureRecord = records['TimeSignatureRecord'] = Record('TimeSignatureRecord', [('bar', 'i32'), ('numerator', 'u32'), ('denominator', 'u32')]) #A time signature in a set_tempo_map command, from bar (counting from 0) on
+MidiCCRecord = records['MidiCCRecord'] = Record('MidiCCRecord', [('controller', 'u32'), ('value', 'u32'), ('channel', 'u32'), ('atBlock', 'u64')]) #A MIDI CC from a keyboard in a notification_batch
+IdentifiedEventRecord = records['IdentifiedEventRecord'] = Record('IdentifiedEventRecord', [('id', 'u64'), ('key', 'i32'), ('status', 'u8'), ('data1', 'u8'), ('data2', 'u8'), ('sampleTime', 'i64'), ('duration', 'i64')]) #A MIDI event with a client-chosen ID in an edit_schedule command. sampleTime is absolute, from the start of the timeline. A note on with a duration gets its note off too, under the same ID
+IdentifiedParamChangeRecord = records['IdentifiedParamChangeRecord'] = Record('IdentifiedParamChangeRecord', [('id', 'u64'), ('key', 'i32'), ('parameterIndex', 'i32'), ('value', 'f32'), ('atBlock', 'u64')]) #A parameter change with a client-chosen ID in an edit_schedule command
+IdRecord = records['IdRecord'] = Record('IdRecord', [('id', 'u64')]) #An event or parameter change to delete, by the ID it was scheduled with
+EventMoveRecord = records['EventMoveRecord'] = Record('EventMoveRecord', [('id', 'u64'), ('sampleTime', 'i64')]) #Moves the event with this ID to start at sampleTime; a note keeps its duration
+CurvePointRecord = records['CurvePointRecord'] = Record('CurvePointRecord', [('sampleTime', 'i64'), ('value', 'f32'), ('shape', 'u8')]) #A breakpoint in a schedule_midi_curve command. sampleTime is relative to the scheduler's current position; value is in the message's own range (0-127, or 0-16383 for pitch bend); shape is a CurveShape, for the segment to the next breakpoint
+ParamMoveRecord = records['ParamMoveRecord'] = Record('ParamMoveRecord', [('id', 'u64'), ('atBlock', 'u64')]) #Moves the parameter change with this ID to atBlock
+ClipEventRecord = records['ClipEventRecord'] = Record('ClipEventRecord', [('status', 'u8'), ('data1', 'u8'), ('data2', 'u8'), ('sampleTime', 'i64')]) #One event of a clip in a define_midi_clip command. sampleTime is from the start of the clip
+ClipInstanceRecord = records['ClipInstanceRecord'] = Record('ClipInstanceRecord', [('clipId', 'u32'), ('sampleTime', 'i64'), ('transpose', 'i32'), ('velocityScale', 'f32')]) #A clip played at sampleTime, relative to the scheduler's current position, in a schedule_clip_instances command. Its notes are moved by transpose semitones and its note on velocities multiplied by velocityScale
+ParameterHandleValueRecord = records['ParameterHandleValueRecord'] = Record('ParameterHandleValueRecord', [('handle', 'u32'), ('value', 'f32')]) #A value for the parameter with a handle from get_parameter_handles, in a set_parameters_by_handle command
+AutomationPointRecord = records['AutomationPointRecord'] = Record('AutomationPointRecord', [('sampleTime', 'i64'), ('value', 'f32'), ('shape', 'u8')]) #A breakpoint in a parameter's automation lane. sampleTime counts from the start of playback; value is the parameter's normalised 0-1 value; shape is a CurveShape, for the segment to the next breakpoint
+RecordedAutomationPointRecord = records['RecordedAutomationPointRecord'] = Record('RecordedAutomationPointRecord', [('key', 'i32'), ('parameterIndex', 'i32'), ('sampleTime', 'i64'), ('value', 'f32')]) #A breakpoint of a recorded parameter in a stop_automation_recording reply, sorted by key, parameterIndex then sampleTime. Each parameter's points, joined by straight lines, are a lane for set_automation_lane
+
+groups = {}
+PluginDescription = groups['PluginDescription'] = Message('PluginDescription', [('isInstrument', 'u32'), ('uid', 'u32'), ('numInputChannels', 'u32'), ('numOutputChannels', 'u32'), ('name', 'str'), ('descriptiveName', 'str'), ('pluginFormatName', 'str'), ('category', 'str'), ('manufacturerName', 'str'), ('version', 'str'), ('fileOrIdentifier', 'str'), ('lastFileModTime', 'str'), ('path', 'str')])
+ParamInfo = groups['ParamInfo'] = Message('ParamInfo', [('originalIndex', 'u32'), ('name', 'str'), ('minValue', 'f32'), ('maxValue', 'f32'), ('interval', 'f32'), ('defaultValue', 'f32'), ('skewFactor', 'f32'), ('value', 'f32'), ('numSteps', 'u32'), ('isDiscrete', 'u32'), ('isBoolean', 'u32'), ('isOrientationInverted', 'u32'), ('isAutomatable', 'u32'), ('isMetaParameter', 'u32')])
+BusInfo = groups['BusInfo'] = Message('BusInfo', [('numChannels', 'u32'), ('channelTypes', 'strs'), ('isEnabled', 'u32'), ('mainBusLayout', 'str')])
+
+load_plugin_args = Message('load_plugin_args', [('path', 'str'), ('key', 'u32')])
+load_plugin_reply = Message('load_plugin_reply', [('success', 'u32'), ('name', 'str'), ('uid', 'u32'), ('errmsg', 'str')])
+load_plugin_by_uid_args = Message('load_plugin_by_uid_args', [('uid', 'u32'), ('key', 'u32')])
+load_plugin_by_uid_reply = Message('load_plugin_by_uid_reply', [('success', 'u32'), ('name', 'str'), ('errmsg', 'str')])
+scan_plugins_args = Message('scan_plugins_args', [('directories', 'strs'), ('badPaths', 'strs')])
+scan_plugins_reply = Message('scan_plugins_reply', [('numFound', 'u32')])
+list_plugins_args = Message('list_plugins_args', [])
+list_plugins_reply = Message('list_plugins_reply', [('plugins', 'list:PluginDescription')])
+get_plugin_info_args = Message('get_plugin_info_args', [('index', 'u32')])
+get_plugin_info_reply = Message('get_plugin_info_reply', [('isInstrument', 'u32'), ('uid', 'u32'), ('numInputChannels', 'u32'), ('numOutputChannels', 'u32'), ('name', 'str'), ('descriptiveName', 'str'), ('pluginFormatName', 'str'), ('category', 'str'), ('manufacturerName', 'str'), ('version', 'str'), ('fileOrIdentifier', 'str'), ('lastFileModTime', 'str'), ('path', 'str')])
+show_plugin_ui_args = Message('show_plugin_ui_args', [('key', 'u32')])
+show_plugin_ui_reply = Message('show_plugin_ui_reply', [('success', 'u32'), ('errmsg', 'str')])
+hide_plugin_ui_args = Message('hide_plugin_ui_args', [('key', 'u32')])
+hide_plugin_ui_reply = Message('hide_plugin_ui_reply', [('success', 'u32')])
+set_parameter_args = Message('set_parameter_args', [('key', 'u32'), ('parameterIndex', 'u32'), ('value', 'f32')])
+set_parameter_reply = Message('set_parameter_reply', [('success', 'u32'), ('errmsg', 'str')])
+get_parameter_args = Message('get_parameter_args', [('key', 'u32'), ('parameterIndex', 'u32')])
+get_parameter_reply = Message('get_parameter_reply', [('success', 'u32'), ('value', 'f32'), ('errmsg', 'str')])
+connect_audio_args = Message('connect_audio_args', [('sourceKey', 'u32'), ('sourceChannel', 'u32'), ('destKey', 'u32'), ('destChannel', 'u32')])
+connect_audio_reply = Message('connect_audio_reply', [('success', 'u32')])
+connect_midi_args = Message('connect_midi_args', [('sourceKey', 'u32'), ('destKey', 'u32')])
+connect_midi_reply = Message('connect_midi_reply', [('success', 'u32')])
+start_playback_args = Message('start_playback_args', [('endBlock', 'u64'), ('toFile', 'u32'), ('fileName', 'str')])
+start_playback_reply = Message('start_playback_reply', [('started', 'u32')])
+cmd_shutdown_args = Message('cmd_shutdown_args', [])
+remove_plugin_args = Message('remove_plugin_args', [('key', 'u32')])
+list_bad_paths_args = Message('list_bad_paths_args', [])
+list_bad_paths_reply = Message('list_bad_paths_reply', [('paths', 'strs')])
+get_params_info_args = Message('get_params_info_args', [('key', 'u32')])
+get_params_info_reply = Message('get_params_info_reply', [('success', 'u32'), ('numParams', 'u32'), ('errmsg', 'str'), ('params', 'list:ParamInfo', 'numParams')])
+get_channels_info_args = Message('get_channels_info_args', [('key', 'u32')])
+get_channels_info_reply = Message('get_channels_info_reply', [('success', 'u32'), ('acceptsMidi', 'u32'), ('producesMidi', 'u32'), ('inputBuses', 'list:BusInfo'), ('outputBuses', 'list:BusInfo'), ('errmsg', 'str')])
+schedule_midi_note_args = Message('schedule_midi_note_args', [('key', 'u32'), ('note', 'u32'), ('velocity', 'f32'), ('startTime', 'f64'), ('duration', 'f64'), ('channel', 'u32')])
+schedule_midi_cc_args = Message('schedule_midi_cc_args', [('key', 'u32'), ('controller', 'u32'), ('value', 'u32'), ('time', 'f64'), ('channel', 'u32')])
+clear_midi_schedule_args = Message('clear_midi_schedule_args', [])
+schedule_param_change_args = Message('schedule_param_change_args', [('key', 'u32'), ('parameterIndex', 'u32'), ('value', 'f32'), ('atBlock', 'u64')])
+route_keyboard_input_args = Message('route_keyboard_input_args', [('key', 'u32'), ('useVelocity', 'u32'), ('fixedVelocity', 'f32')])
+route_keyboard_input_reply = Message('route_keyboard_input_reply', [('success', 'u32')])
+unroute_keyboard_input_args = Message('unroute_keyboard_input_args', [])
+unroute_keyboard_input_reply = Message('unroute_keyboard_input_reply', [('success', 'u32')])
+route_cc_to_param_args = Message('route_cc_to_param_args', [('key', 'u32'), ('parameterIndex', 'u32'), ('ccController', 'u32'), ('midiChannel', 'i32')])
+route_cc_to_param_reply = Message('route_cc_to_param_reply', [('success', 'u32')])
+unroute_cc_to_param_args = Message('unroute_cc_to_param_args', [('key', 'u32'), ('parameterIndex', 'u32'), ('ccController', 'u32')])
+unroute_cc_to_param_reply = Message('unroute_cc_to_param_reply', [('success', 'u32')])
+show_virtual_keyboard_args = Message('show_virtual_keyboard_args', [])
+show_virtual_keyboard_reply = Message('show_virtual_keyboard_reply', [('success', 'u32')])
+hide_virtual_keyboard_args = Message('hide_virtual_keyboard_args', [])
+hide_virtual_keyboard_reply = Message('hide_virtual_keyboard_reply', [('success', 'u32')])
+route_virtual_keyboard_args = Message('route_virtual_keyboard_args', [('key', 'u32'), ('useVelocity', 'u32'), ('fixedVelocity', 'f32')])
+route_virtual_keyboard_reply = Message('route_virtual_keyboard_reply', [('success', 'u32')])
+unroute_virtual_keyboard_args = Message('unroute_virtual_keyboard_args', [])
+unroute_virtual_keyboard_reply = Message('unroute_virtual_keyboard_reply', [('success', 'u32')])
+toggle_recording_args = Message('toggle_recording_args', [])
+toggle_recording_reply = Message('toggle_recording_reply', [('recording', 'u32')])
+toggle_monitoring_args = Message('toggle_monitoring_args', [])
+toggle_monitoring_reply = Message('toggle_monitoring_reply', [('monitoring', 'u32')])
+load_audio_file_args = Message('load_audio_file_args', [('fileName', 'str')])
+load_audio_file_reply = Message('load_audio_file_reply', [('playerId', 'i32')])
+control_audio_playback_args = Message('control_audio_playback_args', [('playerId', 'u32'), ('action', 'u8'), ('startSample', 'u64'), ('fileStartPosition', 'u64')])
+control_audio_playback_reply = Message('control_audio_playback_reply', [('success', 'u32')])
+schedule_ordered_notes_args = Message('schedule_ordered_notes_args', [('notes', 'records:OrderedNoteRecord')])
+schedule_ordered_notes_reply = Message('schedule_ordered_notes_reply', [('count', 'u32')])
+start_ordered_playback_args = Message('start_ordered_playback_args', [('useKeyboardVelocity', 'u32'), ('useKeyboardDuration', 'u32')])
+start_ordered_playback_reply = Message('start_ordered_playback_reply', [('success', 'u32')])
+stop_ordered_playback_args = Message('stop_ordered_playback_args', [])
+stop_ordered_playback_reply = Message('stop_ordered_playback_reply', [('success', 'u32')])
+clear_ordered_notes_args = Message('clear_ordered_notes_args', [])
+clear_ordered_notes_reply = Message('clear_ordered_notes_reply', [('success', 'u32')])
+clear_midi_cc_schedule_args = Message('clear_midi_cc_schedule_args', [])
+clear_param_schedule_args = Message('clear_param_schedule_args', [])
+clear_all_plugins_args = Message('clear_all_plugins_args', [])
+schedule_midi_events_bulk_args = Message('schedule_midi_events_bulk_args', [('events', 'records:MidiEventRecord')])
+open_shared_transport_args = Message('open_shared_transport_args', [('ringCapacity', 'u32'), ('clientPid', 'i64')])
+open_shared_transport_reply = Message('open_shared_transport_reply', [('ok', 'i32'), ('nameOrError', 'str'), ('ringCapacity', 'u32')])
+set_notification_interval_args = Message('set_notification_interval_args', [('ms', 'u32')])
+subscribe_audio_tap_args = Message('subscribe_audio_tap_args', [('key', 'u32'), ('bus', 'u32'), ('ringFrames', 'u32')])
+subscribe_audio_tap_reply = Message('subscribe_audio_tap_reply', [('tapId', 'i32'), ('name', 'str'), ('channels', 'u32'), ('capacity', 'u32'), ('errmsg', 'str')])
+unsubscribe_audio_tap_args = Message('unsubscribe_audio_tap_args', [('tapId', 'u32')])
+subscribe_args = Message('subscribe_args', [('streams', 'u32'), ('keys', 'records:KeyRecord'), ('paramRate', 'f32'), ('noteRate', 'f32'), ('ccRate', 'f32'), ('virtualNoteRate', 'f32'), ('virtualCCRate', 'f32')])
+set_tempo_map_args = Message('set_tempo_map_args', [('tempos', 'records:TempoPointRecord'), ('signatures', 'records:TimeSignatureRecord')])
+set_tempo_map_reply = Message('set_tempo_map_reply', [('success', 'u32'), ('errmsg', 'str')])
+schedule_midi_note_at_beat_args = Message('schedule_midi_note_at_beat_args', [('key', 'u32'), ('note', 'u32'), ('velocity', 'f32'), ('startBeat', 'f64'), ('durationBeats', 'f64'), ('channel', 'u32')])
+schedule_midi_cc_at_beat_args = Message('schedule_midi_cc_at_beat_args', [('key', 'u32'), ('controller', 'u32'), ('value', 'u32'), ('beat', 'f64'), ('channel', 'u32')])
+schedule_param_change_at_beat_args = Message('schedule_param_change_at_beat_args', [('key', 'u32'), ('parameterIndex', 'u32'), ('value', 'f32'), ('beat', 'f64')])
+schedule_midi_events_bulk_at_beats_args = Message('schedule_midi_events_bulk_at_beats_args', [('events', 'records:MidiBeatEventRecord')])
+seek_args = Message('seek_args', [('sample', 'i64')])
+set_loop_args = Message('set_loop_args', [('start', 'i64'), ('end', 'i64')])
+set_loop_reply = Message('set_loop_reply', [('success', 'u32'), ('errmsg', 'str')])
+stream_midi_event_file_args = Message('stream_midi_event_file_args', [('path', 'str')])
+stream_midi_event_file_reply = Message('stream_midi_event_file_reply', [('success', 'u32'), ('errmsg', 'str')])
+edit_schedule_args = Message('edit_schedule_args', [('deletes', 'records:IdRecord'), ('moves', 'records:EventMoveRecord'), ('events', 'records:IdentifiedEventRecord'), ('paramDeletes', 'records:IdRecord'), ('paramMoves', 'records:ParamMoveRecord'), ('paramChanges', 'records:IdentifiedParamChangeRecord')])
+replace_event_range_args = Message('replace_event_range_args', [('key', 'i32'), ('start', 'i64'), ('end', 'i64'), ('events', 'records:IdentifiedEventRecord')])
+replace_param_change_range_args = Message('replace_param_change_range_args', [('key', 'i32'), ('firstBlock', 'u64'), ('endBlock', 'u64'), ('changes', 'records:IdentifiedParamChangeRecord')])
+schedule_midi_curve_args = Message('schedule_midi_curve_args', [('key', 'i32'), ('status', 'u8'), ('controller', 'u8'), ('resolution', 'u32'), ('points', 'records:CurvePointRecord')])
+define_midi_clip_args = Message('define_midi_clip_args', [('clipId', 'u32'), ('events', 'records:ClipEventRecord')])
+schedule_clip_instances_args = Message('schedule_clip_instances_args', [('key', 'i32'), ('instances', 'records:ClipInstanceRecord')])
+clear_midi_events_args = Message('clear_midi_events_args', [('key', 'i32'), ('categories', 'u32'), ('startSample', 'i64'), ('endSample', 'i64')])
+schedule_param_change_at_sample_args = Message('schedule_param_change_at_sample_args', [('key', 'u32'), ('parameterIndex', 'u32'), ('value', 'f32'), ('sample', 'u64')])
+get_parameter_handles_args = Message('get_parameter_handles_args', [('key', 'i32')])
+get_parameter_handles_reply = Message('get_parameter_handles_reply', [('success', 'u32'), ('firstHandle', 'u32'), ('numParams', 'u32')])
+set_parameters_by_handle_args = Message('set_parameters_by_handle_args', [('changes', 'records:ParameterHandleValueRecord')])
+set_automation_lane_args = Message('set_automation_lane_args', [('key', 'i32'), ('parameterIndex', 'i32'), ('resolution', 'u32'), ('points', 'records:AutomationPointRecord')])
+add_automation_points_args = Message('add_automation_points_args', [('key', 'i32'), ('parameterIndex', 'i32'), ('points', 'records:AutomationPointRecord')])
+start_automation_recording_args = Message('start_automation_recording_args', [('capacity', 'u32')])
+stop_automation_recording_args = Message('stop_automation_recording_args', [('tolerance', 'f32')])
+stop_automation_recording_reply = Message('stop_automation_recording_reply', [('recorded', 'u32'), ('dropped', 'u32'), ('points', 'records:RecordedAutomationPointRecord')])
+confirm_shared_transport_args = Message('confirm_shared_transport_args', [('attached', 'u32'), ('error', 'str')])
+confirm_shared_transport_reply = Message('confirm_shared_transport_reply', [('switched', 'u32')])
+command_failed_reply = Message('command_failed_reply', [('message', 'str')])
+param_changed_notification = Message('param_changed_notification', [('key', 'u32'), ('parameterIndex', 'u32'), ('value', 'f32'), ('atBlock', 'u64')])
+param_changes_end_notification = Message('param_changes_end_notification', [])
+stop_playback_notification = Message('stop_playback_notification', [])
+midi_note_event_notification = Message('midi_note_event_notification', [('noteNumber', 'u32'), ('velocity', 'u32'), ('channel', 'u32'), ('isNoteOn', 'u32'), ('samplePosition', 'u64')])
+midi_cc_event_notification = Message('midi_cc_event_notification', [('controller', 'u32'), ('value', 'u32'), ('channel', 'u32'), ('atBlock', 'u64')])
+virtual_keyboard_note_event_notification = Message('virtual_keyboard_note_event_notification', [('noteNumber', 'u32'), ('velocity', 'u32'), ('channel', 'u32'), ('isNoteOn', 'u32'), ('samplePosition', 'u64')])
+virtual_keyboard_cc_event_notification = Message('virtual_keyboard_cc_event_notification', [('controller', 'u32'), ('value', 'u32'), ('channel', 'u32'), ('atBlock', 'u64')])
+midi_keyboard_routed_notification = Message('midi_keyboard_routed_notification', [('key', 'i32'), ('samplePosition', 'i64')])
+virtual_keyboard_routed_notification = Message('virtual_keyboard_routed_notification', [('key', 'i32'), ('samplePosition', 'i64')])
+recording_started_notification = Message('recording_started_notification', [('fileName', 'str'), ('samplePosition', 'i64')])
+recording_stopped_notification = Message('recording_stopped_notification', [('fileName', 'str'), ('samplePosition', 'i64')])
+monitoring_changed_notification = Message('monitoring_changed_notification', [('monitoring', 'u8'), ('samplePosition', 'i64')])
+audio_file_loaded_notification = Message('audio_file_loaded_notification', [('fileName', 'str'), ('playerId', 'i32')])
+audio_playback_started_notification = Message('audio_playback_started_notification', [('playerId', 'i32'), ('samplePosition', 'i64')])
+audio_playback_stopped_notification = Message('audio_playback_stopped_notification', [('playerId', 'i32'), ('samplePosition', 'i64')])
+ordered_note_triggered_notification = Message('ordered_note_triggered_notification', [('orderNumber', 'i32'), ('orderIndex', 'i32'), ('numNotes', 'i32')])
+ordered_playback_started_notification = Message('ordered_playback_started_notification', [('samplePosition', 'i64')])
+ordered_playback_stopped_notification = Message('ordered_playback_stopped_notification', [('samplePosition', 'i64')])
+notification_batch_notification = Message('notification_batch_notification', [('params', 'records:ParamChangeRecord'), ('notes', 'records:MidiNoteRecord'), ('ccs', 'records:MidiCCRecord'), ('virtualNotes', 'records:MidiNoteRecord'), ('virtualCCs', 'records:MidiCCRecord')])
+audio_tap_closed_notification = Message('audio_tap_closed_notification', [('tapId', 'i32')])
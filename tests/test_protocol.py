@@ -0,0 +1,50 @@
+#Round trips between the byte layouts the server writes and the generated juce_protocol decoders.
+#Run with python -m unittest from the repository root, or through ctest
+import os
+import struct
+import sys
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import juce_protocol as protocol
+
+def packstr(s):
+  data = s.encode("utf-8")
+  return struct.pack("<I", len(data)) + data
+
+class ProtocolRoundTrip(unittest.TestCase):
+  def test_get_params_info(self):
+    #Fields in the order the get_params_info handler passes them to WRITEALLC
+    params = [
+      (0, "Cutoff", 20.0, 20000.0, 0.0, 1000.0, 0.25, 440.0, 0, 0, 0, 0, 1, 0),
+      (3, "Bypass", 0.0, 1.0, 1.0, 0.0, 1.0, 1.0, 2, 1, 1, 0, 1, 0),
+    ]
+    data = struct.pack("<II", 1, len(params)) + packstr("")
+    for p in params:
+      data += struct.pack("<I", p[0]) + packstr(p[1]) + struct.pack("<6f", *p[2:8]) + struct.pack("<6I", *p[8:])
+    reply, offset = protocol.get_params_info_reply.unpack_from(data)
+    self.assertEqual(offset, len(data))
+    self.assertEqual((reply.success, reply.numParams, reply.errmsg), (1, 2, ""))
+    for decoded, p in zip(reply.params, params):
+      self.assertEqual(decoded.originalIndex, p[0])
+      self.assertEqual(decoded.name, p[1])
+      self.assertEqual((decoded.minValue, decoded.maxValue, decoded.interval), p[2:5])
+      self.assertEqual(decoded.defaultValue, p[5])
+      self.assertEqual(decoded.skewFactor, p[6])
+      self.assertEqual(decoded.value, p[7])
+      self.assertEqual((decoded.numSteps, decoded.isDiscrete, decoded.isBoolean, decoded.isOrientationInverted,
+        decoded.isAutomatable, decoded.isMetaParameter), p[8:])
+    self.assertEqual(protocol.get_params_info_reply.pack(*reply), data)
+
+  def test_command_failed(self):
+    #The frame replyCommandFailed writes: the request ID with command_failed_bit set, then the message
+    data = struct.pack("<I", 7 | protocol.command_failed_bit) + packstr("no plugin loaded with key 3")
+    requestId, = struct.unpack_from("<I", data)
+    self.assertTrue(requestId & protocol.command_failed_bit)
+    self.assertEqual(requestId & ~protocol.command_failed_bit, 7)
+    reply, offset = protocol.command_failed_reply.unpack_from(data, 4)
+    self.assertEqual(offset, len(data))
+    self.assertEqual(reply.message, "no plugin loaded with key 3")
+
+if __name__ == "__main__":
+  unittest.main()